@@ -293,7 +293,7 @@ namespace Falcor
         UNSUPPORTED_IN_D3D11("Texture::uploadSubresourceData()");
     }
 
-    void Texture::compress2DTexture()
+    void Texture::compress2DTexture(ResourceFormat format)
     {
         UNSUPPORTED_IN_D3D11("Texture::compress2DTexture");
     }
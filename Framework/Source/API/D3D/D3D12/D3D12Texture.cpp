@@ -35,6 +35,7 @@
 #include "Graphics/FullScreenPass.h"
 #include "Graphics/GraphicsState.h"
 #include "D3D12Resource.h"
+#include "Utils/BlockCompressor.h"
 
 namespace Falcor
 {
@@ -55,6 +56,7 @@ namespace Falcor
 
         static std::unique_ptr<GenMipsData> spGenMips;
         Fbo::SharedPtr pGenMipsFbo;
+        bool isEvicted = false;
 
     private:
         static uint64_t sObjCount;
@@ -115,13 +117,24 @@ namespace Falcor
 
     uint64_t Texture::makeResident(const Sampler* pSampler) const
     {
-        UNSUPPORTED_IN_D3D12("Texture::makeResident()");
+        // D3D12 residency is per-resource, so the sampler is ignored. There's no bindless handle to return
+        if(mpApiData->isEvicted)
+        {
+            ID3D12Pageable* pPageable = mApiHandle;
+            d3d_call(gpDevice->getApiHandle()->MakeResident(1, &pPageable));
+            mpApiData->isEvicted = false;
+        }
         return 0;
     }
 
     void Texture::evict(const Sampler* pSampler) const
     {
-        UNSUPPORTED_IN_D3D12("Texture::evict()");
+        if(mpApiData->isEvicted == false)
+        {
+            ID3D12Pageable* pPageable = mApiHandle;
+            d3d_call(gpDevice->getApiHandle()->Evict(1, &pPageable));
+            mpApiData->isEvicted = true;
+        }
     }
 
     void createTextureCommon(const Texture* pTexture, Texture::ApiHandle& apiHandle, const void* pData, D3D12_RESOURCE_DIMENSION dim, bool autoGenMips, Texture::BindFlags bindFlags)
@@ -250,9 +263,96 @@ namespace Falcor
         return 0;
     }
 
-    void Texture::compress2DTexture()
+    void Texture::compress2DTexture(ResourceFormat format)
     {
-        UNSUPPORTED_IN_D3D12("Texture::compress2DTexture");
+        if(mType != Type::Texture2D)
+        {
+            logError("Texture::compress2DTexture() only supports 2D texture compression\n");
+            return;
+        }
+
+        if(mArraySize > 1)
+        {
+            logError("Texture::compress2DTexture() only supports 2D texture compression with a single array slice\n");
+            return;
+        }
+
+        if(isCompressedFormat(mFormat))
+        {
+            // Already compressed
+            return;
+        }
+
+        if(BlockCompressor::isSupportedSourceFormat(mFormat) == false)
+        {
+            logError("Texture::compress2DTexture() - can't compress textures with format " + to_string(mFormat) + "\n");
+            return;
+        }
+
+        // Select format
+        ResourceFormat compressedFormat = format;
+        if(compressedFormat == ResourceFormat::Unknown)
+        {
+            compressedFormat = BlockCompressor::getDefaultCompressedFormat(mFormat);
+        }
+        else if(isSrgbFormat(mFormat))
+        {
+            compressedFormat = linearToSrgbFormat(compressedFormat);
+        }
+
+        if(BlockCompressor::isSupportedCompressedFormat(compressedFormat) == false)
+        {
+            logError("Texture::compress2DTexture() - unsupported compressed format " + to_string(compressedFormat) + "\n");
+            return;
+        }
+
+        // The compressed resource is created with dimensions aligned to the block size, so its mip levels can have more blocks than the source mip levels cover
+        const uint32_t alignedWidth = align_to(4, mWidth);
+        const uint32_t alignedHeight = align_to(4, mHeight);
+        const uint32_t bytesPerPixel = getFormatBytesPerBlock(mFormat);
+        std::vector<uint8_t> compressedData;
+        std::vector<uint8_t> paddedMip;
+
+        // The readback copies from the resource, so it must be resident
+        makeResident(nullptr);
+
+        for(uint32_t mip = 0; mip < mMipLevels; mip++)
+        {
+            std::vector<uint8> mipData = gpDevice->getRenderContext()->readTextureSubresource(this, getSubresourceIndex(0, mip));
+            uint32_t width = getWidth(mip);
+            uint32_t height = getHeight(mip);
+            const uint8_t* pSrc = mipData.data();
+
+            uint32_t dstWidth = std::max(1u, alignedWidth >> mip);
+            uint32_t dstHeight = std::max(1u, alignedHeight >> mip);
+            if(dstWidth != width || dstHeight != height)
+            {
+                // Pad the mip level by repeating the last row and column
+                paddedMip.resize(dstWidth * dstHeight * bytesPerPixel);
+                for(uint32_t y = 0; y < dstHeight; y++)
+                {
+                    const uint8_t* pSrcRow = pSrc + std::min(y, height - 1) * width * bytesPerPixel;
+                    uint8_t* pDstRow = paddedMip.data() + y * dstWidth * bytesPerPixel;
+                    for(uint32_t x = 0; x < dstWidth; x++)
+                    {
+                        memcpy(pDstRow + x * bytesPerPixel, pSrcRow + std::min(x, width - 1) * bytesPerPixel, bytesPerPixel);
+                    }
+                }
+                pSrc = paddedMip.data();
+            }
+
+            size_t offset = compressedData.size();
+            compressedData.resize(offset + BlockCompressor::getCompressedSize(dstWidth, dstHeight, compressedFormat));
+            BlockCompressor::compress(pSrc, dstWidth, dstHeight, dstWidth * bytesPerPixel, mFormat, compressedFormat, BlockCompressor::Preset::Normal, compressedData.data() + offset);
+        }
+
+        // Replace the resource. Block-compressed formats can't be bound as render-targets or UAVs
+        gpDevice->releaseResource(mApiHandle);
+        invalidateViews();
+        mFormat = compressedFormat;
+        mBindFlags &= (BindFlags)~(uint32_t)(BindFlags::RenderTarget | BindFlags::UnorderedAccess);
+        mState = Resource::State::Common;
+        createTextureCommon(this, mApiHandle, compressedData.data(), D3D12_RESOURCE_DIMENSION_TEXTURE2D, false, mBindFlags);
     }
 
     void Texture::generateMips() const
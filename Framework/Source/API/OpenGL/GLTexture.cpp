@@ -588,7 +588,7 @@ namespace Falcor
 
     }
 
-    void Texture::compress2DTexture()
+    void Texture::compress2DTexture(ResourceFormat format)
     {
         if(mType != Type::Texture2D)
         {
@@ -622,27 +622,34 @@ namespace Falcor
         readSubresourceData(data.data(), requiredSize, 0, 0);
 
         // Select format
-        ResourceFormat compressedFormat = ResourceFormat::Unknown;
+        ResourceFormat compressedFormat = format;
         bool isSrgb = isSrgbFormat(mFormat);
 
-        switch(getFormatChannelCount(mFormat))
-        {
-        case 1:
-            assert(isSrgb == false);
-            compressedFormat = ResourceFormat::BC4Unorm;
-            break;
-        case 2:
-            assert(isSrgb == false);
-            compressedFormat = ResourceFormat::BC5Unorm;
-            break;
-        case 3:
-            compressedFormat = isSrgb ? ResourceFormat::BC1UnormSrgb : ResourceFormat::BC1Unorm;
-            break;
-        case 4:
-            compressedFormat = isSrgb ? ResourceFormat::BC3UnormSrgb : ResourceFormat::BC3Unorm;
-            break;
-        default:
-            should_not_get_here();
+        if(compressedFormat == ResourceFormat::Unknown)
+        {
+            switch(getFormatChannelCount(mFormat))
+            {
+            case 1:
+                assert(isSrgb == false);
+                compressedFormat = ResourceFormat::BC4Unorm;
+                break;
+            case 2:
+                assert(isSrgb == false);
+                compressedFormat = ResourceFormat::BC5Unorm;
+                break;
+            case 3:
+                compressedFormat = isSrgb ? ResourceFormat::BC1UnormSrgb : ResourceFormat::BC1Unorm;
+                break;
+            case 4:
+                compressedFormat = isSrgb ? ResourceFormat::BC3UnormSrgb : ResourceFormat::BC3Unorm;
+                break;
+            default:
+                should_not_get_here();
+            }
+        }
+        else if(isSrgb)
+        {
+            compressedFormat = linearToSrgbFormat(compressedFormat);
         }
 
         // Delete the old resource
@@ -29,6 +29,7 @@
 #include "Framework.h"
 #include "ProgramReflection.h"
 #include "Utils/StringUtils.h"
+#include "Utils/BinaryFileStream.h"
 
 using namespace slang;
 
@@ -217,6 +218,160 @@ namespace Falcor
         if(outX) *outZ = mThreadGroupSizeZ;
     }
 
+    /************************************************************************/
+    /*  Serialization                                                       */
+    /************************************************************************/
+    static void writeString(BinaryFileStream& stream, const std::string& str)
+    {
+        stream << (uint32_t)str.size();
+        stream.write(str.data(), str.size());
+    }
+
+    static std::string readString(BinaryFileStream& stream)
+    {
+        uint32_t length = 0;
+        stream >> length;
+        if(stream.isFail() || length > stream.getRemainingStreamSize())
+        {
+            return std::string();
+        }
+        std::string str(length, '\0');
+        stream.read(&str[0], length);
+        return str;
+    }
+
+    static void writeVariableMap(BinaryFileStream& stream, const ProgramReflection::VariableMap& varMap)
+    {
+        stream << (uint32_t)varMap.size();
+        for(const auto& var : varMap)
+        {
+            writeString(stream, var.first);
+            stream << (uint64_t)var.second.location << var.second.arraySize << var.second.arrayStride << var.second.isRowMajor << var.second.type;
+        }
+    }
+
+    static void readVariableMap(BinaryFileStream& stream, ProgramReflection::VariableMap& varMap)
+    {
+        uint32_t count = 0;
+        stream >> count;
+        for(uint32_t i = 0; i < count && stream.isFail() == false; i++)
+        {
+            std::string name = readString(stream);
+            ProgramReflection::Variable var;
+            uint64_t location;
+            stream >> location >> var.arraySize >> var.arrayStride >> var.isRowMajor >> var.type;
+            var.location = (size_t)location;
+            varMap[name] = var;
+        }
+    }
+
+    static void writeResourceMap(BinaryFileStream& stream, const ProgramReflection::ResourceMap& resourceMap)
+    {
+        stream << (uint32_t)resourceMap.size();
+        for(const auto& res : resourceMap)
+        {
+            writeString(stream, res.first);
+            const ProgramReflection::Resource& desc = res.second;
+            stream << desc.shaderAccess << desc.type << desc.dims << desc.retType << desc.regIndex << desc.arraySize << desc.shaderMask << desc.registerSpace;
+        }
+    }
+
+    static void readResourceMap(BinaryFileStream& stream, ProgramReflection::ResourceMap& resourceMap)
+    {
+        uint32_t count = 0;
+        stream >> count;
+        for(uint32_t i = 0; i < count && stream.isFail() == false; i++)
+        {
+            std::string name = readString(stream);
+            ProgramReflection::Resource desc;
+            stream >> desc.shaderAccess >> desc.type >> desc.dims >> desc.retType >> desc.regIndex >> desc.arraySize >> desc.shaderMask >> desc.registerSpace;
+            resourceMap[name] = desc;
+        }
+    }
+
+    void ProgramReflection::serialize(BinaryFileStream& stream) const
+    {
+        for(const auto& bufferData : mBuffers)
+        {
+            stream << (uint32_t)bufferData.descMap.size();
+            for(const auto& desc : bufferData.descMap)
+            {
+                const BufferReflection* pBuffer = desc.second.get();
+                stream << desc.first.u64;
+                writeString(stream, pBuffer->getName());
+                stream << pBuffer->getRegisterIndex() << pBuffer->getRegisterSpace() << pBuffer->getType() << pBuffer->getStructuredType();
+                stream << (uint64_t)pBuffer->getRequiredSize() << pBuffer->getShaderAccess() << pBuffer->getShaderMask();
+                writeVariableMap(stream, VariableMap(pBuffer->varBegin(), pBuffer->varEnd()));
+                writeResourceMap(stream, ResourceMap(pBuffer->resourceBegin(), pBuffer->resourceEnd()));
+            }
+
+            stream << (uint32_t)bufferData.nameMap.size();
+            for(const auto& name : bufferData.nameMap)
+            {
+                writeString(stream, name.first);
+                stream << name.second.u64;
+            }
+        }
+
+        writeVariableMap(stream, mFragOut);
+        writeVariableMap(stream, mVertAttr);
+        writeResourceMap(stream, mResources);
+        stream << mThreadGroupSizeX << mThreadGroupSizeY << mThreadGroupSizeZ;
+    }
+
+    ProgramReflection::SharedPtr ProgramReflection::deserialize(BinaryFileStream& stream)
+    {
+        SharedPtr pReflection = SharedPtr(new ProgramReflection);
+
+        for(auto& bufferData : pReflection->mBuffers)
+        {
+            uint32_t bufferCount = 0;
+            stream >> bufferCount;
+            for(uint32_t i = 0; i < bufferCount && stream.isFail() == false; i++)
+            {
+                BindLocation bindLocation;
+                stream >> bindLocation.u64;
+                std::string name = readString(stream);
+                uint32_t regIndex, regSpace, shaderMask;
+                BufferReflection::Type type;
+                BufferReflection::StructuredType structuredType;
+                uint64_t size;
+                ShaderAccess shaderAccess;
+                stream >> regIndex >> regSpace >> type >> structuredType >> size >> shaderAccess >> shaderMask;
+
+                VariableMap varMap;
+                ResourceMap resourceMap;
+                readVariableMap(stream, varMap);
+                readResourceMap(stream, resourceMap);
+                if(stream.isFail() || (uint32_t)type >= BufferReflection::kTypeCount)
+                {
+                    return nullptr;
+                }
+
+                auto pBuffer = BufferReflection::create(name, regIndex, regSpace, type, structuredType, (size_t)size, varMap, resourceMap, shaderAccess);
+                pBuffer->setShaderMask(shaderMask);
+                bufferData.descMap[bindLocation] = pBuffer;
+            }
+
+            uint32_t nameCount = 0;
+            stream >> nameCount;
+            for(uint32_t i = 0; i < nameCount && stream.isFail() == false; i++)
+            {
+                std::string name = readString(stream);
+                BindLocation bindLocation;
+                stream >> bindLocation.u64;
+                bufferData.nameMap[name] = bindLocation;
+            }
+        }
+
+        readVariableMap(stream, pReflection->mFragOut);
+        readVariableMap(stream, pReflection->mVertAttr);
+        readResourceMap(stream, pReflection->mResources);
+        stream >> pReflection->mThreadGroupSizeX >> pReflection->mThreadGroupSizeY >> pReflection->mThreadGroupSizeZ;
+
+        return stream.isFail() ? nullptr : pReflection;
+    }
+
     /************************************************************************/
     /*  SPIRE Reflection                                                    */
     /************************************************************************/
@@ -32,6 +32,8 @@
 
 namespace Falcor
 {
+    class BinaryFileStream;
+
     /** This class holds all of the data required to reflect a program, including inputs, outputs, constants, textures and samplers declarations
     */
     class ProgramReflection
@@ -326,6 +328,15 @@ namespace Falcor
             slang::ShaderReflection*    pSlangReflector,
             std::string&                log);
 
+        /** Write the reflection data into a stream, so that it can be recreated later without running Slang
+        */
+        void serialize(BinaryFileStream& stream) const;
+
+        /** Create a new object from data written by serialize()
+            \return A new object, or nullptr if the stream doesn't contain valid reflection data
+        */
+        static SharedPtr deserialize(BinaryFileStream& stream);
+
         /** Get a buffer binding index
         \param[in] name The buffer name in the program
         \return The bind location of the buffer if it is found, otherwise ProgramVersion#kInvalidLocation
@@ -179,10 +179,14 @@ namespace Falcor
             \param[in] filename Name of the PNG file to save.
             \param[in] fileFormat Destination image file format (e.g., PNG, PFM, etc.)
             \param[in] exportFlags Save flags, see Bitmap::ExportFlags
+            \param[in] async If true, the image is written using Bitmap::saveImageAsync(), and the function returns once the texture data was read back
         */
-        void captureToFile(uint32_t mipLevel, uint32_t arraySlice, const std::string& filename, Bitmap::FileFormat format = Bitmap::FileFormat::PngFile, Bitmap::ExportFlags exportFlags = Bitmap::ExportFlags::None) const;
+        void captureToFile(uint32_t mipLevel, uint32_t arraySlice, const std::string& filename, Bitmap::FileFormat format = Bitmap::FileFormat::PngFile, Bitmap::ExportFlags exportFlags = Bitmap::ExportFlags::None, bool async = false) const;
 
-        void compress2DTexture();
+        /** Compress the texture into a block-compressed format. Only supports 2D textures with a single array slice. All the mip levels are compressed.
+            \param[in] format The compressed format. If it's ResourceFormat::Unknown, the format is selected based on the texture's channel count (BC4, BC5, BC1 or BC3). If the texture is sRGB, the sRGB variant of the format is used
+        */
+        void compress2DTexture(ResourceFormat format = ResourceFormat::Unknown);
 
         /** Generates mipmaps for a specified texture object.
         */
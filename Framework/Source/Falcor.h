@@ -90,6 +90,7 @@
 #include "Graphics/Material/BasicMaterial.h"
 #include "Graphics/Material/MaterialSystem.h"
 #include "Graphics/Material/MaterialEditor.h"
+#include "Graphics/Material/TextureResidencyManager.h"
 
 // Model
 #include "Graphics/Model/Mesh.h"
@@ -98,6 +99,8 @@
 
 // Scene
 #include "Graphics/Scene/Scene.h"
+#include "Graphics/Scene/SceneBVH.h"
+#include "Graphics/Scene/OcclusionCuller.h"
 #include "Graphics/Scene/SceneRenderer.h"
 #include "Graphics/Scene/Editor/SceneEditor.h"
 #include "Graphics/Scene/SceneUtils.h"
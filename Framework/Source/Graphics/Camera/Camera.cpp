@@ -30,6 +30,7 @@
 #include "glm/gtx/quaternion.hpp"
 #include "utils/AABB.h"
 #include "Utils/math/FalcorMath.h"
+#include "Utils/Math/SimdOps.h"
 #include "API/ConstantBuffer.h"
 
 namespace Falcor
@@ -194,6 +195,149 @@ namespace Falcor
         return !isInside;
     }
 
+    struct FrustumPlanesSoA
+    {
+        float xyz[3][6];
+        float sign[3][6];
+        float negW[6];
+    };
+
+    /** Test a batch of boxes against the frustum. Mirrors isObjectCulled() operation by operation, so the results are identical to it.
+        \return A mask with a bit set for every box which is inside the frustum
+    */
+    template<typename Ops>
+    static uint32_t testBoxes(const FrustumPlanesSoA& planes, const float* const pCenter[3], const float* const pExtent[3], size_t offset)
+    {
+        using Reg = typename Ops::Reg;
+        Reg center[3];
+        Reg extent[3];
+        for(uint32_t i = 0; i < 3; i++)
+        {
+            center[i] = Ops::loadu(pCenter[i] + offset);
+            extent[i] = Ops::loadu(pExtent[i] + offset);
+        }
+
+        Reg isInside = Ops::cmpEq(Ops::set1(0.0f), Ops::set1(0.0f));
+        for(uint32_t plane = 0; plane < 6; plane++)
+        {
+            Reg dr = Ops::set1(0.0f);
+            for(uint32_t i = 0; i < 3; i++)
+            {
+                Reg signedExtent = Ops::mul(extent[i], Ops::set1(planes.sign[i][plane]));
+                Reg d = Ops::mul(Ops::add(center[i], signedExtent), Ops::set1(planes.xyz[i][plane]));
+                dr = (i == 0) ? d : Ops::add(dr, d);
+            }
+            isInside = Ops::bitAnd(isInside, Ops::cmpGt(dr, Ops::set1(planes.negW[plane])));
+        }
+        return Ops::moveMask(isInside);
+    }
+
+    static void writeVisibleMask(uint32_t insideMask, uint32_t count, uint8_t* pVisibleMask)
+    {
+        for(uint32_t lane = 0; lane < count; lane++)
+        {
+            pVisibleMask[lane] = (uint8_t)((insideMask >> lane) & 1);
+        }
+    }
+
+    template<typename Ops>
+    static void cullBoxesSoA(const FrustumPlanesSoA& planes, const float* const pCenter[3], const float* const pExtent[3], size_t count, uint8_t* pVisibleMask)
+    {
+        const uint32_t W = Ops::kWidth;
+        size_t first = 0;
+        for(; first + W <= count; first += W)
+        {
+            writeVisibleMask(testBoxes<Ops>(planes, pCenter, pExtent, first), W, pVisibleMask + first);
+        }
+
+        // Copy the remaining boxes to a padded array
+        if(first < count)
+        {
+            float staging[6][W] = {};
+            const float* pStagingCenter[3] = { staging[0], staging[1], staging[2] };
+            const float* pStagingExtent[3] = { staging[3], staging[4], staging[5] };
+            const uint32_t remaining = (uint32_t)(count - first);
+            for(uint32_t i = 0; i < 3; i++)
+            {
+                std::memcpy(staging[i], pCenter[i] + first, remaining * sizeof(float));
+                std::memcpy(staging[i + 3], pExtent[i] + first, remaining * sizeof(float));
+            }
+            writeVisibleMask(testBoxes<Ops>(planes, pStagingCenter, pStagingExtent, 0), remaining, pVisibleMask + first);
+        }
+        Ops::finish();
+    }
+
+    template<typename Ops>
+    static void cullBoxesAoS(const FrustumPlanesSoA& planes, const BoundingBox* pBoxes, size_t count, uint8_t* pVisibleMask)
+    {
+        const uint32_t W = Ops::kWidth;
+        float staging[6][W];
+        const float* pStagingCenter[3] = { staging[0], staging[1], staging[2] };
+        const float* pStagingExtent[3] = { staging[3], staging[4], staging[5] };
+
+        for(size_t first = 0; first < count; first += W)
+        {
+            // Transpose the boxes. Lanes past the end of the array replicate the last box and are discarded.
+            const uint32_t laneCount = (uint32_t)std::min<size_t>(W, count - first);
+            for(uint32_t lane = 0; lane < W; lane++)
+            {
+                const BoundingBox& box = pBoxes[first + std::min(lane, laneCount - 1)];
+                for(uint32_t i = 0; i < 3; i++)
+                {
+                    staging[i][lane] = box.center[i];
+                    staging[i + 3][lane] = box.extent[i];
+                }
+            }
+            writeVisibleMask(testBoxes<Ops>(planes, pStagingCenter, pStagingExtent, 0), laneCount, pVisibleMask + first);
+        }
+        Ops::finish();
+    }
+
+    static FrustumPlanesSoA transposePlanes(const Camera::FrustumPlane planes[6])
+    {
+        FrustumPlanesSoA soa;
+        for(uint32_t plane = 0; plane < 6; plane++)
+        {
+            for(uint32_t i = 0; i < 3; i++)
+            {
+                soa.xyz[i][plane] = planes[plane].xyz[i];
+                soa.sign[i][plane] = planes[plane].sign[i];
+            }
+            soa.negW[plane] = planes[plane].negW;
+        }
+        return soa;
+    }
+
+    void Camera::cullBoxes(const BoundingBox* pBoxes, size_t count, uint8_t* pVisibleMask) const
+    {
+        calculateCameraParameters();
+        FrustumPlanesSoA planes = transposePlanes(mFrustumPlanes);
+
+        if(isAvxSupported())
+        {
+            cullBoxesAoS<AvxOps>(planes, pBoxes, count, pVisibleMask);
+        }
+        else
+        {
+            cullBoxesAoS<SseOps>(planes, pBoxes, count, pVisibleMask);
+        }
+    }
+
+    void Camera::cullBoxes(const float* const pCenter[3], const float* const pExtent[3], size_t count, uint8_t* pVisibleMask) const
+    {
+        calculateCameraParameters();
+        FrustumPlanesSoA planes = transposePlanes(mFrustumPlanes);
+
+        if(isAvxSupported())
+        {
+            cullBoxesSoA<AvxOps>(planes, pCenter, pExtent, count, pVisibleMask);
+        }
+        else
+        {
+            cullBoxesSoA<SseOps>(planes, pCenter, pExtent, count, pVisibleMask);
+        }
+    }
+
     void Camera::setRightEyeMatrices(const glm::mat4& view, const glm::mat4& proj)
     {
         mData.rightEyeViewMat = view;
@@ -158,6 +158,21 @@ namespace Falcor
         */
         bool isObjectCulled(const BoundingBox& box) const;
 
+        /** Frustum-cull an array of bounding boxes. Produces the same results as calling isObjectCulled() for every box, but tests 4 or 8 boxes at a time using SSE/AVX.
+            \param[in] pBoxes Array of bounding boxes
+            \param[in] count Number of boxes
+            \param[out] pVisibleMask Receives 1 for every box which intersects the frustum and 0 for culled boxes. Must hold 'count' elements
+        */
+        void cullBoxes(const BoundingBox* pBoxes, size_t count, uint8_t* pVisibleMask) const;
+
+        /** Frustum-cull an array of bounding boxes stored as structure-of-arrays.
+            \param[in] pCenter The X, Y and Z components of the box centers. Each one is an array of 'count' floats
+            \param[in] pExtent The X, Y and Z components of the box extents. Each one is an array of 'count' floats
+            \param[in] count Number of boxes
+            \param[out] pVisibleMask Receives 1 for every box which intersects the frustum and 0 for culled boxes. Must hold 'count' elements
+        */
+        void cullBoxes(const float* const pCenter[3], const float* const pExtent[3], size_t count, uint8_t* pVisibleMask) const;
+
         void setIntoConstantBuffer(ConstantBuffer* pBuffer, const std::string& varName) const;
         void setIntoConstantBuffer(ConstantBuffer* pBuffer, const std::size_t& offset) const;
 
@@ -170,6 +185,19 @@ namespace Falcor
         const glm::mat4& getRightEyeProjMatrix() const { return mData.rightEyeProjMat; }
         const glm::mat4& getRightEyeViewProjMatrix() const { return mData.rightEyeViewProjMat; }
 
+        /** Frustum plane, in the form used by the culling functions
+        */
+        struct FrustumPlane
+        {
+            glm::vec3   xyz;    ///< Plane normal
+            float       negW;   ///< Negated plane distance
+            glm::vec3   sign;   ///< Sign of the normal's coordinates
+        };
+
+        /** Get the 6 frustum planes used by isObjectCulled(). A box is culled if, for any plane, dot(box.center + box.extent * plane.sign, plane.xyz) <= plane.negW
+        */
+        const FrustumPlane* getFrustumPlanes() const { calculateCameraParameters(); return mFrustumPlanes; }
+
         static uint32_t getShaderDataSize() 
         {
             static const size_t dataSize = sizeof(CameraData);
@@ -192,11 +220,6 @@ namespace Falcor
         mutable CameraData mData;
         mutable glm::mat4 viewProjMatNoJitter;
 
-        struct 
-        {
-            glm::vec3   xyz;    ///< Camera frustum plane position
-            float       negW;   ///< Camera frustum plane, sign of the coordinates
-            glm::vec3   sign;   ///< Camera frustum plane position
-        } mutable mFrustumPlanes[6];
+        mutable FrustumPlane mFrustumPlanes[6];
     };
 }
\ No newline at end of file
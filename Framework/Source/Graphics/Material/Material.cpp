@@ -33,17 +33,17 @@
 #include "Utils/os.h"
 #include "Utils/Math/FalcorMath.h"
 #include "MaterialSystem.h"
+#include "TextureResidencyManager.h"
 #include "API/ProgramVars.h"
 
 namespace Falcor
 {
-    uint32_t Material::sMaterialCounter = 0;
+    std::atomic<uint32_t> Material::sMaterialCounter(0);
     std::vector<Material::DescId> Material::sDescIdentifier;
 
     Material::Material(const std::string& name) : mName(name)
     {
-        mData.values.id = sMaterialCounter;
-        sMaterialCounter++;
+        mData.values.id = sMaterialCounter++;
     }
 
     Material::SharedPtr Material::create(const std::string& name)
@@ -349,6 +349,7 @@ namespace Falcor
         {
             if (pTextures[i] != nullptr)
             {
+                TextureResidencyManager::touch(pTextures[i], mData.samplerState);
                 pVars->setSrv(pResourceDesc->regIndex + i, pTextures[i]->getSRV());
             }
         }
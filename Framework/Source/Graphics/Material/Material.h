@@ -27,6 +27,7 @@
 ***************************************************************************/
 #pragma once
 #include "glm/vec3.hpp"
+#include <atomic>
 #include <map>
 #include <vector>
 #include "glm/common.hpp"
@@ -328,7 +329,7 @@ namespace Falcor
         void updateDescIdentifier() const;
         void removeDescIdentifier() const;
         void updateDescString() const;
-        static uint32_t sMaterialCounter;
+        static std::atomic<uint32_t> sMaterialCounter;
         static std::vector<DescId> sDescIdentifier; // vector is slower then map, but map requires 'less' operator. This vector is only being used when the material is dirty, which shouldn't happen often
     };
 }
\ No newline at end of file
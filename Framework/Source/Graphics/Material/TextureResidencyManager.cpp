@@ -0,0 +1,289 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TextureResidencyManager.h"
+
+namespace Falcor
+{
+    bool ResidencyPolicy::touch(ObjectID id, uint64_t size)
+    {
+        auto it = mObjects.find(id);
+        if(it == mObjects.end())
+        {
+            mLru.push_back(id);
+            mObjects[id] = {size, mFrameIndex, true, std::prev(mLru.end())};
+            mTrackedBytes += size;
+            mResidentBytes += size;
+            return false;
+        }
+
+        Object& object = it->second;
+        object.lastUsedFrame = mFrameIndex;
+        if(object.isResident)
+        {
+            mLru.splice(mLru.end(), mLru, object.lruIt);
+            return false;
+        }
+
+        mLru.push_back(id);
+        object.lruIt = std::prev(mLru.end());
+        object.isResident = true;
+        mResidentBytes += object.size;
+        return true;
+    }
+
+    void ResidencyPolicy::remove(ObjectID id)
+    {
+        auto it = mObjects.find(id);
+        if(it == mObjects.end())
+        {
+            return;
+        }
+
+        if(it->second.isResident)
+        {
+            mLru.erase(it->second.lruIt);
+            mResidentBytes -= it->second.size;
+        }
+        mTrackedBytes -= it->second.size;
+        mObjects.erase(it);
+    }
+
+    void ResidencyPolicy::endFrame(std::vector<ObjectID>& evicted)
+    {
+        while(mResidentBytes > mBudget && mLru.empty() == false)
+        {
+            Object& object = mObjects[mLru.front()];
+            if(object.lastUsedFrame + mMinIdleFrames > mFrameIndex)
+            {
+                // The list is sorted by the last use, so the remaining objects were used even more recently
+                break;
+            }
+
+            evicted.push_back(mLru.front());
+            mLru.pop_front();
+            object.isResident = false;
+            mResidentBytes -= object.size;
+        }
+        mFrameIndex++;
+    }
+
+    void ResidencyPolicy::clear()
+    {
+        mObjects.clear();
+        mLru.clear();
+        mTrackedBytes = 0;
+        mResidentBytes = 0;
+    }
+
+    struct TextureResidencyData
+    {
+        struct Entry
+        {
+            std::weak_ptr<const Texture> pTexture;
+            std::weak_ptr<const Sampler> pSampler;
+        };
+
+        ResidencyPolicy policy;
+        std::unordered_map<ResidencyPolicy::ObjectID, Entry> textures;
+        uint64_t evictions = 0;
+        uint64_t restores = 0;
+    };
+
+    // Entries of released textures are normally removed when they're selected for eviction. Sweep them periodically so they don't count against the budget forever
+    static const uint64_t kSweepInterval = 64;
+
+    static TextureResidencyData& getData()
+    {
+        static TextureResidencyData sData;
+        return sData;
+    }
+
+    template<typename T, typename U>
+    static bool isSameOwner(const std::weak_ptr<T>& a, const std::shared_ptr<U>& b)
+    {
+        return (a.owner_before(b) == false) && (b.owner_before(a) == false);
+    }
+
+    void TextureResidencyManager::setBudget(uint64_t bytes)
+    {
+        if(bytes == ResidencyPolicy::kUnlimitedBudget)
+        {
+            clear();
+        }
+        getData().policy.setBudget(bytes);
+    }
+
+    uint64_t TextureResidencyManager::getBudget()
+    {
+        return getData().policy.getBudget();
+    }
+
+    bool TextureResidencyManager::isEnabled()
+    {
+        return getBudget() != ResidencyPolicy::kUnlimitedBudget;
+    }
+
+    void TextureResidencyManager::setMinIdleFrames(uint32_t frames)
+    {
+        getData().policy.setMinIdleFrames(frames);
+    }
+
+    void TextureResidencyManager::touch(const Texture::SharedPtr& pTexture, const Sampler::SharedPtr& pSampler)
+    {
+        TextureResidencyData& data = getData();
+        if(pTexture == nullptr || data.policy.getBudget() == ResidencyPolicy::kUnlimitedBudget)
+        {
+            return;
+        }
+
+        const Texture* pRaw = pTexture.get();
+        auto it = data.textures.find(pRaw);
+        if(it != data.textures.end() && isSameOwner(it->second.pTexture, pTexture) == false)
+        {
+            // A new texture was allocated at the address of a released one
+            data.policy.remove(pRaw);
+            data.textures.erase(it);
+            it = data.textures.end();
+        }
+
+        uint64_t size = 0;
+        if(it == data.textures.end())
+        {
+            data.textures[pRaw] = {pTexture, pSampler};
+            size = getTextureSize(pRaw);
+        }
+        else
+        {
+            it->second.pSampler = pSampler;
+        }
+
+        if(data.policy.touch(pRaw, size))
+        {
+            pTexture->makeResident(pSampler.get());
+            data.restores++;
+        }
+    }
+
+    void TextureResidencyManager::endFrame()
+    {
+        TextureResidencyData& data = getData();
+        if(data.policy.getBudget() == ResidencyPolicy::kUnlimitedBudget)
+        {
+            return;
+        }
+
+        if(data.policy.getFrameIndex() % kSweepInterval == 0)
+        {
+            for(auto it = data.textures.begin(); it != data.textures.end();)
+            {
+                if(it->second.pTexture.expired())
+                {
+                    data.policy.remove(it->first);
+                    it = data.textures.erase(it);
+                }
+                else
+                {
+                    it++;
+                }
+            }
+        }
+
+        std::vector<ResidencyPolicy::ObjectID> evicted;
+        data.policy.endFrame(evicted);
+        for(ResidencyPolicy::ObjectID id : evicted)
+        {
+            auto it = data.textures.find(id);
+            Texture::SharedConstPtr pTexture = it->second.pTexture.lock();
+            if(pTexture)
+            {
+                Sampler::SharedConstPtr pSampler = it->second.pSampler.lock();
+                pTexture->evict(pSampler.get());
+                data.evictions++;
+            }
+            else
+            {
+                data.policy.remove(id);
+                data.textures.erase(it);
+            }
+        }
+    }
+
+    TextureResidencyManager::Stats TextureResidencyManager::getStats()
+    {
+        const TextureResidencyData& data = getData();
+        Stats stats;
+        stats.trackedBytes = data.policy.getTrackedBytes();
+        stats.residentBytes = data.policy.getResidentBytes();
+        stats.budget = data.policy.getBudget();
+        stats.textureCount = (uint32_t)data.policy.getObjectCount();
+        stats.evictions = data.evictions;
+        stats.restores = data.restores;
+        return stats;
+    }
+
+    void TextureResidencyManager::resetStats()
+    {
+        getData().evictions = 0;
+        getData().restores = 0;
+    }
+
+    void TextureResidencyManager::clear()
+    {
+        TextureResidencyData& data = getData();
+        for(auto& it : data.textures)
+        {
+            // The policy no longer tracks the textures, so they must not stay evicted
+            Texture::SharedConstPtr pTexture = it.second.pTexture.lock();
+            if(pTexture && data.policy.touch(it.first, 0))
+            {
+                Sampler::SharedConstPtr pSampler = it.second.pSampler.lock();
+                pTexture->makeResident(pSampler.get());
+            }
+        }
+        data.textures.clear();
+        data.policy.clear();
+    }
+
+    uint64_t TextureResidencyManager::getTextureSize(const Texture* pTexture)
+    {
+        const ResourceFormat format = pTexture->getFormat();
+        const uint32_t widthRatio = getFormatWidthCompressionRatio(format);
+        const uint32_t heightRatio = getFormatHeightCompressionRatio(format);
+        uint64_t size = 0;
+        for(uint32_t mip = 0; mip < pTexture->getMipCount(); mip++)
+        {
+            uint64_t blocksX = (pTexture->getWidth(mip) + widthRatio - 1) / widthRatio;
+            uint64_t blocksY = (pTexture->getHeight(mip) + heightRatio - 1) / heightRatio;
+            size += blocksX * blocksY * pTexture->getDepth(mip) * getFormatBytesPerBlock(format);
+        }
+
+        uint64_t sliceCount = pTexture->getArraySize() * ((pTexture->getType() == Texture::Type::TextureCube) ? 6 : 1);
+        return size * sliceCount * pTexture->getSampleCount();
+    }
+}
@@ -0,0 +1,164 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "API/Texture.h"
+#include "API/Sampler.h"
+
+namespace Falcor
+{
+    /** Backend-agnostic LRU residency policy. Tracks the size and the last frame in which opaque objects were used, and selects the least-recently-used objects to evict when the resident size exceeds the budget.
+        The policy doesn't call any API, which makes it possible to drive it with fake objects.
+    */
+    class ResidencyPolicy
+    {
+    public:
+        using ObjectID = const void*;
+        static const uint64_t kUnlimitedBudget = UINT64_MAX;
+
+        /** Set the budget in bytes. The budget is enforced by endFrame()
+        */
+        void setBudget(uint64_t bytes) { mBudget = bytes; }
+
+        /** Get the budget in bytes
+        */
+        uint64_t getBudget() const { return mBudget; }
+
+        /** Set the number of frames an object must go unused before it can be evicted. Should cover the frames the GPU may still be processing
+        */
+        void setMinIdleFrames(uint32_t frames) { mMinIdleFrames = frames; }
+
+        /** Mark an object as used in the current frame. Unknown objects are added as resident.
+            \param[in] id The object
+            \param[in] size The object's size in bytes
+            \return true if the object was evicted and has to be made resident before it's used, otherwise false
+        */
+        bool touch(ObjectID id, uint64_t size);
+
+        /** Stop tracking an object
+        */
+        void remove(ObjectID id);
+
+        /** End the current frame. If the resident size exceeds the budget, evicts the least-recently-used objects which were idle long enough
+            \param[out] evicted Receives the objects which were evicted. The caller is responsible for releasing their memory
+        */
+        void endFrame(std::vector<ObjectID>& evicted);
+
+        /** Remove all the objects
+        */
+        void clear();
+
+        uint64_t getFrameIndex() const { return mFrameIndex; }
+        uint64_t getTrackedBytes() const { return mTrackedBytes; }
+        uint64_t getResidentBytes() const { return mResidentBytes; }
+        size_t getObjectCount() const { return mObjects.size(); }
+
+    private:
+        struct Object
+        {
+            uint64_t size;
+            uint64_t lastUsedFrame;
+            bool isResident;
+            std::list<ObjectID>::iterator lruIt;    // Valid only if the object is resident
+        };
+
+        std::unordered_map<ObjectID, Object> mObjects;
+        std::list<ObjectID> mLru;                   // Resident objects, least-recently-used first
+        uint64_t mBudget = kUnlimitedBudget;
+        uint32_t mMinIdleFrames = 3;
+        uint64_t mFrameIndex = 0;
+        uint64_t mTrackedBytes = 0;
+        uint64_t mResidentBytes = 0;
+    };
+
+    /** Keeps the GPU memory used by material textures under a budget.
+        Material::setIntoProgramVars() reports every texture it binds. At the end of every frame, if the textures' size exceeds the budget, the least-recently-used textures are evicted using Texture::evict(), and they are made resident again the next time they are bound.
+        Textures are tracked using weak references, so the manager doesn't extend their lifetime. Must be used from the render thread.
+        The manager is disabled until a budget is set.
+    */
+    class TextureResidencyManager
+    {
+    public:
+        /** Residency statistics
+        */
+        struct Stats
+        {
+            uint64_t trackedBytes = 0;      ///< Size of all the textures used since the manager was enabled
+            uint64_t residentBytes = 0;     ///< Size of the textures which are currently resident
+            uint64_t budget = 0;            ///< The budget in bytes
+            uint32_t textureCount = 0;      ///< Number of tracked textures
+            uint64_t evictions = 0;         ///< Number of textures evicted since the last resetStats() call
+            uint64_t restores = 0;          ///< Number of evicted textures which were made resident again since the last resetStats() call
+        };
+
+        /** Set the budget in bytes. Use ResidencyPolicy::kUnlimitedBudget to disable the manager
+        */
+        static void setBudget(uint64_t bytes);
+
+        /** Get the budget in bytes
+        */
+        static uint64_t getBudget();
+
+        /** Check if a budget was set
+        */
+        static bool isEnabled();
+
+        /** Set the number of frames a texture must go unused before it can be evicted
+        */
+        static void setMinIdleFrames(uint32_t frames);
+
+        /** Report that a texture is used in the current frame. Makes the texture resident if it was evicted
+            \param[in] pTexture The texture
+            \param[in] pSampler The sampler the texture is used with. Passed to Texture::makeResident() and Texture::evict()
+        */
+        static void touch(const Texture::SharedPtr& pTexture, const Sampler::SharedPtr& pSampler);
+
+        /** End the frame and evict textures if the budget is exceeded. Called by Sample after presenting the frame
+        */
+        static void endFrame();
+
+        /** Get the residency statistics
+        */
+        static Stats getStats();
+
+        /** Reset the eviction and restore counters
+        */
+        static void resetStats();
+
+        /** Make all the evicted textures resident and stop tracking them
+        */
+        static void clear();
+
+        /** Get the GPU memory size of a texture, including all the mip-levels and array slices
+        */
+        static uint64_t getTextureSize(const Texture* pTexture);
+    };
+}
@@ -0,0 +1,413 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "InstanceTransformStore.h"
+#include "Utils/JobSystem.h"
+#include "Utils/Math/FalcorMath.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <emmintrin.h>
+
+namespace Falcor
+{
+    static const uint32_t kBlockSizeLog2 = 10;
+    static const uint32_t kBlockSize = 1 << kBlockSizeLog2;
+    static const uint32_t kMaxBlocks = 16 * 1024;
+
+    enum DirtyFlags : uint8_t
+    {
+        kBaseDirty = 0x1,       // The base layer's matrix has to be recomputed from its components
+        kMovableDirty = 0x2,    // The movable layer's matrix has to be recomputed from its components
+        kWorldDirty = 0x4,      // The world matrix, its inverse-transpose and the world bounds have to be recomputed
+        kUpdating = 0x80,       // A thread claimed the slot and is updating it
+    };
+
+    struct TransformLayerArrays
+    {
+        glm::vec3 translation[kBlockSize];
+        glm::vec3 target[kBlockSize];
+        glm::vec3 up[kBlockSize];
+        glm::vec3 scale[kBlockSize];
+        glm::mat4 matrix[kBlockSize];
+    };
+
+    struct TransformBlock
+    {
+        TransformLayerArrays layers[2];
+        const BoundingBox* pLocalBounds[kBlockSize];
+        glm::mat4 worldMat[kBlockSize];
+        glm::mat3x4 invTransposeMat[kBlockSize];
+        BoundingBox worldBounds[kBlockSize];
+        uint32_t generation[kBlockSize];
+        std::atomic<uint8_t> dirty[kBlockSize];
+        std::atomic<bool> hasDirtySlots{false};
+    };
+
+    struct TransformStoreData
+    {
+        std::unique_ptr<TransformBlock> pBlocks[kMaxBlocks];    // Blocks are never freed or moved, so slots can be accessed without locking
+        std::atomic<uint32_t> blockCount{0};
+        uint32_t slotCount = 0;                                 // Number of slots handed out, including the released ones
+        uint32_t allocatedCount = 0;
+        std::vector<InstanceTransformStore::Handle> freeSlots;
+        std::atomic<uint64_t> changeCount{0};
+        std::mutex mutex;
+    };
+
+    static TransformStoreData& getData()
+    {
+        // Never destroyed, so instances owned by other static objects (such as the model cache) can still be released at exit
+        static TransformStoreData* spData = new TransformStoreData;
+        return *spData;
+    }
+
+    static TransformBlock& getBlock(InstanceTransformStore::Handle handle)
+    {
+        assert(handle != InstanceTransformStore::kInvalidHandle);
+        return *getData().pBlocks[handle >> kBlockSizeLog2];
+    }
+
+    static uint32_t getSlot(InstanceTransformStore::Handle handle)
+    {
+        return handle & (kBlockSize - 1);
+    }
+
+    static glm::mat4 calculateTransformMatrix(const glm::vec3& translation, const glm::vec3& target, const glm::vec3& up, const glm::vec3& scale)
+    {
+        glm::mat4 translationMtx = glm::translate(glm::mat4(), translation);
+        glm::mat4 rotationMtx = createMatrixFromLookAt(translation, target, up);
+        glm::mat4 scalingMtx = glm::scale(glm::mat4(), scale);
+
+        return translationMtx * rotationMtx * scalingMtx;
+    }
+
+    static __m128 cross(__m128 a, __m128 b)
+    {
+        __m128 aYzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 bYzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 c = _mm_sub_ps(_mm_mul_ps(a, bYzx), _mm_mul_ps(aYzx, b));
+        return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+    }
+
+    /** Compute the derived data of a slot from the layer matrices. The world matrix product uses the same operation order as glm's operator*, so it's identical to the scalar result
+    */
+    static void updateWorldData(TransformBlock& block, uint32_t slot)
+    {
+        const glm::mat4& movable = block.layers[(uint32_t)InstanceTransformStore::Layer::Movable].matrix[slot];
+        const glm::mat4& base = block.layers[(uint32_t)InstanceTransformStore::Layer::Base].matrix[slot];
+
+        __m128 a[4];
+        for(uint32_t i = 0; i < 4; i++)
+        {
+            a[i] = _mm_loadu_ps(&movable[i][0]);
+        }
+
+        __m128 world[4];
+        for(uint32_t j = 0; j < 4; j++)
+        {
+            __m128 r = _mm_mul_ps(a[0], _mm_set1_ps(base[j][0]));
+            r = _mm_add_ps(r, _mm_mul_ps(a[1], _mm_set1_ps(base[j][1])));
+            r = _mm_add_ps(r, _mm_mul_ps(a[2], _mm_set1_ps(base[j][2])));
+            r = _mm_add_ps(r, _mm_mul_ps(a[3], _mm_set1_ps(base[j][3])));
+            world[j] = r;
+            _mm_storeu_ps(&block.worldMat[slot][j][0], r);
+        }
+
+        // The inverse-transpose of a 3x3 matrix with columns c0, c1, c2 has the columns (c1 x c2, c2 x c0, c0 x c1) / det
+        const __m128 xyzMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+        __m128 c0 = _mm_and_ps(world[0], xyzMask);
+        __m128 c1 = _mm_and_ps(world[1], xyzMask);
+        __m128 c2 = _mm_and_ps(world[2], xyzMask);
+        __m128 c12 = cross(c1, c2);
+        __m128 c20 = cross(c2, c0);
+        __m128 c01 = cross(c0, c1);
+        __m128 det = _mm_mul_ps(c0, c12);
+        det = _mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(2, 3, 0, 1)));
+        det = _mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(1, 0, 3, 2)));
+        __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+        _mm_storeu_ps(&block.invTransposeMat[slot][0][0], _mm_mul_ps(c12, invDet));
+        _mm_storeu_ps(&block.invTransposeMat[slot][1][0], _mm_mul_ps(c20, invDet));
+        _mm_storeu_ps(&block.invTransposeMat[slot][2][0], _mm_mul_ps(c01, invDet));
+
+        // World bounds: the center is transformed as a point, and the extent by the absolute value of the 3x3 part
+        const BoundingBox& local = *block.pLocalBounds[slot];
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        __m128 center = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(local.center.x)), _mm_mul_ps(c1, _mm_set1_ps(local.center.y))), _mm_mul_ps(c2, _mm_set1_ps(local.center.z))), world[3]);
+        __m128 extent = _mm_mul_ps(_mm_and_ps(c0, absMask), _mm_set1_ps(local.extent.x));
+        extent = _mm_add_ps(extent, _mm_mul_ps(_mm_and_ps(c1, absMask), _mm_set1_ps(local.extent.y)));
+        extent = _mm_add_ps(extent, _mm_mul_ps(_mm_and_ps(c2, absMask), _mm_set1_ps(local.extent.z)));
+
+        float values[8];
+        _mm_storeu_ps(values, center);
+        _mm_storeu_ps(values + 4, extent);
+        block.worldBounds[slot].center = glm::vec3(values[0], values[1], values[2]);
+        block.worldBounds[slot].extent = glm::vec3(values[4], values[5], values[6]);
+    }
+
+    /** Update a slot if it's dirty. The first thread to find the slot dirty claims it, and the other threads wait until it publishes the result. Returns once the slot is clean
+    */
+    static void updateSlot(TransformBlock& block, uint32_t slot)
+    {
+        std::atomic<uint8_t>& dirty = block.dirty[slot];
+        uint8_t flags = dirty.load(std::memory_order_acquire);
+        while(flags)
+        {
+            if(flags & kUpdating)
+            {
+                std::this_thread::yield();
+                flags = dirty.load(std::memory_order_acquire);
+            }
+            else if(dirty.compare_exchange_weak(flags, kUpdating, std::memory_order_acquire))
+            {
+                for(uint32_t layer = 0; layer < 2; layer++)
+                {
+                    if(flags & (kBaseDirty << layer))
+                    {
+                        TransformLayerArrays& arrays = block.layers[layer];
+                        arrays.matrix[slot] = calculateTransformMatrix(arrays.translation[slot], arrays.target[slot], arrays.up[slot], arrays.scale[slot]);
+                    }
+                }
+                updateWorldData(block, slot);
+                dirty.store(0, std::memory_order_release);
+                return;
+            }
+        }
+    }
+
+    static void updateBlock(TransformBlock& block)
+    {
+        for(uint32_t slot = 0; slot < kBlockSize; slot++)
+        {
+            if(block.dirty[slot].load(std::memory_order_relaxed))
+            {
+                updateSlot(block, slot);
+            }
+        }
+    }
+
+    static void initSlot(TransformBlock& block, uint32_t slot, const BoundingBox* pLocalBounds)
+    {
+        for(auto& arrays : block.layers)
+        {
+            arrays.translation[slot] = glm::vec3(0.0f);
+            arrays.target[slot] = glm::vec3(0.0f, 0.0f, 1.0f);
+            arrays.up[slot] = glm::vec3(0.0f, 1.0f, 0.0f);
+            arrays.scale[slot] = glm::vec3(1.0f);
+        }
+        block.pLocalBounds[slot] = pLocalBounds;
+        block.generation[slot] = 0;
+        block.dirty[slot].store(kBaseDirty | kMovableDirty | kWorldDirty, std::memory_order_relaxed);
+        block.hasDirtySlots.store(true, std::memory_order_relaxed);
+    }
+
+    static void markDirty(InstanceTransformStore::Handle handle, uint8_t flags)
+    {
+        TransformBlock& block = getBlock(handle);
+        uint32_t slot = getSlot(handle);
+        block.generation[slot]++;
+        block.dirty[slot].fetch_or(flags, std::memory_order_relaxed);
+        block.hasDirtySlots.store(true, std::memory_order_relaxed);
+        getData().changeCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    InstanceTransformStore::Handle InstanceTransformStore::allocate(const BoundingBox* pLocalBounds)
+    {
+        assert(pLocalBounds);
+        TransformStoreData& data = getData();
+        Handle handle;
+        {
+            std::lock_guard<std::mutex> lock(data.mutex);
+            if(data.freeSlots.size())
+            {
+                handle = data.freeSlots.back();
+                data.freeSlots.pop_back();
+            }
+            else
+            {
+                handle = data.slotCount++;
+                uint32_t blockIndex = handle >> kBlockSizeLog2;
+                if(blockIndex == data.blockCount.load(std::memory_order_relaxed))
+                {
+                    if(blockIndex == kMaxBlocks)
+                    {
+                        logError("InstanceTransformStore::allocate() - Too many instances. Can't allocate more than " + std::to_string(kMaxBlocks * kBlockSize) + " instance transforms");
+                        data.slotCount--;
+                        return kInvalidHandle;
+                    }
+                    data.pBlocks[blockIndex] = std::make_unique<TransformBlock>();
+                    for(auto& dirty : data.pBlocks[blockIndex]->dirty)
+                    {
+                        dirty.store(0, std::memory_order_relaxed);
+                    }
+                    data.blockCount.store(blockIndex + 1, std::memory_order_release);
+                }
+            }
+            data.allocatedCount++;
+        }
+
+        initSlot(getBlock(handle), getSlot(handle), pLocalBounds);
+        return handle;
+    }
+
+    void InstanceTransformStore::release(Handle handle)
+    {
+        if(handle == kInvalidHandle)
+        {
+            return;
+        }
+
+        TransformStoreData& data = getData();
+        getBlock(handle).dirty[getSlot(handle)].store(0, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(data.mutex);
+        data.freeSlots.push_back(handle);
+        data.allocatedCount--;
+    }
+
+    void InstanceTransformStore::setTranslation(Handle handle, Layer layer, const glm::vec3& translation)
+    {
+        getBlock(handle).layers[(uint32_t)layer].translation[getSlot(handle)] = translation;
+        markDirty(handle, (kBaseDirty << (uint32_t)layer) | kWorldDirty);
+    }
+
+    void InstanceTransformStore::setTarget(Handle handle, Layer layer, const glm::vec3& target)
+    {
+        getBlock(handle).layers[(uint32_t)layer].target[getSlot(handle)] = target;
+        markDirty(handle, (kBaseDirty << (uint32_t)layer) | kWorldDirty);
+    }
+
+    void InstanceTransformStore::setUpVector(Handle handle, Layer layer, const glm::vec3& up)
+    {
+        getBlock(handle).layers[(uint32_t)layer].up[getSlot(handle)] = up;
+        markDirty(handle, (kBaseDirty << (uint32_t)layer) | kWorldDirty);
+    }
+
+    void InstanceTransformStore::setScaling(Handle handle, Layer layer, const glm::vec3& scale)
+    {
+        getBlock(handle).layers[(uint32_t)layer].scale[getSlot(handle)] = scale;
+        markDirty(handle, (kBaseDirty << (uint32_t)layer) | kWorldDirty);
+    }
+
+    void InstanceTransformStore::setTransform(Handle handle, Layer layer, const glm::vec3& translation, const glm::vec3& target, const glm::vec3& up, const glm::vec3& scale)
+    {
+        TransformLayerArrays& arrays = getBlock(handle).layers[(uint32_t)layer];
+        uint32_t slot = getSlot(handle);
+        arrays.translation[slot] = translation;
+        arrays.target[slot] = target;
+        arrays.up[slot] = up;
+        arrays.scale[slot] = scale;
+        markDirty(handle, (kBaseDirty << (uint32_t)layer) | kWorldDirty);
+    }
+
+    void InstanceTransformStore::setMatrix(Handle handle, Layer layer, const glm::mat4& matrix)
+    {
+        TransformBlock& block = getBlock(handle);
+        uint32_t slot = getSlot(handle);
+        block.layers[(uint32_t)layer].matrix[slot] = matrix;
+        block.dirty[slot].fetch_and((uint8_t)~(kBaseDirty << (uint32_t)layer), std::memory_order_relaxed);
+        markDirty(handle, kWorldDirty);
+    }
+
+    const glm::vec3& InstanceTransformStore::getTranslation(Handle handle, Layer layer)
+    {
+        return getBlock(handle).layers[(uint32_t)layer].translation[getSlot(handle)];
+    }
+
+    const glm::vec3& InstanceTransformStore::getTarget(Handle handle, Layer layer)
+    {
+        return getBlock(handle).layers[(uint32_t)layer].target[getSlot(handle)];
+    }
+
+    const glm::vec3& InstanceTransformStore::getUpVector(Handle handle, Layer layer)
+    {
+        return getBlock(handle).layers[(uint32_t)layer].up[getSlot(handle)];
+    }
+
+    const glm::vec3& InstanceTransformStore::getScaling(Handle handle, Layer layer)
+    {
+        return getBlock(handle).layers[(uint32_t)layer].scale[getSlot(handle)];
+    }
+
+    const glm::mat4& InstanceTransformStore::getWorldMatrix(Handle handle)
+    {
+        TransformBlock& block = getBlock(handle);
+        uint32_t slot = getSlot(handle);
+        updateSlot(block, slot);
+        return block.worldMat[slot];
+    }
+
+    const glm::mat3x4& InstanceTransformStore::getInvTransposeMatrix(Handle handle)
+    {
+        TransformBlock& block = getBlock(handle);
+        uint32_t slot = getSlot(handle);
+        updateSlot(block, slot);
+        return block.invTransposeMat[slot];
+    }
+
+    const BoundingBox& InstanceTransformStore::getWorldBounds(Handle handle)
+    {
+        TransformBlock& block = getBlock(handle);
+        uint32_t slot = getSlot(handle);
+        updateSlot(block, slot);
+        return block.worldBounds[slot];
+    }
+
+    void InstanceTransformStore::update()
+    {
+        TransformStoreData& data = getData();
+        uint32_t blockCount = data.blockCount.load(std::memory_order_acquire);
+        JobSystem::parallelFor(blockCount, [&data](uint32_t blockIndex)
+        {
+            TransformBlock& block = *data.pBlocks[blockIndex];
+            if(block.hasDirtySlots.exchange(false, std::memory_order_relaxed))
+            {
+                updateBlock(block);
+            }
+        });
+    }
+
+    uint32_t InstanceTransformStore::getCount()
+    {
+        TransformStoreData& data = getData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        return data.allocatedCount;
+    }
+
+    uint32_t InstanceTransformStore::getGeneration(Handle handle)
+    {
+        return getBlock(handle).generation[getSlot(handle)];
+    }
+
+    uint64_t InstanceTransformStore::getChangeCount()
+    {
+        return getData().changeCount.load(std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,119 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "glm/vec3.hpp"
+#include "glm/mat4x4.hpp"
+#include "glm/mat3x4.hpp"
+#include "Utils/AABB.h"
+
+namespace Falcor
+{
+    /*!
+    *  \addtogroup Falcor
+    *  @{
+    */
+
+    /** Process-wide storage for the transforms of object instances.
+        Every instance owns a slot, identified by a handle. The slots are stored as structure-of-arrays in fixed-size blocks, so the matrices and bounds of consecutive instances are contiguous in memory and the blocks never move.
+        A slot holds two transform layers, each with a translation, a look-at target, an up vector and a scale, and the derived world matrix (Movable * Base), its inverse-transpose and the world-space bounds.
+        Setters only mark the slot as dirty and increment its generation, so owners can detect moves without being notified. update() recomputes all the dirty slots in a batch on the JobSystem workers, and the getters update a dirty slot on demand. A slot is claimed atomically before it's updated, so several threads can read the same slot, and update() can run concurrently with the getters.
+        Slots can be allocated and released from any thread. Setting a slot while other threads read it requires external synchronization, and update() must not run concurrently with the setters.
+    */
+    class InstanceTransformStore
+    {
+    public:
+        using Handle = uint32_t;
+        static const Handle kInvalidHandle = (Handle)-1;
+
+        /** The transform layers of a slot. The world matrix is Movable * Base
+        */
+        enum class Layer
+        {
+            Base,       ///< The instance's own transform
+            Movable,    ///< Set by paths through the IMovableObject interface
+        };
+
+        /** Allocate a slot. Both layers are initialized to the identity transform
+            \param[in] pLocalBounds The object-space bounds of the instance. They are read every time the slot is updated, so changes to the object's bounds are picked up with the next transform change. Must stay valid until the slot is released
+            \return The slot's handle, or kInvalidHandle if the maximum number of slots is allocated
+        */
+        static Handle allocate(const BoundingBox* pLocalBounds);
+
+        /** Release a slot. The handle is invalid after this call
+        */
+        static void release(Handle handle);
+
+        static void setTranslation(Handle handle, Layer layer, const glm::vec3& translation);
+        static void setTarget(Handle handle, Layer layer, const glm::vec3& target);
+        static void setUpVector(Handle handle, Layer layer, const glm::vec3& up);
+        static void setScaling(Handle handle, Layer layer, const glm::vec3& scale);
+
+        /** Set all the components of a layer at once
+        */
+        static void setTransform(Handle handle, Layer layer, const glm::vec3& translation, const glm::vec3& target, const glm::vec3& up, const glm::vec3& scale);
+
+        /** Set the matrix of a layer directly. The layer's components are left unchanged, and are not used until one of them is set
+        */
+        static void setMatrix(Handle handle, Layer layer, const glm::mat4& matrix);
+
+        static const glm::vec3& getTranslation(Handle handle, Layer layer);
+        static const glm::vec3& getTarget(Handle handle, Layer layer);
+        static const glm::vec3& getUpVector(Handle handle, Layer layer);
+        static const glm::vec3& getScaling(Handle handle, Layer layer);
+
+        /** Get the world matrix. Updates the slot if it's dirty
+        */
+        static const glm::mat4& getWorldMatrix(Handle handle);
+
+        /** Get the inverse-transpose of the world matrix's upper 3x3, with the columns padded to 16 bytes as required by HLSL constant buffers. Updates the slot if it's dirty
+        */
+        static const glm::mat3x4& getInvTransposeMatrix(Handle handle);
+
+        /** Get the world-space bounds. Updates the slot if it's dirty
+        */
+        static const BoundingBox& getWorldBounds(Handle handle);
+
+        /** Recompute all the dirty slots. Large batches are split between the JobSystem workers
+        */
+        static void update();
+
+        /** Get the number of allocated slots
+        */
+        static uint32_t getCount();
+
+        /** Get the generation of a slot. It's incremented every time one of the slot's transform layers is set
+        */
+        static uint32_t getGeneration(Handle handle);
+
+        /** Get the number of transform changes of all the slots since the process started. If it didn't change, no slot moved
+        */
+        static uint64_t getChangeCount();
+    };
+
+    /*! @} */
+}
@@ -44,6 +44,7 @@
 #include "API/VertexLayout.h"
 #include "Data/VertexAttrib.h"
 #include "Utils/StringUtils.h"
+#include "Utils/RenderThreadQueue.h"
 
 namespace Falcor
 {
@@ -257,6 +258,31 @@ namespace Falcor
         }
     }
 
+    void AssimpModelImporter::startTextureDecoding(const aiScene* pScene, const std::string& folder)
+    {
+        // Decoding is the most expensive part of loading image files. Decode all of them concurrently, and create the textures in loadTextures() as the decoded bitmaps become available
+        for (uint32_t i = 0; i < pScene->mNumMaterials; i++)
+        {
+            const aiMaterial* pAiMaterial = pScene->mMaterials[i];
+            for (int type = 0; type < AI_TEXTURE_TYPE_MAX; ++type)
+            {
+                if (pAiMaterial->GetTextureCount((aiTextureType)type) != 1)
+                {
+                    continue;
+                }
+
+                aiString path;
+                pAiMaterial->GetTexture((aiTextureType)type, 0, &path);
+                std::string s(path.data);
+                if (s.empty() || hasSuffix(s, ".dds", false) || mTextureCache.count(s) || mPendingBitmaps.count(s))
+                {
+                    continue;
+                }
+                mPendingBitmaps[s] = decodeTextureFileAsync(folder + '\\' + s);
+            }
+        }
+    }
+
     void AssimpModelImporter::loadTextures(const aiMaterial* pAiMaterial, const std::string& folder, BasicMaterial* pMaterial, bool isObjFile, bool useSrgb)
     {
         for (int i = 0; i < AI_TEXTURE_TYPE_MAX; ++i)
@@ -295,7 +321,28 @@ namespace Falcor
                 {
                     // create a new texture
                     std::string fullpath = folder + '\\' + s;
-                    pTex = createTextureFromFile(fullpath, true, isSrgbRequired(aiType, useSrgb));
+                    MipGenDesc mipDesc;
+                    if(aiType == aiTextureType_OPACITY)
+                    {
+                        // Keep the alpha-tested coverage of the lower mip-levels. The material uses a threshold of 0.5 and samples the first channel
+                        mipDesc.alphaTestRef = 0.5f;
+                        mipDesc.alphaTestChannel = 0;
+                    }
+                    const auto& pending = mPendingBitmaps.find(s);
+                    if (pending != mPendingBitmaps.end())
+                    {
+                        Bitmap::UniqueConstPtr pBitmap = Bitmap::waitForLoad(pending->second);
+                        mPendingBitmaps.erase(pending);
+                        if (pBitmap)
+                        {
+                            pTex = RenderThreadQueue::call([&]() { return createTextureFromBitmap(pBitmap.get(), true, isSrgbRequired(aiType, useSrgb), Texture::BindFlags::ShaderResource, mipDesc); });
+                            pTex->setSourceFilename(stripDataDirectories(fullpath));
+                        }
+                    }
+                    else
+                    {
+                        pTex = RenderThreadQueue::call([&]() { return createTextureFromFile(fullpath, true, isSrgbRequired(aiType, useSrgb), Texture::BindFlags::ShaderResource, mipDesc); });
+                    }
                     if (pTex)
                     {
                         mTextureCache[s] = pTex;
@@ -414,6 +461,8 @@ namespace Falcor
 
     bool AssimpModelImporter::createAllMaterials(const aiScene* pScene, const std::string& modelFolder, bool isObjFile, bool useSrgb)
     {
+        startTextureDecoding(pScene, modelFolder);
+
         for (uint32_t i = 0; i < pScene->mNumMaterials; i++)
         {
             const aiMaterial* pAiMaterial = pScene->mMaterials[i];
@@ -432,6 +481,7 @@ namespace Falcor
             mAiMaterialToFalcor[i] = pMaterial;
         }
 
+        mPendingBitmaps.clear();
         return true;
     }
 
@@ -796,7 +846,7 @@ namespace Falcor
         {
             bindFlags |= Buffer::BindFlags::ShaderResource;
         }
-        return Buffer::create(size, bindFlags, Buffer::CpuAccess::None, indices.data());;
+        return RenderThreadQueue::call([&]() { return Buffer::create(size, bindFlags, Buffer::CpuAccess::None, indices.data()); });
     }
 
 
@@ -931,6 +981,6 @@ namespace Falcor
             bindFlags |= Buffer::BindFlags::ShaderResource;
         }
 
-        return Buffer::create(vertexStride * pAiMesh->mNumVertices, bindFlags, Buffer::CpuAccess::None, initData.data());;
+        return RenderThreadQueue::call([&]() { return Buffer::create(vertexStride * pAiMesh->mNumVertices, bindFlags, Buffer::CpuAccess::None, initData.data()); });
     }
 }
\ No newline at end of file
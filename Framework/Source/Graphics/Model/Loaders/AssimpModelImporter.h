@@ -32,6 +32,7 @@
 #include "../AnimationController.h"
 #include "../Mesh.h"
 #include "../Model.h"
+#include "Utils/Bitmap.h"
 
 struct aiScene;
 struct aiNode;
@@ -80,6 +81,7 @@ namespace Falcor
         VertexLayout::SharedPtr createVertexLayout(const aiMesh* pAiMesh);
         Buffer::SharedPtr createIndexBuffer(const aiMesh* pAiMesh);
         Buffer::SharedPtr createVertexBuffer(const aiMesh* pAiMesh, const VertexBufferLayout* pLayout, const uint8_t* pBoneIds, const vec4* pBoneWeights);
+        void startTextureDecoding(const aiScene* pScene, const std::string& folder);
         void loadTextures(const aiMaterial* pAiMaterial, const std::string& folder, BasicMaterial* pMaterial, bool isObjFile, bool useSrgb);
         Material::SharedPtr createMaterial(const aiMaterial* pAiMaterial, const std::string& folder, bool isObjFile, bool useSrgb);
 
@@ -91,5 +93,6 @@ namespace Falcor
         std::vector<Bone> mBones;
         Model::LoadFlags mFlags;
         std::map<const std::string, Texture::SharedPtr> mTextureCache;
+        std::map<const std::string, Bitmap::AsyncLoadHandle> mPendingBitmaps;
     };
 }
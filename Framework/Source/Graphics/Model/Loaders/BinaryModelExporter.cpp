@@ -36,6 +36,7 @@
 #include "BinaryImage.hpp"
 #include "Data/VertexAttrib.h"
 #include "API/Device.h"
+#include "TangentGenerator.h"
 
 namespace Falcor
 {
@@ -185,11 +186,21 @@ namespace Falcor
             return;
         }
 
-        if(prepareSubmeshes() == false) return;
-        if(writeHeader()      == false) return;
-        if(writeTextures()    == false) return;
-        if(writeMeshes()      == false) return;
-        if(writeInstances()   == false) return;
+        if(prepareSubmeshes()       == false) return;
+        if(prepareTextures()        == false) return;
+        if(writeHeader()            == false) return;
+        if(writeTextures()          == false) return;
+        if(writeMeshes()            == false) return;
+        if(writeInstances()         == false) return;
+        if(writeTableOfContents()   == false) return;
+    }
+
+    void BinaryModelExporter::alignWritePosition()
+    {
+        static const uint8_t kZeros[kBinarySceneAlignment] = {};
+        uint64_t pos = mStream.getPosition();
+        uint64_t aligned = align_to((uint64_t)kBinarySceneAlignment, pos);
+        mStream.write(kZeros, (size_t)(aligned - pos));
     }
 
     bool BinaryModelExporter::prepareSubmeshes()
@@ -210,44 +221,74 @@ namespace Falcor
             submesh.push_back(i);
         }
 
-        // Calculate the number of mesh instances
+        // Calculate the number of mesh instances and submeshes
         for(const auto& m : mMeshes)
         {
             mInstanceCount += mpModel->getMeshInstanceCount(m.second[0]);
+            mSubmeshCount += (uint32_t)m.second.size();
         }
 
         return true;
     }
 
-    bool BinaryModelExporter::writeHeader()
-    {
-        mStream.write("BinScene", 8);
-        mStream << (int32_t)8 << (int32_t)mpModel->getTextureCount() << (int32_t)mMeshes.size() << (int32_t)mInstanceCount;
-        return true;
-    }
-
-    bool BinaryModelExporter::writeTextures()
+    bool BinaryModelExporter::prepareTextures()
     {
         mTextureHash[nullptr] = -1;
 
-        uint32_t texID = 0;
         for (uint32_t meshID = 0; meshID < mpModel->getMeshCount(); meshID++)
         {
-            bool succeeded = true;
-
-            // Write all material textures
+            // Assign IDs to all material textures
             const auto& pMaterial = mpModel->getMesh(meshID)->getMaterial();
             for (uint32_t i = 0; i < pMaterial->getNumLayers(); i++)
             {
-                succeeded &= writeMaterialTexture(texID, pMaterial->getLayer(i).pTexture);
+                addMaterialTexture(pMaterial->getLayer(i).pTexture);
             }
 
-            succeeded &= writeMaterialTexture(texID, pMaterial->getNormalMap());
-            succeeded &= writeMaterialTexture(texID, pMaterial->getAlphaMap());
-            succeeded &= writeMaterialTexture(texID, pMaterial->getAmbientOcclusionMap());
-            succeeded &= writeMaterialTexture(texID, pMaterial->getHeightMap());
+            addMaterialTexture(pMaterial->getNormalMap());
+            addMaterialTexture(pMaterial->getAlphaMap());
+            addMaterialTexture(pMaterial->getAmbientOcclusionMap());
+            addMaterialTexture(pMaterial->getHeightMap());
+        }
+
+        return true;
+    }
+
+    bool BinaryModelExporter::writeHeader()
+    {
+        mStream.write("BinScene", 8);
+        mStream << (int32_t)kBinarySceneLatestVersion << (int32_t)mTextures.size() << (int32_t)mMeshes.size() << (int32_t)mInstanceCount << (int32_t)mSubmeshCount;
+
+        // Reserve space for the table of contents. It is written once all the offsets are known.
+        mTocOffset = mStream.getPosition();
+        mTextureOffsets.resize(mTextures.size());
+        mMeshOffsets.resize(mMeshes.size());
+        mSubmeshOffsets.resize(mSubmeshCount);
+        return writeTableOfContents();
+    }
+
+    bool BinaryModelExporter::writeTableOfContents()
+    {
+        mStream.seek(mTocOffset);
+        mStream << mInstancesOffset;
+        mStream.write(mTextureOffsets.data(), mTextureOffsets.size() * sizeof(uint64_t));
+        mStream.write(mMeshOffsets.data(), mMeshOffsets.size() * sizeof(uint64_t));
+        mStream.write(mSubmeshOffsets.data(), mSubmeshOffsets.size() * sizeof(uint64_t));
+
+        if(mStream.isFail())
+        {
+            error("Failed writing the table of contents");
+            return false;
+        }
+        return true;
+    }
 
-            if (succeeded == false)
+    bool BinaryModelExporter::writeTextures()
+    {
+        for(size_t texID = 0; texID < mTextures.size(); texID++)
+        {
+            alignWritePosition();
+            mTextureOffsets[texID] = mStream.getPosition();
+            if(exportBinaryImage(mTextures[texID]) == false)
             {
                 return false;
             }
@@ -256,11 +297,40 @@ namespace Falcor
         return true;
     }
 
-    bool BinaryModelExporter::writeCommonMeshData(const Mesh::SharedPtr& pMesh, uint32_t submeshCount)
+    bool BinaryModelExporter::writeCommonMeshData(const Mesh::SharedPtr& pMesh, const std::vector<uint32_t>& submeshes, uint32_t firstSubmesh)
     {
         auto pVao = pMesh->getVao();
         const uint32_t vertexBufferCount = pMesh->getVao()->getVertexBuffersCount();
-        mStream << (int32_t)vertexBufferCount << (int32_t)pMesh->getVertexCount() << (int32_t)submeshCount;
+        const uint32_t vertexCount = pMesh->getVertexCount();
+
+        // Find the attributes required to generate the tangent frames
+        const uint32_t kInvalidBufferIndex = (uint32_t)-1;
+        uint32_t positionBufferIndex = kInvalidBufferIndex;
+        uint32_t normalBufferIndex = kInvalidBufferIndex;
+        uint32_t bitangentBufferIndex = kInvalidBufferIndex;
+        uint32_t texCoordBufferIndex = kInvalidBufferIndex;
+        for (uint32_t i = 0; i < vertexBufferCount; i++)
+        {
+            switch(getBinaryAttribType(pVao->getVertexLayout()->getBufferLayout(i)->getElementName(0)))
+            {
+            case AttribType_Position:
+                positionBufferIndex = i;
+                break;
+            case AttribType_Normal:
+                normalBufferIndex = i;
+                break;
+            case AttribType_Bitangent:
+                bitangentBufferIndex = i;
+                break;
+            case AttribType_TexCoord:
+                texCoordBufferIndex = i;
+                break;
+            }
+        }
+        bool generateTangents = (bitangentBufferIndex == kInvalidBufferIndex) && (normalBufferIndex != kInvalidBufferIndex) && (positionBufferIndex != kInvalidBufferIndex);
+
+        const uint32_t attribCount = vertexBufferCount + (generateTangents ? 1 : 0);
+        mStream << (int32_t)attribCount << (int32_t)vertexCount << (int32_t)submeshes.size() << (int32_t)firstSubmesh;
 
         struct vertexBufferInfo 
         {
@@ -297,21 +367,41 @@ namespace Falcor
             vbInfo[i].pData = (size_t)vbInfo[i].pBuffer->map(Buffer::MapType::Read);
         }
 
-        // Write the vertex buffer
-        for (uint32_t i = 0; i < pMesh->getVertexCount(); ++i)
+        std::vector<glm::vec3> bitangents;
+        if(generateTangents)
         {
-            for (auto& a : vbInfo)
-            { 			
-                mStream.write((void*)a.pData, a.stride);
-                a.pData += a.stride;
+            mStream << (int32_t)AttribType_Bitangent << (int32_t)AttribFormat_F32 << (int32_t)3;
+
+            bitangents.resize(vertexCount);
+            const vertexBufferInfo& position = vbInfo[positionBufferIndex];
+            const vertexBufferInfo* pTexCrd = (texCoordBufferIndex != kInvalidBufferIndex) ? &vbInfo[texCoordBufferIndex] : nullptr;
+            for(uint32_t meshID : submeshes)
+            {
+                const auto& pIB = mpModel->getMesh(meshID)->getVao()->getIndexBuffer();
+                const uint32_t* pIndices = (const uint32_t*)pIB->map(Buffer::MapType::Read);
+                generateSubmeshTangentData(pIndices, mpModel->getMesh(meshID)->getIndexCount(),
+                    (const float*)position.pData, position.stride,
+                    (const glm::vec3*)vbInfo[normalBufferIndex].pData,
+                    pTexCrd ? (const glm::vec2*)pTexCrd->pData : nullptr, pTexCrd ? pTexCrd->stride : 0,
+                    bitangents.data());
+                pIB->unmap();
             }
         }
 
+        // Write the vertex streams, one per attribute
         for (auto& a : vbInfo)
         {
+            alignWritePosition();
+            mStream.write((void*)a.pData, (size_t)a.stride * vertexCount);
             a.pBuffer->unmap();
         }
 
+        if(generateTangents)
+        {
+            alignWritePosition();
+            mStream.write(bitangents.data(), bitangents.size() * sizeof(glm::vec3));
+        }
+
         return true;
     }
 
@@ -346,6 +436,9 @@ namespace Falcor
             mStream << index;
         }
 
+        const BoundingBox& box = pMesh->getBoundingBox();
+        mStream << box.getMinPos() << box.getMaxPos();
+
         uint32_t indexCount = pMesh->getIndexCount();
         assert(indexCount % 3 == 0);
         uint32_t primCount = indexCount / 3;
@@ -353,6 +446,7 @@ namespace Falcor
         mStream << (int32_t)primCount;
 
         // Output the index buffer
+        alignWritePosition();
         const void* pIndices = pMesh->getVao()->getIndexBuffer()->map(Buffer::MapType::Read);
         mStream.write(pIndices, indexCount * sizeof(uint32_t));
         pMesh->getVao()->getIndexBuffer()->unmap();
@@ -362,7 +456,8 @@ namespace Falcor
 
     bool BinaryModelExporter::writeMeshes()
     {
-        uint32_t inst = 0;
+        uint32_t meshIdx = 0;
+        uint32_t submeshIdx = 0;
         for(const auto& mesh : mMeshes)
         {
             const auto& submeshes = mesh.second;
@@ -374,18 +469,21 @@ namespace Falcor
                 if(meshID == submeshes[0])
                 {
                     // All submeshes share the same VB and same layout. We use the first submesh for that.
-                    if(writeCommonMeshData(pMesh, (uint32_t)submeshes.size()) == false)
+                    alignWritePosition();
+                    mMeshOffsets[meshIdx] = mStream.getPosition();
+                    if(writeCommonMeshData(pMesh, submeshes, submeshIdx) == false)
                     {
                         return false;
                     }
                 }
 
+                mSubmeshOffsets[submeshIdx++] = mStream.getPosition();
                 if(writeSubmesh(pMesh) == false)
                 {
                     return false;
                 }
-                inst += mpModel->getMeshInstanceCount(meshID);
             }
+            meshIdx++;
         }
 
         return true;
@@ -393,6 +491,9 @@ namespace Falcor
 
     bool BinaryModelExporter::writeInstances()
     {
+        alignWritePosition();
+        mInstancesOffset = mStream.getPosition();
+
         int32_t meshIdx = 0;
         int32_t enabled = 1;
         for(const auto& mesh : mMeshes)
@@ -412,19 +513,17 @@ namespace Falcor
         return true;
     }
 
-    bool BinaryModelExporter::writeMaterialTexture(uint32_t& texID, const Texture::SharedPtr& pTexture)
+    void BinaryModelExporter::addMaterialTexture(const Texture::SharedPtr& pTexture)
     {
         if (pTexture != nullptr)
         {
-            // If not exported yet
+            // If not added yet
             if (mTextureHash.find(pTexture.get()) == mTextureHash.end())
             {
-                mTextureHash[pTexture.get()] = texID++;
-                return exportBinaryImage(pTexture.get());
+                mTextureHash[pTexture.get()] = (int32_t)mTextures.size();
+                mTextures.push_back(pTexture.get());
             }
         }
-
-        return true;
     }
 
     bool BinaryModelExporter::exportBinaryImage(const Texture* pTexture)
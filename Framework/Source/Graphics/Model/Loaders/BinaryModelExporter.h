@@ -58,20 +58,33 @@ namespace Falcor
         bool writeHeader();
         bool writeTextures();
         bool writeMeshes();
-        bool writeCommonMeshData(const Mesh::SharedPtr& pMesh, uint32_t submeshCount);
+        bool writeCommonMeshData(const Mesh::SharedPtr& pMesh, const std::vector<uint32_t>& submeshes, uint32_t firstSubmesh);
         bool writeSubmesh(const Mesh::SharedPtr& pMesh);
         bool writeInstances();
+        bool writeTableOfContents();
 
-        bool writeMaterialTexture(uint32_t& texID, const Texture::SharedPtr& pTexture);
+        void addMaterialTexture(const Texture::SharedPtr& pTexture);
         
         bool exportBinaryImage(const Texture* pTexture);
 
+        void alignWritePosition();
+
         void error(const std::string& Msg);
         void warning(const std::string& Msg);
 
         bool prepareSubmeshes();
+        bool prepareTextures();
         std::map<const Vao*, std::vector<uint32_t>> mMeshes; // Maps to meshID in model
         std::map<const Texture*, int32_t> mTextureHash;
+        std::vector<const Texture*> mTextures;  // Unique textures, ordered by their ID in the file
         uint32_t mInstanceCount = 0; // Not the same as Model::Instance count. Model keeps the total instance count, while the binary format has a concept of meshes and submeshes, and the instance count there is the mesh instance count.
+        uint32_t mSubmeshCount = 0;
+
+        // Table of contents. Filled while writing the data, and written into the header once done
+        uint64_t mTocOffset = 0;
+        uint64_t mInstancesOffset = 0;
+        std::vector<uint64_t> mTextureOffsets;
+        std::vector<uint64_t> mMeshOffsets;
+        std::vector<uint64_t> mSubmeshOffsets;
     };
 }
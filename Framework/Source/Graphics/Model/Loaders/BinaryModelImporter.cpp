@@ -40,6 +40,9 @@
 #include "API/Texture.h"
 #include "Graphics/Material/Material.h"
 #include "glm/geometric.hpp"
+#include "TangentGenerator.h"
+#include "Utils/JobSystem.h"
+#include "Utils/RenderThreadQueue.h"
 
 namespace Falcor
 {
@@ -48,120 +51,35 @@ namespace Falcor
         uint32_t width  = 0;
         uint32_t height = 0;
         ResourceFormat format = ResourceFormat::Unknown;
-        std::vector<uint8_t> data;
+        const uint8_t* pData = nullptr; // Either points into the file mapping or into 'storage'
+        std::vector<uint8_t> storage;
         std::string name;
-    };
 
-    bool isSpecialFloat(float f)
-    {
-        uint32_t d = *(uint32_t*)&f;
-        // Check the exponent
-        d = (d >> 23) & 0xff;
-        return d == 0xff;
-    }
+        // 3-channel RGB data which still needs to be expanded into 'storage'. The expansion is deferred so that it can run in parallel.
+        const uint8_t* pRgbData = nullptr;
+        uint32_t texelCount = 0;
+    };
 
-    template<typename posType>
-    void generateSubmeshTangentData(
-        const std::vector<uint32_t>& indices,
-        const posType* vertexPosData,
-        const glm::vec3* vertexNormalData,
-        const glm::vec2* texCrdData,
-        uint32_t texCrdCount,
-        glm::vec3* bitangentData)
+    /** Get a pointer to the next 'size' bytes of the stream. Memory-mapped streams return a pointer into the mapping without copying, otherwise the data is read into 'storage'.
+        Returns nullptr if the stream doesn't contain enough data.
+    */
+    static const uint8_t* readBlock(BinaryFileStream& stream, uint64_t size, std::vector<uint8_t>& storage)
     {
-        // calculate the tangent and bitangent for every face
-        size_t primCount = indices.size() / 3;
-        for(size_t primID = 0; primID < primCount; primID++)
+        if(stream.isMapped())
         {
-            struct Data
-            {
-                posType position;
-                glm::vec3 normal;
-                glm::vec2 uv;
-            };
-            Data V[3];
-
-            // Get the data
-            for(uint32_t i = 0; i < 3; i++)
-            {
-                uint32_t index = indices[primID * 3 + i];
-                V[i].position = vertexPosData[index];
-                V[i].normal = vertexNormalData[index];
-
-                if(texCrdData)
-                {
-                    V[i].uv = texCrdData[index * texCrdCount];
-                }
-                else
-                {
-                    V[i].uv = glm::vec2(0.f, 0.f);
-                }
-            }
-
-            // Position delta
-            posType posDelta[2];
-            posDelta[0] = V[1].position - V[0].position;
-            posDelta[1] = V[2].position - V[0].position;
-
-            // Texture offset
-            glm::vec2 s = V[1].uv - V[0].uv;
-            glm::vec2 t = V[2].uv - V[0].uv;
-            s.y = -s.y;
-            t.y = -t.y;
-
-            glm::vec3 tangent;
-            glm::vec3 bitangent;
-
-            // when t1, t2, t3 in same position in UV space, just use default UV direction.
-            if((s == glm::vec2(0, 0)) || (t == glm::vec2(0, 0)))
-            {
-				const glm::vec3 &normal = V[0].normal;
-				if(abs(normal.x) > abs(normal.y))
-					bitangent = v3(normal.z, 0.f, -normal.x) / length(v2(normal.x, normal.z));
-				else
-					bitangent = v3(0.f, normal.z, -normal.y) / length(v2(normal.y, normal.z));
-				tangent = cross(bitangent, normal);
-            }
-			else
-			{
-				float dirCorrection = (t.x * s.y - t.y * s.x) < 0.0f ? -1.0f : 1.0f;
-
-				// tangent points in the direction where to positive X axis of the texture coord's would point in model space
-				// bitangent's points along the positive Y axis of the texture coord's, respectively
-				tangent.x = (posDelta[1].x * s.y - posDelta[0].x * t.y) * dirCorrection;
-				tangent.y = (posDelta[1].y * s.y - posDelta[0].y * t.y) * dirCorrection;
-				tangent.z = (posDelta[1].z * s.y - posDelta[0].z * t.y) * dirCorrection;
-
-				bitangent.x = (posDelta[1].x * s.x - posDelta[0].x * t.x) * dirCorrection;
-				bitangent.y = (posDelta[1].y * s.x - posDelta[0].y * t.x) * dirCorrection;
-				bitangent.z = (posDelta[1].z * s.x - posDelta[0].z * t.x) * dirCorrection;
-			}
-
-            // store for every vertex of that face
-            for(uint32_t i = 0; i < 3; i++)
-            {
-                // project tangent and bitangent into the plane formed by the vertex' normal
-                glm::vec3 localTangent = tangent - V[i].normal * (glm::dot(tangent, V[i].normal));
-                localTangent = glm::normalize(localTangent);
-                glm::vec3 localBitangent = bitangent - V[i].normal * (glm::dot(bitangent, V[i].normal));
-                localBitangent = glm::normalize(localBitangent);
-                localBitangent = localBitangent - localTangent * (glm::dot(localBitangent, localTangent));
-                localBitangent = glm::normalize(localBitangent);
-
-                // reconstruct tangent/bitangent according to normal and bitangent/tangent when it's infinite or NaN.
-                bool isInvalidBitangent = isSpecialFloat(localBitangent.x) || isSpecialFloat(localBitangent.y) || isSpecialFloat(localBitangent.z);
-
-                if (isInvalidBitangent)
-                {
-                    localBitangent = glm::cross(localTangent, V[i].normal);
-                    localBitangent = glm::normalize(localBitangent);
-                }
+            return stream.readSpan(size);
+        }
 
-                // and write it into the mesh
-                uint32_t index = indices[primID * 3 + i];
-                bitangentData[index] = localBitangent;
-            }
+        // Sizes come from the file, so validate them before allocating the storage
+        if(stream.isFail() || size > stream.getRemainingStreamSize())
+        {
+            return nullptr;
         }
+
+        // Never return nullptr for empty blocks
+        storage.resize(std::max<size_t>((size_t)size, 1));
+        stream.read(storage.data(), (size_t)size);
+        return stream.isFail() ? nullptr : storage.data();
     }
 
     static BasicMaterial::MapType getFalcorMapType(TextureType map)
@@ -343,14 +261,38 @@ namespace Falcor
 
     std::string readString(BinaryFileStream& stream)
     {
-        int32_t length;
+        int32_t length = 0;
         stream >> length;
+        if(stream.isFail() || length < 0)
+        {
+            return std::string();
+        }
         std::vector<char> charVec(length + 1);
         stream.read(&charVec[0], length);
         charVec[length] = 0;
         return std::string(charVec.data());
     }
 
+    // Convert 3-channel 8-bits RGB formats to 4-channel RGBX by adding padding
+    static void expandRgbTextureData(TextureData& data)
+    {
+        if(data.pRgbData == nullptr)
+        {
+            return;
+        }
+
+        data.storage.resize((size_t)data.texelCount * 4);
+        for(size_t i = 0; i < data.texelCount; i++)
+        {
+            data.storage[i * 4 + 0] = data.pRgbData[i * 3 + 0];
+            data.storage[i * 4 + 1] = data.pRgbData[i * 3 + 1];
+            data.storage[i * 4 + 2] = data.pRgbData[i * 3 + 2];
+            data.storage[i * 4 + 3] = 0xff;
+        }
+        data.pData = data.storage.data();
+        data.pRgbData = nullptr;
+    }
+
     bool loadBinaryTextureData(BinaryFileStream& stream, const std::string& modelName, TextureData& data)
     {
         // ImageHeader.
@@ -432,29 +374,43 @@ namespace Falcor
         data.format = getTextureFormat(FW::ImageFormat::ID(formatId));
 
         // Image data.
-        const int32_t texelCount = data.width * data.height;
-        if(dataSize == -1)
+        const uint64_t texelCount = (uint64_t)data.width * data.height;
+        const uint64_t imageSize = texelCount * bpp;
+        if(texelCount > UINT32_MAX || (dataSize != -1 && (uint64_t)dataSize < imageSize))
         {
-            dataSize = bpp * texelCount;
+            std::string msg = "Error when loading model " + modelName + ".\nCorrupt binary image data (image size doesn't match the dimensions).";
+            logError(msg);
+            return false;
         }
-        size_t storageSize = dataSize;
-        if(bpp == 3)
-            storageSize = 4 * texelCount;
 
-        data.data.resize(storageSize);
-        stream.read(data.data.data(), dataSize);
+        std::vector<uint8_t> fileStorage;
+        const uint8_t* pFileData = readBlock(stream, (dataSize == -1) ? imageSize : (uint64_t)dataSize, fileStorage);
+        if(pFileData == nullptr)
+        {
+            std::string msg = "Error when loading model " + modelName + ".\nCorrupt binary image data (unexpected end of file).";
+            logError(msg);
+            return false;
+        }
 
-        // Convert 3-channel 8-bits RGB formats to 4-channel RGBX by adding padding
         if(bpp == 3)
         {
-            for(int32_t i=texelCount-1;i>=0;--i)
+            data.pRgbData = pFileData;
+            data.texelCount = (uint32_t)texelCount;
+            if(stream.isMapped() == false)
             {
-                data.data[i * 4 + 0] = data.data[i * 3 + 0];
-                data.data[i * 4 + 1] = data.data[i * 3 + 1];
-                data.data[i * 4 + 2] = data.data[i * 3 + 2];
-                data.data[i * 4 + 3] = 0xff;
+                // The file data is only valid until we return
+                expandRgbTextureData(data);
             }
         }
+        else if(stream.isMapped())
+        {
+            data.pData = pFileData;
+        }
+        else
+        {
+            data.storage = std::move(fileStorage);
+            data.pData = data.storage.data();
+        }
 
         return true;
     }
@@ -475,8 +431,464 @@ namespace Falcor
         return true;
     }
 
-    BinaryModelImporter::BinaryModelImporter(const std::string& fullpath) : mModelName(fullpath), mStream(fullpath.c_str(), BinaryFileStream::Mode::Read)
+    struct TexSignature
+    {
+        const uint8_t* pData;
+        ResourceFormat format;
+        bool operator<(const TexSignature& other) const 
+        { 
+            if(pData < other.pData) return true;
+            if(pData == other.pData) return format < other.format;
+            return false;
+        }
+        bool operator==(const TexSignature& other) const { return pData == other.pData || format == other.format; }
+    };
+    using TextureMap = std::map<TexSignature, Texture::SharedPtr>;
+
+    // Returns the texture created from the image data with the requested format. The texture is created on the first request.
+    static Texture::SharedPtr getOrCreateTexture(TextureMap& textures, const TextureData& data, ResourceFormat format)
     {
+        TexSignature texSig;
+        texSig.format = format;
+        texSig.pData = data.pData;
+
+        // Check if we already created a matching texture
+        auto existingTex = textures.find(texSig);
+        if(existingTex != textures.end())
+        {
+            return existingTex->second;
+        }
+
+        auto pTexture = RenderThreadQueue::call([&]() { return Texture::create2D(data.width, data.height, texSig.format, 1, Texture::kMaxPossible, texSig.pData); });
+        pTexture->setSourceFilename(data.name);
+        textures[texSig] = pTexture;
+        return pTexture;
+    }
+
+    // Layout information shared by all the meshes of a file
+    struct FileInfo
+    {
+        uint32_t version = 0;
+        int32_t numTextureSlots = 0;
+        int32_t numAttributesType = 0;
+        int32_t numTextures = 0;
+        int32_t numMeshes = 0;
+        int32_t numInstances = 0;
+
+        // v1-v5 files contain a single mesh, and its header is part of the file header
+        int32_t numAttribs_v5 = 0;
+        int32_t numVertices_v5 = 0;
+        int32_t numSubmeshes_v5 = 0;
+
+        // v9 files store the offset of every submesh in the table of contents
+        std::vector<uint64_t> submeshOffsets;
+    };
+
+    struct SubmeshData
+    {
+        BasicMaterial material;
+        int32_t texIDs[TextureType_Max];
+        uint32_t numIndices = 0;
+        const uint32_t* pIndices = nullptr; // Either points into the file mapping or into 'indexStorage'
+        std::vector<uint8_t> indexStorage;
+        BoundingBox box;
+    };
+
+    struct VertexStreamData
+    {
+        const uint8_t* pData = nullptr;     // Either points into the file mapping or into 'storage'
+        std::vector<uint8_t> storage;
+        uint32_t elementSize = 0;
+        bool shouldSkip = false;
+    };
+
+    // CPU-side result of decoding a mesh. Decoding doesn't touch the API or the logger, so meshes can be decoded concurrently.
+    struct MeshData
+    {
+        int32_t numVertices = 0;
+        VertexLayout::SharedPtr pLayout;
+        std::vector<VertexStreamData> streams;
+        std::vector<SubmeshData> submeshes;
+        std::string error;
+        std::string warning;
+    };
+
+    // Reads the material part of a submesh. texIDs receives the texture ID of every slot, -1 for slots which are not used or not present in the file
+    static bool readSubmeshMaterial(BinaryFileStream& stream, const FileInfo& info, BasicMaterial& basicMaterial, int32_t texIDs[TextureType_Max])
+    {
+        glm::vec3 ambient;
+        glm::vec4 diffuse;
+        glm::vec3 specular;
+        float glossiness;
+
+        stream >> ambient >> diffuse >> specular >> glossiness;
+        basicMaterial.diffuseColor = glm::vec3(diffuse);
+        basicMaterial.opacity = 1 - diffuse.w;
+        basicMaterial.specularColor = specular;
+        basicMaterial.shininess = glossiness;
+
+        if(info.version >= 3)
+        {
+            float displacementCoeff;
+            float displacementBias;
+            stream >> displacementCoeff >> displacementBias;
+            basicMaterial.bumpScale = displacementCoeff;
+            basicMaterial.bumpOffset = displacementBias;
+        }
+
+        for(int32_t i = 0; i < TextureType_Max; i++)
+        {
+            texIDs[i] = -1;
+            if(i < info.numTextureSlots)
+            {
+                stream >> texIDs[i];
+                if(texIDs[i] < -1 || texIDs[i] >= info.numTextures)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Skip the padding which precedes v9 data blocks
+    static void alignReadPosition(BinaryFileStream& stream)
+    {
+        uint64_t pos = stream.getPosition();
+        uint64_t aligned = align_to((uint64_t)kBinarySceneAlignment, pos);
+        stream.skip(aligned - pos);
+    }
+
+    /** Decode a mesh, starting at the current stream position.
+        \param[in] pLegacyTextures v1-v5 files store the texture table inside the mesh. Receives the textures for those versions, ignored otherwise
+    */
+    static bool decodeMesh(BinaryFileStream& stream, const FileInfo& info, uint32_t meshIdx, bool shouldGenerateTangents, const std::string& modelName, std::vector<TextureData>* pLegacyTextures, MeshData& mesh)
+    {
+        // Mesh header
+        int32_t numAttribs = 0;
+        int32_t numSubmeshes = 0;
+        int32_t firstSubmesh = 0;
+
+        if(info.version >= kBinarySceneTocVersion)
+        {
+            stream >> numAttribs >> mesh.numVertices >> numSubmeshes >> firstSubmesh;
+        }
+        else if(info.version >= 6)
+        {
+            stream >> numAttribs >> mesh.numVertices >> numSubmeshes;
+        }
+        else
+        {
+            numAttribs = info.numAttribs_v5;
+            mesh.numVertices = info.numVertices_v5;
+            numSubmeshes = info.numSubmeshes_v5;
+        }
+
+        if(stream.isFail() || numAttribs < 0 || mesh.numVertices < 0 || numSubmeshes < 0 || firstSubmesh < 0 ||
+            (info.version >= kBinarySceneTocVersion && (uint64_t)firstSubmesh + numSubmeshes > info.submeshOffsets.size()))
+        {
+            mesh.error = "Error when loading model " + modelName + ".\nCorrupted data.!";
+            return false;
+        }
+
+        const int32_t numVertices = mesh.numVertices;
+        mesh.pLayout = VertexLayout::create();
+        mesh.streams.resize(numAttribs);
+
+        const uint32_t kInvalidBufferIndex = (uint32_t)-1;
+        uint32_t positionBufferIndex = kInvalidBufferIndex;
+        uint32_t normalBufferIndex = kInvalidBufferIndex;
+        uint32_t bitangentBufferIndex = kInvalidBufferIndex;
+        uint32_t texCoordBufferIndex = kInvalidBufferIndex;
+
+        for(int i = 0; i < numAttribs; i++)
+        {
+            VertexBufferLayout::SharedPtr pBufferLayout = VertexBufferLayout::create();
+            mesh.pLayout->addBufferLayout(i, pBufferLayout);
+            int32_t type, format, length;
+            stream >> type >> format >> length;
+
+            if(type < 0 || type >= info.numAttributesType || format < 0 || format >= AttribFormat::AttribFormat_Max || length < 1 || length > 4)
+            {
+                mesh.error = "Error when loading model " + modelName + ".\nCorrupted data.!";
+                return false;
+            }
+
+            const std::string falcorName = getSemanticName(AttribType(type));
+            ResourceFormat falcorFormat = getFalcorFormat(AttribFormat(format), length);
+            uint32_t shaderLocation = getShaderLocation(AttribType(type));
+
+            switch (shaderLocation)
+            {
+            case VERTEX_POSITION_LOC:
+                positionBufferIndex = i;
+                assert(falcorFormat == ResourceFormat::RGB32Float || falcorFormat == ResourceFormat::RGBA32Float);
+                break;
+            case VERTEX_NORMAL_LOC:
+                normalBufferIndex = i;
+                assert(falcorFormat == ResourceFormat::RGB32Float);
+                break;
+            case VERTEX_BITANGENT_LOC:
+                bitangentBufferIndex = i;
+                assert(falcorFormat == ResourceFormat::RGB32Float);
+                break;
+            case VERTEX_TEXCOORD_LOC:
+                texCoordBufferIndex = i;
+                break;
+            }
+
+            mesh.streams[i].elementSize = getFormatBytesPerBlock(falcorFormat);
+            if(shaderLocation != kUnusedShaderElement)
+            {
+                pBufferLayout->addElement(falcorName, 0, falcorFormat, 1, shaderLocation);
+            }
+            else
+            {
+                mesh.streams[i].shouldSkip = true;
+            }
+        }
+
+        if(info.version >= kBinarySceneTocVersion)
+        {
+            // Each attribute is stored in its own aligned stream, which can be used as a vertex-buffer as-is
+            for(int32_t i = 0; i < numAttribs; i++)
+            {
+                VertexStreamData& vertexStream = mesh.streams[i];
+                alignReadPosition(stream);
+                uint64_t streamSize = (uint64_t)vertexStream.elementSize * numVertices;
+                if(vertexStream.shouldSkip)
+                {
+                    stream.skip(streamSize);
+                    continue;
+                }
+
+                vertexStream.pData = readBlock(stream, streamSize, vertexStream.storage);
+                if(vertexStream.pData == nullptr)
+                {
+                    mesh.error = "Error when loading model " + modelName + ".\nUnexpected end of file.";
+                    return false;
+                }
+            }
+        }
+        else
+        {
+            // The vertex data is interleaved in the file. Fetch it as a single block and de-interleave it into the attribute buffers.
+            uint32_t vertexSize = 0;
+            for(int32_t i = 0; i < numAttribs; i++)
+            {
+                vertexSize += mesh.streams[i].elementSize;
+            }
+
+            std::vector<uint8_t> vertexStorage;
+            const uint8_t* pVertexData = readBlock(stream, (uint64_t)vertexSize * numVertices, vertexStorage);
+            if(pVertexData == nullptr)
+            {
+                mesh.error = "Error when loading model " + modelName + ".\nUnexpected end of file.";
+                return false;
+            }
+
+            if(numAttribs == 1 && mesh.streams[0].shouldSkip == false && stream.isMapped())
+            {
+                // A single attribute is already laid out the way the vertex buffer expects it
+                mesh.streams[0].pData = pVertexData;
+            }
+            else
+            {
+                uint32_t attribOffset = 0;
+                for(int32_t attrib = 0; attrib < numAttribs; attrib++)
+                {
+                    VertexStreamData& vertexStream = mesh.streams[attrib];
+                    if(vertexStream.shouldSkip == false)
+                    {
+                        vertexStream.storage.resize((size_t)vertexStream.elementSize * numVertices);
+                        const uint8_t* pSrc = pVertexData + attribOffset;
+                        uint8_t* pDst = vertexStream.storage.data();
+                        for(int32_t v = 0; v < numVertices; v++)
+                        {
+                            std::memcpy(pDst, pSrc, vertexStream.elementSize);
+                            pSrc += vertexSize;
+                            pDst += vertexStream.elementSize;
+                        }
+                        vertexStream.pData = vertexStream.storage.data();
+                    }
+                    attribOffset += vertexStream.elementSize;
+                }
+            }
+        }
+
+        if(info.version <= 5)
+        {
+            // The caller makes sure we are running on the calling thread in this case, so it's OK to log errors
+            if(importTextures(*pLegacyTextures, info.numTextures, stream, modelName) == false)
+            {
+                return false;
+            }
+        }
+
+        // Array of Submesh.
+        mesh.submeshes.resize(numSubmeshes);
+        for(int32_t submeshIdx = 0; submeshIdx < numSubmeshes; submeshIdx++)
+        {
+            SubmeshData& submesh = mesh.submeshes[submeshIdx];
+            if(info.version >= kBinarySceneTocVersion)
+            {
+                stream.seek(info.submeshOffsets[firstSubmesh + submeshIdx]);
+            }
+
+            if(readSubmeshMaterial(stream, info, submesh.material, submesh.texIDs) == false)
+            {
+                mesh.error = "Error when loading model " + modelName + ".\nCorrupt binary mesh data!";
+                return false;
+            }
+
+            glm::vec3 boundsMin, boundsMax;
+            if(info.version >= kBinarySceneTocVersion)
+            {
+                stream >> boundsMin >> boundsMax;
+            }
+
+            int32_t numTriangles;
+            stream >> numTriangles;
+            if(stream.isFail() || numTriangles < 0)
+            {
+                mesh.error = "Error when loading model " + modelName + ".\nMesh has negative number of triangles!";
+                return false;
+            }
+
+            // Fetch the index data. The index count is a 32-bit value in the mesh, reject submeshes which don't fit.
+            const uint64_t numIndices = (uint64_t)numTriangles * 3;
+            if(numIndices > UINT32_MAX)
+            {
+                mesh.error = "Error when loading model " + modelName + ".\nSubmesh has too many triangles!";
+                return false;
+            }
+            submesh.numIndices = (uint32_t)numIndices;
+            if(info.version >= kBinarySceneTocVersion)
+            {
+                alignReadPosition(stream);
+            }
+            submesh.pIndices = (const uint32_t*)readBlock(stream, numIndices * sizeof(uint32_t), submesh.indexStorage);
+            if(submesh.pIndices == nullptr)
+            {
+                mesh.error = "Error when loading model " + modelName + ".\nUnexpected end of file.";
+                return false;
+            }
+
+            // The indices are used to address the vertex data, when generating tangents and when drawing, so validate them for every file version
+            for(uint32_t i = 0; i < submesh.numIndices; i++)
+            {
+                if(submesh.pIndices[i] >= (uint32_t)numVertices)
+                {
+                    mesh.error = "Error when loading model " + modelName + ".\nSubmesh index is out of range!";
+                    return false;
+                }
+            }
+
+            // Calculate the bounding-box
+            if(info.version >= kBinarySceneTocVersion)
+            {
+                submesh.box = BoundingBox::fromMinMax(boundsMin, boundsMax);
+            }
+            else if(positionBufferIndex != kInvalidBufferIndex)
+            {
+                glm::vec3 max, min;
+                uint32_t posStride = mesh.streams[positionBufferIndex].elementSize;
+                for(uint32_t i = 0; i < submesh.numIndices; i++)
+                {
+                    const float* pPosition = (const float*)(mesh.streams[positionBufferIndex].pData + (size_t)posStride * submesh.pIndices[i]);
+                    glm::vec3 xyz(pPosition[0], pPosition[1], pPosition[2]);
+                    min = glm::min(min, xyz);
+                    max = glm::max(max, xyz);
+                }
+                submesh.box = BoundingBox::fromMinMax(min, max);
+            }
+        }
+
+        // Generate tangent space data if needed. v9 exporters store the tangent frames, so this only happens for files written without them.
+        if(shouldGenerateTangents && (bitangentBufferIndex == kInvalidBufferIndex))
+        {
+            if(normalBufferIndex == kInvalidBufferIndex || positionBufferIndex == kInvalidBufferIndex)
+            {
+                mesh.warning = "Can't generate tangent space for mesh " + std::to_string(meshIdx) + " when loading model " + modelName + ".\nMesh doesn't contain normals coordinates\n";
+            }
+            else
+            {
+                bitangentBufferIndex = (uint32_t)mesh.streams.size();
+                auto pBitangentLayout = VertexBufferLayout::create();
+                mesh.pLayout->addBufferLayout(bitangentBufferIndex, pBitangentLayout);
+                pBitangentLayout->addElement(VERTEX_BITANGENT_NAME, 0, ResourceFormat::RGB32Float, 1, VERTEX_BITANGENT_LOC);
+
+                mesh.streams.resize(bitangentBufferIndex + 1);
+                VertexStreamData& bitangents = mesh.streams[bitangentBufferIndex];
+                bitangents.elementSize = sizeof(glm::vec3);
+                bitangents.storage.resize(sizeof(glm::vec3) * (size_t)numVertices);
+                bitangents.pData = bitangents.storage.data();
+
+                const VertexStreamData* pTexCrd = (texCoordBufferIndex != kInvalidBufferIndex) ? &mesh.streams[texCoordBufferIndex] : nullptr;
+                const VertexStreamData& position = mesh.streams[positionBufferIndex];
+                for(const auto& submesh : mesh.submeshes)
+                {
+                    generateSubmeshTangentData(submesh.pIndices, submesh.numIndices,
+                        (const float*)position.pData, position.elementSize,
+                        (const glm::vec3*)mesh.streams[normalBufferIndex].pData,
+                        pTexCrd ? (const glm::vec2*)pTexCrd->pData : nullptr, pTexCrd ? pTexCrd->elementSize : 0,
+                        (glm::vec3*)bitangents.storage.data());
+                }
+            }
+        }
+
+        return true;
+    }
+
+    // Advance the stream past a v6-v8 mesh without decoding it
+    static bool skipMesh(BinaryFileStream& stream, const FileInfo& info)
+    {
+        int32_t numAttribs = 0;
+        int32_t numVertices = 0;
+        int32_t numSubmeshes = 0;
+        stream >> numAttribs >> numVertices >> numSubmeshes;
+        if(stream.isFail() || numAttribs < 0 || numVertices < 0 || numSubmeshes < 0)
+        {
+            return false;
+        }
+
+        uint64_t vertexSize = 0;
+        for(int32_t i = 0; i < numAttribs; i++)
+        {
+            int32_t type, format, length;
+            stream >> type >> format >> length;
+            if(type < 0 || type >= info.numAttributesType || format < 0 || format >= AttribFormat::AttribFormat_Max || length < 1 || length > 4)
+            {
+                return false;
+            }
+            vertexSize += getFormatBytesPerBlock(getFalcorFormat(AttribFormat(format), length));
+        }
+        stream.skip(vertexSize * (uint64_t)numVertices);
+
+        // ambient, diffuse, specular, glossiness, displacement coefficient and bias, texture IDs
+        const uint64_t materialSize = (3 + 4 + 3 + 1 + 2) * sizeof(float) + info.numTextureSlots * sizeof(int32_t);
+        for(int32_t i = 0; i < numSubmeshes; i++)
+        {
+            stream.skip(materialSize);
+            int32_t numTriangles;
+            stream >> numTriangles;
+            if(stream.isFail() || numTriangles < 0)
+            {
+                return false;
+            }
+            stream.skip((uint64_t)numTriangles * 3 * sizeof(uint32_t));
+        }
+        return stream.isFail() == false;
+    }
+
+    BinaryModelImporter::BinaryModelImporter(const std::string& fullpath) : mModelName(fullpath), mStream(fullpath.c_str(), BinaryFileStream::Mode::MappedRead)
+    {
+        // Fall back to regular file reads if the file can't be mapped (e.g. not enough address space)
+        if(mStream.isFail())
+        {
+            mStream.close();
+            mStream.open(fullpath, BinaryFileStream::Mode::Read);
+        }
     }
 
     bool BinaryModelImporter::import(Model& model, const std::string& filename, Model::LoadFlags flags)
@@ -489,14 +901,27 @@ namespace Falcor
         }
 
         BinaryModelImporter loader(fullpath);
-        return loader.importModel(model, flags);
+        return loader.importModel(model, flags, nullptr);
+    }
+
+    bool BinaryModelImporter::import(Model& model, const std::string& filename, Model::LoadFlags flags, const std::vector<uint32_t>& meshIDs)
+    {
+        std::string fullpath;
+        if(findFileInDataDirectories(filename, fullpath) == false)
+        {
+            logError(std::string("Can't find model file ") + filename);
+            return false;
+        }
+
+        BinaryModelImporter loader(fullpath);
+        return loader.importModel(model, flags, &meshIDs);
     }
 
     static bool checkVersion(const std::string& formatID, uint32_t version, const std::string& modelName)
     {
         if(std::string(formatID) == "BinScene")
         {
-            if(version < 6 || version > 8)
+            if(version < 6 || version > kBinarySceneLatestVersion)
             {
                 std::string Msg = "Error when loading model " + modelName + ".\nUnsupported binary scene version " + std::to_string(version);
                 logError(Msg);
@@ -544,296 +969,258 @@ namespace Falcor
         }
     }
     
-    bool BinaryModelImporter::importModel(Model& model, Model::LoadFlags flags)
+    bool BinaryModelImporter::importModel(Model& model, Model::LoadFlags flags, const std::vector<uint32_t>* pMeshIDs)
     {
         // Format ID and version.
         char formatID[9];
         mStream.read(formatID, 8);
         formatID[8] = '\0';
 
-        uint32_t version;
-        mStream >> version;
+        FileInfo info;
+        mStream >> info.version;
 
         // Check if the version matches
-        if(checkVersion(formatID, version, mModelName) == false)
+        if(checkVersion(formatID, info.version, mModelName) == false)
         {
             return false;
         }
 
-        int numTextureSlots;
-        int numAttributesType = AttribType_AORadius + 1;
+        info.numAttributesType = AttribType_AORadius + 1;
 
-        switch(version)
+        switch(info.version)
         {
-        case 1:     numTextureSlots = 0; break;
-        case 2:     numTextureSlots = TextureType_Alpha + 1; break;
-        case 3:     numTextureSlots = TextureType_Displacement + 1; break;
-        case 4:     numTextureSlots = TextureType_Environment + 1; break;
-        case 5:     numTextureSlots = TextureType_Specular + 1; break;
-        case 6:     numTextureSlots = TextureType_Specular + 1; break;
-        case 7:     numTextureSlots = TextureType_Glossiness + 1; break;
-        case 8:     numTextureSlots = TextureType_Glossiness + 1; numAttributesType = AttribType_Max; break;
+        case 1:     info.numTextureSlots = 0; break;
+        case 2:     info.numTextureSlots = TextureType_Alpha + 1; break;
+        case 3:     info.numTextureSlots = TextureType_Displacement + 1; break;
+        case 4:     info.numTextureSlots = TextureType_Environment + 1; break;
+        case 5:     info.numTextureSlots = TextureType_Specular + 1; break;
+        case 6:     info.numTextureSlots = TextureType_Specular + 1; break;
+        case 7:     info.numTextureSlots = TextureType_Glossiness + 1; break;
+        case 8:     info.numTextureSlots = TextureType_Glossiness + 1; info.numAttributesType = AttribType_Max; break;
+        case 9:     info.numTextureSlots = TextureType_Max; info.numAttributesType = AttribType_Max; break;
         default:
             should_not_get_here();
             return false;
         }
 
-
         // File header
-        int32_t numTextures = 0;
-        int32_t numMeshes = 0;
-        int32_t numInstances = 0;
-        int32_t numAttribs_v5 = 0;
-        int32_t numVertices_v5 = 0;
-        int32_t numSubmeshes_v5 = 0;
+        int32_t numSubmeshes = 0;
+        uint64_t instancesOffset = 0;
 
-        if(version >= 6)
+        if(info.version >= kBinarySceneTocVersion)
+        {
+            mStream >> info.numTextures >> info.numMeshes >> info.numInstances >> numSubmeshes >> instancesOffset;
+        }
+        else if(info.version >= 6)
         {
-            mStream >> numTextures >> numMeshes >> numInstances;
+            mStream >> info.numTextures >> info.numMeshes >> info.numInstances;
         }
         else
         {
-            numMeshes = 1;
-            numInstances = 1;
-            mStream >> numAttribs_v5 >> numVertices_v5 >> numSubmeshes_v5;
-            if(version >= 2)
+            info.numMeshes = 1;
+            info.numInstances = 1;
+            mStream >> info.numAttribs_v5 >> info.numVertices_v5 >> info.numSubmeshes_v5;
+            if(info.version >= 2)
             {
-                mStream >> numTextures;
+                mStream >> info.numTextures;
             }
         }
 
-        if(numTextures < 0 || numMeshes < 0 || numInstances < 0)
+        // The v9 table of contents must fit in the file
+        const uint64_t tocSize = (info.version >= kBinarySceneTocVersion) ? ((uint64_t)info.numTextures + info.numMeshes + numSubmeshes) * sizeof(uint64_t) : 0;
+        if(mStream.isFail() || info.numTextures < 0 || info.numMeshes < 0 || info.numInstances < 0 || numSubmeshes < 0 || tocSize > mStream.getRemainingStreamSize())
         {
             std::string msg = "Error when loading model " + mModelName + ".\nFile is corrupted.";
             logError(msg);
             return false;
         }
 
-        // create objects
-        bool shouldGenerateTangents = is_set(flags, Model::LoadFlags::DontGenerateTangentSpace) == false;
-
+        // Find where every mesh and texture starts
+        std::vector<uint64_t> textureOffsets;
+        std::vector<uint64_t> meshOffsets(info.numMeshes);
         std::vector<TextureData> texData;
 
-        if(version >= 6)
+        if(info.version >= kBinarySceneTocVersion)
         {
-            importTextures(texData, numTextures, mStream, mModelName);
+            textureOffsets.resize(info.numTextures);
+            info.submeshOffsets.resize(numSubmeshes);
+            mStream.read(textureOffsets.data(), textureOffsets.size() * sizeof(uint64_t));
+            mStream.read(meshOffsets.data(), meshOffsets.size() * sizeof(uint64_t));
+            mStream.read(info.submeshOffsets.data(), info.submeshOffsets.size() * sizeof(uint64_t));
+            texData.resize(info.numTextures);
         }
-
-        // This file format has a concept of sub-meshes, which Falcor model doesn't have - Falcor creates a new mesh for each sub-mesh
-        // When creating instances of meshes, it means we need to translate the original mesh index to all it's submeshes Falcor IDs. This is what the next 2 variables are for.
-        std::vector<std::vector<uint32_t>> meshToSubmeshesID(numMeshes);
-
-        // This importer loads mesh/submesh data before instance data, so the meshes are cached here.
-        std::vector<Mesh::SharedPtr> falcorMeshCache;
-        
-        struct TexSignature
-        {
-            const uint8_t* pData;
-            ResourceFormat format;
-            bool operator<(const TexSignature& other) const 
-            { 
-                if(pData < other.pData) return true;
-                if(pData == other.pData) return format < other.format;
-                return false;
-            }
-            bool operator==(const TexSignature& other) const { return pData == other.pData || format == other.format; }
-        };
-        std::map<TexSignature, Texture::SharedPtr> textures;
-        bool loadTexAsSrgb = !is_set(flags, Model::LoadFlags::AssumeLinearSpaceTextures);
-
-        // Load the meshes
-        for(int meshIdx = 0; meshIdx < numMeshes; meshIdx++)
+        else if(info.version >= 6)
         {
-            // Mesh header
-            int32_t numAttribs = 0;
-            int32_t numVertices = 0;
-            int32_t numSubmeshes = 0;
-
-            if(version >= 6)
-            {
-                mStream >> numAttribs >> numVertices >> numSubmeshes;
-            }
-            else
+            // Textures come first. The meshes don't have a table of contents, so scan the file for them.
+            if(importTextures(texData, info.numTextures, mStream, mModelName) == false)
             {
-                numAttribs = numAttribs_v5;
-                numVertices = numVertices_v5;
-                numSubmeshes = numSubmeshes_v5;
-            }
-
-            if(numAttribs < 0 || numVertices < 0 || numSubmeshes < 0)
-            {
-                std::string Msg = "Error when loading model " + mModelName + ".\nCorrupted data.!";
-                logError(Msg);
                 return false;
             }
 
-            Vao::BufferVec pVBs;
-            VertexLayout::SharedPtr pLayout = VertexLayout::create();
-            
-            struct BufferData
-            {
-                std::vector<uint8_t> vec;
-                bool shouldSkip = false;
-                uint32_t elementSize = 0;
-            };
-
-            std::vector<BufferData> buffers;
-            pVBs.resize(numAttribs);
-            buffers.resize(numAttribs);
-
-            const uint32_t kInvalidBufferIndex = (uint32_t)-1;
-            uint32_t positionBufferIndex = kInvalidBufferIndex;
-            uint32_t normalBufferIndex = kInvalidBufferIndex;
-            uint32_t bitangentBufferIndex = kInvalidBufferIndex;
-            uint32_t texCoordBufferIndex = kInvalidBufferIndex;
-
-            for(int i = 0; i < numAttribs; i++)
+            for(int32_t meshIdx = 0; meshIdx < info.numMeshes; meshIdx++)
             {
-                VertexBufferLayout::SharedPtr pBufferLayout = VertexBufferLayout::create();
-                pLayout->addBufferLayout(i, pBufferLayout);
-                int32_t type, format, length;
-                mStream >> type >> format >> length;
-
-                if(type < 0 || type >= numAttributesType || format < 0 || format >= AttribFormat::AttribFormat_Max || length < 1 || length > 4)
+                meshOffsets[meshIdx] = mStream.getPosition();
+                if(skipMesh(mStream, info) == false)
                 {
                     std::string msg = "Error when loading model " + mModelName + ".\nCorrupted data.!";
                     logError(msg);
                     return false;
                 }
-                else
-                {
-                    const std::string falcorName = getSemanticName(AttribType(type));
-                    ResourceFormat falcorFormat = getFalcorFormat(AttribFormat(format), length);
-                    uint32_t shaderLocation = getShaderLocation(AttribType(type));
-
-                    switch (shaderLocation)
-                    {
-                    case VERTEX_POSITION_LOC:
-                        positionBufferIndex = i;
-                        assert(falcorFormat == ResourceFormat::RGB32Float || falcorFormat == ResourceFormat::RGBA32Float);
-                        break;
-                    case VERTEX_NORMAL_LOC:
-                        normalBufferIndex = i;
-                        assert(falcorFormat == ResourceFormat::RGB32Float);
-                        break;
-                    case VERTEX_BITANGENT_LOC:
-                        bitangentBufferIndex = i;
-                        assert(falcorFormat == ResourceFormat::RGB32Float);
-                        break;
-                    case VERTEX_TEXCOORD_LOC:
-                        texCoordBufferIndex = i;
-                        break;
-                    }
-
-                    buffers[i].elementSize = getFormatBytesPerBlock(falcorFormat);
-                    if(shaderLocation != kUnusedShaderElement)
-                    {
-                        pBufferLayout->addElement(falcorName, 0, falcorFormat, 1, shaderLocation);
-                        buffers[i].vec.resize(buffers[i].elementSize * numVertices);
-                    }
-                    else
-                    {
-                        buffers[i].shouldSkip = true;
-                    }
-                }
             }
+            instancesOffset = mStream.getPosition();
+        }
+        else
+        {
+            meshOffsets[0] = mStream.getPosition();
+        }
 
-            
-            // Check if we need to generate tangents  
-            bool genTangentForMesh = false;
-            if(shouldGenerateTangents && (bitangentBufferIndex == kInvalidBufferIndex))
+        if(mStream.isFail())
+        {
+            std::string msg = "Error when loading model " + mModelName + ".\nFile is corrupted.";
+            logError(msg);
+            return false;
+        }
+
+        // Select the meshes to load
+        std::vector<uint32_t> meshesToLoad;
+        if(pMeshIDs)
+        {
+            std::vector<bool> isSelected(info.numMeshes, false);
+            for(uint32_t meshID : *pMeshIDs)
             {
-                if(normalBufferIndex == kInvalidBufferIndex)
+                if(meshID >= (uint32_t)info.numMeshes)
                 {
-                    logWarning("Can't generate tangent space for mesh " + std::to_string(meshIdx) + " when loading model " + mModelName + ".\nMesh doesn't contain normals coordinates\n");
-                    genTangentForMesh = false;
+                    logWarning("Model " + mModelName + " doesn't contain mesh " + std::to_string(meshID) + ". Ignoring it.");
+                    continue;
                 }
-                else
+                isSelected[meshID] = true;
+            }
+            for(int32_t meshIdx = 0; meshIdx < info.numMeshes; meshIdx++)
+            {
+                if(isSelected[meshIdx])
                 {
-                    // Set the offsets
-                    genTangentForMesh = true;
-                    bitangentBufferIndex = (uint32_t)pVBs.size();
-                    pVBs.resize(bitangentBufferIndex + 1);
-                    buffers.resize(bitangentBufferIndex + 1);
-                   
-                    auto pBitangentLayout = VertexBufferLayout::create();
-                    pLayout->addBufferLayout(bitangentBufferIndex, pBitangentLayout);
-                    pBitangentLayout->addElement(VERTEX_BITANGENT_NAME, 0, ResourceFormat::RGB32Float, 1, VERTEX_BITANGENT_LOC);
-                    buffers[bitangentBufferIndex].vec.resize(sizeof(glm::vec3) * numVertices);
+                    meshesToLoad.push_back(meshIdx);
                 }
             }
-            
+        }
+        else
+        {
+            for(int32_t meshIdx = 0; meshIdx < info.numMeshes; meshIdx++)
+            {
+                meshesToLoad.push_back(meshIdx);
+            }
+        }
+
+        // Decode the meshes. Each mesh is decoded independently, so when the file is mapped all of them are decoded in parallel, each through its own view of the mapping.
+        bool shouldGenerateTangents = is_set(flags, Model::LoadFlags::DontGenerateTangentSpace) == false;
+        std::vector<MeshData> meshData(info.numMeshes);
 
-            // Read the data, one vertex at a time
-            for(int32_t i = 0; i < numVertices; i++)
+        if(mStream.isMapped() && info.version >= 6)
+        {
+            JobSystem::parallelFor((uint32_t)meshesToLoad.size(), [&](uint32_t i)
+            {
+                uint32_t meshIdx = meshesToLoad[i];
+                BinaryFileStream meshStream(mStream, meshOffsets[meshIdx]);
+                decodeMesh(meshStream, info, meshIdx, shouldGenerateTangents, mModelName, nullptr, meshData[meshIdx]);
+            });
+        }
+        else
+        {
+            for(uint32_t meshIdx : meshesToLoad)
             {
-                for (int32_t attributes = 0; attributes < numAttribs; ++attributes)
+                mStream.seek(meshOffsets[meshIdx]);
+                decodeMesh(mStream, info, meshIdx, shouldGenerateTangents, mModelName, &texData, meshData[meshIdx]);
+            }
+        }
+
+        for(uint32_t meshIdx : meshesToLoad)
+        {
+            if(meshData[meshIdx].warning.size())
+            {
+                logWarning(meshData[meshIdx].warning);
+            }
+            if(meshData[meshIdx].error.size())
+            {
+                logError(meshData[meshIdx].error);
+                return false;
+            }
+        }
+
+        // v9 files only load the textures referenced by the loaded meshes
+        std::vector<uint32_t> texturesToDecode;
+        if(info.version >= kBinarySceneTocVersion)
+        {
+            std::vector<bool> isReferenced(info.numTextures, false);
+            for(uint32_t meshIdx : meshesToLoad)
+            {
+                for(const auto& submesh : meshData[meshIdx].submeshes)
                 {
-                    if (buffers[attributes].shouldSkip)
-                    {
-                        mStream.skip(buffers[attributes].elementSize);
-                    }
-                    else
+                    for(int32_t texID : submesh.texIDs)
                     {
-                        uint32_t stride = pLayout->getBufferLayout(attributes)->getStride();
-                        uint8_t* pDest = buffers[attributes].vec.data() + stride * i;
-                        mStream.read(pDest, stride);
+                        if(texID != -1)
+                        {
+                            isReferenced[texID] = true;
+                        }
                     }
                 }
             }
 
-            for (int32_t i = 0; i < numAttribs; ++i)
+            for(int32_t texID = 0; texID < info.numTextures; texID++)
             {
-                if(buffers[i].shouldSkip == false)
+                if(isReferenced[texID])
                 {
-                    pVBs[i] = Buffer::create(buffers[i].vec.size(), Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, buffers[i].vec.data());
+                    mStream.seek(textureOffsets[texID]);
+                    texData[texID].name = readString(mStream);
+                    if(loadBinaryTextureData(mStream, mModelName, texData[texID]) == false)
+                    {
+                        return false;
+                    }
                 }
             }
+        }
 
-            if(version <= 5)
+        // Expand RGB textures in parallel
+        for(uint32_t texID = 0; texID < (uint32_t)texData.size(); texID++)
+        {
+            if(texData[texID].pRgbData)
             {
-                importTextures(texData, numTextures, mStream, mModelName);
-                textures.clear();
+                texturesToDecode.push_back(texID);
             }
+        }
+        JobSystem::parallelFor((uint32_t)texturesToDecode.size(), [&](uint32_t i)
+        {
+            expandRgbTextureData(texData[texturesToDecode[i]]);
+        });
 
-            // Array of Submesh.
-            // Falcor doesn't have a concept of submeshes, just create a new mesh for each submesh
-            for(int submesh = 0; submesh < numSubmeshes; submesh++)
-            {
-                // create the material
-                BasicMaterial basicMaterial;
-
-                glm::vec3 ambient;
-                glm::vec4 diffuse;
-                glm::vec3 specular;
-                float glossiness;
+        // Create the API resources. This is done on the calling thread, in file order, so the results don't depend on the decoding order.
+        // This file format has a concept of sub-meshes, which Falcor model doesn't have - Falcor creates a new mesh for each sub-mesh
+        // When creating instances of meshes, it means we need to translate the original mesh index to all it's submeshes Falcor meshes.
+        std::vector<std::vector<Mesh::SharedPtr>> meshToSubmeshes(info.numMeshes);
+        TextureMap textures;
+        bool loadTexAsSrgb = !is_set(flags, Model::LoadFlags::AssumeLinearSpaceTextures);
 
-                mStream >> ambient >> diffuse >> specular >> glossiness;
-                basicMaterial.diffuseColor = glm::vec3(diffuse);
-                basicMaterial.opacity = 1 - diffuse.w;
-                basicMaterial.specularColor = specular;
-                basicMaterial.shininess = glossiness;
+        for(uint32_t meshIdx : meshesToLoad)
+        {
+            MeshData& mesh = meshData[meshIdx];
 
-                if(version >= 3)
+            Vao::BufferVec pVBs(mesh.streams.size());
+            for(size_t i = 0; i < mesh.streams.size(); i++)
+            {
+                if(mesh.streams[i].shouldSkip == false)
                 {
-                    float displacementCoeff;
-                    float displacementBias;
-                    mStream >> displacementCoeff >> displacementBias;
-                    basicMaterial.bumpScale = displacementCoeff;
-                    basicMaterial.bumpOffset = displacementBias;
+                    pVBs[i] = RenderThreadQueue::call([&]() { return Buffer::create((size_t)mesh.streams[i].elementSize * mesh.numVertices, Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, mesh.streams[i].pData); });
                 }
+            }
 
-                for(int i = 0; i < numTextureSlots; i++)
+            // Falcor doesn't have a concept of submeshes, just create a new mesh for each submesh
+            for(const auto& submesh : mesh.submeshes)
+            {
+                // create the material
+                BasicMaterial basicMaterial = submesh.material;
+                for(int i = 0; i < info.numTextureSlots; i++)
                 {
-                    int32_t texID;
-                    mStream >> texID;
-                    if(texID < -1 || texID >= numTextures)
-                    {
-                        std::string msg = "Error when loading model " + mModelName + ".\nCorrupt binary mesh data!";
-                        logError(msg);
-                        return false;
-                    }
-                    else if(texID != -1)
+                    int32_t texID = submesh.texIDs[i];
+                    if(texID != -1)
                     {
                         BasicMaterial::MapType falcorType = getFalcorMapType(TextureType(i));
                         if(BasicMaterial::MapType::Count == falcorType)
@@ -843,105 +1230,39 @@ namespace Falcor
                         }
 
                         // Load the texture
-                        TexSignature texSig;
-                        texSig.format = getFormatFromMapType(loadTexAsSrgb, texData[texID].format, falcorType);
-                        texSig.pData = texData[texID].data.data();
-                        // Check if we already created a matching texture
-                        auto existingTex = textures.find(texSig);
-                        if(existingTex != textures.end())
-                        {
-                            basicMaterial.pTextures[falcorType] = existingTex->second;
-                        }
-                        else
-                        {
-                            auto pTexture = Texture::create2D(texData[texID].width, texData[texID].height, texSig.format, 1, Texture::kMaxPossible, texSig.pData);
-                            pTexture->setSourceFilename(texData[texID].name);
-                            textures[texSig] = pTexture;
-                            basicMaterial.pTextures[falcorType] = pTexture;
-                        }
+                        ResourceFormat texFormat = getFormatFromMapType(loadTexAsSrgb, texData[texID].format, falcorType);
+                        basicMaterial.pTextures[falcorType] = getOrCreateTexture(textures, texData[texID], texFormat);
                     }
                 }
 
                 // Create material and check if it already exists
                 auto pMaterial = checkForExistingMaterial(basicMaterial.convertToMaterial());
 
-                int32_t numTriangles;
-                mStream >> numTriangles;
-                if(numTriangles < 0)
-                {
-                    std::string Msg = "Error when loading model " + mModelName + ".\nMesh has negative number of triangles!";
-                    logError(Msg);
-                    return false;
-                }
-
                 // create the index buffer
-                uint32_t numIndices = numTriangles * 3;
-                std::vector<uint32_t> indices(numIndices);
-                uint32_t ibSize = 3 * numTriangles * sizeof(uint32_t);
-                mStream.read(&indices[0], ibSize);
-
-                auto pIB = Buffer::create(ibSize, Buffer::BindFlags::Index, Buffer::CpuAccess::None, indices.data());
-
-                // Generate tangent space data if needed
-                if(genTangentForMesh)
-                {
-                    uint32_t texCrdCount = 0;
-                    glm::vec2* texCrd = nullptr;
-                    if(texCoordBufferIndex != kInvalidBufferIndex)
-                    {
-                        texCrdCount = pLayout->getBufferLayout(texCoordBufferIndex)->getStride() / sizeof(glm::vec2);
-                        texCrd = (glm::vec2*)buffers[texCoordBufferIndex].vec.data();
-                    }
-
-                    ResourceFormat posFormat = pLayout->getBufferLayout(positionBufferIndex)->getElementFormat(0);
-
-                    if (posFormat == ResourceFormat::RGB32Float)
-                    {
-                        generateSubmeshTangentData<glm::vec3>(indices, (glm::vec3*)buffers[positionBufferIndex].vec.data(), (glm::vec3*)buffers[normalBufferIndex].vec.data(), texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
-                    }
-                    else if (posFormat == ResourceFormat::RGBA32Float)
-                    {
-                        generateSubmeshTangentData<glm::vec4>(indices, (glm::vec4*)buffers[positionBufferIndex].vec.data(), (glm::vec3*)buffers[normalBufferIndex].vec.data(), texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
-                    }
-
-                    pVBs[bitangentBufferIndex] = Buffer::create(buffers[bitangentBufferIndex].vec.size(), Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, buffers[bitangentBufferIndex].vec.data());
-                }
-                
-
-                // Calculate the bounding-box
-                glm::vec3 max, min;
-                for(uint32_t i = 0; i < numIndices; i++)
-                {
-                    uint32_t vertexID = indices[i];
-                    uint8_t* pVertex = (pLayout->getBufferLayout(positionBufferIndex)->getStride() * vertexID) + buffers[positionBufferIndex].vec.data();
-
-                    float* pPosition = (float*)pVertex;
-
-                    glm::vec3 xyz(pPosition[0], pPosition[1], pPosition[2]);
-                    min = glm::min(min, xyz);
-                    max = glm::max(max, xyz);
-                }
-
-                BoundingBox box = BoundingBox::fromMinMax(min, max);
+                size_t ibSize = (size_t)submesh.numIndices * sizeof(uint32_t);
+                auto pIB = RenderThreadQueue::call([&]() { return Buffer::create(ibSize, Buffer::BindFlags::Index, Buffer::CpuAccess::None, submesh.pIndices); });
 
                 // create the mesh
-                auto pMesh = Mesh::create(pVBs, numVertices, pIB, numIndices, pLayout, Vao::Topology::TriangleList, pMaterial, box, false);
+                auto pMesh = Mesh::create(pVBs, mesh.numVertices, pIB, submesh.numIndices, mesh.pLayout, Vao::Topology::TriangleList, pMaterial, submesh.box, false);
 
-                if (version >= 6)
+                if(info.version >= 6)
                 {
-                    falcorMeshCache.push_back(pMesh);
-                    meshToSubmeshesID[meshIdx].push_back((uint32_t)(falcorMeshCache.size() - 1));
+                    meshToSubmeshes[meshIdx].push_back(pMesh);
                 }
                 else
                 {
                     model.addMeshInstance(pMesh, glm::mat4());
                 }
             }
+
+            // Release the CPU copy as soon as the API resources were created
+            mesh = MeshData();
         }
 
-        if(version >= 6)
+        if(info.version >= 6)
         {
-            for(int32_t instanceID = 0; instanceID < numInstances; instanceID++)
+            mStream.seek(instancesOffset);
+            for(int32_t instanceID = 0; instanceID < info.numInstances; instanceID++)
             {
                 int32_t meshIdx = 0;
                 int32_t enabled = 1;
@@ -952,11 +1273,18 @@ namespace Falcor
                 readString(mStream);   // Name
                 readString(mStream);   // Meta-data
 
-                if(enabled)
+                if(mStream.isFail() || meshIdx < -1 || meshIdx >= info.numMeshes)
+                {
+                    std::string msg = "Error when loading model " + mModelName + ".\nCorrupted instance data.";
+                    logError(msg);
+                    return false;
+                }
+
+                if(enabled && meshIdx != -1)
                 {
-                    for(uint32_t i : meshToSubmeshesID[meshIdx])
+                    for(const auto& pMesh : meshToSubmeshes[meshIdx])
                     {
-                        model.addMeshInstance(falcorMeshCache[i], transformation);
+                        model.addMeshInstance(pMesh, transformation);
                     }
                 }
             }
@@ -27,6 +27,7 @@
 ***************************************************************************/
 #pragma once
 #include <string>
+#include <vector>
 #include "Utils/BinaryFileStream.h"
 #include "glm/vec3.hpp"
 #include "../Model.h"
@@ -46,9 +47,18 @@ namespace Falcor
         */
         static bool import(Model& model, const std::string& filename, Model::LoadFlags flags);
 
+        /** import a subset of the meshes of a model in internal binary format. Only the requested meshes, the textures they use and the instances referencing them are loaded.
+            Files older than v9 don't have a table of contents, so the entire file is scanned to locate the meshes.
+            \param[in] filename Model's filename. Loader will look for it in the data directories.
+            \param[in] flags Flags controlling model creation
+            \param[in] meshIDs Indices of the meshes to load, as stored in the file
+            returns false if loading failed
+        */
+        static bool import(Model& model, const std::string& filename, Model::LoadFlags flags, const std::vector<uint32_t>& meshIDs);
+
     private:
         BinaryModelImporter(const std::string& fullpath);
-        bool importModel(Model& model, Model::LoadFlags flags);
+        bool importModel(Model& model, Model::LoadFlags flags, const std::vector<uint32_t>* pMeshIDs);
 
         std::string mModelName;
         BinaryFileStream mStream;
@@ -30,7 +30,7 @@
 //------------------------------------------------------------------------
 /*
 
-Binary scene file format v8
+Binary scene file format v9
 ---------------------------
 
 - The basic units of data are 32-bit little-endian ints and floats.
@@ -38,15 +38,33 @@ Binary scene file format v8
 - Each individual field is marked with the version number where it was introduced.
 - Legacy structs are postfixed with the highest version number for which they are still valid.
 - Each line describes: <ofs_dwords> <size_dwords> <Type> <version> <name> (<comments>)
+- Offsets stored in v9 files are 64-bit byte offsets from the start of the file.
+- In v9 files, every Texture, Mesh_v9, VertexStream, Submesh index array and the Instance array start on a 16-byte boundary. Padding bytes are zero.
 
 File
 0       2       string8 v6  formatID            ("BinScene")
-2       1       int     v6  formatVersion       (6)
+2       1       int     v6  formatVersion       (9)
+3       1       int     v6  numTextures
+4       1       int     v6  numMeshes
+5       1       int     v6  numInstances
+6       1       int     v9  numSubmeshes        (total over all meshes)
+7       2       int64   v9  instancesOffset     (offset of the Instance array)
+9       n*2     int64   v9  textureOffsets      (numTextures)
+?       n*2     int64   v9  meshOffsets         (numMeshes)
+?       n*2     int64   v9  submeshOffsets      (numSubmeshes, in mesh order)
+?       n*?     array   v6  Texture             (numTextures)
+?       n*?     array   v9  Mesh                (numMeshes)
+?       n*?     array   v6  Instance            (numInstances)
+?
+
+File_v8
+0       2       string8 v6  formatID            ("BinScene")
+2       1       int     v6  formatVersion       (6 .. 8)
 3       1       int     v6  numTextures
 4       1       int     v6  numMeshes
 5       1       int     v6  numInstances
 6       n*?     array   v6  Texture             (numTextures)
-?       n*?     array   v6  Mesh                (numMeshes)
+?       n*?     array   v6  Mesh_v8             (numMeshes)
 ?       n*?     array   v6  Instance            (numInstances)
 ?
 
@@ -60,7 +78,7 @@ File_v5
 7       n*3     array   v1  AttribSpec          (numAttribs)
 ?       n*?     array   v1  Vertex              (numVertices)
 ?       n*?     array   v2  Texture             (numTextures)
-?       n*?     array   v1  Submesh             (numSubmeshes)
+?       n*?     array   v1  Submesh_v8          (numSubmeshes)
 ?
 
 Texture
@@ -70,12 +88,22 @@ Texture
 ?
 
 Mesh
+0       1       int     v9  numAttribs
+1       1       int     v9  numVertices
+2       1       int     v9  numSubmeshes
+3       1       int     v9  firstSubmesh        (index of the mesh's first entry in submeshOffsets)
+4       n*3     array   v9  AttribSpec          (numAttribs)
+?       n*?     array   v9  VertexStream        (numAttribs, one non-interleaved stream per attribute)
+?       n*?     array   v9  Submesh             (numSubmeshes)
+?
+
+Mesh_v8
 0       1       int     v6  numAttribs
 1       1       int     v6  numVertices
 2       1       int     v6  numSubmeshes
 3       n*3     array   v6  AttribSpec          (numAttribs)
 ?       n*?     array   v6  Vertex              (numVertices)
-?       n*?     array   v6  Submesh             (numSubmeshes)
+?       n*?     array   v6  Submesh_v8          (numSubmeshes)
 ?
 
 AttribSpec
@@ -88,7 +116,25 @@ Vertex
 0       ?       bytes   v1  vertex data         (dictated by the AttribSpecs)
 ?
 
+VertexStream
+0       ?       bytes   v9  attribute data      (numVertices elements, tightly packed, dictated by the AttribSpec)
+?
+
 Submesh
+0       3       float   v9  ambient             (ignored)
+3       4       float   v9  diffuse
+7       3       float   v9  specular
+10      1       float   v9  glossiness
+11      1       float   v9  displacementCoef
+12      1       float   v9  displacementBias
+13      n*1     int     v9  textures            (TextureType_Max texture IDs, -1 if none)
+?       3       float   v9  boundsMin
+?       3       float   v9  boundsMax
+?       1       int     v9  numTriangles
+?       n*3     int     v9  indices             (numTriangles * 3)
+?
+
+Submesh_v8
 0       3       float   v1  ambient             (ignored)
 3       4       float   v1  diffuse
 7       3       float   v1  specular
@@ -115,9 +161,16 @@ Instance
 ?       ?       string  v6  metadataString
 ?
 
+Tangent frames
+- A v9 mesh that has normals always contains an AttribType_Bitangent stream. Tangent frames are generated at export time, so importers never need to generate them.
+
 */
 //------------------------------------------------------------------------
 
+static const int kBinarySceneTocVersion = 9;    // First version with a table of contents
+static const int kBinarySceneLatestVersion = 9;
+static const int kBinarySceneAlignment = 16;    // Alignment of v9 data blocks in bytes
+
 enum AttribType // allows arbitrary values
 {
     AttribType_Position = 0,    // (x, y, z) or (x, y, z, w)
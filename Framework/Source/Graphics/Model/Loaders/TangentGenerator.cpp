@@ -0,0 +1,264 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TangentGenerator.h"
+#include "Utils/JobSystem.h"
+#include "Utils/Math/SimdOps.h"
+#include <algorithm>
+#include <cfloat>
+
+namespace Falcor
+{
+    template<typename T>
+    static const T& getElement(const T* pData, uint32_t stride, uint32_t index)
+    {
+        return *(const T*)((const uint8_t*)pData + (size_t)stride * index);
+    }
+
+    struct TangentInput
+    {
+        const uint32_t* pIndices;
+        const glm::vec3* pPositions;
+        uint32_t positionStride;
+        const glm::vec3* pNormals;
+        const glm::vec2* pTexCrd;
+        uint32_t texCrdStride;
+    };
+
+    // Triangles are processed in batches, one triangle per SIMD lane. The kernel mirrors the original scalar glm code operation by operation
+    // (same evaluation order, IEEE division and square-root, no reciprocal approximations), so the results are bit-identical to it.
+    template<typename Ops>
+    struct TangentKernel
+    {
+        using Reg = typename Ops::Reg;
+        static const uint32_t W = Ops::kWidth;
+
+        struct Vec3
+        {
+            Reg x, y, z;
+        };
+
+        static Vec3 sub(const Vec3& a, const Vec3& b)     { return{ Ops::sub(a.x, b.x), Ops::sub(a.y, b.y), Ops::sub(a.z, b.z) }; }
+        static Vec3 mul(const Vec3& a, Reg s)             { return{ Ops::mul(a.x, s), Ops::mul(a.y, s), Ops::mul(a.z, s) }; }
+        static Reg dot(const Vec3& a, const Vec3& b)      { return Ops::add(Ops::add(Ops::mul(a.x, b.x), Ops::mul(a.y, b.y)), Ops::mul(a.z, b.z)); }
+        static Reg neg(Reg a)                             { return Ops::bitXor(a, Ops::set1(-0.0f)); }
+        static Reg abs(Reg a)                             { return Ops::bitAndNot(Ops::set1(-0.0f), a); }
+        static Reg select(Reg mask, Reg a, Reg b)         { return Ops::bitOr(Ops::bitAnd(mask, a), Ops::bitAndNot(mask, b)); }
+        static Vec3 select(Reg mask, const Vec3& a, const Vec3& b) { return{ select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z) }; }
+
+        // Matches isSpecialFloat() - the exponent is all ones for Inf and NaN
+        static Reg isSpecial(Reg a)                       { return Ops::cmpNotLe(abs(a), Ops::set1(FLT_MAX)); }
+
+        static Vec3 cross(const Vec3& a, const Vec3& b)
+        {
+            return{ Ops::sub(Ops::mul(a.y, b.z), Ops::mul(b.y, a.z)), Ops::sub(Ops::mul(a.z, b.x), Ops::mul(b.z, a.x)), Ops::sub(Ops::mul(a.x, b.y), Ops::mul(b.x, a.y)) };
+        }
+
+        // glm::normalize() multiplies by the inverse length
+        static Vec3 normalize(const Vec3& a)
+        {
+            return mul(a, Ops::div(Ops::set1(1.0f), Ops::sqrt(dot(a, a))));
+        }
+
+        // Project v into the plane formed by n
+        static Vec3 project(const Vec3& v, const Vec3& n)
+        {
+            return sub(v, mul(n, dot(v, n)));
+        }
+
+        /** Process the triangles in [firstPrim, lastPrim). output(cornerIndex, bitangent) is called for every triangle corner, in index-buffer order.
+        */
+        template<typename Output>
+        static void run(const TangentInput& in, size_t firstPrim, size_t lastPrim, const Output& output)
+        {
+            // SoA staging area. Lanes past the end of the range replicate the last triangle and are discarded.
+            alignas(32) float position[3][3][W];
+            alignas(32) float normal[3][3][W];
+            alignas(32) float uv[3][2][W];
+            alignas(32) float result[3][3][W];
+
+            const Reg zero = Ops::set1(0.0f);
+            for(size_t basePrim = firstPrim; basePrim < lastPrim; basePrim += W)
+            {
+                const uint32_t laneCount = (uint32_t)std::min<size_t>(W, lastPrim - basePrim);
+
+                // Get the data
+                for(uint32_t lane = 0; lane < W; lane++)
+                {
+                    size_t primID = basePrim + std::min(lane, laneCount - 1);
+                    for(uint32_t c = 0; c < 3; c++)
+                    {
+                        uint32_t index = in.pIndices[primID * 3 + c];
+                        const glm::vec3& p = getElement(in.pPositions, in.positionStride, index);
+                        const glm::vec3& n = in.pNormals[index];
+                        glm::vec2 t = in.pTexCrd ? getElement(in.pTexCrd, in.texCrdStride, index) : glm::vec2(0.f, 0.f);
+                        for(uint32_t i = 0; i < 3; i++)
+                        {
+                            position[c][i][lane] = p[i];
+                            normal[c][i][lane] = n[i];
+                        }
+                        uv[c][0][lane] = t.x;
+                        uv[c][1][lane] = t.y;
+                    }
+                }
+
+                Vec3 P[3];
+                Vec3 N[3];
+                for(uint32_t c = 0; c < 3; c++)
+                {
+                    P[c] = { Ops::load(position[c][0]), Ops::load(position[c][1]), Ops::load(position[c][2]) };
+                    N[c] = { Ops::load(normal[c][0]), Ops::load(normal[c][1]), Ops::load(normal[c][2]) };
+                }
+
+                // Position delta
+                Vec3 posDelta0 = sub(P[1], P[0]);
+                Vec3 posDelta1 = sub(P[2], P[0]);
+
+                // Texture offset
+                Reg sx = Ops::sub(Ops::load(uv[1][0]), Ops::load(uv[0][0]));
+                Reg sy = neg(Ops::sub(Ops::load(uv[1][1]), Ops::load(uv[0][1])));
+                Reg tx = Ops::sub(Ops::load(uv[2][0]), Ops::load(uv[0][0]));
+                Reg ty = neg(Ops::sub(Ops::load(uv[2][1]), Ops::load(uv[0][1])));
+
+                // when t1, t2, t3 in same position in UV space, just use default UV direction.
+                Reg sIsZero = Ops::bitAnd(Ops::cmpEq(sx, zero), Ops::cmpEq(sy, zero));
+                Reg tIsZero = Ops::bitAnd(Ops::cmpEq(tx, zero), Ops::cmpEq(ty, zero));
+                Reg useDefault = Ops::bitOr(sIsZero, tIsZero);
+
+                // Default direction, derived from the first vertex' normal
+                const Vec3& n0 = N[0];
+                Reg useXZ = Ops::cmpGt(abs(n0.x), abs(n0.y));
+                Reg lengthXZ = Ops::sqrt(Ops::add(Ops::mul(n0.x, n0.x), Ops::mul(n0.z, n0.z)));
+                Reg lengthYZ = Ops::sqrt(Ops::add(Ops::mul(n0.y, n0.y), Ops::mul(n0.z, n0.z)));
+                Vec3 bitangentXZ = { Ops::div(n0.z, lengthXZ), Ops::div(zero, lengthXZ), Ops::div(neg(n0.x), lengthXZ) };
+                Vec3 bitangentYZ = { Ops::div(zero, lengthYZ), Ops::div(n0.z, lengthYZ), Ops::div(neg(n0.y), lengthYZ) };
+                Vec3 defaultBitangent = select(useXZ, bitangentXZ, bitangentYZ);
+                Vec3 defaultTangent = cross(defaultBitangent, n0);
+
+                // tangent points in the direction where to positive X axis of the texture coord's would point in model space
+                // bitangent's points along the positive Y axis of the texture coord's, respectively
+                Reg dirCorrection = select(Ops::cmpLt(Ops::sub(Ops::mul(tx, sy), Ops::mul(ty, sx)), zero), Ops::set1(-1.0f), Ops::set1(1.0f));
+                Vec3 uvTangent;
+                uvTangent.x = Ops::mul(Ops::sub(Ops::mul(posDelta1.x, sy), Ops::mul(posDelta0.x, ty)), dirCorrection);
+                uvTangent.y = Ops::mul(Ops::sub(Ops::mul(posDelta1.y, sy), Ops::mul(posDelta0.y, ty)), dirCorrection);
+                uvTangent.z = Ops::mul(Ops::sub(Ops::mul(posDelta1.z, sy), Ops::mul(posDelta0.z, ty)), dirCorrection);
+                Vec3 uvBitangent;
+                uvBitangent.x = Ops::mul(Ops::sub(Ops::mul(posDelta1.x, sx), Ops::mul(posDelta0.x, tx)), dirCorrection);
+                uvBitangent.y = Ops::mul(Ops::sub(Ops::mul(posDelta1.y, sx), Ops::mul(posDelta0.y, tx)), dirCorrection);
+                uvBitangent.z = Ops::mul(Ops::sub(Ops::mul(posDelta1.z, sx), Ops::mul(posDelta0.z, tx)), dirCorrection);
+
+                Vec3 tangent = select(useDefault, defaultTangent, uvTangent);
+                Vec3 bitangent = select(useDefault, defaultBitangent, uvBitangent);
+
+                // project tangent and bitangent into the plane formed by the vertex' normal
+                for(uint32_t c = 0; c < 3; c++)
+                {
+                    Vec3 localTangent = normalize(project(tangent, N[c]));
+                    Vec3 localBitangent = normalize(project(bitangent, N[c]));
+                    localBitangent = normalize(project(localBitangent, localTangent));
+
+                    // reconstruct tangent/bitangent according to normal and bitangent/tangent when it's infinite or NaN.
+                    Reg isInvalidBitangent = Ops::bitOr(Ops::bitOr(isSpecial(localBitangent.x), isSpecial(localBitangent.y)), isSpecial(localBitangent.z));
+                    localBitangent = select(isInvalidBitangent, normalize(cross(localTangent, N[c])), localBitangent);
+
+                    Ops::store(result[c][0], localBitangent.x);
+                    Ops::store(result[c][1], localBitangent.y);
+                    Ops::store(result[c][2], localBitangent.z);
+                }
+
+                // and write it into the mesh
+                for(uint32_t lane = 0; lane < laneCount; lane++)
+                {
+                    for(uint32_t c = 0; c < 3; c++)
+                    {
+                        output((basePrim + lane) * 3 + c, glm::vec3(result[c][0][lane], result[c][1][lane], result[c][2][lane]));
+                    }
+                }
+            }
+            Ops::finish();
+        }
+    };
+
+    template<typename Output>
+    static void runTangentKernel(const TangentInput& in, size_t firstPrim, size_t lastPrim, const Output& output)
+    {
+        if(isAvxSupported())
+        {
+            TangentKernel<AvxOps>::run(in, firstPrim, lastPrim, output);
+        }
+        else
+        {
+            TangentKernel<SseOps>::run(in, firstPrim, lastPrim, output);
+        }
+    }
+
+    void generateSubmeshTangentData(
+        const uint32_t* pIndices,
+        size_t indexCount,
+        const float* pPositions,
+        uint32_t positionStride,
+        const glm::vec3* pNormals,
+        const glm::vec2* pTexCrd,
+        uint32_t texCrdStride,
+        glm::vec3* pBitangents)
+    {
+        TangentInput in;
+        in.pIndices = pIndices;
+        in.pPositions = (const glm::vec3*)pPositions;
+        in.positionStride = positionStride;
+        in.pNormals = pNormals;
+        in.pTexCrd = pTexCrd;
+        in.texCrdStride = texCrdStride;
+
+        const size_t primCount = indexCount / 3;
+        const size_t kPrimsPerTask = 16 * 1024;
+
+        if(primCount < 2 * kPrimsPerTask)
+        {
+            // Corners are produced in index-buffer order, so writing them directly keeps the last-triangle-wins behavior
+            runTangentKernel(in, 0, primCount, [&](size_t corner, const glm::vec3& bitangent) { pBitangents[pIndices[corner]] = bitangent; });
+            return;
+        }
+
+        // Large submeshes are split between threads. Each task writes the results of its corners into a separate array, which is then scattered
+        // to the vertices in index-buffer order. This makes the output independent of the scheduling.
+        std::vector<glm::vec3> cornerBitangents(primCount * 3);
+        const uint32_t taskCount = (uint32_t)((primCount + kPrimsPerTask - 1) / kPrimsPerTask);
+        JobSystem::parallelFor(taskCount, [&](uint32_t task)
+        {
+            size_t firstPrim = task * kPrimsPerTask;
+            size_t lastPrim = std::min(primCount, firstPrim + kPrimsPerTask);
+            runTangentKernel(in, firstPrim, lastPrim, [&](size_t corner, const glm::vec3& bitangent) { cornerBitangents[corner] = bitangent; });
+        });
+
+        for(size_t i = 0; i < primCount * 3; i++)
+        {
+            pBitangents[pIndices[i]] = cornerBitangents[i];
+        }
+    }
+}
@@ -0,0 +1,55 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "glm/vec2.hpp"
+#include "glm/vec3.hpp"
+
+namespace Falcor
+{
+    /** Generate per-vertex bitangents for a triangle-list. Used by the binary model importer/exporter when a mesh doesn't contain tangent-space data.
+        Each triangle writes the bitangent of its three vertices, so vertices shared between triangles get the value computed by the last triangle referencing them.
+        Triangles are processed with SSE or AVX, selected at runtime, and large index buffers are split between threads. The result doesn't depend on the instruction set or the thread count.
+        \param[in] pIndices Triangle-list indices
+        \param[in] indexCount Number of indices
+        \param[in] pPositions Vertex positions. Only the first 3 components of each element are used
+        \param[in] positionStride Distance in bytes between consecutive positions
+        \param[in] pNormals Vertex normals
+        \param[in] pTexCrd Vertex texture coordinates. Only the first 2 components of each element are used. Can be nullptr
+        \param[in] texCrdStride Distance in bytes between consecutive texture coordinates
+        \param[out] pBitangents Buffer receiving the bitangents. Must be large enough to hold an element for every referenced vertex
+    */
+    void generateSubmeshTangentData(
+        const uint32_t* pIndices,
+        size_t indexCount,
+        const float* pPositions,
+        uint32_t positionStride,
+        const glm::vec3* pNormals,
+        const glm::vec2* pTexCrd,
+        uint32_t texCrdStride,
+        glm::vec3* pBitangents);
+}
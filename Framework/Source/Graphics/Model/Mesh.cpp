@@ -39,7 +39,7 @@
 
 namespace Falcor
 { 
-    uint32_t Mesh::sMeshCounter = 0;
+    std::atomic<uint32_t> Mesh::sMeshCounter(0);
     Mesh::~Mesh() = default;
 
     Mesh::SharedPtr Mesh::create(const Vao::BufferVec& vertexBuffers,
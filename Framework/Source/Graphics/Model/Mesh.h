@@ -26,6 +26,7 @@
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ***************************************************************************/
 #pragma once
+#include <atomic>
 #include <map>
 #include <vector>
 #include "glm/vec3.hpp"
@@ -116,6 +117,10 @@ namespace Falcor
         */
         const uint32_t getId() const { return mId; }
 
+        /** Set the mesh ID. Used by SceneImporter to number the meshes in scene order
+        */
+        void setId(uint32_t id) { mId = id; }
+
         /** Reset all global id counter of model, mesh and material
         */
         static void resetGlobalIdCounter();
@@ -138,7 +143,7 @@ namespace Falcor
             const BoundingBox& boundingBox,
             bool hasBones);
 
-        static uint32_t sMeshCounter;
+        static std::atomic<uint32_t> sMeshCounter;
 
         uint32_t mId;
         uint32_t mIndexCount = 0;
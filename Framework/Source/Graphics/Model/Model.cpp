@@ -46,7 +46,7 @@
 namespace Falcor
 {
 
-    uint32_t Model::sModelCounter = 0;
+    std::atomic<uint32_t> Model::sModelCounter(0);
     const char* Model::kSupportedFileFormatsStr = "Supported Formats\0*.obj;*.bin;*.dae;*.x;*.md5mesh;*.ply;*.fbx;*.3ds;*.blend;*.ase;*.ifc;*.xgl;*.zgl;*.dxf;*.lwo;*.lws;*.lxo;*.stl;*.x;*.ac;*.ms3d;*.cob;*.scn;*.3d;*.mdl;*.mdl2;*.pk3;*.smd;*.vta;*.raw;*.ter\0\0";
 
     // Method to sort meshes
@@ -122,6 +122,14 @@ namespace Falcor
         return SharedPtr(new Model());
     }
 
+    Model::SharedPtr Model::createShallowCopy(const SharedPtr& pModel)
+    {
+        // The deleter holds a reference to the shared model
+        SharedPtr pCopy = SharedPtr(new Model(*pModel), [pModel](Model* pShared) { delete pShared; });
+        pCopy->mName = pModel->mName;
+        return pCopy;
+    }
+
     void Model::exportToBinaryFile(const std::string& filename)
     {
         if(hasSuffix(filename, ".bin", false) == false)
@@ -297,6 +305,13 @@ namespace Falcor
 
     void Model::addMeshInstance(const Mesh::SharedPtr& pMesh, const glm::mat4& baseTransform)
     {
+        // Fails if the InstanceTransformStore is full. The store logs the error
+        MeshInstance::SharedPtr pInstance = MeshInstance::create(pMesh, baseTransform);
+        if(pInstance == nullptr)
+        {
+            return;
+        }
+
         int32_t meshID = -1;
 
         // Linear search from the end. Instances are usually added in order by mesh
@@ -316,7 +331,7 @@ namespace Falcor
             meshID = (int32_t)mMeshes.size() - 1;
         }
 
-        mMeshes[meshID].push_back(MeshInstance::create(pMesh, baseTransform));
+        mMeshes[meshID].push_back(pInstance);
     }
 
     void Model::sortMeshes()
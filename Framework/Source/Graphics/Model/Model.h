@@ -27,6 +27,7 @@
 ***************************************************************************/
 #pragma once
 #include <vector>
+#include <atomic>
 #include <map>
 #include "glm/mat4x4.hpp"
 #include "glm/vec3.hpp"
@@ -67,12 +68,18 @@ namespace Falcor
             BuffersAsShaderResource     = 0x10,   ///< Generate the VBs and IB with the shader-resource-view bind flag
         };
 
-        /** create a new model from file
+        /** create a new model from file. The model isn't shared with other users. Use ModelCache to share models between users which don't modify them.
         */
         static SharedPtr createFromFile(const char* filename, LoadFlags flags = LoadFlags::None);
 
         static SharedPtr create();
 
+        /** Create a model which shares the meshes, materials and buffers of another model. It has its own name, filename and animation state, and keeps the other model alive
+            \param[in] pModel The model to share
+            \return A new model with the same name, filename and meshes
+        */
+        static SharedPtr createShallowCopy(const SharedPtr& pModel);
+
         static const char* kSupportedFileFormatsStr;
 
         virtual ~Model();
@@ -224,6 +231,10 @@ namespace Falcor
         /** Get global ID of the model
         */
         const uint32_t getId() const { return mId; }
+
+        /** Set the model ID. Used by SceneImporter to number the models in scene order
+        */
+        void setId(uint32_t id) { mId = id; }
         
         /** Reset all global id counter of model, mesh and material
         */
@@ -257,7 +268,7 @@ namespace Falcor
         std::string mName;
         std::string mFilename;
 
-        static uint32_t sModelCounter;
+        static std::atomic<uint32_t> sModelCounter;
 
         void calculateModelProperties();
     };
@@ -0,0 +1,337 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "ModelCache.h"
+#include "Utils/OS.h"
+#include "Utils/JobSystem.h"
+#include "Utils/RenderThreadQueue.h"
+#include <algorithm>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
+namespace Falcor
+{
+    struct PendingLoad
+    {
+        JobSystem::JobHandle pLoadedJob;                    // Empty job, submitted by the loader once pModel is set
+        std::thread::id loaderThread;
+        Model::SharedPtr pModel;
+    };
+
+    // A file loaded with a set of flags. The meshes of this model are shared by all the models returned for the file
+    struct CacheEntry
+    {
+        std::weak_ptr<Model> pModel;
+        std::shared_ptr<PendingLoad> pPendingLoad;          // Set while the model is being loaded
+        uint64_t loadID = 0;                                // Identifies the request which loads the model
+        uint64_t bytes = 0;
+        time_t modifiedTime = 0;                            // Modification time of the file when the model was loaded
+    };
+
+    // A model returned to the users, with the properties they requested, sharing the meshes of a loaded file
+    struct SharedModelEntry
+    {
+        std::weak_ptr<Model> pModel;
+        std::weak_ptr<Model> pLoadedModel;                  // The model it shares its meshes with
+    };
+
+    struct ModelCacheData
+    {
+        std::mutex mutex;
+        std::unordered_map<std::string, CacheEntry> entries;
+        std::unordered_map<std::string, SharedModelEntry> sharedModels;
+        ModelCache::Stats stats;
+        uint64_t loadCounter = 0;
+    };
+
+    static ModelCacheData& getCacheData()
+    {
+        static ModelCacheData data;
+        return data;
+    }
+
+    static std::string getCacheKey(const std::string& fullpath, Model::LoadFlags flags)
+    {
+        // File names are case-insensitive on Windows
+        std::string key = canonicalizeFilename(fullpath);
+        std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+        return key + '\n' + std::to_string((uint32_t)flags);
+    }
+
+    static std::string getSharedModelKey(const std::string& cacheKey, const ModelCache::Properties& properties)
+    {
+        return cacheKey + '\n' + std::to_string(properties.activeAnimation) + '\n' + properties.filename + '\n' + properties.name;
+    }
+
+    static uint64_t getGeometrySize(const Model* pModel)
+    {
+        // Meshes can share buffers, so count every buffer once
+        std::set<const Buffer*> buffers;
+        for(uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+        {
+            const Vao::SharedPtr& pVao = pModel->getMesh(meshID)->getVao();
+            if(pVao == nullptr)
+            {
+                continue;
+            }
+
+            for(uint32_t i = 0; i < pVao->getVertexBuffersCount(); i++)
+            {
+                buffers.insert(pVao->getVertexBuffer(i).get());
+            }
+            buffers.insert(pVao->getIndexBuffer().get());
+        }
+
+        uint64_t size = 0;
+        for(const Buffer* pBuffer : buffers)
+        {
+            size += pBuffer ? pBuffer->getSize() : 0;
+        }
+        return size;
+    }
+
+    static void setProperties(Model* pModel, const ModelCache::Properties& properties)
+    {
+        if(properties.filename.size())
+        {
+            pModel->setFilename(properties.filename);
+        }
+        if(properties.name.size())
+        {
+            pModel->setName(properties.name);
+        }
+        if(properties.activeAnimation < pModel->getAnimationsCount())
+        {
+            pModel->setActiveAnimation(properties.activeAnimation);
+        }
+    }
+
+    Model::SharedPtr ModelCache::create(const std::string& filename, Model::LoadFlags flags, const Properties& properties)
+    {
+        Model::SharedPtr pModel = Model::createFromFile(filename.c_str(), flags);
+        if(pModel)
+        {
+            setProperties(pModel.get(), properties);
+        }
+        return pModel;
+    }
+
+    /** Get the model loaded from a file, loading it if needed. The model is never returned to the users, they get models sharing its meshes
+    */
+    static Model::SharedPtr getLoadedModel(const std::string& fullpath, const std::string& key, Model::LoadFlags flags)
+    {
+        const time_t modifiedTime = getFileModifiedTime(fullpath);
+        ModelCacheData& data = getCacheData();
+        std::shared_ptr<PendingLoad> pPendingLoad;
+        uint64_t loadID;
+
+        {
+            std::unique_lock<std::mutex> lock(data.mutex);
+            auto it = data.entries.find(key);
+            if(it != data.entries.end())
+            {
+                CacheEntry& entry = it->second;
+                if(entry.pPendingLoad && entry.pPendingLoad->loaderThread == std::this_thread::get_id())
+                {
+                    // The load is further up this thread's stack, which is running a job the loader waits for. It can't complete before we return, so load a private copy
+                    data.stats.misses++;
+                    lock.unlock();
+                    return Model::createFromFile(fullpath.c_str(), flags);
+                }
+                if(entry.pPendingLoad)
+                {
+                    // Another thread is loading the model. Wait for it without holding the lock, and execute other jobs meanwhile, since the loader might be waiting for one of them
+                    pPendingLoad = entry.pPendingLoad;
+                    lock.unlock();
+                    JobSystem::wait(pPendingLoad->pLoadedJob);
+                    Model::SharedPtr pModel = pPendingLoad->pModel;
+                    lock.lock();
+                    if(pModel)
+                    {
+                        data.stats.hits++;
+                        data.stats.bytesShared += getGeometrySize(pModel.get());
+                    }
+                    return pModel;
+                }
+
+                // Reload the model if the file changed since it was cached
+                Model::SharedPtr pModel = entry.pModel.lock();
+                if(pModel && entry.modifiedTime == modifiedTime)
+                {
+                    data.stats.hits++;
+                    data.stats.bytesShared += entry.bytes;
+                    return pModel;
+                }
+            }
+
+            // Mark the model as loading, so that concurrent requests for the same key will wait for us
+            CacheEntry& entry = data.entries[key];
+            entry.pModel.reset();
+            pPendingLoad = std::make_shared<PendingLoad>();
+            pPendingLoad->pLoadedJob = JobSystem::createJob([]() {});
+            pPendingLoad->loaderThread = std::this_thread::get_id();
+            entry.pPendingLoad = pPendingLoad;
+            entry.loadID = loadID = ++data.loadCounter;
+            entry.modifiedTime = modifiedTime;
+            data.stats.misses++;
+        }
+
+        Model::SharedPtr pModel = Model::createFromFile(fullpath.c_str(), flags);
+        uint64_t bytes = pModel ? getGeometrySize(pModel.get()) : 0;
+
+        {
+            std::lock_guard<std::mutex> lock(data.mutex);
+            // The entry might have been removed by clear() and replaced by another request while we were loading
+            auto it = data.entries.find(key);
+            if(it != data.entries.end() && it->second.loadID == loadID)
+            {
+                if(pModel)
+                {
+                    it->second.pModel = pModel;
+                    it->second.pPendingLoad = nullptr;
+                    it->second.bytes = bytes;
+                }
+                else
+                {
+                    data.entries.erase(it);
+                }
+            }
+            data.stats.bytesLoaded += bytes;
+        }
+
+        pPendingLoad->pModel = pModel;
+        JobSystem::submit(pPendingLoad->pLoadedJob);
+        return pModel;
+    }
+
+    Model::SharedPtr ModelCache::getOrCreate(const std::string& filename, Model::LoadFlags flags, const Properties& properties)
+    {
+        std::string fullpath;
+        if(findFileInDataDirectories(filename, fullpath) == false)
+        {
+            // Let the loader report the error
+            return create(filename, flags, properties);
+        }
+
+        const std::string key = getCacheKey(fullpath, flags);
+        Model::SharedPtr pLoadedModel = getLoadedModel(fullpath, key, flags);
+        if(pLoadedModel == nullptr)
+        {
+            return nullptr;
+        }
+
+        // Requests with the same properties get the same model, as long as it's sharing the meshes of the current version of the file
+        ModelCacheData& data = getCacheData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        SharedModelEntry& entry = data.sharedModels[getSharedModelKey(key, properties)];
+        Model::SharedPtr pModel = entry.pModel.lock();
+        if(pModel == nullptr || entry.pLoadedModel.lock() != pLoadedModel)
+        {
+            pModel = Model::createShallowCopy(pLoadedModel);
+            setProperties(pModel.get(), properties);
+            entry.pModel = pModel;
+            entry.pLoadedModel = pLoadedModel;
+        }
+        return pModel;
+    }
+
+    Model::SharedPtr ModelCache::load(const Request& request)
+    {
+        if(request.isShared)
+        {
+            return getOrCreate(request.filename, request.flags, request.properties);
+        }
+        return create(request.filename, request.flags, request.properties);
+    }
+
+    void ModelCache::loadModels(const std::vector<Request*>& requests)
+    {
+        // Every file is only loaded once. The first shared request for a file loads it, the other shared requests for the file get their model from the cache once it's loaded.
+        // Separate jobs would wait for each other in the cache, and a load which waits for its own jobs (e.g. in parallelFor()) can pick up the job waiting for it, which never completes
+        std::vector<Request*> fileRequests;
+        std::vector<Request*> cachedRequests;
+        std::set<std::string> sharedFiles;
+        for(Request* pRequest : requests)
+        {
+            std::string fullpath;
+            const std::string& path = findFileInDataDirectories(pRequest->filename, fullpath) ? fullpath : pRequest->filename;
+            if(pRequest->isShared && sharedFiles.insert(getCacheKey(path, pRequest->flags)).second == false)
+            {
+                cachedRequests.push_back(pRequest);
+            }
+            else
+            {
+                fileRequests.push_back(pRequest);
+            }
+        }
+
+        RenderThreadQueue::runJobs((uint32_t)fileRequests.size(), [&fileRequests](uint32_t i)
+        {
+            fileRequests[i]->pModel = load(*fileRequests[i]);
+        });
+
+        // The files are cached now, this only creates the models which share their meshes
+        for(Request* pRequest : cachedRequests)
+        {
+            pRequest->pModel = load(*pRequest);
+        }
+    }
+
+    ModelCache::Stats ModelCache::getStats()
+    {
+        ModelCacheData& data = getCacheData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        Stats stats = data.stats;
+        stats.bytesResident = 0;
+        for(const auto& it : data.entries)
+        {
+            if(it.second.pModel.expired() == false)
+            {
+                stats.bytesResident += it.second.bytes;
+            }
+        }
+        return stats;
+    }
+
+    void ModelCache::resetStats()
+    {
+        ModelCacheData& data = getCacheData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        data.stats = Stats();
+    }
+
+    void ModelCache::clear()
+    {
+        ModelCacheData& data = getCacheData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        data.entries.clear();
+        data.sharedModels.clear();
+    }
+}
@@ -0,0 +1,118 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include "Graphics/Model/Model.h"
+
+namespace Falcor
+{
+    /** Process-wide cache of the models loaded from files, used by SceneImporter to load every file only once and share its meshes between all the scene entries which reference it.
+        Files are keyed by their canonical full path and the load flags. Every set of properties the scene sets on a model (name, filename, active animation) gets its own lightweight Model,
+        created with Model::createShallowCopy(), which shares the meshes, materials and buffers of the loaded file. Requests with the same properties get the same Model, so it is fully configured when it is created and never modified afterwards.
+        The cache only keeps weak references, so a file's data is released once the last model using it is dropped. A file which was modified since it was loaded is loaded again.
+        Concurrent requests for a model which is still loading wait for the first request to finish instead of loading the file again. They execute JobSystem jobs while waiting.
+        A request made by a job which the loading thread itself picked up while waiting gets a private copy of the model, since the load can't complete before that job does.
+        Models returned by getOrCreate() are shared and must not be modified. Use create() for models which will be modified (e.g. by material overrides).
+    */
+    class ModelCache
+    {
+    public:
+        static const uint32_t kNoAnimation = (uint32_t)-1;
+
+        /** Per-model properties set by the scene
+        */
+        struct Properties
+        {
+            std::string filename;                       ///< Filename stored in the model, usually the path as written in the scene file. Empty to keep the path the model was loaded from
+            std::string name;                           ///< Model name. Empty to keep the name derived from the filename
+            uint32_t activeAnimation = kNoAnimation;    ///< Active animation. Ignored if the model doesn't have this animation
+        };
+
+        /** A model requested from load() or loadModels()
+        */
+        struct Request
+        {
+            std::string filename;               ///< The model's file. Relative paths are searched in the data directories
+            Model::LoadFlags flags;             ///< The load flags
+            bool isShared;                      ///< True to get the model with getOrCreate(), false to load a private copy with create()
+            Properties properties;              ///< The properties to set on the model
+            Model::SharedPtr pModel;            ///< Receives the model loaded by loadModels()
+        };
+
+        /** Cache statistics
+        */
+        struct Stats
+        {
+            uint64_t hits = 0;              ///< Number of requests which returned an existing model
+            uint64_t misses = 0;            ///< Number of requests which loaded the file
+            uint64_t bytesLoaded = 0;       ///< Size of the vertex and index buffers created by the misses
+            uint64_t bytesShared = 0;       ///< Size of the vertex and index buffers which the hits would have created
+            uint64_t bytesResident = 0;     ///< Size of the vertex and index buffers of the cached models which are still alive
+        };
+
+        /** Get a model from the cache, or load it if it isn't cached
+            \param[in] filename The model's file. Relative paths are searched in the data directories
+            \param[in] flags The load flags
+            \param[in] properties The properties to set on the model
+            \return The cached model, or nullptr if the model failed to load. The model is shared and must not be modified
+        */
+        static Model::SharedPtr getOrCreate(const std::string& filename, Model::LoadFlags flags, const Properties& properties);
+
+        /** Load a model without going through the cache. The model isn't shared, so it can be modified
+            \param[in] filename The model's file. Relative paths are searched in the data directories
+            \param[in] flags The load flags
+            \param[in] properties The properties to set on the model
+            \return A new model, or nullptr if the model failed to load
+        */
+        static Model::SharedPtr create(const std::string& filename, Model::LoadFlags flags, const Properties& properties);
+
+        /** Load a model with getOrCreate() or create(), depending on the request
+            \return The model, or nullptr if the model failed to load
+        */
+        static Model::SharedPtr load(const Request& request);
+
+        /** Load several models in parallel. Every file is loaded by its own job. The importers queue the creation of the API resources, which RenderThreadQueue::runJobs() executes on the calling thread.
+            Shared requests for a file which is already requested by another shared request wait until the file is loaded, then get their model from the cache.
+            Must be called from the render thread, and not from a job.
+            \param[in] requests The requests. The pModel field of each request receives its model, or nullptr if it failed to load
+        */
+        static void loadModels(const std::vector<Request*>& requests);
+
+        /** Get the cache statistics
+        */
+        static Stats getStats();
+
+        /** Reset the hit, miss and byte counters
+        */
+        static void resetStats();
+
+        /** Remove all the entries. Models which are still in use are not affected, but will not be returned by later requests
+        */
+        static void clear();
+    };
+}
@@ -34,12 +34,15 @@
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtx/euler_angles.hpp"
 #include "Utils/Math/FalcorMath.h"
+#include "Graphics/Model/InstanceTransformStore.h"
 
 namespace Falcor
 {
     class SceneRenderer;
     class Model;
 
+    /** An instance of an object with its own transform. The transform is kept in the InstanceTransformStore, the instance only holds its handle
+    */
     template<typename ObjectType>
     class ObjectInstance : public IMovableObject, public inherit_shared_from_this<IMovableObject, ObjectInstance<typename ObjectType>>
     {
@@ -51,12 +54,17 @@ namespace Falcor
             \param[in] pObject Object to create an instance of
             \param[in] baseTransform Base transform matrix of the instance
             \param[in] name Name of the instance
-            \return A new instance of the object if pObject
+            \return A new instance of the object, or nullptr if the InstanceTransformStore is full
         */
         static SharedPtr create(const typename ObjectType::SharedPtr& pObject, const glm::mat4& baseTransform, const std::string& name = "")
         {
-            assert(pObject);
-            return SharedPtr(new ObjectInstance<ObjectType>(pObject, baseTransform, name));
+            SharedPtr pInstance = createUninitialized(pObject, name);
+            if(pInstance)
+            {
+                // #TODO Decompose matrix
+                InstanceTransformStore::setMatrix(pInstance->mTransform, kBase, baseTransform);
+            }
+            return pInstance;
         }
 
         /** Constructs a object instance with a transform
@@ -66,11 +74,16 @@ namespace Falcor
             \param[in] up Base up vector of the instance
             \param[in] scale Base scale of the instance
             \param[in] name Name of the instance
-            \return A new instance of the object
+            \return A new instance of the object, or nullptr if the InstanceTransformStore is full
         */
         static SharedPtr create(const typename ObjectType::SharedPtr& pObject, const glm::vec3& translation, const glm::vec3& target, const glm::vec3& up, const glm::vec3& scale, const std::string& name = "")
         {
-             return SharedPtr(new ObjectInstance<ObjectType>(pObject, translation, target, up, scale, name));
+            SharedPtr pInstance = createUninitialized(pObject, name);
+            if(pInstance)
+            {
+                InstanceTransformStore::setTransform(pInstance->mTransform, kBase, translation, target, up, scale);
+            }
+            return pInstance;
         }
 
         /** Constructs a object instance with a transform
@@ -79,13 +92,28 @@ namespace Falcor
             \param[in] yawPitchRoll Rotation of the instance in radians
             \param[in] scale Base scale of the instance
             \param[in] name Name of the instance
-            \return A new instance of the object
+            \return A new instance of the object, or nullptr if the InstanceTransformStore is full
         */
         static SharedPtr create(const typename ObjectType::SharedPtr& pObject, const glm::vec3& translation, const glm::vec3& yawPitchRoll, const glm::vec3& scale, const std::string& name = "")
         {
-            return SharedPtr(new ObjectInstance<ObjectType>(pObject, translation, yawPitchRoll, scale, name));
+            SharedPtr pInstance = createUninitialized(pObject, name);
+            if(pInstance)
+            {
+                InstanceTransformStore::setTranslation(pInstance->mTransform, kBase, translation);
+                pInstance->setRotation(yawPitchRoll);
+                InstanceTransformStore::setScaling(pInstance->mTransform, kBase, scale);
+            }
+            return pInstance;
+        }
+
+        ~ObjectInstance()
+        {
+            InstanceTransformStore::release(mTransform);
         }
 
+        ObjectInstance(const ObjectInstance&) = delete;
+        ObjectInstance& operator=(const ObjectInstance&) = delete;
+
         /** Gets object for which this is an instance of
             \return Object for this instance
         */
@@ -119,28 +147,27 @@ namespace Falcor
         {
             if (updateLookAt)
             {
-                glm::vec3 toLookAt = mBase.target - mBase.translation;
-                mBase.target = translation + toLookAt;
+                glm::vec3 toLookAt = getTarget() - getTranslation();
+                InstanceTransformStore::setTarget(mTransform, kBase, translation + toLookAt);
             }
 
-            mBase.translation = translation;
-            mBase.matrixDirty = true;
+            InstanceTransformStore::setTranslation(mTransform, kBase, translation);
         };
 
         /** Gets the position/translation of the instance
             \return Translation of the instance
         */
-        const glm::vec3& getTranslation() const { return mBase.translation; };
+        const glm::vec3& getTranslation() const { return InstanceTransformStore::getTranslation(mTransform, kBase); };
 
         /** Sets scale of the instance
             \param[in] scaling Instance scale
         */
-        void setScaling(const glm::vec3& scaling) { mBase.scale = scaling; mBase.matrixDirty = true; }
+        void setScaling(const glm::vec3& scaling) { InstanceTransformStore::setScaling(mTransform, kBase, scaling); }
 
         /** Gets scale of the instance
             \return Scale of the instance
         */
-        const glm::vec3& getScaling() const { return mBase.scale; }
+        const glm::vec3& getScaling() const { return InstanceTransformStore::getScaling(mTransform, kBase); }
 
         /** Sets orientation of the instance
             \param[in] yawPitchRoll Yaw-Pitch-Roll rotation in radians
@@ -151,10 +178,8 @@ namespace Falcor
             const glm::mat3 rotMtx(glm::yawPitchRoll(yawPitchRoll[0], yawPitchRoll[1], yawPitchRoll[2]));
 
             // Get look-at info
-            mBase.up = rotMtx[1];
-            mBase.target = mBase.translation + rotMtx[2]; // position + forward
-
-            mBase.matrixDirty = true;
+            InstanceTransformStore::setUpVector(mTransform, kBase, rotMtx[1]);
+            InstanceTransformStore::setTarget(mTransform, kBase, getTranslation() + rotMtx[2]); // position + forward
         }
 
         /** Gets rotation for the instance
@@ -164,34 +189,41 @@ namespace Falcor
         {
             glm::vec3 result;
 
-            glm::mat4 rotationMtx = createMatrixFromLookAt(mBase.translation, mBase.target, mBase.up);
+            glm::mat4 rotationMtx = createMatrixFromLookAt(getTranslation(), getTarget(), getUpVector());
             glm::extractEulerAngleXYZ(rotationMtx, result[1], result[0], result[2]); // YawPitchRoll is YXZ
 
             return result;
         }
 
 // #toodo comments
-        void setUpVector(const glm::vec3& up) { mBase.up = glm::normalize(up); mBase.matrixDirty = true; }
+        void setUpVector(const glm::vec3& up) { InstanceTransformStore::setUpVector(mTransform, kBase, glm::normalize(up)); }
 
-        void setTarget(const glm::vec3& target) { mBase.target = target; mBase.matrixDirty = true; }
+        void setTarget(const glm::vec3& target) { InstanceTransformStore::setTarget(mTransform, kBase, target); }
 
         /** Gets the up vector of the instance
             \return Up vector
         */
-        const glm::vec3& getUpVector() const { return mBase.up; }
+        const glm::vec3& getUpVector() const { return InstanceTransformStore::getUpVector(mTransform, kBase); }
 
         /** Gets look-at target of the instance's orientation
             \return Look-at target position
         */
-        const glm::vec3& getTarget() const { return mBase.target; }
+        const glm::vec3& getTarget() const { return InstanceTransformStore::getTarget(mTransform, kBase); }
 
         /** Gets the transform matrix
             \return Transform matrix
         */
         const glm::mat4& getTransformMatrix() const
         {
-            updateInstanceProperties();
-            return mFinalTransformMatrix;
+            return InstanceTransformStore::getWorldMatrix(mTransform);
+        }
+
+        /** Gets the inverse-transpose of the transform matrix's upper 3x3, used to transform normals
+            \return Inverse-transpose matrix, with the columns padded to 16 bytes
+        */
+        const glm::mat3x4& getInvTransposeMatrix() const
+        {
+            return InstanceTransformStore::getInvTransposeMatrix(mTransform);
         }
 
         /** Gets the bounding box
@@ -199,19 +231,18 @@ namespace Falcor
         */
         const BoundingBox& getBoundingBox() const
         {
-            updateInstanceProperties();
-            return mBoundingBox;
+            return InstanceTransformStore::getWorldBounds(mTransform);
         }
 
+        /** Gets the handle of the instance's transform in the InstanceTransformStore
+        */
+        InstanceTransformStore::Handle getTransformHandle() const { return mTransform; }
+
         /** IMovableObject interface
         */
         virtual void move(const glm::vec3& position, const glm::vec3& target, const glm::vec3& up) override
         {
-            mMovable.translation = position;
-            mMovable.target = target;
-            mMovable.up = up;
-            mMovable.scale = glm::vec3(1.0f);
-            mMovable.matrixDirty = true;
+            InstanceTransformStore::setTransform(mTransform, InstanceTransformStore::Layer::Movable, position, target, up, glm::vec3(1.0f));
         }
 
         SharedPtr shared_from_this()
@@ -224,73 +255,20 @@ namespace Falcor
             return inherit_shared_from_this < IMovableObject, ObjectInstance>::shared_from_this();
         }
     private:
+        static const InstanceTransformStore::Layer kBase = InstanceTransformStore::Layer::Base;
 
-        void updateInstanceProperties() const
-        {
-            if (mBase.matrixDirty || mMovable.matrixDirty)
-            {
-                if (mBase.matrixDirty)
-                {
-                    mBase.matrix = calculateTransformMatrix(mBase.translation, mBase.target, mBase.up, mBase.scale);
-                    mBase.matrixDirty = false;
-                }
-
-                if (mMovable.matrixDirty)
-                {
-                    mMovable.matrix = calculateTransformMatrix(mMovable.translation, mMovable.target, mMovable.up, mMovable.scale);
-                    mMovable.matrixDirty = false;
-                }
-
-                mFinalTransformMatrix = mMovable.matrix * mBase.matrix;
-                mBoundingBox = mpObject->getBoundingBox().transform(mFinalTransformMatrix);
-            }
-        }
-
-        static glm::mat4 calculateTransformMatrix(const glm::vec3& translation, const glm::vec3& target, const glm::vec3& up, const glm::vec3& scale)
-        {
-            glm::mat4 translationMtx = glm::translate(glm::mat4(), translation);
-            glm::mat4 rotationMtx = createMatrixFromLookAt(translation, target, up);
-            glm::mat4 scalingMtx = glm::scale(glm::mat4(), scale);
-
-            return translationMtx * rotationMtx * scalingMtx;
-        }
-
-        static glm::mat4 calculateTransformMatrix(const glm::vec3& translation, const glm::vec3& yawPitchRoll, const glm::vec3& scale)
-        {
-            glm::mat4 translationMtx = glm::translate(glm::mat4(), translation);
-            glm::mat4 rotationMtx = glm::yawPitchRoll(yawPitchRoll[0], yawPitchRoll[1], yawPitchRoll[2]);
-            glm::mat4 scalingMtx = glm::scale(glm::mat4(), scale);
-
-            return translationMtx * rotationMtx * scalingMtx;
-        }
-
+        // The store reads the object's bounds whenever it recomputes the world bounds. The instance holds a reference to the object, so they stay valid as long as the slot exists
         ObjectInstance(const typename ObjectType::SharedPtr& pObject, const std::string& name)
-            : mpObject(pObject), mName(name) { }
-
-        ObjectInstance(const typename ObjectType::SharedPtr& pObject, const glm::mat4& baseTransform, const std::string& name)
-            : ObjectInstance(pObject, name)
-        {
-            // #TODO Decompose matrix
-
-            mBase.matrix = baseTransform;
-            mBase.matrixDirty = false;
-        }
-
-        ObjectInstance(const typename ObjectType::SharedPtr& pObject, const glm::vec3& translation, const glm::vec3& target, const glm::vec3& up, const glm::vec3& scale, const std::string& name = "")
-            : ObjectInstance(pObject, name)
-        {
-            mBase.translation = translation;
-            mBase.target = target;
-            mBase.up = up;
-            mBase.scale = scale;
-        }
+            : mpObject(pObject), mName(name), mTransform(InstanceTransformStore::allocate(&pObject->getBoundingBox())) { }
 
-        ObjectInstance(const typename ObjectType::SharedPtr& pObject, const glm::vec3& translation, const glm::vec3& yawPitchRoll, const glm::vec3& scale, const std::string& name = "")
-            : ObjectInstance(pObject, name)
+        /** Create an instance with an identity transform
+            eturn The instance, or nullptr if no transform slot could be allocated
+        */
+        static SharedPtr createUninitialized(const typename ObjectType::SharedPtr& pObject, const std::string& name)
         {
-            mBase.translation = translation;
-            setRotation(yawPitchRoll);
-            mBase.scale = scale;
+            assert(pObject);
+            SharedPtr pInstance = SharedPtr(new ObjectInstance<ObjectType>(pObject, name));
+            return (pInstance->mTransform == InstanceTransformStore::kInvalidHandle) ? nullptr : pInstance;
         }
 
         friend class Model;
@@ -299,23 +277,6 @@ namespace Falcor
         bool mVisible = true;
 
         typename ObjectType::SharedPtr mpObject;
-
-        struct Transform
-        {
-            glm::vec3 translation;
-            glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
-            glm::vec3 target = glm::vec3(0.0f, 0.0f, 1.0f);
-            glm::vec3 scale = glm::vec3(1.0f);
-
-            // Matrix containing the above transforms
-            glm::mat4 matrix;
-            bool matrixDirty = true;
-        };
-
-        mutable Transform mBase;
-        mutable Transform mMovable;
-
-        mutable glm::mat4 mFinalTransformMatrix;
-        mutable BoundingBox mBoundingBox;
+        InstanceTransformStore::Handle mTransform;
     };
 }
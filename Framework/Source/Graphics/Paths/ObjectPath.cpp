@@ -49,39 +49,41 @@ namespace Falcor
         keyFrame.up = up;
         mDirty = true;
 
-        if(mKeyFrames.size() == 0 || mKeyFrames[0].time > time)
+        // The key-frames are sorted by time. If we already have a key-frame at the same time, replace it
+        auto it = std::lower_bound(mKeyFrames.begin(), mKeyFrames.end(), time, [](const Frame& frame, float t) { return frame.time < t; });
+        if(it != mKeyFrames.end() && it->time == time)
         {
-            mKeyFrames.insert(mKeyFrames.begin(), keyFrame);
-            return 0;
+            *it = keyFrame;
         }
         else
         {
-            for(size_t i = 0 ; i < mKeyFrames.size() ; i++)
+            it = mKeyFrames.insert(it, keyFrame);
+        }
+        return (uint32_t)(it - mKeyFrames.begin());
+    }
+
+    uint32_t ObjectPath::findKeyFrame(double time)
+    {
+        // Returns the last key-frame with a time which is less or equal to 'time'. The caller makes sure that the time is inside the path
+        auto isInside = [this, time](uint32_t frameID)
+        {
+            return (frameID + 1 < mKeyFrames.size()) && (time >= mKeyFrames[frameID].time) && (time < mKeyFrames[frameID + 1].time);
+        };
+
+        if(isInside(mCurrentKeyFrame) == false)
+        {
+            if(isInside(mCurrentKeyFrame + 1))
             {
-                auto& current = mKeyFrames[i];
-                // If we already have a key-frame at the same time, replace it
-                if(current.time == time)
-                {
-                    current = keyFrame;
-                    return (uint32_t)i;
-                }
-
-                // If this is not the last frame, Check if we are in between frames
-                if(i < mKeyFrames.size() - 1)
-                {
-                    auto& Next = mKeyFrames[i + 1];
-                    if(current.time < time && Next.time > time)
-                    {
-                        mKeyFrames.insert(mKeyFrames.begin() + i + 1, keyFrame);
-                        return (uint32_t)i + 1;
-                    }
-                }
+                mCurrentKeyFrame++;
+            }
+            else
+            {
+                auto it = std::upper_bound(mKeyFrames.begin(), mKeyFrames.end(), time, [](double t, const Frame& frame) { return t < frame.time; });
+                mCurrentKeyFrame = (uint32_t)(it - mKeyFrames.begin()) - 1;
             }
-
-            // If we got here, need to push it to the end of the list
-            mKeyFrames.push_back(keyFrame);
-            return (uint32_t)mKeyFrames.size() - 1;
         }
+        assert(isInside(mCurrentKeyFrame));
+        return mCurrentKeyFrame;
     }
 
     bool ObjectPath::animate(double currentTime)
@@ -116,23 +118,29 @@ namespace Falcor
         }
         else
         {
-            // Find out where we are
-            bool foundFrame = false;
-            for(uint32_t i = 0 ; i < (uint32_t)mKeyFrames.size() - 1; i++)
+            bool useArcLength = mConstantSpeed && mMode == Interpolation::CubicSpline && getKeyFrameCount() >= 3;
+            if(useArcLength)
+            {
+                updateSplines();
+                useArcLength = mpPositionSpline->getArcLength() > 0;
+            }
+
+            if(useArcLength)
+            {
+                // Convert the time to a distance along the path
+                double factor = (animTime - firstFrame.time) / (lastFrame.time - firstFrame.time);
+                uint32_t section;
+                float t;
+                mpPositionSpline->getPointAtArcLength(float(factor * mpPositionSpline->getArcLength()), section, t);
+                getFrameAt(section, t, mCurrentFrame);
+            }
+            else
             {
-                const auto& curKey = mKeyFrames[i];
-                const auto& nextKey = mKeyFrames[i + 1];
-
-                if(animTime >= curKey.time && animTime < nextKey.time)
-                {
-                    // Found the animation keys. Interpolate
-                    float t = getInterpolationFactor(i, animTime);
-                    getFrameAt(i, t, mCurrentFrame);
-                    foundFrame = true;
-                    break;
-                }
+                // Find out where we are, and interpolate
+                uint32_t frameID = findKeyFrame(animTime);
+                float t = getInterpolationFactor(frameID, animTime);
+                getFrameAt(frameID, t, mCurrentFrame);
             }
-            assert(foundFrame);
         }
 
         for(auto& pObj : mpObjects)
@@ -191,7 +199,7 @@ namespace Falcor
         return result;
     }
 
-    ObjectPath::Frame ObjectPath::cubicSplineInterpolation(uint32_t currentFrame, float t)
+    void ObjectPath::updateSplines()
     {
         if (mDirty)
         {
@@ -207,7 +215,16 @@ namespace Falcor
             mpPositionSpline = std::make_unique<Vec3CubicSpline>(positions.data(), uint32_t(mKeyFrames.size()));
             mpTargetSpline = std::make_unique<Vec3CubicSpline>(targets.data(), uint32_t(mKeyFrames.size()));
             mpUpSpline = std::make_unique<Vec3CubicSpline>(ups.data(), uint32_t(mKeyFrames.size()));
+            if(mConstantSpeed)
+            {
+                mpPositionSpline->buildArcLengthTable();
+            }
         }
+    }
+
+    ObjectPath::Frame ObjectPath::cubicSplineInterpolation(uint32_t currentFrame, float t)
+    {
+        updateSplines();
 
         const Frame& current = mKeyFrames[currentFrame];
         const Frame& next = mKeyFrames[currentFrame + 1];
@@ -65,6 +65,12 @@ namespace Falcor
 
         void setAnimationRepeat(bool repeatAnimation) { mRepeatAnimation = repeatAnimation; }
 
+        /** Move along the path at a constant speed, instead of reaching every key-frame at its time. The objects go from the first to the last key-frame in the same time.
+            Only used with cubic-spline interpolation. The spline is sampled by arc length, so the speed is constant along the position spline
+        */
+        void setConstantSpeed(bool constantSpeed) { mConstantSpeed = constantSpeed; mDirty = true; }
+        bool isConstantSpeed() const { return mConstantSpeed; }
+
         const glm::vec3& getCurrentPosition() const { return mCurrentFrame.position; }
         const glm::vec3& getCurrentLookAtVector() const { return mCurrentFrame.target; }
         const glm::vec3& getCurrentUpVector() const { return mCurrentFrame.up; }
@@ -95,6 +101,8 @@ namespace Falcor
         ObjectPath() = default;
 
         float getInterpolationFactor(uint32_t frameID, double currentTime) const;
+        uint32_t findKeyFrame(double time);
+        void updateSplines();
 
         Frame linearInterpolation(uint32_t currentFrame, float t) const;
         Frame cubicSplineInterpolation(uint32_t currentFrame, float t);
@@ -107,6 +115,8 @@ namespace Falcor
         Frame mCurrentFrame;
         Interpolation mMode = Interpolation::CubicSpline;
         bool mDirty = false;
+        bool mConstantSpeed = false;
+        uint32_t mCurrentKeyFrame = 0;      ///< The key-frame found by the last search. Animation usually stays in the same interval or moves to the next one
 
         std::unique_ptr<Vec3CubicSpline> mpPositionSpline;
         std::unique_ptr<Vec3CubicSpline> mpTargetSpline;
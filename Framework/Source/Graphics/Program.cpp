@@ -39,6 +39,7 @@
 #include "Utils/ShaderUtils.h"
 #include "API/RenderContext.h"
 #include "Utils/StringUtils.h"
+#include "Graphics/ShaderCache.h"
 
 namespace Falcor
 {
@@ -203,10 +204,71 @@ namespace Falcor
         }
     }
 
+    std::string Program::getShaderCacheKey() const
+    {
+        // Describe everything which affects Slang's output
+#if defined(FALCOR_GL)
+        std::string key = "target GLSL\n";
+#elif defined(FALCOR_D3D11) || defined(FALCOR_D3D12)
+        std::string key = "target HLSL\n";
+#endif
+        for(uint32_t i = 0; i < kShaderCount; i++)
+        {
+            if(mOriginalShaderStrings[i].size() == 0)
+            {
+                continue;
+            }
+
+            key += std::string("stage ") + getSlangTargetString(ShaderType(i)) + "\n";
+            if(mCreatedFromFile)
+            {
+                std::string fullpath;
+                findFileInDataDirectories(mOriginalShaderStrings[i], fullpath);
+                key += "file " + fullpath + " " + std::to_string(ShaderCache::getFileHash(fullpath)) + "\n";
+            }
+            else
+            {
+                key += "source " + mOriginalShaderStrings[i] + "\n";
+            }
+        }
+
+        for(const auto& shaderDefine : mDefineList)
+        {
+            key += "define " + shaderDefine.first + "=" + shaderDefine.second + "\n";
+        }
+
+        for(const auto& path : getDataDirectoriesList())
+        {
+            key += "search path " + path + "\n";
+        }
+        return key;
+    }
+
     ProgramVersion::SharedPtr Program::preprocessAndCreateProgramVersion(std::string& log) const
     {
         mFileTimeMap.clear();
 
+        // Use the persistent cache if the same program was already compiled
+        std::string cacheKey;
+        if(ShaderCache::isEnabled())
+        {
+            cacheKey = getShaderCacheKey();
+            ShaderCache::Entry entry;
+            if(ShaderCache::load(cacheKey, entry))
+            {
+                for(uint32_t i = 0; i < kShaderCount; i++)
+                {
+                    mPreprocessedShaderStrings[i] = entry.shaderStrings[i];
+                }
+                mPreprocessedReflector = entry.pReflector;
+                for(const auto& depFilePath : entry.dependencies)
+                {
+                    mFileTimeMap[depFilePath] = getFileModifiedTime(depFilePath);
+                }
+                return createProgramVersion(log);
+            }
+        }
+
         // Run all of the shaders through Slang, so that we can get final code,
         // reflection data, etc.
         //
@@ -311,18 +373,32 @@ namespace Falcor
         mPreprocessedReflector = ProgramReflection::create(slang::ShaderReflection::get(slangRequest), log);
 
         // Extract list of files referenced, for dependency-tracking purposes
+        ShaderCache::Entry cacheEntry;
         int depFileCount = spGetDependencyFileCount(slangRequest);
         for(int ii = 0; ii < depFileCount; ++ii)
         {
             std::string depFilePath = spGetDependencyFilePath(slangRequest, ii);
             mFileTimeMap[depFilePath] = getFileModifiedTime(depFilePath);
+            cacheEntry.dependencies.push_back(depFilePath);
         }
 
         spDestroyCompileRequest(slangRequest);
 
         // Now that we've preprocessed things, dispatch to the actual program creation logic,
         // which may vary in subclasses of `Program`
-        return createProgramVersion(log);
+        ProgramVersion::SharedPtr pVersion = createProgramVersion(log);
+
+        // Only cache successful compilations
+        if(pVersion && mPreprocessedReflector && cacheKey.size())
+        {
+            for(uint32_t i = 0; i < kShaderCount; i++)
+            {
+                cacheEntry.shaderStrings[i] = mPreprocessedShaderStrings[i];
+            }
+            cacheEntry.pReflector = mPreprocessedReflector;
+            ShaderCache::store(cacheKey, cacheEntry);
+        }
+        return pVersion;
     }
 
     ProgramVersion::SharedPtr Program::createProgramVersion(std::string& log) const
@@ -89,6 +89,7 @@ namespace Falcor
 
         bool link() const;
         ProgramVersion::SharedPtr preprocessAndCreateProgramVersion(std::string& log) const;
+        std::string getShaderCacheKey() const;
         virtual ProgramVersion::SharedPtr createProgramVersion(std::string& log) const;
 
         std::string mOriginalShaderStrings[kShaderCount]; // Either a filename or a string, depending on the value of mCreatedFromFile
@@ -1549,6 +1549,10 @@ namespace Falcor
             {
                 const auto& frame = pPath->getKeyFrame(i);
                 auto pNewInstance = Scene::ModelInstance::create(mpKeyframeModel, frame.position, frame.target, frame.up, glm::vec3(kKeyframeModelScale), "Frame " + std::to_string(i));
+                if(pNewInstance == nullptr)
+                {
+                    break;
+                }
                 mpEditorScene->addModelInstance(pNewInstance);
             }
 
@@ -0,0 +1,430 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "OcclusionCuller.h"
+#include "Utils/JobSystem.h"
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <emmintrin.h>
+
+namespace Falcor
+{
+    static const uint32_t kTileSizeLog2 = 5;
+    static const uint32_t kTileSize = 1 << kTileSizeLog2;
+    static const uint32_t kBinningChunkSize = 2048;         // Number of occluder triangles set up and binned by a single job
+    static const float kGuardBand = 8.0f;                   // Triangles are only clipped against the side planes when they extend beyond kGuardBand times the screen size, to keep the edge functions precise
+    static const float kDepthBias = 1e-4f;                  // Relative depth difference required to consider a box occluded. Covers the rounding of the depth interpolation
+
+    OcclusionCuller::SharedPtr OcclusionCuller::create(uint32_t width, uint32_t height)
+    {
+        return SharedPtr(new OcclusionCuller(width, height));
+    }
+
+    OcclusionCuller::OcclusionCuller(uint32_t width, uint32_t height)
+    {
+        mTilesX = std::max(1u, (width + kTileSize - 1) / kTileSize);
+        mTilesY = std::max(1u, (height + kTileSize - 1) / kTileSize);
+        mWidth = mTilesX * kTileSize;
+        mHeight = mTilesY * kTileSize;
+
+        uint32_t levelWidth = mWidth;
+        uint32_t levelHeight = mHeight;
+        mDepthLevels.push_back(std::vector<float>(mWidth * mHeight, 0.0f));
+        while (levelWidth > 1 || levelHeight > 1)
+        {
+            levelWidth = (levelWidth + 1) / 2;
+            levelHeight = (levelHeight + 1) / 2;
+            mDepthLevels.push_back(std::vector<float>(levelWidth * levelHeight, 0.0f));
+        }
+    }
+
+    void OcclusionCuller::beginFrame(const glm::mat4& viewProj, float nearZ)
+    {
+        mViewProj = viewProj;
+        mNearZ = nearZ;
+        mOccluders.clear();
+        mTriangleCount = 0;
+        mStats = Stats();
+        for (auto& level : mDepthLevels)
+        {
+            std::fill(level.begin(), level.end(), 0.0f);
+        }
+    }
+
+    void OcclusionCuller::addOccluder(const glm::vec3* pPositions, const uint32_t* pIndices, uint32_t indexCount, const glm::mat4& world)
+    {
+        uint32_t triangleCount = indexCount / 3;
+        if (triangleCount == 0)
+        {
+            return;
+        }
+
+        Occluder occluder;
+        occluder.pPositions = pPositions;
+        occluder.pIndices = pIndices;
+        occluder.triangleCount = triangleCount;
+        occluder.firstTriangle = mTriangleCount;
+        occluder.clipMat = mViewProj * world;
+        mOccluders.push_back(occluder);
+        mTriangleCount += triangleCount;
+    }
+
+    /** Clip a convex polygon against the half-space dot(plane, v) + offset >= 0
+        \return The number of output vertices
+    */
+    static uint32_t clipPolygon(const glm::vec4* pIn, uint32_t count, const glm::vec4& plane, float offset, glm::vec4* pOut)
+    {
+        uint32_t outCount = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const glm::vec4& a = pIn[i];
+            const glm::vec4& b = pIn[(i + 1) % count];
+            float da = glm::dot(plane, a) + offset;
+            float db = glm::dot(plane, b) + offset;
+            if (da >= 0)
+            {
+                pOut[outCount++] = a;
+            }
+            if ((da >= 0) != (db >= 0))
+            {
+                pOut[outCount++] = a + (b - a) * (da / (da - db));
+            }
+        }
+        return outCount;
+    }
+
+    void OcclusionCuller::binTriangles(uint32_t chunkIndex)
+    {
+        BinChunk& chunk = mChunks[chunkIndex];
+        chunk.triangles.clear();
+        for (auto& bin : chunk.tileBins)
+        {
+            bin.clear();
+        }
+
+        const uint32_t begin = chunkIndex * kBinningChunkSize;
+        const uint32_t end = std::min(begin + kBinningChunkSize, mTriangleCount);
+
+        // Find the occluder of the first triangle
+        auto it = std::upper_bound(mOccluders.begin(), mOccluders.end(), begin, [](uint32_t triangle, const Occluder& occluder) { return triangle < occluder.firstTriangle; });
+        uint32_t occluderIndex = (uint32_t)(it - mOccluders.begin()) - 1;
+
+        // Clipping planes: w >= nearZ, then the guard band
+        const glm::vec4 planes[5] =
+        {
+            glm::vec4(0, 0, 0, 1),
+            glm::vec4(-1, 0, 0, kGuardBand),
+            glm::vec4(1, 0, 0, kGuardBand),
+            glm::vec4(0, -1, 0, kGuardBand),
+            glm::vec4(0, 1, 0, kGuardBand),
+        };
+
+        const float halfWidth = 0.5f * (float)mWidth;
+        const float halfHeight = 0.5f * (float)mHeight;
+
+        for (uint32_t triangle = begin; triangle < end; triangle++)
+        {
+            while (triangle >= mOccluders[occluderIndex].firstTriangle + mOccluders[occluderIndex].triangleCount)
+            {
+                occluderIndex++;
+            }
+            const Occluder& occluder = mOccluders[occluderIndex];
+            const uint32_t* pIndices = occluder.pIndices + 3 * (triangle - occluder.firstTriangle);
+
+            // Transform to clip space and compute the outcodes against the screen and the near plane
+            glm::vec4 polygon[2][8];
+            uint32_t outcodeAnd = 0x1f;
+            uint32_t outcodeOr = 0;
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                glm::vec4 v = occluder.clipMat * glm::vec4(occluder.pPositions[pIndices[i]], 1.0f);
+                polygon[0][i] = v;
+                uint32_t outcode = (v.w < mNearZ ? 0x1 : 0) | (v.x > v.w ? 0x2 : 0) | (v.x < -v.w ? 0x4 : 0) | (v.y > v.w ? 0x8 : 0) | (v.y < -v.w ? 0x10 : 0);
+                outcodeAnd &= outcode;
+                outcodeOr |= outcode;
+            }
+
+            // All the vertices are outside the same plane
+            if (outcodeAnd)
+            {
+                continue;
+            }
+
+            uint32_t vertexCount = 3;
+            uint32_t current = 0;
+            if (outcodeOr)
+            {
+                for (uint32_t plane = 0; plane < 5 && vertexCount >= 3; plane++)
+                {
+                    const float offset = (plane == 0) ? -mNearZ : 0.0f;
+                    bool needsClipping = false;
+                    for (uint32_t i = 0; i < vertexCount; i++)
+                    {
+                        needsClipping |= (glm::dot(planes[plane], polygon[current][i]) + offset) < 0;
+                    }
+                    if (needsClipping)
+                    {
+                        vertexCount = clipPolygon(polygon[current], vertexCount, planes[plane], offset, polygon[1 - current]);
+                        current = 1 - current;
+                    }
+                }
+            }
+
+            // Project to the screen. Pixel centers are at half-integer coordinates and the first row is at the top
+            glm::vec3 screen[8];
+            for (uint32_t i = 0; i < vertexCount; i++)
+            {
+                const glm::vec4& v = polygon[current][i];
+                float invW = 1.0f / v.w;
+                screen[i] = glm::vec3((v.x * invW + 1.0f) * halfWidth, (1.0f - v.y * invW) * halfHeight, invW);
+            }
+
+            // Triangulate the clipped polygon as a fan
+            for (uint32_t i = 1; i + 1 < vertexCount; i++)
+            {
+                const glm::vec3& v0 = screen[0];
+                const glm::vec3& v1 = screen[i];
+                const glm::vec3& v2 = screen[i + 1];
+                float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+                if (area == 0)
+                {
+                    continue;
+                }
+
+                ScreenTriangle tri;
+                tri.minX = std::max(0, (int32_t)ceilf(std::min(std::min(v0.x, v1.x), v2.x) - 0.5f));
+                tri.maxX = std::min((int32_t)mWidth - 1, (int32_t)floorf(std::max(std::max(v0.x, v1.x), v2.x) - 0.5f));
+                tri.minY = std::max(0, (int32_t)ceilf(std::min(std::min(v0.y, v1.y), v2.y) - 0.5f));
+                tri.maxY = std::min((int32_t)mHeight - 1, (int32_t)floorf(std::max(std::max(v0.y, v1.y), v2.y) - 0.5f));
+                if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+                {
+                    continue;
+                }
+
+                // Edge i goes from vertex i to vertex i + 1. Its function evaluates to the signed area at the opposite vertex, so flipping the signs of clockwise triangles makes the inside positive
+                const glm::vec3* pV[3] = { &v0, &v1, &v2 };
+                const float sign = (area > 0) ? 1.0f : -1.0f;
+                for (uint32_t e = 0; e < 3; e++)
+                {
+                    const glm::vec3& a = *pV[e];
+                    const glm::vec3& b = *pV[(e + 1) % 3];
+                    tri.edge[e][0] = sign * (a.y - b.y);
+                    tri.edge[e][1] = sign * (b.x - a.x);
+                    tri.edge[e][2] = sign * (a.x * b.y - b.x * a.y);
+                }
+
+                // 1/w is linear in screen space
+                float dz1 = v1.z - v0.z;
+                float dz2 = v2.z - v0.z;
+                tri.depth[0] = (dz1 * (v2.y - v0.y) - dz2 * (v1.y - v0.y)) / area;
+                tri.depth[1] = (dz2 * (v1.x - v0.x) - dz1 * (v2.x - v0.x)) / area;
+                tri.depth[2] = v0.z - tri.depth[0] * v0.x - tri.depth[1] * v0.y;
+
+                uint32_t triIndex = (uint32_t)chunk.triangles.size();
+                chunk.triangles.push_back(tri);
+                for (int32_t tileY = tri.minY >> kTileSizeLog2; tileY <= (tri.maxY >> kTileSizeLog2); tileY++)
+                {
+                    for (int32_t tileX = tri.minX >> kTileSizeLog2; tileX <= (tri.maxX >> kTileSizeLog2); tileX++)
+                    {
+                        chunk.tileBins[tileY * mTilesX + tileX].push_back(triIndex);
+                    }
+                }
+            }
+        }
+    }
+
+    void OcclusionCuller::rasterizeTile(uint32_t tileIndex)
+    {
+        const int32_t tileX0 = (int32_t)((tileIndex % mTilesX) * kTileSize);
+        const int32_t tileY0 = (int32_t)((tileIndex / mTilesX) * kTileSize);
+        float* pDepth = mDepthLevels[0].data();
+        const __m128 xOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+        for (const BinChunk& chunk : mChunks)
+        {
+            for (uint32_t triIndex : chunk.tileBins[tileIndex])
+            {
+                const ScreenTriangle& tri = chunk.triangles[triIndex];
+
+                // The tile is a multiple of 4 pixels wide, so aligning the start keeps the 4-pixel groups inside the tile. Pixels outside the triangle's bounds fail the edge tests
+                const int32_t x0 = std::max(tri.minX, tileX0) & ~3;
+                const int32_t x1 = std::min(tri.maxX, tileX0 + (int32_t)kTileSize - 1);
+                const int32_t y0 = std::max(tri.minY, tileY0);
+                const int32_t y1 = std::min(tri.maxY, tileY0 + (int32_t)kTileSize - 1);
+
+                const __m128 edgeA0 = _mm_set1_ps(tri.edge[0][0]);
+                const __m128 edgeA1 = _mm_set1_ps(tri.edge[1][0]);
+                const __m128 edgeA2 = _mm_set1_ps(tri.edge[2][0]);
+                const __m128 depthA = _mm_set1_ps(tri.depth[0]);
+                const __m128 zero = _mm_setzero_ps();
+
+                for (int32_t y = y0; y <= y1; y++)
+                {
+                    const float py = (float)y + 0.5f;
+                    const __m128 rowEdge0 = _mm_set1_ps(tri.edge[0][1] * py + tri.edge[0][2]);
+                    const __m128 rowEdge1 = _mm_set1_ps(tri.edge[1][1] * py + tri.edge[1][2]);
+                    const __m128 rowEdge2 = _mm_set1_ps(tri.edge[2][1] * py + tri.edge[2][2]);
+                    const __m128 rowDepth = _mm_set1_ps(tri.depth[1] * py + tri.depth[2]);
+                    float* pRow = pDepth + y * mWidth;
+
+                    for (int32_t x = x0; x <= x1; x += 4)
+                    {
+                        __m128 px = _mm_add_ps(_mm_set1_ps((float)x), xOffsets);
+                        __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA0, px), rowEdge0), zero);
+                        inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA1, px), rowEdge1), zero));
+                        inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA2, px), rowEdge2), zero));
+                        if (_mm_movemask_ps(inside) == 0)
+                        {
+                            continue;
+                        }
+
+                        // Keep the nearest depth, which is the largest 1/w. Masked-out lanes become 0, which never wins
+                        __m128 depth = _mm_and_ps(inside, _mm_add_ps(_mm_mul_ps(depthA, px), rowDepth));
+                        _mm_storeu_ps(pRow + x, _mm_max_ps(_mm_loadu_ps(pRow + x), depth));
+                    }
+                }
+            }
+        }
+    }
+
+    void OcclusionCuller::buildHierarchy()
+    {
+        uint32_t srcWidth = mWidth;
+        uint32_t srcHeight = mHeight;
+        for (size_t level = 1; level < mDepthLevels.size(); level++)
+        {
+            const float* pSrc = mDepthLevels[level - 1].data();
+            float* pDst = mDepthLevels[level].data();
+            uint32_t dstWidth = (srcWidth + 1) / 2;
+            uint32_t dstHeight = (srcHeight + 1) / 2;
+            for (uint32_t y = 0; y < dstHeight; y++)
+            {
+                uint32_t srcY0 = 2 * y;
+                uint32_t srcY1 = std::min(srcY0 + 1, srcHeight - 1);
+                for (uint32_t x = 0; x < dstWidth; x++)
+                {
+                    uint32_t srcX0 = 2 * x;
+                    uint32_t srcX1 = std::min(srcX0 + 1, srcWidth - 1);
+                    float farthest = std::min(std::min(pSrc[srcY0 * srcWidth + srcX0], pSrc[srcY0 * srcWidth + srcX1]), std::min(pSrc[srcY1 * srcWidth + srcX0], pSrc[srcY1 * srcWidth + srcX1]));
+                    pDst[y * dstWidth + x] = farthest;
+                }
+            }
+            srcWidth = dstWidth;
+            srcHeight = dstHeight;
+        }
+    }
+
+    void OcclusionCuller::rasterize()
+    {
+        mStats.occluderTriangles = mTriangleCount;
+        if (mTriangleCount == 0)
+        {
+            return;
+        }
+
+        const uint32_t chunkCount = (mTriangleCount + kBinningChunkSize - 1) / kBinningChunkSize;
+        mChunks.resize(chunkCount);
+        for (auto& chunk : mChunks)
+        {
+            chunk.tileBins.resize(mTilesX * mTilesY);
+        }
+
+        JobSystem::parallelFor(chunkCount, [this](uint32_t chunkIndex) { binTriangles(chunkIndex); });
+        JobSystem::parallelFor(mTilesX * mTilesY, [this](uint32_t tileIndex) { rasterizeTile(tileIndex); });
+        buildHierarchy();
+
+        for (const auto& chunk : mChunks)
+        {
+            mStats.rasterizedTriangles += (uint32_t)chunk.triangles.size();
+        }
+    }
+
+    bool OcclusionCuller::isVisible(const BoundingBox& box) const
+    {
+        if (mTriangleCount == 0)
+        {
+            return true;
+        }
+
+        // Project the corners. The nearest point of the box is one of them, since w is linear in the position
+        float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+        float maxInvW = 0;
+        for (uint32_t i = 0; i < 8; i++)
+        {
+            glm::vec3 corner = box.center + box.extent * glm::vec3((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f);
+            glm::vec4 v = mViewProj * glm::vec4(corner, 1.0f);
+            if (v.w < mNearZ)
+            {
+                return true;
+            }
+
+            float invW = 1.0f / v.w;
+            float x = (v.x * invW + 1.0f) * 0.5f * (float)mWidth;
+            float y = (1.0f - v.y * invW) * 0.5f * (float)mHeight;
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+            maxInvW = std::max(maxInvW, invW);
+        }
+
+        if (maxX < 0 || maxY < 0 || minX >= (float)mWidth || minY >= (float)mHeight)
+        {
+            return true;
+        }
+
+        // Every pixel the box's screen rectangle touches
+        int32_t x0 = std::max(0, (int32_t)floorf(minX));
+        int32_t y0 = std::max(0, (int32_t)floorf(minY));
+        int32_t x1 = std::min((int32_t)mWidth - 1, (int32_t)floorf(maxX));
+        int32_t y1 = std::min((int32_t)mHeight - 1, (int32_t)floorf(maxY));
+
+        // Use the finest level in which the rectangle covers at most 4x4 texels
+        uint32_t level = 0;
+        while (((x1 >> level) - (x0 >> level)) >= 4 || ((y1 >> level) - (y0 >> level)) >= 4)
+        {
+            level++;
+        }
+
+        const float* pLevel = mDepthLevels[level].data();
+        const uint32_t levelWidth = (mWidth + (1u << level) - 1) >> level;
+        const float threshold = maxInvW * (1.0f + kDepthBias);
+        for (int32_t y = y0 >> level; y <= (y1 >> level); y++)
+        {
+            for (int32_t x = x0 >> level; x <= (x1 >> level); x++)
+            {
+                if (pLevel[y * levelWidth + x] <= threshold)
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+}
@@ -0,0 +1,155 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <vector>
+#include "glm/vec3.hpp"
+#include "glm/mat4x4.hpp"
+#include "Utils/AABB.h"
+
+namespace Falcor
+{
+    /** CPU occlusion culler.
+        Occluder triangles are rasterized into a low-resolution depth buffer, and bounding boxes are then tested against a hierarchy of the buffer's farthest depths.
+        The buffer is split into tiles. The triangles are transformed, clipped and binned to the tiles in parallel chunks, then every tile is rasterized by its own job, 4 pixels at a time using SSE.
+        The buffer stores 1/w, the reciprocal of the view-space depth, so it doesn't depend on the projection's depth range. Pixels not covered by any occluder hold 0. Only perspective projections are supported.
+        The rasterizer doesn't use the GPU, so it can be run and validated without a device.
+    */
+    class OcclusionCuller
+    {
+    public:
+        using SharedPtr = std::shared_ptr<OcclusionCuller>;
+        using SharedConstPtr = std::shared_ptr<const OcclusionCuller>;
+
+        /** Occluder geometry, usually a simplified version of a mesh. The triangles must not extend beyond the geometry they stand for, otherwise visible objects may be culled
+        */
+        struct OccluderMesh
+        {
+            using SharedPtr = std::shared_ptr<OccluderMesh>;
+            using SharedConstPtr = std::shared_ptr<const OccluderMesh>;
+
+            std::vector<glm::vec3> positions;   ///< Object-space vertex positions
+            std::vector<uint32_t> indices;      ///< Triangle list
+        };
+
+        /** Per-frame counters
+        */
+        struct Stats
+        {
+            uint32_t occluderTriangles = 0;     ///< Number of triangles submitted
+            uint32_t rasterizedTriangles = 0;   ///< Number of triangles which survived clipping, including the ones created by clipping
+        };
+
+        /** Create a culler
+            \param[in] width Width of the depth buffer. Rounded up to a multiple of the tile size (32)
+            \param[in] height Height of the depth buffer. Rounded up to a multiple of the tile size (32)
+        */
+        static SharedPtr create(uint32_t width = 256, uint32_t height = 128);
+
+        /** Start a new frame. Removes the occluders of the previous frame
+            \param[in] viewProj The view-projection matrix. Must be a perspective projection, with w being the view-space depth
+            \param[in] nearZ The distance of the near plane. Occluder triangles are clipped against it
+        */
+        void beginFrame(const glm::mat4& viewProj, float nearZ);
+
+        /** Add an occluder. The data is only referenced, and must stay valid until rasterize() returns
+            \param[in] pPositions Object-space vertex positions
+            \param[in] pIndices Triangle list indices
+            \param[in] indexCount Number of indices
+            \param[in] world Object-to-world matrix
+        */
+        void addOccluder(const glm::vec3* pPositions, const uint32_t* pIndices, uint32_t indexCount, const glm::mat4& world);
+
+        /** Add an occluder mesh. The mesh must stay alive until rasterize() returns
+        */
+        void addOccluder(const OccluderMesh& mesh, const glm::mat4& world) { addOccluder(mesh.positions.data(), mesh.indices.data(), (uint32_t)mesh.indices.size(), world); }
+
+        /** Rasterize the occluders added since beginFrame() and build the depth hierarchy
+        */
+        void rasterize();
+
+        /** Check if a world-space box may be visible. Boxes which cross the near plane or lie outside the screen are reported as visible
+            \return false if the box is completely hidden behind the occluders, otherwise true
+        */
+        bool isVisible(const BoundingBox& box) const;
+
+        /** Get the depth buffer, as 1/w per pixel. The rows are stored top to bottom
+        */
+        const float* getDepthBuffer() const { return mDepthLevels[0].data(); }
+
+        uint32_t getWidth() const { return mWidth; }
+        uint32_t getHeight() const { return mHeight; }
+
+        /** Get the counters of the current frame
+        */
+        const Stats& getStats() const { return mStats; }
+
+    private:
+        OcclusionCuller(uint32_t width, uint32_t height);
+
+        struct Occluder
+        {
+            const glm::vec3* pPositions;
+            const uint32_t* pIndices;
+            uint32_t triangleCount;
+            uint32_t firstTriangle;     ///< Index of the occluder's first triangle in the frame
+            glm::mat4 clipMat;          ///< Object-to-clip matrix
+        };
+
+        struct ScreenTriangle
+        {
+            float edge[3][3];           ///< Coefficients (A, B, C) of the edge functions A * x + B * y + C. Pixels inside the triangle have all 3 values >= 0
+            float depth[3];             ///< 1/w = depth[0] * x + depth[1] * y + depth[2]
+            int32_t minX, minY, maxX, maxY;
+        };
+
+        /** Triangles set up by one binning job, and their indices binned per tile
+        */
+        struct BinChunk
+        {
+            std::vector<ScreenTriangle> triangles;
+            std::vector<std::vector<uint32_t>> tileBins;
+        };
+
+        void binTriangles(uint32_t chunkIndex);
+        void rasterizeTile(uint32_t tileIndex);
+        void buildHierarchy();
+
+        uint32_t mWidth;
+        uint32_t mHeight;
+        uint32_t mTilesX;
+        uint32_t mTilesY;
+        glm::mat4 mViewProj;
+        float mNearZ = 0;
+        std::vector<Occluder> mOccluders;
+        uint32_t mTriangleCount = 0;
+        std::vector<BinChunk> mChunks;
+        std::vector<std::vector<float>> mDepthLevels;   ///< The depth buffer, followed by levels holding the minimum (farthest) 1/w of 2x2 texels
+        Stats mStats;
+    };
+}
@@ -66,8 +66,43 @@ namespace Falcor
 
     Scene::~Scene() = default;
 
+    void Scene::detectInstanceMoves()
+    {
+        uint64_t changeCount = InstanceTransformStore::getChangeCount();
+        if (changeCount == mTransformChangeCount)
+        {
+            return;
+        }
+        mTransformChangeCount = changeCount;
+
+        uint64_t generationSum = 0;
+        for (uint32_t modelID = 0; modelID < getModelCount(); modelID++)
+        {
+            const Model* pModel = getModel(modelID).get();
+            for (uint32_t instanceID = 0; instanceID < getModelInstanceCount(modelID); instanceID++)
+            {
+                generationSum += InstanceTransformStore::getGeneration(getModelInstance(modelID, instanceID)->getTransformHandle());
+            }
+            for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+            {
+                for (uint32_t instanceID = 0; instanceID < pModel->getMeshInstanceCount(meshID); instanceID++)
+                {
+                    generationSum += InstanceTransformStore::getGeneration(pModel->getMeshInstance(meshID, instanceID)->getTransformHandle());
+                }
+            }
+        }
+
+        if (generationSum != mTransformGenerationSum)
+        {
+            mTransformGenerationSum = generationSum;
+            mExtentsDirty = true;
+            mBVHRefitNeeded = true;
+        }
+    }
+
     void Scene::updateExtents()
     {
+        detectInstanceMoves();
         if (mExtentsDirty)
         {
             mExtentsDirty = false;
@@ -119,6 +154,27 @@ namespace Falcor
         }
     }
 
+    const SceneBVH* Scene::getBVH()
+    {
+        if (mpBVH == nullptr)
+        {
+            mpBVH = SceneBVH::create();
+        }
+
+        detectInstanceMoves();
+        if (mBVHRebuildNeeded)
+        {
+            mpBVH->build(this);
+        }
+        else if (mBVHRefitNeeded)
+        {
+            mpBVH->refit(this);
+        }
+        mBVHRebuildNeeded = false;
+        mBVHRefitNeeded = false;
+        return mpBVH.get();
+    }
+
     bool Scene::update(double currentTime, CameraController* cameraController)
     {
         bool changed = false;
@@ -131,6 +187,10 @@ namespace Falcor
         }
 
         mExtentsDirty = mExtentsDirty || changed;
+        mBVHRefitNeeded = mBVHRefitNeeded || changed;
+
+        // Recompute the transforms of the instances the paths moved in a single batch, instead of one at a time when they are first read
+        InstanceTransformStore::update();
 
         // Ignore the elapsed time we got from the user. This will allow camera movement in cases where the time is frozen
         if (cameraController)
@@ -154,12 +214,14 @@ namespace Falcor
         mModels.erase(mModels.begin() + modelID);
 
         mExtentsDirty = true;
+        mBVHRebuildNeeded = true;
     }
 
     void Scene::deleteAllModels()
     {
         mModels.clear();
         mExtentsDirty = true;
+        mBVHRebuildNeeded = true;
     }
 
     uint32_t Scene::getModelInstanceCount(uint32_t modelID) const
@@ -170,6 +232,10 @@ namespace Falcor
     void Scene::addModelInstance(const Model::SharedPtr& pModel, const std::string& instanceName, const glm::vec3& translation, const glm::vec3& yawPitchRoll, const glm::vec3& scaling)
     {
         ModelInstance::SharedPtr pInstance = ModelInstance::create(pModel, translation, yawPitchRoll, scaling, instanceName);
+        if(pInstance == nullptr)
+        {
+            return;
+        }
         addModelInstance(pInstance);
         mExtentsDirty = true;
     }
@@ -183,6 +249,8 @@ namespace Falcor
             if (getModel(modelID) == pInstance->getObject())
             {
                 mModels[modelID].push_back(pInstance);
+                mExtentsDirty = true;
+                mBVHRebuildNeeded = true;
                 return;
             }
         }
@@ -191,6 +259,7 @@ namespace Falcor
         mModels.emplace_back();
         mModels.back().push_back(pInstance);
         mExtentsDirty = true;
+        mBVHRebuildNeeded = true;
     }
 
     void Scene::deleteModelInstance(uint32_t modelID, uint32_t instanceID)
@@ -213,6 +282,7 @@ namespace Falcor
 
         //  Extents will be dirty in either case.
         mExtentsDirty = true;
+        mBVHRebuildNeeded = true;
     }
 
     const Scene::UserVariable& Scene::getUserVariable(const std::string& name)
@@ -318,6 +388,7 @@ namespace Falcor
 #undef merge
         mUserVars.insert(pFrom->mUserVars.begin(), pFrom->mUserVars.end());
         mExtentsDirty = true;
+        mBVHRebuildNeeded = true;
     }
 
     void Scene::createAreaLights()
@@ -37,6 +37,7 @@
 #include "Graphics/Paths/ObjectPath.h"
 #include "Graphics/Model/ObjectInstance.h"
 #include "Graphics/Material/MaterialHistory.h"
+#include "Graphics/Scene/SceneBVH.h"
 
 namespace Falcor
 {
@@ -99,7 +100,8 @@ namespace Falcor
         {
 			None                =   0x0,
 			GenerateAreaLights  =   0x1,    ///< Create area light(s) for meshes that have emissive material
-            StoreMaterialHistory =  0x2     ///< Store history of overridden mesh materials
+            StoreMaterialHistory =  0x2,    ///< Store history of overridden mesh materials
+            DontLoadModelsInParallel = 0x4  ///< Load the models one after the other on the calling thread. Gives the same scene, apart from the numbering of the model, mesh and material IDs
         };
 
         static Scene::SharedPtr loadFromFile(const std::string& filename, Model::LoadFlags modelLoadFlags = Model::LoadFlags::None, Scene::LoadFlags sceneLoadFlags = LoadFlags::None);
@@ -199,6 +201,11 @@ namespace Falcor
         */
         void deleteAreaLights();
 
+        /** Get the bounding volume hierarchy over the scene's mesh instances. It's built on first use and rebuilt after model instances were added or removed. If instances moved since the last call, it's refit.
+            Moves are detected from the transform generations in the InstanceTransformStore, so instances can be moved directly without notifying the scene
+        */
+        const SceneBVH* getBVH();
+
         /** Bind a sampler to all the scene's global materials
         */
         void bindSamplerToMaterials(Sampler::SharedPtr pSampler);
@@ -213,6 +220,11 @@ namespace Falcor
             Update changed scene extents (radius and center).
         */
         void updateExtents();
+
+        /**
+            Flag the extents and the BVH for an update if any of the scene's instances moved since the last call.
+        */
+        void detectInstanceMoves();
         
         static uint32_t sSceneCounter;
 
@@ -237,6 +249,13 @@ namespace Falcor
 
         bool mExtentsDirty = true;
 
+        SceneBVH::SharedPtr mpBVH;
+        bool mBVHRebuildNeeded = true;
+        bool mBVHRefitNeeded = false;
+
+        uint64_t mTransformChangeCount = 0;     // InstanceTransformStore::getChangeCount() when the instances were last checked for moves
+        uint64_t mTransformGenerationSum = 0;   // Sum of the transform generations of the scene's instances. Generations only grow, so it changes when an instance moves
+
         using string_uservar_map = std::map<const std::string, UserVariable>;
         string_uservar_map mUserVars;
         static const UserVariable kInvalidVar;
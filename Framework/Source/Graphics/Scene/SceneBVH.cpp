@@ -0,0 +1,753 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "SceneBVH.h"
+#include "Scene.h"
+#include "Graphics/Camera/Camera.h"
+#include "Utils/JobSystem.h"
+#include <algorithm>
+#include <emmintrin.h>
+#include <atomic>
+#include <cmath>
+#include <float.h>
+
+namespace Falcor
+{
+    static const uint32_t kBinCount = 16;
+    static const uint32_t kMaxLeafSize = 4;
+    static const float kTraversalCost = 1.0f;               // Relative to the cost of testing an item
+    static const uint32_t kMaxSahDepth = 48;                // Deeper nodes are split at the median, which bounds the depth by kMaxSahDepth + log2(item count)
+    static const uint32_t kMaxDepth = 96;                   // Size of the traversal stacks
+    static const uint32_t kParallelSubtreeSize = 4096;      // Larger subtrees are built in separate jobs
+    static const uint32_t kParallelBinningSize = 64 * 1024; // Larger nodes are binned in parallel
+    static const uint32_t kBinningChunkSize = 16 * 1024;
+
+    /** Bounds stored in SSE registers. The 4th lane is ignored
+    */
+    struct BuildBounds
+    {
+        __m128 min = _mm_set1_ps(FLT_MAX);
+        __m128 max = _mm_set1_ps(-FLT_MAX);
+
+        void extend(__m128 pMin, __m128 pMax)
+        {
+            min = _mm_min_ps(min, pMin);
+            max = _mm_max_ps(max, pMax);
+        }
+
+        void extend(const BuildBounds& b)
+        {
+            extend(b.min, b.max);
+        }
+
+        float getHalfArea() const
+        {
+            float d[4];
+            _mm_storeu_ps(d, _mm_sub_ps(max, min));
+            return d[0] * d[1] + d[1] * d[2] + d[2] * d[0];
+        }
+
+        vec3 getMin() const { return toVec3(min); }
+        vec3 getMax() const { return toVec3(max); }
+
+        static vec3 toVec3(__m128 v)
+        {
+            float f[4];
+            _mm_storeu_ps(f, v);
+            return vec3(f[0], f[1], f[2]);
+        }
+    };
+
+    /** An item's bounds during the build. The item ID occupies the 4th lane of the min vector
+    */
+    struct PrimRef
+    {
+        vec3 min;
+        uint32_t itemID;
+        vec3 max;
+        float pad;
+
+        __m128 loadMin() const { return _mm_loadu_ps(&min.x); }
+        __m128 loadMax() const { return _mm_loadu_ps(&max.x); }
+    };
+    static_assert(sizeof(PrimRef) == 32, "PrimRef must be 2 SSE vectors");
+
+    struct NodeBounds
+    {
+        BuildBounds bounds;
+        BuildBounds centroids;  // Bounds of (min + max), which is twice the centroid
+
+        void extend(const PrimRef& ref)
+        {
+            __m128 min = ref.loadMin();
+            __m128 max = ref.loadMax();
+            bounds.extend(min, max);
+            __m128 c = _mm_add_ps(min, max);
+            centroids.extend(c, c);
+        }
+
+        void merge(const NodeBounds& other)
+        {
+            bounds.extend(other.bounds);
+            centroids.extend(other.centroids);
+        }
+    };
+
+    struct BinSet
+    {
+        BuildBounds bounds[3][kBinCount];
+        uint32_t counts[3][kBinCount] = {};
+
+        void merge(const BinSet& other)
+        {
+            for(uint32_t axis = 0; axis < 3; axis++)
+            {
+                for(uint32_t bin = 0; bin < kBinCount; bin++)
+                {
+                    bounds[axis][bin].extend(other.bounds[axis][bin]);
+                    counts[axis][bin] += other.counts[axis][bin];
+                }
+            }
+        }
+    };
+
+    struct BinMapping
+    {
+        __m128 offset;
+        __m128 scale;       // 0 for axes with no centroid extent
+        bool canBin;
+
+        BinMapping(const BuildBounds& centroids)
+        {
+            offset = centroids.min;
+            vec3 extent = centroids.getMax() - centroids.getMin();
+            vec3 s;
+            for(uint32_t axis = 0; axis < 3; axis++)
+            {
+                s[axis] = (extent[axis] > 0) ? (kBinCount * 0.9999f) / extent[axis] : 0.0f;
+            }
+            scale = _mm_setr_ps(s.x, s.y, s.z, 0);
+            canBin = s != vec3(0);
+        }
+
+        /** Get the bin of an item on every axis. Used by both the binning and the partitioning, so they always agree
+        */
+        __m128i getBins(const PrimRef& ref) const
+        {
+            __m128 c = _mm_add_ps(ref.loadMin(), ref.loadMax());
+            __m128 f = _mm_mul_ps(_mm_sub_ps(c, offset), scale);
+            f = _mm_min_ps(_mm_max_ps(f, _mm_setzero_ps()), _mm_set1_ps((float)(kBinCount - 1)));
+            return _mm_cvttps_epi32(f);
+        }
+
+        uint32_t getBin(const PrimRef& ref, uint32_t axis) const
+        {
+            int32_t bins[4];
+            _mm_storeu_si128((__m128i*)bins, getBins(ref));
+            return (uint32_t)bins[axis];
+        }
+    };
+
+    struct BuildContext
+    {
+        std::vector<PrimRef> refs;
+        std::vector<SceneBVH::Node>* pNodes;
+        std::atomic<uint32_t> nodeCount;
+    };
+
+    /** Run func(begin, end, result) over chunks of a range and merge the results. Chunks run in parallel when the range is large
+    */
+    template<typename Result, typename Func>
+    static void reduceRange(uint32_t begin, uint32_t end, Result& result, const Func& func)
+    {
+        const uint32_t count = end - begin;
+        if(count < kParallelBinningSize)
+        {
+            func(begin, end, result);
+            return;
+        }
+
+        const uint32_t chunkCount = (count + kBinningChunkSize - 1) / kBinningChunkSize;
+        std::vector<Result> partial(chunkCount);
+        JobSystem::parallelFor(chunkCount, [&](uint32_t chunk)
+        {
+            uint32_t chunkBegin = begin + chunk * kBinningChunkSize;
+            func(chunkBegin, std::min(chunkBegin + kBinningChunkSize, end), partial[chunk]);
+        });
+
+        for(const auto& p : partial)
+        {
+            result.merge(p);
+        }
+    }
+
+    struct SplitCandidate
+    {
+        float cost = FLT_MAX;
+        uint32_t axis = 0;
+        uint32_t bin = 0;       // Bins up to and including this one go to the first child
+    };
+
+    static SplitCandidate findBestSplit(const BinSet& bins, float parentHalfArea)
+    {
+        SplitCandidate best;
+        for(uint32_t axis = 0; axis < 3; axis++)
+        {
+            // Sweep from the right to get the cost of the right side of every split
+            float rightCost[kBinCount];
+            uint32_t rightCount[kBinCount];
+            BuildBounds right;
+            uint32_t count = 0;
+            for(uint32_t bin = kBinCount - 1; bin > 0; bin--)
+            {
+                right.extend(bins.bounds[axis][bin]);
+                count += bins.counts[axis][bin];
+                rightCount[bin - 1] = count;
+                rightCost[bin - 1] = count ? right.getHalfArea() * count : 0;
+            }
+
+            BuildBounds left;
+            count = 0;
+            for(uint32_t bin = 0; bin < kBinCount - 1; bin++)
+            {
+                left.extend(bins.bounds[axis][bin]);
+                count += bins.counts[axis][bin];
+                if(count == 0 || rightCount[bin] == 0)
+                {
+                    continue;
+                }
+
+                float cost = kTraversalCost + (left.getHalfArea() * count + rightCost[bin]) / parentHalfArea;
+                if(cost < best.cost)
+                {
+                    best.cost = cost;
+                    best.axis = axis;
+                    best.bin = bin;
+                }
+            }
+        }
+        return best;
+    }
+
+    static void buildSubtree(BuildContext& ctx, uint32_t nodeIndex, uint32_t begin, uint32_t end, uint32_t depth)
+    {
+        NodeBounds nodeBounds;
+        reduceRange(begin, end, nodeBounds, [&ctx](uint32_t first, uint32_t last, NodeBounds& result)
+        {
+            for(uint32_t i = first; i < last; i++)
+            {
+                result.extend(ctx.refs[i]);
+            }
+        });
+
+        SceneBVH::Node& node = (*ctx.pNodes)[nodeIndex];
+        node.min = nodeBounds.bounds.getMin();
+        node.max = nodeBounds.bounds.getMax();
+        node.offset = begin;
+        node.count = end - begin;
+
+        // Small nodes are always leaves. Splitting them barely speeds up the queries, but doubles the node count
+        const uint32_t count = end - begin;
+        if(count <= kMaxLeafSize)
+        {
+            return;
+        }
+
+        const BinMapping mapping(nodeBounds.centroids);
+        uint32_t mid = begin;
+
+        if(mapping.canBin && depth < kMaxSahDepth)
+        {
+            BinSet bins;
+            reduceRange(begin, end, bins, [&ctx, &mapping](uint32_t first, uint32_t last, BinSet& result)
+            {
+                for(uint32_t i = first; i < last; i++)
+                {
+                    const PrimRef& ref = ctx.refs[i];
+                    int32_t bins[4];
+                    _mm_storeu_si128((__m128i*)bins, mapping.getBins(ref));
+                    __m128 min = ref.loadMin();
+                    __m128 max = ref.loadMax();
+                    for(uint32_t axis = 0; axis < 3; axis++)
+                    {
+                        result.bounds[axis][bins[axis]].extend(min, max);
+                        result.counts[axis][bins[axis]]++;
+                    }
+                }
+            });
+
+            // A flat parent (for example, a single planar item) has no area, so compare the costs using the area of its items
+            float parentHalfArea = std::max(nodeBounds.bounds.getHalfArea(), FLT_MIN);
+            SplitCandidate split = findBestSplit(bins, parentHalfArea);
+            if(split.cost < FLT_MAX)
+            {
+                auto first = ctx.refs.begin() + begin;
+                auto last = ctx.refs.begin() + end;
+                mid = (uint32_t)(std::partition(first, last, [&](const PrimRef& ref) { return mapping.getBin(ref, split.axis) <= split.bin; }) - ctx.refs.begin());
+            }
+        }
+
+        if(mid == begin || mid == end)
+        {
+            // Binning can't separate the items. Split at the median of the longest centroid axis
+            vec3 extent = nodeBounds.centroids.getMax() - nodeBounds.centroids.getMin();
+            uint32_t axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : ((extent.y >= extent.z) ? 1 : 2);
+            mid = begin + count / 2;
+            std::nth_element(ctx.refs.begin() + begin, ctx.refs.begin() + mid, ctx.refs.begin() + end, [axis](const PrimRef& a, const PrimRef& b)
+            {
+                return a.min[axis] + a.max[axis] < b.min[axis] + b.max[axis];
+            });
+        }
+
+        // Children are allocated in pairs, after their parent. refitNodes() relies on it
+        const uint32_t firstChild = ctx.nodeCount.fetch_add(2);
+        node.offset = firstChild;
+        node.count = 0;
+
+        if(count > kParallelSubtreeSize)
+        {
+            JobSystem::JobHandle pJob = JobSystem::run([&ctx, firstChild, begin, mid, depth]()
+            {
+                buildSubtree(ctx, firstChild, begin, mid, depth + 1);
+            });
+            buildSubtree(ctx, firstChild + 1, mid, end, depth + 1);
+            JobSystem::wait(pJob);
+        }
+        else
+        {
+            buildSubtree(ctx, firstChild, begin, mid, depth + 1);
+            buildSubtree(ctx, firstChild + 1, mid, end, depth + 1);
+        }
+    }
+
+    SceneBVH::SharedPtr SceneBVH::create()
+    {
+        return SharedPtr(new SceneBVH());
+    }
+
+    void SceneBVH::gatherItemBoxes(const Scene* pScene, bool gatherItems)
+    {
+        // Update the cached instance transforms serially. Mesh instances are shared between the model instances, so the transforms can't be updated concurrently
+        std::vector<const glm::mat4*> transforms;
+        std::vector<const BoundingBox*> meshBoxes;
+        if(gatherItems)
+        {
+            mItems.clear();
+        }
+
+        for(uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++)
+        {
+            const Model* pModel = pScene->getModel(modelID).get();
+            for(uint32_t modelInstanceID = 0; modelInstanceID < pScene->getModelInstanceCount(modelID); modelInstanceID++)
+            {
+                const glm::mat4* pTransform = &pScene->getModelInstance(modelID, modelInstanceID)->getTransformMatrix();
+                for(uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+                {
+                    for(uint32_t meshInstanceID = 0; meshInstanceID < pModel->getMeshInstanceCount(meshID); meshInstanceID++)
+                    {
+                        transforms.push_back(pTransform);
+                        meshBoxes.push_back(&pModel->getMeshInstance(meshID, meshInstanceID)->getBoundingBox());
+                        if(gatherItems)
+                        {
+                            mItems.push_back({modelID, modelInstanceID, meshID, meshInstanceID});
+                        }
+                    }
+                }
+            }
+        }
+
+        mItemBoxes.resize(transforms.size());
+        JobSystem::parallelFor((uint32_t)mItemBoxes.size(), [&](uint32_t i)
+        {
+            mItemBoxes[i] = meshBoxes[i]->transform(*transforms[i]);
+        }, 1024);
+    }
+
+    void SceneBVH::build(const Scene* pScene)
+    {
+        gatherItemBoxes(pScene, true);
+        buildNodes();
+    }
+
+    void SceneBVH::build(const BoundingBox* pBoxes, uint32_t count)
+    {
+        mItems.clear();
+        mItemBoxes.assign(pBoxes, pBoxes + count);
+        buildNodes();
+    }
+
+    void SceneBVH::buildNodes()
+    {
+        const uint32_t itemCount = (uint32_t)mItemBoxes.size();
+        mNodes.clear();
+        mLeafItems.clear();
+        if(itemCount == 0)
+        {
+            return;
+        }
+
+        BuildContext ctx;
+        ctx.refs.resize(itemCount);
+        JobSystem::parallelFor(itemCount, [&](uint32_t i)
+        {
+            ctx.refs[i].min = mItemBoxes[i].getMinPos();
+            ctx.refs[i].max = mItemBoxes[i].getMaxPos();
+            ctx.refs[i].itemID = i;
+            ctx.refs[i].pad = 0;
+        }, 4096);
+
+        // A binary tree with N leaves has 2N-1 nodes
+        mNodes.resize(2 * itemCount - 1);
+        ctx.pNodes = &mNodes;
+        ctx.nodeCount = 1;
+        buildSubtree(ctx, 0, 0, itemCount, 0);
+        mNodes.resize(ctx.nodeCount);
+
+        mLeafItems.resize(itemCount);
+        for(uint32_t i = 0; i < itemCount; i++)
+        {
+            mLeafItems[i] = ctx.refs[i].itemID;
+        }
+    }
+
+    void SceneBVH::refit(const Scene* pScene)
+    {
+        const size_t itemCount = mItemBoxes.size();
+        gatherItemBoxes(pScene, false);
+        if(mItemBoxes.size() != itemCount)
+        {
+            logError("SceneBVH::refit() - the scene's instances changed since the hierarchy was built. Rebuilding it.");
+            build(pScene);
+            return;
+        }
+        refitNodes();
+    }
+
+    void SceneBVH::refit(const BoundingBox* pBoxes)
+    {
+        mItemBoxes.assign(pBoxes, pBoxes + mItemBoxes.size());
+        refitNodes();
+    }
+
+    void SceneBVH::refitNodes()
+    {
+        // Update the leaves in parallel, then propagate the bounds up. Children are always stored after their parents, so a reverse pass visits them first
+        JobSystem::parallelFor((uint32_t)mNodes.size(), [this](uint32_t nodeIndex)
+        {
+            Node& node = mNodes[nodeIndex];
+            if(node.count)
+            {
+                node.min = vec3(FLT_MAX);
+                node.max = vec3(-FLT_MAX);
+                for(uint32_t i = node.offset; i < node.offset + node.count; i++)
+                {
+                    const BoundingBox& box = mItemBoxes[mLeafItems[i]];
+                    node.min = glm::min(node.min, box.getMinPos());
+                    node.max = glm::max(node.max, box.getMaxPos());
+                }
+            }
+        }, 1024);
+
+        for(size_t nodeIndex = mNodes.size(); nodeIndex-- > 0;)
+        {
+            Node& node = mNodes[nodeIndex];
+            if(node.count == 0)
+            {
+                const Node& left = mNodes[node.offset];
+                const Node& right = mNodes[node.offset + 1];
+                node.min = glm::min(left.min, right.min);
+                node.max = glm::max(left.max, right.max);
+            }
+        }
+    }
+
+    BoundingBox SceneBVH::getBounds() const
+    {
+        return mNodes.empty() ? BoundingBox() : BoundingBox::fromMinMax(mNodes[0].min, mNodes[0].max);
+    }
+
+    void SceneBVH::appendSubtreeItems(uint32_t nodeIndex, std::vector<uint32_t>& items) const
+    {
+        // The items of a subtree are contiguous, between its leftmost and rightmost leaves
+        uint32_t first = nodeIndex;
+        while(mNodes[first].count == 0)
+        {
+            first = mNodes[first].offset;
+        }
+        uint32_t last = nodeIndex;
+        while(mNodes[last].count == 0)
+        {
+            last = mNodes[last].offset + 1;
+        }
+        items.insert(items.end(), mLeafItems.begin() + mNodes[first].offset, mLeafItems.begin() + mNodes[last].offset + mNodes[last].count);
+    }
+
+    /** Traverse the hierarchy depth-first
+        \param[in] visitNode Called with every reached node. Returns true to visit the node's children or items
+        \param[in] visitItem Called with every item of a visited leaf
+    */
+    template<typename Node, typename NodeFunc, typename ItemFunc>
+    static void traverse(const std::vector<Node>& nodes, const std::vector<uint32_t>& leafItems, const NodeFunc& visitNode, const ItemFunc& visitItem)
+    {
+        if(nodes.empty())
+        {
+            return;
+        }
+
+        uint32_t stack[kMaxDepth];
+        uint32_t stackSize = 0;
+        stack[stackSize++] = 0;
+        while(stackSize)
+        {
+            const uint32_t nodeIndex = stack[--stackSize];
+            const Node& node = nodes[nodeIndex];
+            if(visitNode(nodeIndex, node) == false)
+            {
+                continue;
+            }
+
+            if(node.count)
+            {
+                for(uint32_t i = node.offset; i < node.offset + node.count; i++)
+                {
+                    visitItem(leafItems[i]);
+                }
+            }
+            else
+            {
+                stack[stackSize++] = node.offset + 1;
+                stack[stackSize++] = node.offset;
+            }
+        }
+    }
+
+    void SceneBVH::queryFrustum(const Camera* pCamera, std::vector<uint32_t>& items) const
+    {
+        queryFrustum(pCamera, 0, items);
+    }
+
+    void SceneBVH::queryFrustum(const Camera* pCamera, float minProjectedSize, std::vector<uint32_t>& items) const
+    {
+        items.clear();
+        const Camera::FrustumPlane* pPlanes = pCamera->getFrustumPlanes();
+
+        // The projected diameter of a sphere of radius r at distance d is about r * proj[1][1] / d viewport heights. Perspective projections have proj[3][3] == 0, orthographic ones don't divide by the distance
+        const bool cullSmallObjects = minProjectedSize > 0;
+        const glm::mat4& proj = pCamera->getProjMatrix();
+        const float sizeScale = proj[1][1];
+        const bool isPerspective = (proj[3][3] == 0);
+        const vec3& eye = pCamera->getPosition();
+        auto isTooSmall = [&](const vec3& min, const vec3& max)
+        {
+            float radius = 0.5f * length(max - min);
+            float distance = isPerspective ? length(eye - glm::clamp(eye, min, max)) : 1.0f;
+            return radius * sizeScale < minProjectedSize * distance;
+        };
+
+        // The node tests evaluate the same expression as the item test with the node's corners. Node bounds are exact unions of the item bounds, so the node tests never reject a visible item
+        traverse(mNodes, mLeafItems, [&](uint32_t nodeIndex, const Node& node)
+        {
+            bool isFullyInside = true;
+            for(uint32_t plane = 0; plane < 6; plane++)
+            {
+                const vec3& n = pPlanes[plane].xyz;
+                vec3 inner = vec3(n.x >= 0 ? node.max.x : node.min.x, n.y >= 0 ? node.max.y : node.min.y, n.z >= 0 ? node.max.z : node.min.z);
+                vec3 outer = vec3(n.x >= 0 ? node.min.x : node.max.x, n.y >= 0 ? node.min.y : node.max.y, n.z >= 0 ? node.min.z : node.max.z);
+                if(glm::dot(inner, n) <= pPlanes[plane].negW)
+                {
+                    return false;
+                }
+                isFullyInside = isFullyInside && (glm::dot(outer, n) > pPlanes[plane].negW);
+            }
+
+            if(cullSmallObjects)
+            {
+                // A fully visible subtree may still contain small items, so it can't be accepted as a whole
+                return isTooSmall(node.min, node.max) == false;
+            }
+
+            if(isFullyInside && node.count == 0)
+            {
+                appendSubtreeItems(nodeIndex, items);
+                return false;
+            }
+            return true;
+        },
+        [&](uint32_t item)
+        {
+            // Same test as Camera::isObjectCulled()
+            const BoundingBox& box = mItemBoxes[item];
+            bool isInside = true;
+            for(uint32_t plane = 0; plane < 6; plane++)
+            {
+                vec3 signedExtent = box.extent * pPlanes[plane].sign;
+                float dr = glm::dot(box.center + signedExtent, pPlanes[plane].xyz);
+                isInside = isInside & (dr > pPlanes[plane].negW);
+            }
+
+            if(isInside && (cullSmallObjects == false || isTooSmall(box.getMinPos(), box.getMaxPos()) == false))
+            {
+                items.push_back(item);
+            }
+        });
+    }
+
+    void SceneBVH::queryBox(const BoundingBox& box, std::vector<uint32_t>& items) const
+    {
+        items.clear();
+        const vec3 boxMin = box.getMinPos();
+        const vec3 boxMax = box.getMaxPos();
+        auto overlaps = [&](const vec3& min, const vec3& max)
+        {
+            return all(lessThanEqual(min, boxMax)) && all(lessThanEqual(boxMin, max));
+        };
+
+        traverse(mNodes, mLeafItems, [&](uint32_t nodeIndex, const Node& node)
+        {
+            return overlaps(node.min, node.max);
+        },
+        [&](uint32_t item)
+        {
+            if(overlaps(mItemBoxes[item].getMinPos(), mItemBoxes[item].getMaxPos()))
+            {
+                items.push_back(item);
+            }
+        });
+    }
+
+    void SceneBVH::querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& items) const
+    {
+        items.clear();
+        const float radiusSquared = radius * radius;
+        auto overlaps = [&](const vec3& min, const vec3& max)
+        {
+            vec3 d = center - glm::clamp(center, min, max);
+            return dot(d, d) <= radiusSquared;
+        };
+
+        traverse(mNodes, mLeafItems, [&](uint32_t nodeIndex, const Node& node)
+        {
+            return overlaps(node.min, node.max);
+        },
+        [&](uint32_t item)
+        {
+            if(overlaps(mItemBoxes[item].getMinPos(), mItemBoxes[item].getMaxPos()))
+            {
+                items.push_back(item);
+            }
+        });
+    }
+
+    static const float kMissDistance = -1;
+
+    /** Slab test. Returns the entry distance, or kMissDistance if the ray misses the box or the entry is further than maxDistance.
+        A miss can't be encoded as FLT_MAX, since that is a valid maxDistance
+    */
+    static float intersectBox(const vec3& origin, const vec3& invDirection, float maxDistance, const vec3& min, const vec3& max)
+    {
+        vec3 t0 = (min - origin) * invDirection;
+        vec3 t1 = (max - origin) * invDirection;
+        vec3 tNear = glm::min(t0, t1);
+        vec3 tFar = glm::max(t0, t1);
+        float entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+        // An infinite entry means the ray is parallel to a slab it starts outside of. It would pass the test if maxDistance is infinite
+        return (entry <= exit && std::isinf(entry) == false) ? entry : kMissDistance;
+    }
+
+    uint32_t SceneBVH::intersectRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance) const
+    {
+        // Division by 0 gives an infinity, which the slab test handles correctly
+        const vec3 invDirection = 1.0f / direction;
+        uint32_t closestItem = kInvalidItem;
+        float closest = maxDistance;
+
+        if(mNodes.empty() || intersectBox(origin, invDirection, closest, mNodes[0].min, mNodes[0].max) == kMissDistance)
+        {
+            return kInvalidItem;
+        }
+
+        // Nodes are pushed with their entry distance, so nodes behind the closest hit can be skipped without testing them again
+        struct StackEntry
+        {
+            uint32_t nodeIndex;
+            float distance;
+        };
+        StackEntry stack[kMaxDepth];
+        uint32_t stackSize = 0;
+        stack[stackSize++] = {0, 0.0f};
+        while(stackSize)
+        {
+            const StackEntry entry = stack[--stackSize];
+            if(entry.distance > closest)
+            {
+                continue;
+            }
+
+            const Node& node = mNodes[entry.nodeIndex];
+            if(node.count)
+            {
+                for(uint32_t i = node.offset; i < node.offset + node.count; i++)
+                {
+                    const uint32_t item = mLeafItems[i];
+                    float t = intersectBox(origin, invDirection, closest, mItemBoxes[item].getMinPos(), mItemBoxes[item].getMaxPos());
+                    if(t != kMissDistance && (t < closest || (t == closest && closestItem == kInvalidItem)))
+                    {
+                        closest = t;
+                        closestItem = item;
+                    }
+                }
+                continue;
+            }
+
+            // Visit the nearer child first. Misses are never pushed, so their order doesn't matter
+            float tLeft = intersectBox(origin, invDirection, closest, mNodes[node.offset].min, mNodes[node.offset].max);
+            float tRight = intersectBox(origin, invDirection, closest, mNodes[node.offset + 1].min, mNodes[node.offset + 1].max);
+            StackEntry near = {node.offset, tLeft};
+            StackEntry far = {node.offset + 1, tRight};
+            if(tRight < tLeft)
+            {
+                std::swap(near, far);
+            }
+            if(far.distance != kMissDistance)
+            {
+                stack[stackSize++] = far;
+            }
+            if(near.distance != kMissDistance)
+            {
+                stack[stackSize++] = near;
+            }
+        }
+
+        if(closestItem != kInvalidItem)
+        {
+            distance = closest;
+        }
+        return closestItem;
+    }
+}
@@ -0,0 +1,164 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <vector>
+#include "glm/vec3.hpp"
+#include "Utils/AABB.h"
+
+namespace Falcor
+{
+    class Scene;
+    class Camera;
+
+    /** Bounding volume hierarchy over the mesh instances of a scene.
+        Every item is a mesh instance of a model instance, bounded by the same world-space box SceneRenderer uses for culling. Queries return item indices, which map to the instances using getItem().
+        The hierarchy is built top-down using the binned surface-area heuristic. Large subtrees are built in parallel on the JobSystem workers.
+        When instances move, refit() updates the bounds without changing the topology.
+    */
+    class SceneBVH
+    {
+    public:
+        using SharedPtr = std::shared_ptr<SceneBVH>;
+        using SharedConstPtr = std::shared_ptr<const SceneBVH>;
+
+        /** A mesh instance of a model instance
+        */
+        struct Item
+        {
+            uint32_t modelID;           ///< Index of the model in the scene
+            uint32_t modelInstanceID;   ///< Index of the model instance
+            uint32_t meshID;            ///< Index of the mesh in the model
+            uint32_t meshInstanceID;    ///< Index of the mesh instance
+        };
+
+        /** A node of the hierarchy
+        */
+        struct Node
+        {
+            glm::vec3 min;
+            uint32_t offset;    ///< Leaves: index of the leaf's first entry in the leaf item list. Internal nodes: index of the first child. The second child follows it
+            glm::vec3 max;
+            uint32_t count;     ///< Number of items in a leaf, 0 for internal nodes
+        };
+
+        static const uint32_t kInvalidItem = (uint32_t)-1;
+
+        /** Create an empty hierarchy
+        */
+        static SharedPtr create();
+
+        /** Build the hierarchy over all the mesh instances of a scene
+        */
+        void build(const Scene* pScene);
+
+        /** Build the hierarchy over an array of boxes. Item i is bounded by pBoxes[i]. getItem() can't be used after this call
+            \param[in] pBoxes The item boxes
+            \param[in] count Number of items
+        */
+        void build(const BoundingBox* pBoxes, uint32_t count);
+
+        /** Update the bounds after instances moved. Much cheaper than a rebuild, but the quality of the hierarchy degrades as the instances move away from where they were when it was built.
+            The scene must contain the same instances it had when the hierarchy was built.
+        */
+        void refit(const Scene* pScene);
+
+        /** Update the bounds from an array which holds the new box of every item
+        */
+        void refit(const BoundingBox* pBoxes);
+
+        /** Find the items which intersect the camera's frustum. Returns the same items as testing every item box with Camera::isObjectCulled()
+            \param[in] pCamera The camera
+            \param[out] items Receives the indices of the visible items. The previous content is discarded
+        */
+        void queryFrustum(const Camera* pCamera, std::vector<uint32_t>& items) const;
+
+        /** Find the items which intersect the camera's frustum and are not too small to matter on screen.
+            The projected size of a box is estimated from its bounding sphere, placed at the box's closest distance to the camera. Since the estimate of a box is never smaller than the estimate of a box it contains, whole subtrees are rejected once their bounds become too small.
+            \param[in] pCamera The camera
+            \param[in] minProjectedSize Items whose projected diameter is smaller than this are culled. In units of the viewport height. 0 disables the test
+            \param[out] items Receives the indices of the visible items. The previous content is discarded
+        */
+        void queryFrustum(const Camera* pCamera, float minProjectedSize, std::vector<uint32_t>& items) const;
+
+        /** Find the items whose boxes overlap a box. Boxes which touch count as overlapping
+            \param[in] box The box
+            \param[out] items Receives the indices of the items. The previous content is discarded
+        */
+        void queryBox(const BoundingBox& box, std::vector<uint32_t>& items) const;
+
+        /** Find the items whose boxes overlap a sphere
+            \param[in] center The center of the sphere
+            \param[in] radius The radius of the sphere
+            \param[out] items Receives the indices of the items. The previous content is discarded
+        */
+        void querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& items) const;
+
+        /** Find the closest item whose box is hit by a ray
+            \param[in] origin The ray origin
+            \param[in] direction The ray direction. Doesn't have to be normalized
+            \param[in] maxDistance Hits further than this are ignored. In units of the direction's length
+            \param[out] distance If an item was hit, the ray parameter of the hit. 0 if the origin is inside the item's box
+            \return The index of the closest item, or kInvalidItem if no item was hit
+        */
+        uint32_t intersectRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance) const;
+
+        /** Get the mesh instance an item represents. Only valid if the hierarchy was built from a scene
+        */
+        const Item& getItem(uint32_t index) const { return mItems[index]; }
+
+        /** Get the box of an item
+        */
+        const BoundingBox& getItemBounds(uint32_t index) const { return mItemBoxes[index]; }
+
+        /** Get the number of items
+        */
+        uint32_t getItemCount() const { return (uint32_t)mItemBoxes.size(); }
+
+        /** Get the number of nodes
+        */
+        uint32_t getNodeCount() const { return (uint32_t)mNodes.size(); }
+
+        /** Get the box which bounds all the items
+        */
+        BoundingBox getBounds() const;
+
+    private:
+        SceneBVH() = default;
+
+        void gatherItemBoxes(const Scene* pScene, bool gatherItems);
+        void buildNodes();
+        void refitNodes();
+        void appendSubtreeItems(uint32_t nodeIndex, std::vector<uint32_t>& items) const;
+
+        std::vector<Node> mNodes;
+        std::vector<uint32_t> mLeafItems;       // Item indices, in the order of the leaves. The items of every subtree are contiguous
+        std::vector<BoundingBox> mItemBoxes;
+        std::vector<Item> mItems;
+    };
+}
@@ -30,8 +30,10 @@
 #include "Scene.h"
 #include "Utils/OS.h"
 #include "Externals/RapidJson/include/rapidjson/error/en.h"
-#include <sstream>
+#include "Externals/RapidJson/include/rapidjson/filereadstream.h"
+#include "Externals/RapidJson/include/rapidjson/writer.h"
 #include <fstream>
+#include <algorithm>
 #include "Graphics/TextureHelper.h"
 #include "glm/detail/func_trigonometric.hpp"
 #include "SceneExportImportCommon.h"
@@ -102,68 +104,21 @@ namespace Falcor
         return importer.load(filename, modelLoadFlags, sceneLoadFlags);
     }
 
-    bool SceneImporter::createModelInstances(const rapidjson::Value& jsonVal, const Model::SharedPtr& pModel)
+    bool SceneImporter::createModelInstances(const std::vector<ModelInstanceDesc>& instances, const Model::SharedPtr& pModel)
     {
-        if(jsonVal.IsArray() == false)
-        {
-            return error("Model instances should be an array of objects");
-        }
-
-        for(uint32_t i = 0; i < jsonVal.Size(); i++)
+        for(const auto& instance : instances)
         {
-            const auto& instance = jsonVal[i];
-            glm::vec3 scaling(1, 1, 1);
-            glm::vec3 translation(0, 0, 0);
-            glm::vec3 rotation(0, 0, 0);
-            std::string name = "Instance " + std::to_string(i);
-
-            for(auto& m = instance.MemberBegin(); m < instance.MemberEnd(); m++)
-            {
-                std::string key(m->name.GetString());
-                if(key == SceneKeys::kName)
-                {
-                    if(m->value.IsString() == false)
-                    {
-                        return error("Model instance name should be a string value.");
-                    }
-                    name = std::string(m->value.GetString());
-                }
-                else if(key == SceneKeys::kTranslationVec)
-                {
-                    if(getFloatVec<3>(m->value, "Model instance translation vector", &translation[0]) == false)
-                    {
-                        return false;
-                    }
-                }
-                else if(key == SceneKeys::kScalingVec)
-                {
-                    if(getFloatVec<3>(m->value, "Model instance scale vector", &scaling[0]) == false)
-                    {
-                        return false;
-                    }
-                }
-                else if(key == SceneKeys::kRotationVec)
-                {
-                    if(getFloatVec<3>(m->value, "Model instance rotation vector", &rotation[0]) == false)
-                    {
-                        return false;
-                    }
-
-                    rotation = glm::radians(rotation);
-                }
-                else
-                {
-                    return error("Unknown key \"" + key + "\" when parsing model instance");
-                }
-            }
-
-            if (isNameDuplicate(name, mInstanceMap, "model instances"))
+            if (isNameDuplicate(instance.name, mInstanceMap, "model instances"))
             {
                 return false;
             }
             else
             {
-                auto pInstance = Scene::ModelInstance::create(pModel, translation, rotation, scaling, name);
+                auto pInstance = Scene::ModelInstance::create(pModel, instance.translation, instance.rotation, instance.scaling, instance.name);
+                if(pInstance == nullptr)
+                {
+                    return error("Can't create model instance '" + instance.name + "'");
+                }
                 mInstanceMap[pInstance->getName()] = pInstance;
                 mScene.addModelInstance(pInstance);
             }
@@ -172,7 +127,7 @@ namespace Falcor
         return true;
     }
 
-    bool SceneImporter::createModel(const rapidjson::Value& jsonModel)
+    bool SceneImporter::createModel(const rapidjson::Value& jsonModel, uint32_t modelIndex)
     {
         // Model must have at least a filename
         if(jsonModel.HasMember(SceneKeys::kFilename) == false)
@@ -185,19 +140,30 @@ namespace Falcor
             return error("Model filename must be a string");
         }
 
-        // Load the model
-        std::string file =  mDirectory + '\\' + modelFile.GetString();
-        if (doesFileExist(file) == false)
+        // Load the model, unless it was already loaded with the other models of the scene.
+        // The filename, name and active animation are set when the model is created, since shared models must not be modified
+        ModelLoad load;
+        getModelLoad(jsonModel, load);
+        Model::SharedPtr pModel;
+        if(modelIndex < mModelLoads.size() && mModelLoads[modelIndex].isLoaded)
+        {
+            pModel = std::move(mModelLoads[modelIndex].pModel);
+        }
+        else
         {
-            file = modelFile.GetString();
+            pModel = ModelCache::load(load);
         }
-        auto pModel = Model::createFromFile(file.c_str(), mModelLoadFlags);
         if(pModel == nullptr)
         {
             return false;
         }
 
-        pModel->setFilename(modelFile.GetString());
+        std::string fullpath;
+        if(findFileInDataDirectories(load.filename, fullpath))
+        {
+            mSnapshotSources.models[pModel.get()] = { fullpath, load.flags, load.isShared, load.properties };
+            mSnapshotSources.dependencies.push_back(fullpath);
+        }
 
         bool instanceAdded = false;
 
@@ -215,7 +181,6 @@ namespace Falcor
                 {
                     return error("Model name should be a string value.");
                 }
-                pModel->setName(std::string(jval->value.GetString()));
             }
             else if (keyName == SceneKeys::kMaterialOverrides)
             {
@@ -226,7 +191,18 @@ namespace Falcor
             }
             else if(keyName == SceneKeys::kModelInstances)
             {
-                if(createModelInstances(jval->value, pModel) == false)
+                // The instances were decoded while reading the file, the DOM only holds an empty array in their place
+                if(jval->value.IsArray() == false)
+                {
+                    return error("Model instances should be an array of objects");
+                }
+
+                std::vector<ModelInstanceDesc> instances;
+                if(modelIndex < mModelInstances.size())
+                {
+                    instances.swap(mModelInstances[modelIndex]);
+                }
+                if(createModelInstances(instances, pModel) == false)
                 {
                     return false;
                 }
@@ -246,10 +222,6 @@ namespace Falcor
                     msg += ", but model only has " + std::to_string(pModel->getAnimationsCount()) + " animations. Ignoring field";
                     logWarning(msg);
                 }
-                else
-                {
-                    pModel->setActiveAnimation(activeAnimation);
-                }
             }
             else
             {
@@ -308,6 +280,7 @@ namespace Falcor
             // Apply override
             auto& pMesh = pModel->getMesh(meshID);
             mScene.getMaterialHistory()->replace(pMesh.get(), mScene.getMaterial(materialID));
+            mSnapshotSources.materialOverrides.push_back({ pModel.get(), meshID, mScene.getMaterial(materialID).get() });
         }
 
         return true;
@@ -323,7 +296,7 @@ namespace Falcor
         // Loop over the array
         for(uint32_t i = 0; i < jsonVal.Size(); i++)
         {
-            if(createModel(jsonVal[i]) == false)
+            if(createModel(jsonVal[i], i) == false)
             {
                 return false;
             }
@@ -450,7 +423,7 @@ namespace Falcor
         return true;
     }
 
-    bool SceneImporter::createMaterialTexture(const rapidjson::Value& jsonValue, Texture::SharedPtr& pTexture, bool isSrgb)
+    bool SceneImporter::createMaterialTexture(const rapidjson::Value& jsonValue, Texture::SharedPtr& pTexture, bool isSrgb, const MipGenDesc& mipDesc)
     {
         if(jsonValue.IsString() == false)
         {
@@ -465,7 +438,13 @@ namespace Falcor
             filename = fullpath;
         }
 
-        pTexture = createTextureFromFile(filename, true, isSrgb);
+        std::string textureFullpath;
+        if(findFileInDataDirectories(filename, textureFullpath))
+        {
+            mSnapshotSources.dependencies.push_back(textureFullpath);
+        }
+
+        pTexture = createTextureFromFile(filename, true, isSrgb, Texture::BindFlags::ShaderResource, mipDesc);
         return (pTexture != nullptr);
     }
 
@@ -576,6 +555,7 @@ namespace Falcor
                     return error("Material ID should be an unsigned integer");
                 }
                 pMaterial->setID(value.GetUint());
+                mMaterialsWithId.insert(pMaterial.get());
             }
             else if (key == SceneKeys::kMaterialDoubleSided)
             {
@@ -587,8 +567,13 @@ namespace Falcor
             }
             else if(key == SceneKeys::kMaterialAlpha)
             {
+                // Keep the alpha-tested coverage of the lower mip-levels. Alpha maps are sampled from the first channel
+                MipGenDesc mipDesc;
+                mipDesc.alphaTestRef = pMaterial->getAlphaThreshold();
+                mipDesc.alphaTestChannel = 0;
+
                 Texture::SharedPtr pTexture;
-                if (createMaterialTexture(value, pTexture, false))
+                if (createMaterialTexture(value, pTexture, false, mipDesc))
                 {
                     pMaterial->setAlphaMap(pTexture);
                 }
@@ -1156,6 +1141,461 @@ namespace Falcor
         return true;
     }
 
+    static bool isKey(const char* str, rapidjson::SizeType length, const char* key)
+    {
+        return (strlen(key) == length) && (memcmp(str, key, length) == 0);
+    }
+
+    /** Filters the SAX events of a scene file.
+        The model instance arrays, which make up most of the data in large scene files, are decoded directly into ModelInstanceDesc records, and replaced by empty arrays.
+        All the other events are written back as JSON text, which is small enough to be parsed into a DOM.
+    */
+    class SceneImporter::JsonStreamFilter
+    {
+    public:
+        using Writer = rapidjson::Writer<rapidjson::StringBuffer>;
+
+        JsonStreamFilter(SceneImporter& importer, Writer& writer) : mImporter(importer), mWriter(writer) {}
+
+        /** Check if parsing was stopped because of an invalid model instance. The error was already reported
+        */
+        bool hasError() const { return mError; }
+
+        bool Null()                 { return isStreaming() ? invalidValue() : (beginValue() && mWriter.Null()); }
+        bool Bool(bool b)           { return isStreaming() ? invalidValue() : (beginValue() && mWriter.Bool(b)); }
+        bool Int(int i)             { return isStreaming() ? number((double)i) : (beginValue() && mWriter.Int(i)); }
+        bool Uint(unsigned u)       { return isStreaming() ? number((double)u) : (beginValue() && mWriter.Uint(u)); }
+        bool Int64(int64_t i)       { return isStreaming() ? number((double)i) : (beginValue() && mWriter.Int64(i)); }
+        bool Uint64(uint64_t u)     { return isStreaming() ? number((double)u) : (beginValue() && mWriter.Uint64(u)); }
+        bool Double(double d)       { return isStreaming() ? number(d) : (beginValue() && mWriter.Double(d)); }
+
+        bool String(const char* str, rapidjson::SizeType length, bool copy)
+        {
+            if(isStreaming())
+            {
+                if(mState != State::Name)
+                {
+                    return invalidValue();
+                }
+                mInstance.name.assign(str, length);
+                mState = State::Object;
+                return true;
+            }
+            return beginValue() && mWriter.String(str, length, copy);
+        }
+
+        bool Key(const char* str, rapidjson::SizeType length, bool copy)
+        {
+            if(isStreaming())
+            {
+                return instanceKey(str, length);
+            }
+
+            // Remember if the value is one of the arrays we're looking for
+            Scope& scope = mScopes.back();
+            scope.isSpecialKey = (scope.type == ScopeType::Root && isKey(str, length, SceneKeys::kModels)) || (scope.type == ScopeType::Model && isKey(str, length, SceneKeys::kModelInstances));
+            return mWriter.Key(str, length, copy);
+        }
+
+        bool StartObject()
+        {
+            if(isStreaming())
+            {
+                if(mState != State::Array)
+                {
+                    return invalidValue();
+                }
+                mInstance.name = "Instance " + std::to_string(mInstanceCount);
+                mInstance.translation = glm::vec3(0, 0, 0);
+                mInstance.rotation = glm::vec3(0, 0, 0);
+                mInstance.scaling = glm::vec3(1, 1, 1);
+                mState = State::Object;
+                return true;
+            }
+
+            ScopeType type = ScopeType::Other;
+            if(mScopes.empty())
+            {
+                type = ScopeType::Root;
+            }
+            else if(mScopes.back().type == ScopeType::ModelArray)
+            {
+                type = ScopeType::Model;
+                mModelIndex = mScopes.back().elementCount;
+            }
+            beginValue();
+            mScopes.push_back({ type, false, 0 });
+            return mWriter.StartObject();
+        }
+
+        bool EndObject(rapidjson::SizeType memberCount)
+        {
+            if(isStreaming())
+            {
+                // Only instance objects can end here, anything else is rejected when it starts
+                auto& instances = mImporter.mModelInstances[mModelIndex];
+                instances.push_back(mInstance);
+                mInstanceCount++;
+                mState = State::Array;
+                return true;
+            }
+            mScopes.pop_back();
+            return mWriter.EndObject(memberCount);
+        }
+
+        bool StartArray()
+        {
+            if(isStreaming())
+            {
+                if(mState != State::Vector)
+                {
+                    return invalidValue();
+                }
+                mVectorSize = 0;
+                mState = State::VectorElements;
+                return true;
+            }
+
+            const bool isSpecialKey = (mScopes.empty() == false) && mScopes.back().isSpecialKey;
+            const ScopeType parentType = mScopes.empty() ? ScopeType::Other : mScopes.back().type;
+            beginValue();
+
+            if(isSpecialKey && parentType == ScopeType::Model)
+            {
+                // Start decoding the model's instances. The DOM gets an empty array
+                if(mImporter.mModelInstances.size() <= mModelIndex)
+                {
+                    mImporter.mModelInstances.resize(mModelIndex + 1);
+                }
+                mState = State::Array;
+                mInstanceCount = 0;
+                return mWriter.StartArray() && mWriter.EndArray(0);
+            }
+
+            mScopes.push_back({ isSpecialKey ? ScopeType::ModelArray : ScopeType::Other, false, 0 });
+            return mWriter.StartArray();
+        }
+
+        bool EndArray(rapidjson::SizeType elementCount)
+        {
+            if(isStreaming())
+            {
+                if(mState == State::VectorElements)
+                {
+                    if(mVectorSize != 3)
+                    {
+                        return fail("Trying to load a vector for " + std::string(mpVectorDesc) + ", but vector size mismatches. Required size is 3, array size is " + std::to_string(mVectorSize));
+                    }
+                    if(mpVector == &mInstance.rotation)
+                    {
+                        mInstance.rotation = glm::radians(mInstance.rotation);
+                    }
+                    mState = State::Object;
+                }
+                else
+                {
+                    // The end of the instance array
+                    mState = State::None;
+                }
+                return true;
+            }
+            mScopes.pop_back();
+            return mWriter.EndArray(elementCount);
+        }
+
+    private:
+        enum class ScopeType
+        {
+            Other,
+            Root,           ///< The top-level object
+            ModelArray,     ///< The models section
+            Model,          ///< An element of the models section
+        };
+
+        struct Scope
+        {
+            ScopeType type;
+            bool isSpecialKey;          ///< For objects, true if the current key is the models section in the root, or the instance array in a model
+            uint32_t elementCount;      ///< For arrays, the number of elements seen so far
+        };
+
+        /** Instance decoding state
+        */
+        enum class State
+        {
+            None,               ///< Not inside an instance array
+            Array,              ///< Expecting an instance object or the end of the array
+            Object,             ///< Expecting a key or the end of the instance object
+            Name,               ///< Expecting the instance name
+            Vector,             ///< Expecting a vector
+            VectorElements,     ///< Inside a vector
+        };
+
+        bool isStreaming() const { return mState != State::None; }
+
+        bool beginValue()
+        {
+            if(mScopes.empty() == false)
+            {
+                mScopes.back().elementCount++;
+                mScopes.back().isSpecialKey = false;
+            }
+            return true;
+        }
+
+        bool fail(const std::string& msg)
+        {
+            mImporter.error(msg);
+            mError = true;
+            return false;
+        }
+
+        // Report a value of the wrong type, using the same messages as the DOM-based parsing functions
+        bool invalidValue()
+        {
+            switch(mState)
+            {
+            case State::Name:
+                return fail("Model instance name should be a string value.");
+            case State::Vector:
+                return fail("Trying to load a vector for " + std::string(mpVectorDesc) + ", but JValue is not an array");
+            case State::VectorElements:
+                return fail("Trying to load a vector for " + std::string(mpVectorDesc) + ", but one the elements is not a number.");
+            default:
+                return fail("Model instances should be an array of objects");
+            }
+        }
+
+        bool number(double value)
+        {
+            if(mState != State::VectorElements)
+            {
+                return invalidValue();
+            }
+            if(mVectorSize < 3)
+            {
+                (*mpVector)[mVectorSize] = (float)value;
+            }
+            mVectorSize++;
+            return true;
+        }
+
+        bool instanceKey(const char* str, rapidjson::SizeType length)
+        {
+            if(isKey(str, length, SceneKeys::kName))
+            {
+                mState = State::Name;
+                return true;
+            }
+
+            mState = State::Vector;
+            if(isKey(str, length, SceneKeys::kTranslationVec))
+            {
+                mpVector = &mInstance.translation;
+                mpVectorDesc = "Model instance translation vector";
+            }
+            else if(isKey(str, length, SceneKeys::kScalingVec))
+            {
+                mpVector = &mInstance.scaling;
+                mpVectorDesc = "Model instance scale vector";
+            }
+            else if(isKey(str, length, SceneKeys::kRotationVec))
+            {
+                mpVector = &mInstance.rotation;
+                mpVectorDesc = "Model instance rotation vector";
+            }
+            else
+            {
+                return fail("Unknown key \"" + std::string(str, length) + "\" when parsing model instance");
+            }
+            return true;
+        }
+
+        SceneImporter& mImporter;
+        Writer& mWriter;
+        std::vector<Scope> mScopes;
+        uint32_t mModelIndex = 0;
+        bool mError = false;
+
+        State mState = State::None;
+        ModelInstanceDesc mInstance;
+        uint32_t mInstanceCount = 0;
+        glm::vec3* mpVector = nullptr;
+        const char* mpVectorDesc = "";
+        uint32_t mVectorSize = 0;
+    };
+
+    // Count the lines before a byte offset in a file, for error messages
+    static size_t getLineNumber(const std::string& fullpath, size_t offset)
+    {
+        std::ifstream stream(fullpath, std::ios::binary);
+        std::vector<char> buffer(64 * 1024);
+        size_t line = 0;
+        while(offset > 0 && stream)
+        {
+            stream.read(buffer.data(), std::min(buffer.size(), offset));
+            size_t count = (size_t)stream.gcount();
+            line += std::count(buffer.begin(), buffer.begin() + count, '\n');
+            offset -= count;
+            if(count == 0)
+            {
+                break;
+            }
+        }
+        return line;
+    }
+
+    bool SceneImporter::readSceneFile(const std::string& fullpath)
+    {
+        FILE* pFile = nullptr;
+        if(fopen_s(&pFile, fullpath.c_str(), "rb") != 0)
+        {
+            return error("Can't open file.");
+        }
+
+        // Stream the file through the filter, so only a small window of it is in memory at any time
+        std::vector<char> readBuffer(64 * 1024);
+        rapidjson::FileReadStream fileStream(pFile, readBuffer.data(), readBuffer.size());
+        rapidjson::StringBuffer textBuffer;
+        JsonStreamFilter::Writer writer(textBuffer);
+        JsonStreamFilter filter(*this, writer);
+        rapidjson::Reader reader;
+        rapidjson::ParseResult result = reader.Parse(fileStream, filter);
+        fclose(pFile);
+
+        if(filter.hasError())
+        {
+            return false;
+        }
+
+        if(result.IsError())
+        {
+            return error(std::string("JSON Parse error in line ") + std::to_string(getLineNumber(fullpath, result.Offset())) + ". " + rapidjson::GetParseError_En(result.Code()));
+        }
+
+        // The remaining text is owned by the importer, so the DOM can reference its strings instead of copying them
+        mJsonText.assign(textBuffer.GetString(), textBuffer.GetSize());
+        mJDoc.ParseInsitu(&mJsonText[0]);
+        if(mJDoc.HasParseError())
+        {
+            return error(std::string("JSON Parse error. ") + rapidjson::GetParseError_En(mJDoc.GetParseError()));
+        }
+        return true;
+    }
+
+    bool SceneImporter::readFile(const std::string& fullpath)
+    {
+        mSnapshotSources.dependencies.push_back(fullpath);
+
+        // Get the file directory
+        auto last = fullpath.find_last_of("/\\");
+        mDirectory = fullpath.substr(0, last);
+
+        // create the DOM
+        if(readSceneFile(fullpath) == false)
+        {
+            return false;
+        }
+
+        // Read the include files now, so their models are loaded together with ours. Invalid entries are reported when the include section is parsed
+        const auto& jsonIncludes = mJDoc.FindMember(SceneKeys::kInclude);
+        if(jsonIncludes != mJDoc.MemberEnd() && jsonIncludes->value.IsArray())
+        {
+            mIncludes.resize(jsonIncludes->value.Size());
+            for(uint32_t i = 0; i < jsonIncludes->value.Size(); i++)
+            {
+                std::string includePath;
+                if(jsonIncludes->value[i].IsString() && findIncludeFile(jsonIncludes->value[i].GetString(), includePath))
+                {
+                    IncludeFile& include = mIncludes[i];
+                    include.pScene = Scene::create();
+                    include.pImporter = std::unique_ptr<SceneImporter>(new SceneImporter(*include.pScene, true));
+                    include.pImporter->mFilename = includePath;
+                    include.pImporter->mModelLoadFlags = mModelLoadFlags;
+                    include.pImporter->mSceneLoadFlags = mSceneLoadFlags;
+                    include.isRead = include.pImporter->readFile(includePath);
+                }
+            }
+        }
+        return true;
+    }
+
+    bool SceneImporter::getModelLoad(const rapidjson::Value& jsonModel, ModelLoad& load) const
+    {
+        if(jsonModel.IsObject() == false)
+        {
+            return false;
+        }
+        const auto& jsonFile = jsonModel.FindMember(SceneKeys::kFilename);
+        if(jsonFile == jsonModel.MemberEnd() || jsonFile->value.IsString() == false)
+        {
+            return false;
+        }
+
+        load.filename = mDirectory + '\\' + jsonFile->value.GetString();
+        if (doesFileExist(load.filename) == false)
+        {
+            load.filename = jsonFile->value.GetString();
+        }
+        load.flags = mModelLoadFlags;
+
+        // Models referenced several times are shared through the model cache. Material overrides change the model's meshes, so they require a private copy
+        load.isShared = (jsonModel.HasMember(SceneKeys::kMaterialOverrides) == false);
+
+        // Invalid values are reported by createModel()
+        load.properties = ModelCache::Properties();
+        load.properties.filename = jsonFile->value.GetString();
+        const auto& jsonName = jsonModel.FindMember(SceneKeys::kName);
+        if(jsonName != jsonModel.MemberEnd() && jsonName->value.IsString())
+        {
+            load.properties.name = jsonName->value.GetString();
+        }
+        const auto& jsonAnimation = jsonModel.FindMember(SceneKeys::kActiveAnimation);
+        if(jsonAnimation != jsonModel.MemberEnd() && jsonAnimation->value.IsUint())
+        {
+            load.properties.activeAnimation = jsonAnimation->value.GetUint();
+        }
+        return true;
+    }
+
+    void SceneImporter::collectModelLoads(std::vector<ModelLoad*>& loads)
+    {
+        const auto& jsonModels = mJDoc.FindMember(SceneKeys::kModels);
+        if(jsonModels != mJDoc.MemberEnd() && jsonModels->value.IsArray())
+        {
+            mModelLoads.resize(jsonModels->value.Size());
+            for(uint32_t i = 0; i < jsonModels->value.Size(); i++)
+            {
+                ModelLoad& load = mModelLoads[i];
+                if(getModelLoad(jsonModels->value[i], load))
+                {
+                    loads.push_back(&load);
+                }
+            }
+        }
+
+        for(auto& include : mIncludes)
+        {
+            if(include.isRead)
+            {
+                include.pImporter->collectModelLoads(loads);
+            }
+        }
+    }
+
+    void SceneImporter::loadModels()
+    {
+        std::vector<ModelLoad*> loads;
+        collectModelLoads(loads);
+
+        // The models are only added to the scene when their section is parsed, in file order, so the result doesn't depend on the order the loads complete
+        ModelCache::loadModels(std::vector<ModelCache::Request*>(loads.begin(), loads.end()));
+        for(ModelLoad* pLoad : loads)
+        {
+            pLoad->isLoaded = true;
+        }
+    }
+
     bool SceneImporter::load(const std::string& filename, Model::LoadFlags modelLoadFlags, Scene::LoadFlags sceneLoadFlags)
     {
         std::string fullpath;
@@ -1165,25 +1605,27 @@ namespace Falcor
 
         if(findFileInDataDirectories(filename, fullpath))
         {
-            // Load the file
-            std::ifstream fileStream(fullpath);
-            std::stringstream strStream;
-            strStream << fileStream.rdbuf();
-            std::string jsonData = strStream.str();
-            rapidjson::StringStream JStream(jsonData.c_str());
-
-            // Get the file directory
-            auto last = fullpath.find_last_of("/\\");
-            mDirectory = fullpath.substr(0, last);
-
-            // create the DOM
-            mJDoc.ParseStream(JStream);
+            // Use the snapshot of the resolved scene if none of the files it was built from changed
+            if(mIsIncludeFile == false && SceneSnapshot::load(mScene, fullpath, mModelLoadFlags))
+            {
+                // The snapshot restored the IDs of the scene's materials. The models were loaded again, so they need new ones
+                for(uint32_t i = 0; i < mScene.getMaterialCount(); i++)
+                {
+                    mMaterialsWithId.insert(mScene.getMaterial(i).get());
+                }
+                assignSceneOrderIds(mScene, mMaterialsWithId);
+                finalizeScene();
+                return true;
+            }
+            // Read the scene and the files it includes, then load all the models they reference
+            if(readFile(fullpath) == false)
+            {
+                return false;
+            }
 
-            if(mJDoc.HasParseError())
+            if(is_set(mSceneLoadFlags, Scene::LoadFlags::DontLoadModelsInParallel) == false)
             {
-                size_t line;
-                line = std::count(jsonData.begin(), jsonData.begin() + mJDoc.GetErrorOffset(), '\n');
-                return error(std::string("JSON Parse error in line ") + std::to_string(line) + ". " + rapidjson::GetParseError_En(mJDoc.GetParseError()));
+                loadModels();
             }
 
             if(topLevelLoop() == false)
@@ -1191,16 +1633,18 @@ namespace Falcor
                 return false;
             }
 
-            if(is_set(mSceneLoadFlags, Scene::LoadFlags::GenerateAreaLights))
+            // The IDs don't depend on whether, or in which order, the models were loaded in parallel. The snapshot stores the final material IDs
+            if(mIsIncludeFile == false)
             {
-                mScene.createAreaLights();
+                assignSceneOrderIds(mScene, mMaterialsWithId);
             }
 
-            if (is_set(mSceneLoadFlags, Scene::LoadFlags::StoreMaterialHistory) == false)
+            if(mIsIncludeFile == false && mCanStoreSnapshot)
             {
-                mScene.deleteMaterialHistory();
+                SceneSnapshot::store(mScene, fullpath, mModelLoadFlags, mSnapshotSources);
             }
 
+            finalizeScene();
             return true;
         }
         else
@@ -1209,6 +1653,59 @@ namespace Falcor
         }
     }
 
+    /** Number the models, meshes and materials in scene order. Their constructors take IDs from global counters, so models loaded in parallel would get IDs in the order their loads completed.
+        The scene's materials are numbered by their index, unless their ID is in keepIds. Meshes and materials shared between models keep the ID of their first use
+    */
+    static void assignSceneOrderIds(Scene& scene, const std::unordered_set<const Material*>& keepIds)
+    {
+        std::unordered_set<const Mesh*> meshes;
+        std::unordered_set<const Material*> materials;
+        for(uint32_t i = 0; i < scene.getMaterialCount(); i++)
+        {
+            const Material::SharedPtr& pMaterial = scene.getMaterial(i);
+            if(keepIds.count(pMaterial.get()) == 0)
+            {
+                pMaterial->setID(i);
+            }
+            materials.insert(pMaterial.get());
+        }
+
+        uint32_t meshId = 0;
+        int32_t materialId = scene.getMaterialCount();
+
+        for(uint32_t modelID = 0; modelID < scene.getModelCount(); modelID++)
+        {
+            const Model::SharedPtr& pModel = scene.getModel(modelID);
+            pModel->setId(modelID);
+            for(uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+            {
+                const Mesh::SharedPtr& pMesh = pModel->getMesh(meshID);
+                const Material::SharedPtr& pMaterial = pMesh->getMaterial();
+                if(meshes.insert(pMesh.get()).second)
+                {
+                    pMesh->setId(meshId++);
+                }
+                if(pMaterial && materials.insert(pMaterial.get()).second)
+                {
+                    pMaterial->setID(materialId++);
+                }
+            }
+        }
+    }
+
+    void SceneImporter::finalizeScene()
+    {
+        if(is_set(mSceneLoadFlags, Scene::LoadFlags::GenerateAreaLights))
+        {
+            mScene.createAreaLights();
+        }
+
+        if (is_set(mSceneLoadFlags, Scene::LoadFlags::StoreMaterialHistory) == false)
+        {
+            mScene.deleteMaterialHistory();
+        }
+    }
+
     bool SceneImporter::parseAmbientIntensity(const rapidjson::Value& jsonVal)
     {
         glm::vec3 ambient;
@@ -1374,26 +1871,47 @@ namespace Falcor
         return true;
     }
 
-    bool SceneImporter::loadIncludeFile(const std::string& include)
+    bool SceneImporter::findIncludeFile(const std::string& include, std::string& fullpath) const
     {
-        // Find the file
-        std::string fullpath = mDirectory + '\\' + include;
+        fullpath = mDirectory + '\\' + include;
         if(doesFileExist(fullpath) == false)
         {
             // Look in the data directories
-            if(findFileInDataDirectories(include, fullpath) == false)
-            {
-                return error("Can't find include file " + include);
-            }
+            return findFileInDataDirectories(include, fullpath);
+        }
+        return true;
+    }
+
+    bool SceneImporter::loadIncludeFile(const std::string& include, uint32_t includeIndex)
+    {
+        // The file was read, and its models loaded, together with this file
+        if(includeIndex >= mIncludes.size() || mIncludes[includeIndex].pImporter == nullptr)
+        {
+            return error("Can't find include file " + include);
         }
 
-        Scene::SharedPtr pScene = Scene::create();
-        SceneImporter::loadScene(*pScene, fullpath, mModelLoadFlags, mSceneLoadFlags);
-        if(pScene == nullptr)
+        // Take ownership of the include, so it's released once it's merged
+        IncludeFile includeFile = std::move(mIncludes[includeIndex]);
+        const Scene::SharedPtr& pScene = includeFile.pScene;
+        SceneImporter& importer = *includeFile.pImporter;
+        if(includeFile.isRead && importer.topLevelLoop())
         {
-            return false;
+            importer.finalizeScene();
+        }
+        else
+        {
+            // The partially loaded include is still merged, but the result must not be cached
+            mCanStoreSnapshot = false;
         }
         mScene.merge(pScene.get());
+        mMaterialsWithId.insert(importer.mMaterialsWithId.begin(), importer.mMaterialsWithId.end());
+
+        // The include file's data is part of this scene's snapshot
+        const auto& sources = importer.mSnapshotSources;
+        mSnapshotSources.dependencies.insert(mSnapshotSources.dependencies.end(), sources.dependencies.begin(), sources.dependencies.end());
+        mSnapshotSources.models.insert(sources.models.begin(), sources.models.end());
+        mSnapshotSources.materialOverrides.insert(mSnapshotSources.materialOverrides.end(), sources.materialOverrides.begin(), sources.materialOverrides.end());
+        mCanStoreSnapshot = mCanStoreSnapshot && importer.mCanStoreSnapshot;
 
         return true;
     }
@@ -1413,7 +1931,7 @@ namespace Falcor
             }
 
             const std::string include = jsonVal[i].GetString();
-            if(loadIncludeFile(include) == false)
+            if(loadIncludeFile(include, i) == false)
             {
                 return false;
             }
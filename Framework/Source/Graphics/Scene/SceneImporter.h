@@ -27,12 +27,16 @@
 ***************************************************************************/
 #pragma once
 #include <string>
+#include <unordered_set>
 #include "Externals/RapidJson/include/rapidjson/document.h"
 #include "Graphics/Material/Material.h"
+#include "Graphics/TextureHelper.h"
 #include "glm/vec2.hpp"
 #include "glm/vec3.hpp"
 #include "glm/vec4.hpp"
 #include "Scene.h"
+#include "Graphics/Model/ModelCache.h"
+#include "SceneSnapshot.h"
 
 namespace Falcor
 {
@@ -43,7 +47,7 @@ namespace Falcor
 
     private:
 
-        SceneImporter(Scene& scene) : mScene(scene) {}
+        SceneImporter(Scene& scene, bool isIncludeFile = false) : mScene(scene), mIsIncludeFile(isIncludeFile) {}
         bool load(const std::string& filename, Model::LoadFlags modelLoadFlags, Scene::LoadFlags sceneLoadFlags);
 
         bool parseVersion(const rapidjson::Value& jsonVal);
@@ -61,12 +65,48 @@ namespace Falcor
         bool parseIncludes(const rapidjson::Value& jsonVal);
 
         bool topLevelLoop();
+        void finalizeScene();
 
-        bool loadIncludeFile(const std::string& Include);
+        bool findIncludeFile(const std::string& include, std::string& fullpath) const;
+        bool loadIncludeFile(const std::string& include, uint32_t includeIndex);
 
-        bool createModel(const rapidjson::Value& jsonModel);
+        /** Model instance, decoded while streaming the scene file
+        */
+        struct ModelInstanceDesc
+        {
+            std::string name;
+            glm::vec3 translation;
+            glm::vec3 rotation;     ///< Yaw-pitch-roll in radians
+            glm::vec3 scaling;
+        };
+
+        class JsonStreamFilter;
+        bool readSceneFile(const std::string& fullpath);
+
+        /** A model referenced by the models section, loaded before the section is parsed. The request isn't shared if the scene modifies the model (material overrides), in which case it needs a private copy
+        */
+        struct ModelLoad : ModelCache::Request
+        {
+            bool isLoaded = false;
+        };
+
+        /** An include file. It is read together with the including file, so its models can be loaded with the others
+        */
+        struct IncludeFile
+        {
+            Scene::SharedPtr pScene;
+            std::unique_ptr<SceneImporter> pImporter;
+            bool isRead = false;
+        };
+
+        bool readFile(const std::string& fullpath);
+        bool getModelLoad(const rapidjson::Value& jsonModel, ModelLoad& load) const;
+        void collectModelLoads(std::vector<ModelLoad*>& loads);
+        void loadModels();
+
+        bool createModel(const rapidjson::Value& jsonModel, uint32_t modelIndex);
         bool setMaterialOverrides(const rapidjson::Value& jsonVal, const Model::SharedPtr& pModel);
-        bool createModelInstances(const rapidjson::Value& jsonVal, const Model::SharedPtr& pModel);
+        bool createModelInstances(const std::vector<ModelInstanceDesc>& instances, const Model::SharedPtr& pModel);
         bool createPointLight(const rapidjson::Value& jsonLight);
         bool createDirLight(const rapidjson::Value& jsonLight);
         ObjectPath::SharedPtr createPath(const rapidjson::Value& jsonPath);
@@ -81,7 +121,7 @@ namespace Falcor
         bool createMaterialLayerNDF(const rapidjson::Value& jsonValue, Material::Layer& layerOut);
         bool createMaterialLayerBlend(const rapidjson::Value& jsonValue, Material::Layer& layerOut);
 
-        bool createMaterialTexture(const rapidjson::Value& jsonValue, Texture::SharedPtr& pTexture, bool isSrgb);
+        bool createMaterialTexture(const rapidjson::Value& jsonValue, Texture::SharedPtr& pTexture, bool isSrgb, const MipGenDesc& mipDesc = MipGenDesc());
 
         bool error(const std::string& msg);
 
@@ -89,12 +129,21 @@ namespace Falcor
         bool getFloatVec(const rapidjson::Value& jsonVal, const std::string& desc, float vec[VecSize]);
         bool getFloatVecAnySize(const rapidjson::Value& jsonVal, const std::string& desc, std::vector<float>& vec);
         rapidjson::Document mJDoc;
+        std::string mJsonText;                                          ///< The scene file without the model instance arrays. mJDoc is parsed in-situ from it
+        std::vector<std::vector<ModelInstanceDesc>> mModelInstances;    ///< The instances of every entry in the models section
+        std::vector<ModelLoad> mModelLoads;                             ///< The models loaded in parallel, indexed like the models section
+        std::vector<IncludeFile> mIncludes;                             ///< Indexed like the include section. Entries which couldn't be found are empty
         Scene& mScene;
         std::string mFilename;
         std::string mDirectory;
         Model::LoadFlags mModelLoadFlags;
         Scene::LoadFlags mSceneLoadFlags;
 
+        bool mIsIncludeFile;                    ///< Include files are part of their parent's snapshot, and don't have one of their own
+        bool mCanStoreSnapshot = true;          ///< Cleared if an include file failed to load, in which case the scene is incomplete
+        SceneSnapshot::Sources mSnapshotSources;
+        std::unordered_set<const Material*> mMaterialsWithId;   ///< Materials whose ID is set by the scene file. Keep it when the IDs are assigned in scene order
+
         using ObjectMap = std::map<std::string, IMovableObject::SharedPtr>;
         bool isNameDuplicate(const std::string& name, const ObjectMap& objectMap, const std::string& objectType) const;
         IMovableObject::SharedPtr getMovableObject(const std::string& type, const std::string& name) const;
@@ -37,6 +37,7 @@
 #include "API/Device.h"
 #include "glm/matrix.hpp"
 #include "Graphics/Material/MaterialSystem.h"
+#include <algorithm>
 
 namespace Falcor
 {
@@ -55,6 +56,9 @@ namespace Falcor
     const char* SceneRenderer::kPerFrameCbName = "InternalPerFrameCB";
     const char* SceneRenderer::kPerMeshCbName = "InternalPerMeshCB";
 
+    // Program variants used in the draw-list sort key
+    static const uint32_t kVertexBlendingVariant = 0x1;
+
     SceneRenderer::SharedPtr SceneRenderer::create(const Scene::SharedPtr& pScene)
     {
         return SharedPtr(new SceneRenderer(pScene));
@@ -173,7 +177,8 @@ namespace Falcor
             if (pMesh->hasBones() == false)
             {
                 glm::mat4 worldMat = pModelInstance->getTransformMatrix() * pMeshInstance->getTransformMatrix();
-                glm::mat3x4 worldInvTransposeMat = transpose(inverse(glm::mat3(worldMat)));
+                // The inverse-transpose of a product is the product of the inverse-transposes, which the instances keep up to date
+                glm::mat3x4 worldInvTransposeMat = glm::mat3x4(glm::mat3(pModelInstance->getInvTransposeMatrix()) * glm::mat3(pMeshInstance->getInvTransposeMatrix()));
 
                 assert(drawInstanceID < sWorldMatArraySize);
                 pCB->setBlob(&worldMat, sWorldMatOffset + drawInstanceID * sizeof(glm::mat4), sizeof(glm::mat4));
@@ -216,6 +221,7 @@ namespace Falcor
             }
             setPerMaterialData(currentData, currentData.pMaterial);
             mpLastMaterial = pMesh->getMaterial().get();
+            mStats.materialChanges++;
 
             if(mCompileMaterialWithProgram)
             {
@@ -224,6 +230,7 @@ namespace Falcor
         }
 
         executeDraw(currentData, pMesh->getIndexCount(), instanceCount);
+        mStats.drawCalls++;
         postFlushDraw(currentData);
         currentData.pState->getProgram()->removeDefine("_MS_STATIC_MATERIAL_DESC");
     }
@@ -233,7 +240,54 @@ namespace Falcor
 
     }
 
-    void SceneRenderer::renderMeshInstances(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t meshID)
+    void SceneRenderer::renderMeshInstance(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const Mesh* pMesh, const Model::MeshInstance* pMeshInstance, uint32_t& activeInstances)
+    {
+        if (pMeshInstance->isVisible())
+        {
+            if (setPerMeshInstanceData(currentData, pModelInstance, pMeshInstance, activeInstances))
+            {
+                currentData.drawID++;
+                activeInstances++;
+
+                if (activeInstances == mMaxInstanceCount)
+                {
+                    // DISABLED_FOR_D3D12
+                    //pContext->setProgram(currentData.pProgram->getActiveProgramVersion());
+                    draw(currentData, pMesh, activeInstances);
+                    activeInstances = 0;
+                }
+            }
+        }
+    }
+
+    void SceneRenderer::cullMeshInstances(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t meshID)
+    {
+        // Cull all the instances of the mesh in a single batch
+        const Model* pModel = pModelInstance->getObject().get();
+        const uint32_t instanceCount = pModel->getMeshInstanceCount(meshID);
+        mCullBoxes.resize(instanceCount);
+        mVisibleMask.resize(instanceCount);
+        for (uint32_t instanceID = 0; instanceID < instanceCount; instanceID++)
+        {
+            const Model::MeshInstance* pMeshInstance = pModel->getMeshInstance(meshID, instanceID).get();
+            mCullBoxes[instanceID] = pMeshInstance->getBoundingBox().transform(pModelInstance->getTransformMatrix());
+        }
+        currentData.pCamera->cullBoxes(mCullBoxes.data(), instanceCount, mVisibleMask.data());
+
+        if (mOcclusionCullActive)
+        {
+            for (uint32_t instanceID = 0; instanceID < instanceCount; instanceID++)
+            {
+                if (mVisibleMask[instanceID] && (mpOcclusionCuller->isVisible(mCullBoxes[instanceID]) == false))
+                {
+                    mVisibleMask[instanceID] = 0;
+                    mStats.occludedInstances++;
+                }
+            }
+        }
+    }
+
+    void SceneRenderer::renderMeshInstances(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t meshID, const uint32_t* pVisibleItems, uint32_t visibleItemCount)
     {
         const Model* pModel = currentData.pModel;
         const Mesh* pMesh = pModel->getMesh(meshID).get();
@@ -242,35 +296,37 @@ namespace Falcor
         {
             // Bind VAO and set topology
             currentData.pState->setVao(pMesh->getVao());
+            mStats.meshChanges++;
 
             uint32_t activeInstances = 0;
 
-            const uint32_t instanceCount = pModel->getMeshInstanceCount(meshID);
-            for (uint32_t instanceID = 0; instanceID < instanceCount; instanceID++)
+            if (pVisibleItems)
             {
-                const Model::MeshInstance* pMeshInstance = pModel->getMeshInstance(meshID, instanceID).get();
-                BoundingBox box = pMeshInstance->getBoundingBox().transform(pModelInstance->getTransformMatrix());
+                // Already culled by the BVH
+                const SceneBVH* pBVH = mpScene->getBVH();
+                for (uint32_t i = 0; i < visibleItemCount; i++)
+                {
+                    uint32_t instanceID = pBVH->getItem(pVisibleItems[i]).meshInstanceID;
+                    renderMeshInstance(currentData, pModelInstance, pMesh, pModel->getMeshInstance(meshID, instanceID).get(), activeInstances);
+                }
+            }
+            else
+            {
+                const uint32_t instanceCount = pModel->getMeshInstanceCount(meshID);
+                if (mCullEnabled)
+                {
+                    cullMeshInstances(currentData, pModelInstance, meshID);
+                }
 
-                if ((mCullEnabled == false) || (currentData.pCamera->isObjectCulled(box) == false))
+                for (uint32_t instanceID = 0; instanceID < instanceCount; instanceID++)
                 {
-                    if (pMeshInstance->isVisible())
+                    if ((mCullEnabled == false) || mVisibleMask[instanceID])
                     {
-                        if (setPerMeshInstanceData(currentData, pModelInstance, pMeshInstance, activeInstances))
-                        {
-                            currentData.drawID++;
-                            activeInstances++;
-
-                            if (activeInstances == mMaxInstanceCount)
-                            {
-                                // DISABLED_FOR_D3D12
-                                //pContext->setProgram(currentData.pProgram->getActiveProgramVersion());
-                                draw(currentData, pMesh, activeInstances);
-                                activeInstances = 0;
-                            }
-                        }
+                        renderMeshInstance(currentData, pModelInstance, pMesh, pModel->getMeshInstance(meshID, instanceID).get(), activeInstances);
                     }
                 }
             }
+
             if(activeInstances != 0)
             {
                 draw(currentData, pMesh, activeInstances);
@@ -278,7 +334,7 @@ namespace Falcor
         }
     }
 
-    void SceneRenderer::renderModelInstance(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance)
+    void SceneRenderer::renderModelInstance(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const uint32_t* pVisibleItems, uint32_t visibleItemCount)
     {
         const Model* pModel = pModelInstance->getObject().get();
 
@@ -293,10 +349,30 @@ namespace Falcor
 
             mpLastMaterial = nullptr;
 
-            // Loop over the meshes
-            for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+            if (pVisibleItems)
+            {
+                // The items are sorted, so the items of every mesh are contiguous. Meshes without visible instances are skipped
+                const SceneBVH* pBVH = mpScene->getBVH();
+                uint32_t begin = 0;
+                while (begin < visibleItemCount)
+                {
+                    uint32_t meshID = pBVH->getItem(pVisibleItems[begin]).meshID;
+                    uint32_t end = begin + 1;
+                    while (end < visibleItemCount && pBVH->getItem(pVisibleItems[end]).meshID == meshID)
+                    {
+                        end++;
+                    }
+                    renderMeshInstances(currentData, pModelInstance, meshID, pVisibleItems + begin, end - begin);
+                    begin = end;
+                }
+            }
+            else
             {
-                renderMeshInstances(currentData, pModelInstance, meshID);
+                // Loop over the meshes
+                for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+                {
+                    renderMeshInstances(currentData, pModelInstance, meshID);
+                }
             }
 
             // Restore the program state
@@ -308,6 +384,269 @@ namespace Falcor
 
     }
 
+    void SceneRenderer::queryVisibleItems(const CurrentWorkingData& currentData)
+    {
+        float viewportHeight = currentData.pState->getViewport(0).height;
+        float minProjectedSize = (viewportHeight > 0) ? mSmallObjectThreshold / viewportHeight : 0;
+        const SceneBVH* pBVH = mpScene->getBVH();
+        pBVH->queryFrustum(currentData.pCamera, minProjectedSize, mVisibleItems);
+
+        if (mOcclusionCullActive)
+        {
+            auto occluded = [this, pBVH](uint32_t itemIndex) { return mpOcclusionCuller->isVisible(pBVH->getItemBounds(itemIndex)) == false; };
+            auto newEnd = std::remove_if(mVisibleItems.begin(), mVisibleItems.end(), occluded);
+            mStats.occludedInstances += (uint32_t)(mVisibleItems.end() - newEnd);
+            mVisibleItems.erase(newEnd, mVisibleItems.end());
+        }
+    }
+
+    void SceneRenderer::addOccluder(const OcclusionCuller::OccluderMesh::SharedConstPtr& pMesh, const Scene::ModelInstance::SharedPtr& pModelInstance)
+    {
+        mOccluders.push_back({ pMesh, pModelInstance });
+    }
+
+    void SceneRenderer::rasterizeOccluders(const CurrentWorkingData& currentData)
+    {
+        mOcclusionCullActive = false;
+        const Camera* pCamera = currentData.pCamera;
+        if (mpOcclusionCuller == nullptr || mOccluders.empty() || pCamera == nullptr)
+        {
+            return;
+        }
+
+        // The culler's depth buffer stores 1/w, which requires a perspective projection
+        if (pCamera->getProjMatrix()[3][3] != 0)
+        {
+            return;
+        }
+
+        mpOcclusionCuller->beginFrame(pCamera->getViewProjMatrix(), pCamera->getNearPlane());
+        for (const auto& occluder : mOccluders)
+        {
+            if (occluder.pModelInstance->isVisible())
+            {
+                mpOcclusionCuller->addOccluder(*occluder.pMesh, occluder.pModelInstance->getTransformMatrix());
+            }
+        }
+        mpOcclusionCuller->rasterize();
+        mOcclusionCullActive = true;
+    }
+
+    void SceneRenderer::renderVisibleItems(CurrentWorkingData& currentData)
+    {
+        const SceneBVH* pBVH = mpScene->getBVH();
+        queryVisibleItems(currentData);
+
+        // Items are numbered in scene order (model, model instance, mesh, mesh instance), so sorting restores the draw order of the flat walk and groups the items of every model instance
+        std::sort(mVisibleItems.begin(), mVisibleItems.end());
+
+        const uint32_t visibleCount = (uint32_t)mVisibleItems.size();
+        uint32_t begin = 0;
+        while (begin < visibleCount)
+        {
+            const SceneBVH::Item& item = pBVH->getItem(mVisibleItems[begin]);
+            uint32_t end = begin + 1;
+            while (end < visibleCount)
+            {
+                const SceneBVH::Item& next = pBVH->getItem(mVisibleItems[end]);
+                if (next.modelID != item.modelID || next.modelInstanceID != item.modelInstanceID)
+                {
+                    break;
+                }
+                end++;
+            }
+
+            currentData.pModel = mpScene->getModel(item.modelID).get();
+            const auto pInstance = mpScene->getModelInstance(item.modelID, item.modelInstanceID).get();
+            if (pInstance->isVisible())
+            {
+                if (setPerModelInstanceData(currentData, pInstance, item.modelInstanceID))
+                {
+                    renderModelInstance(currentData, pInstance, mVisibleItems.data() + begin, end - begin);
+                }
+            }
+            begin = end;
+        }
+    }
+
+    uint64_t SceneRenderer::makeDrawSortKey(uint32_t pass, uint32_t programVariant, uint32_t materialID, uint32_t meshID, float depth)
+    {
+        float clampedDepth = (depth > 0) ? glm::min(depth, 1.0f) : 0.0f; // Also maps NaN to 0
+        uint64_t quantizedDepth = (uint64_t)(clampedDepth * 65535.0f);
+        return ((uint64_t)(pass & 0xf) << 60) | ((uint64_t)(programVariant & 0xf) << 56) | ((uint64_t)(materialID & 0xfffff) << 36) | ((uint64_t)(meshID & 0xfffff) << 16) | quantizedDepth;
+    }
+
+    void SceneRenderer::addDrawRecord(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t modelInstanceID, const Model::MeshInstance* pMeshInstance)
+    {
+        if (pMeshInstance->isVisible() == false)
+        {
+            return;
+        }
+
+        const Mesh* pMesh = pMeshInstance->getObject().get();
+        const Material* pMaterial = pMesh->getMaterial().get();
+        uint32_t variant = pModelInstance->getObject()->hasBones() ? kVertexBlendingVariant : 0;
+
+        float depth = 0;
+        if (currentData.pCamera)
+        {
+            const Camera* pCamera = currentData.pCamera;
+            glm::vec3 center = glm::vec3(pModelInstance->getTransformMatrix() * glm::vec4(pMeshInstance->getBoundingBox().center, 1.0f));
+            depth = (glm::length(center - pCamera->getPosition()) - pCamera->getNearPlane()) / (pCamera->getFarPlane() - pCamera->getNearPlane());
+        }
+
+        mDrawKeys.push_back(makeDrawSortKey(0, variant, pMaterial ? pMaterial->getId() : 0, pMesh->getId(), depth));
+        mDrawRecords.push_back({ pModelInstance, pMeshInstance, modelInstanceID });
+    }
+
+    void SceneRenderer::buildDrawList(const CurrentWorkingData& currentData)
+    {
+        mDrawRecords.clear();
+        mDrawKeys.clear();
+
+        if (mBVHCullEnabled && currentData.pCamera)
+        {
+            const SceneBVH* pBVH = mpScene->getBVH();
+            queryVisibleItems(currentData);
+            for (uint32_t itemIndex : mVisibleItems)
+            {
+                const SceneBVH::Item& item = pBVH->getItem(itemIndex);
+                const auto pInstance = mpScene->getModelInstance(item.modelID, item.modelInstanceID).get();
+                if (pInstance->isVisible())
+                {
+                    addDrawRecord(currentData, pInstance, item.modelInstanceID, pInstance->getObject()->getMeshInstance(item.meshID, item.meshInstanceID).get());
+                }
+            }
+        }
+        else
+        {
+            for (uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
+            {
+                for (uint32_t instanceID = 0; instanceID < mpScene->getModelInstanceCount(modelID); instanceID++)
+                {
+                    const auto pInstance = mpScene->getModelInstance(modelID, instanceID).get();
+                    if (pInstance->isVisible() == false)
+                    {
+                        continue;
+                    }
+
+                    const Model* pModel = pInstance->getObject().get();
+                    for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+                    {
+                        if (mCullEnabled)
+                        {
+                            cullMeshInstances(currentData, pInstance, meshID);
+                        }
+
+                        for (uint32_t meshInstanceID = 0; meshInstanceID < pModel->getMeshInstanceCount(meshID); meshInstanceID++)
+                        {
+                            if ((mCullEnabled == false) || mVisibleMask[meshInstanceID])
+                            {
+                                addDrawRecord(currentData, pInstance, instanceID, pModel->getMeshInstance(meshID, meshInstanceID).get());
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        const uint32_t recordCount = (uint32_t)mDrawRecords.size();
+        mDrawOrder.resize(recordCount);
+        for (uint32_t i = 0; i < recordCount; i++)
+        {
+            mDrawOrder[i] = i;
+        }
+        mRadixSort.sort(mDrawKeys.data(), mDrawOrder.data(), recordCount);
+    }
+
+    void SceneRenderer::renderDrawList(CurrentWorkingData& currentData)
+    {
+        const Scene::ModelInstance* pCurrentInstance = nullptr;
+        const Mesh* pCurrentMesh = nullptr;
+        const Vao* pCurrentVao = nullptr;
+        Program* pBlendingProgram = nullptr;    // The program _VERTEX_BLENDING was added to
+        bool skipInstance = false;
+        bool skipMesh = false;
+        uint32_t activeInstances = 0;
+        mpLastMaterial = nullptr;
+
+        for (uint32_t drawIndex : mDrawOrder)
+        {
+            const DrawRecord& record = mDrawRecords[drawIndex];
+            const Mesh* pMesh = record.pMeshInstance->getObject().get();
+            const bool instanceChanged = (record.pModelInstance != pCurrentInstance);
+
+            if ((instanceChanged || pMesh != pCurrentMesh) && activeInstances != 0)
+            {
+                draw(currentData, pCurrentMesh, activeInstances);
+                activeInstances = 0;
+            }
+
+            if (instanceChanged)
+            {
+                pCurrentInstance = record.pModelInstance;
+                pCurrentMesh = nullptr;
+                currentData.pModel = pCurrentInstance->getObject().get();
+
+                // The per-model-instance callback may switch the program or vars, in which case the material has to be bound again
+                const Program* pPrevProgram = currentData.pState->getProgram().get();
+                const GraphicsVars* pPrevVars = currentData.pContext->getGraphicsVars().get();
+                skipInstance = (setPerModelInstanceData(currentData, pCurrentInstance, record.modelInstanceID) == false) || (setPerModelData(currentData) == false);
+                Program* pProgram = currentData.pState->getProgram().get();
+                if (pProgram != pPrevProgram || currentData.pContext->getGraphicsVars().get() != pPrevVars)
+                {
+                    mpLastMaterial = nullptr;
+                }
+
+                // Draws are sorted by program variant, so the define rarely changes
+                const bool vertexBlending = (skipInstance == false) && currentData.pModel->hasBones();
+                if (pBlendingProgram && (vertexBlending == false || pBlendingProgram != pProgram))
+                {
+                    pBlendingProgram->removeDefine("_VERTEX_BLENDING");
+                    pBlendingProgram = nullptr;
+                }
+                if (vertexBlending && pBlendingProgram == nullptr)
+                {
+                    pProgram->addDefine("_VERTEX_BLENDING");
+                    pBlendingProgram = pProgram;
+                }
+            }
+
+            if (skipInstance)
+            {
+                continue;
+            }
+
+            if (pMesh != pCurrentMesh)
+            {
+                pCurrentMesh = pMesh;
+                skipMesh = (setPerMeshData(currentData, pMesh) == false);
+                if (skipMesh == false && pMesh->getVao().get() != pCurrentVao)
+                {
+                    // Bind VAO and set topology
+                    currentData.pState->setVao(pMesh->getVao());
+                    pCurrentVao = pMesh->getVao().get();
+                    mStats.meshChanges++;
+                }
+            }
+
+            if (skipMesh == false)
+            {
+                renderMeshInstance(currentData, pCurrentInstance, pMesh, record.pMeshInstance, activeInstances);
+            }
+        }
+
+        if (activeInstances != 0)
+        {
+            draw(currentData, pCurrentMesh, activeInstances);
+        }
+
+        if (pBlendingProgram)
+        {
+            pBlendingProgram->removeDefine("_VERTEX_BLENDING");
+        }
+    }
+
     bool SceneRenderer::update(double currentTime)
     {
         return mpScene->update(currentTime, mpCameraController.get());
@@ -337,6 +676,21 @@ namespace Falcor
     {
         setupVR();
         setPerFrameData(currentData);
+        mStats = Stats();
+        rasterizeOccluders(currentData);
+
+        if (mDrawListSortingEnabled)
+        {
+            buildDrawList(currentData);
+            renderDrawList(currentData);
+            return;
+        }
+
+        if (mBVHCullEnabled && currentData.pCamera)
+        {
+            renderVisibleItems(currentData);
+            return;
+        }
 
         for (uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
         {
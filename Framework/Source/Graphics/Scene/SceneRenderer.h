@@ -33,6 +33,8 @@
 #include "utils/CpuTimer.h"
 #include "API/ConstantBuffer.h"
 #include "Utils/DebugDrawer.h"
+#include "Utils/RadixSort.h"
+#include "Graphics/Scene/OcclusionCuller.h"
 
 namespace Falcor
 {
@@ -80,6 +82,60 @@ namespace Falcor
         */
         void setObjectCullState(bool enable) { mCullEnabled = enable; }
 
+        /** Enable/disable culling through the scene's bounding volume hierarchy. Instead of testing every mesh instance, whole subtrees of the hierarchy are accepted or rejected against the camera frustum, and only the visible mesh instances are visited.
+            Replaces the per-mesh culling controlled by setObjectCullState(). Pays off for scenes with many instances, of which only a fraction is visible.
+        */
+        void setBVHCullState(bool enable) { mBVHCullEnabled = enable; }
+
+        /** Set the screen-space size below which mesh instances are culled. Only used when BVH culling is enabled.
+            \param[in] pixels Minimal projected diameter of a mesh instance's bounds, in pixels of the viewport height. 0 disables small-object culling
+        */
+        void setSmallObjectCullThreshold(float pixels) { mSmallObjectThreshold = pixels; }
+
+        /** Enable/disable sorting the draws of a frame. When enabled, the visible mesh instances of all the models are first collected into a draw list, which is sorted by a key built from the pass, program variant, material, mesh and depth (see makeDrawSortKey()) and then submitted in that order.
+            Reduces material and mesh changes in scenes with many small models. setPerModelInstanceData() is still called before the draws of a model instance, but the draws of a model instance are no longer submitted together
+        */
+        void setDrawListSorting(bool enable) { mDrawListSortingEnabled = enable; }
+
+        /** Set the occlusion culler. When set, the occluders registered with addOccluder() are rasterized at the start of every renderScene() call, and mesh instances hidden behind them are skipped.
+            Occlusion culling is applied on top of the frustum culling (per-mesh or BVH), so it has no effect when both are disabled. Only perspective cameras are supported. Pass nullptr to disable
+        */
+        void setOcclusionCuller(const OcclusionCuller::SharedPtr& pCuller) { mpOcclusionCuller = pCuller; }
+        const OcclusionCuller::SharedPtr& getOcclusionCuller() const { return mpOcclusionCuller; }
+
+        /** Register an occluder. The mesh is rasterized every frame with the model instance's current transform, as long as the instance is visible
+            \param[in] pMesh Occluder geometry, in the model's object space
+            \param[in] pModelInstance The model instance the occluder belongs to
+        */
+        void addOccluder(const OcclusionCuller::OccluderMesh::SharedConstPtr& pMesh, const Scene::ModelInstance::SharedPtr& pModelInstance);
+
+        /** Remove all the registered occluders
+        */
+        void clearOccluders() { mOccluders.clear(); }
+
+        /** Counters of the last renderScene() call
+        */
+        struct Stats
+        {
+            uint32_t drawCalls = 0;         ///< Number of draw calls
+            uint32_t materialChanges = 0;   ///< Number of times a material was bound
+            uint32_t meshChanges = 0;       ///< Number of times a mesh's VAO was bound
+            uint32_t occludedInstances = 0; ///< Number of mesh instances inside the frustum which were culled by the occlusion culler
+        };
+
+        /** Get the counters of the last renderScene() call. Useful to compare the state changes with and without draw-list sorting
+        */
+        const Stats& getStats() const { return mStats; }
+
+        /** Build the sort key of a draw. Fields are stored from the most significant bits down, so the draws are grouped by pass first and by depth last
+            \param[in] pass Pass index. 4 bits
+            \param[in] programVariant Program variant. 4 bits
+            \param[in] materialID Material ID. Only the low 20 bits are used
+            \param[in] meshID Mesh ID. Only the low 20 bits are used
+            \param[in] depth Normalized distance from the camera, clamped to [0, 1] and quantized to 16 bits. Draws of the same mesh are sorted front-to-back
+        */
+        static uint64_t makeDrawSortKey(uint32_t pass, uint32_t programVariant, uint32_t materialID, uint32_t meshID, float depth);
+
         /** Set the maximal number of mesh instance to dispatch in a single draw call.
         */
         void setMaxInstanceCount(uint32_t instanceCount) { mMaxInstanceCount = instanceCount; }
@@ -147,8 +203,28 @@ namespace Falcor
         virtual void executeDraw(const CurrentWorkingData& currentData, uint32_t indexCount, uint32_t instanceCount);
         virtual void postFlushDraw(const CurrentWorkingData& currentData);
 
-        void renderModelInstance(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance);
-        void renderMeshInstances(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t meshID);
+        /** Render a model instance. If pVisibleItems is not nullptr, only the listed SceneBVH items are rendered. They must belong to the model instance and be sorted
+        */
+        void renderModelInstance(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const uint32_t* pVisibleItems = nullptr, uint32_t visibleItemCount = 0);
+        void renderMeshInstances(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t meshID, const uint32_t* pVisibleItems = nullptr, uint32_t visibleItemCount = 0);
+        void renderMeshInstance(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const Mesh* pMesh, const Model::MeshInstance* pMeshInstance, uint32_t& activeInstances);
+        void renderVisibleItems(CurrentWorkingData& currentData);
+        void cullMeshInstances(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t meshID);
+        void queryVisibleItems(const CurrentWorkingData& currentData);
+        void rasterizeOccluders(const CurrentWorkingData& currentData);
+
+        /** A visible mesh instance in the draw list
+        */
+        struct DrawRecord
+        {
+            const Scene::ModelInstance* pModelInstance;
+            const Model::MeshInstance* pMeshInstance;
+            uint32_t modelInstanceID;
+        };
+
+        void buildDrawList(const CurrentWorkingData& currentData);
+        void addDrawRecord(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t modelInstanceID, const Model::MeshInstance* pMeshInstance);
+        void renderDrawList(CurrentWorkingData& currentData);
         void draw(CurrentWorkingData& currentData, const Mesh* pMesh, uint32_t instanceCount);
 
         void setupVR();
@@ -160,6 +236,27 @@ namespace Falcor
         uint32_t mMaxInstanceCount = 64;
         const Material* mpLastMaterial = nullptr;
         bool mCullEnabled = true;
+        std::vector<BoundingBox> mCullBoxes;    ///< Scratch space for culling, reused between meshes to avoid allocations
+        std::vector<uint8_t> mVisibleMask;
+        bool mBVHCullEnabled = false;
+        float mSmallObjectThreshold = 0;
+        std::vector<uint32_t> mVisibleItems;    ///< Result of the BVH query, reused between frames
+        bool mDrawListSortingEnabled = false;
+        std::vector<DrawRecord> mDrawRecords;
+        std::vector<uint64_t> mDrawKeys;
+        std::vector<uint32_t> mDrawOrder;       ///< Indices into mDrawRecords, sorted by key
+        RadixSort mRadixSort;
+
+        struct Occluder
+        {
+            OcclusionCuller::OccluderMesh::SharedConstPtr pMesh;
+            Scene::ModelInstance::SharedPtr pModelInstance;
+        };
+        OcclusionCuller::SharedPtr mpOcclusionCuller;
+        std::vector<Occluder> mOccluders;
+        bool mOcclusionCullActive = false;      ///< Set by rasterizeOccluders() if the culler's depth buffer is valid for the current frame
+
+        Stats mStats;
         bool mUnloadTexturesOnMaterialChange = false;
         RenderMode mRenderMode = RenderMode::Mono;
         bool mCompileMaterialWithProgram = true;
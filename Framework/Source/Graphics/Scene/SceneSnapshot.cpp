@@ -0,0 +1,971 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "SceneSnapshot.h"
+#include "Utils/OS.h"
+#include "Utils/BinaryFileStream.h"
+#include "Graphics/ShaderCache.h"
+#include "Graphics/TextureHelper.h"
+#include <algorithm>
+#include <mutex>
+
+namespace Falcor
+{
+    // Bump the format version whenever the snapshot layout or the way SceneImporter builds scenes changes
+    static const uint32_t kSnapshotFormatVersion = 2;
+    static const char kSnapshotTag[] = "FalcorSS";
+    static const std::string kSnapshotExtension = ".fss";
+
+    enum class AttachedObjectType : uint32_t
+    {
+        ModelInstance,
+        Camera,
+        Light,
+    };
+
+    struct SceneSnapshotData
+    {
+        std::mutex mutex;
+        bool enabled = false;
+        std::string directory;
+    };
+
+    static SceneSnapshotData& getData()
+    {
+        static SceneSnapshotData sData;
+        return sData;
+    }
+
+    // 64-bit FNV-1a
+    static uint64_t hashString(const std::string& str)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for(char c : str)
+        {
+            hash ^= (uint8_t)c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static void writeString(BinaryFileStream& stream, const std::string& str)
+    {
+        stream << (uint32_t)str.size();
+        stream.write(str.data(), str.size());
+    }
+
+    static std::string readString(BinaryFileStream& stream)
+    {
+        uint32_t length = 0;
+        stream >> length;
+        if(stream.isFail() || length > stream.getRemainingStreamSize())
+        {
+            return std::string();
+        }
+        std::string str(length, '\0');
+        stream.read(&str[0], length);
+        return str;
+    }
+
+    // Element counts are validated against the remaining size of the stream before allocating, so that a corrupted snapshot can't trigger huge allocations
+    static bool readCount(BinaryFileStream& stream, uint32_t& count, uint32_t minElementSize)
+    {
+        stream >> count;
+        return (stream.isFail() == false) && ((uint64_t)count * minElementSize <= stream.getRemainingStreamSize());
+    }
+
+    static std::string getDirectory()
+    {
+        SceneSnapshotData& data = getData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        if(data.directory.empty())
+        {
+            data.directory = getExecutableDirectory() + "\\SceneCache";
+        }
+        return data.directory;
+    }
+
+    static std::string getFullKey(const std::string& sceneFile, Model::LoadFlags modelLoadFlags)
+    {
+        std::string path = canonicalizeFilename(sceneFile);
+        std::transform(path.begin(), path.end(), path.begin(), ::tolower);
+        return path + "\n" + std::to_string((uint32_t)modelLoadFlags);
+    }
+
+    static std::string getSnapshotPath(const std::string& fullKey)
+    {
+        char name[17];
+        snprintf(name, sizeof(name), "%016llx", (unsigned long long)hashString(fullKey));
+        return getDirectory() + "\\" + name + kSnapshotExtension;
+    }
+
+    // Textures are stored by full path, so that they don't depend on the data directories of the application loading the snapshot
+    static std::string getTextureFilename(const Texture::SharedPtr& pTexture)
+    {
+        std::string fullpath;
+        if(pTexture && findFileInDataDirectories(pTexture->getSourceFilename(), fullpath))
+        {
+            return fullpath;
+        }
+        return pTexture ? pTexture->getSourceFilename() : std::string();
+    }
+
+    static bool loadTexture(const std::string& filename, bool isSrgb, Texture::SharedPtr& pTexture, const MipGenDesc& mipDesc = MipGenDesc())
+    {
+        if(filename.empty())
+        {
+            pTexture = nullptr;
+            return true;
+        }
+        pTexture = createTextureFromFile(filename, true, isSrgb, Texture::BindFlags::ShaderResource, mipDesc);
+        return pTexture != nullptr;
+    }
+
+    // The snapshot content, read completely before any object is created
+    struct SnapshotContent
+    {
+        struct LayerDesc
+        {
+            uint32_t type, ndf, blend;
+            glm::vec4 albedo, roughness, extraParam;
+            std::string texture;
+        };
+
+        struct MaterialDesc
+        {
+            std::string name;
+            int32_t id;
+            bool doubleSided;
+            float alphaThreshold;
+            std::string alphaMap, normalMap, heightMap, aoMap;
+            std::vector<LayerDesc> layers;
+        };
+
+        struct InstanceDesc
+        {
+            std::string name;
+            glm::vec3 translation, target, up, scaling;
+        };
+
+        struct ModelDesc
+        {
+            std::string fullpath;
+            uint32_t loadFlags;
+            uint32_t isShared;
+            std::string filename;
+            std::string name;
+            uint32_t activeAnimation;
+            std::vector<InstanceDesc> instances;
+        };
+
+        struct OverrideDesc
+        {
+            uint32_t modelID, meshID, materialID;
+        };
+
+        struct LightDesc
+        {
+            uint32_t type;
+            std::string name;
+            glm::vec3 intensity, direction, position;
+            float openingAngle, penumbraAngle;
+        };
+
+        struct CameraDesc
+        {
+            std::string name;
+            glm::vec3 position, target, up;
+            float focalLength, nearZ, farZ, aspectRatio;
+        };
+
+        struct AttachedObjectDesc
+        {
+            uint32_t type, index, subIndex;
+        };
+
+        struct PathDesc
+        {
+            std::string name;
+            bool repeat;
+            std::vector<ObjectPath::Frame> frames;
+            std::vector<AttachedObjectDesc> objects;
+        };
+
+        uint32_t version;
+        glm::vec3 ambientIntensity;
+        float lightingScale;
+        float cameraSpeed;
+        uint32_t activeCamera;
+        std::vector<MaterialDesc> materials;
+        std::vector<ModelDesc> models;
+        std::vector<OverrideDesc> overrides;
+        std::vector<LightDesc> lights;
+        std::vector<CameraDesc> cameras;
+        std::vector<PathDesc> paths;
+        std::vector<std::pair<std::string, Scene::UserVariable>> userVars;
+    };
+
+    static bool readUserVariable(BinaryFileStream& stream, Scene::UserVariable& var)
+    {
+        uint32_t type = 0;
+        stream >> type;
+        var.type = (Scene::UserVariable::Type)type;
+        switch(var.type)
+        {
+        case Scene::UserVariable::Type::Int:
+        case Scene::UserVariable::Type::Uint:
+        case Scene::UserVariable::Type::Int64:
+        case Scene::UserVariable::Type::Uint64:
+        case Scene::UserVariable::Type::Double:
+            stream >> var.u64;
+            break;
+        case Scene::UserVariable::Type::Bool:
+        {
+            uint8_t b = 0;
+            stream >> b;
+            var.b = (b != 0);
+            break;
+        }
+        case Scene::UserVariable::Type::String:
+            var.str = readString(stream);
+            break;
+        case Scene::UserVariable::Type::Vec2:
+            stream >> var.vec2;
+            break;
+        case Scene::UserVariable::Type::Vec3:
+            stream >> var.vec3;
+            break;
+        case Scene::UserVariable::Type::Vec4:
+            stream >> var.vec4;
+            break;
+        case Scene::UserVariable::Type::Vector:
+        {
+            uint32_t count = 0;
+            if(readCount(stream, count, sizeof(float)) == false)
+            {
+                return false;
+            }
+            var.vector.resize(count);
+            stream.read(var.vector.data(), count * sizeof(float));
+            break;
+        }
+        default:
+            return false;
+        }
+        return stream.isFail() == false;
+    }
+
+    static void writeUserVariable(BinaryFileStream& stream, const Scene::UserVariable& var)
+    {
+        stream << (uint32_t)var.type;
+        switch(var.type)
+        {
+        case Scene::UserVariable::Type::Int:
+        case Scene::UserVariable::Type::Uint:
+        case Scene::UserVariable::Type::Int64:
+        case Scene::UserVariable::Type::Uint64:
+        case Scene::UserVariable::Type::Double:
+            // All the scalar types share the storage of the 64-bit members
+            stream << var.u64;
+            break;
+        case Scene::UserVariable::Type::Bool:
+            stream << (uint8_t)(var.b ? 1 : 0);
+            break;
+        case Scene::UserVariable::Type::String:
+            writeString(stream, var.str);
+            break;
+        case Scene::UserVariable::Type::Vec2:
+            stream << var.vec2;
+            break;
+        case Scene::UserVariable::Type::Vec3:
+            stream << var.vec3;
+            break;
+        case Scene::UserVariable::Type::Vec4:
+            stream << var.vec4;
+            break;
+        case Scene::UserVariable::Type::Vector:
+            stream << (uint32_t)var.vector.size();
+            stream.write(var.vector.data(), var.vector.size() * sizeof(float));
+            break;
+        default:
+            should_not_get_here();
+        }
+    }
+
+    static bool readContent(BinaryFileStream& stream, SnapshotContent& content)
+    {
+        stream >> content.version >> content.ambientIntensity >> content.lightingScale >> content.cameraSpeed >> content.activeCamera;
+
+        uint32_t count = 0;
+        if(readCount(stream, count, 32) == false) return false;
+        content.materials.resize(count);
+        for(auto& material : content.materials)
+        {
+            uint8_t doubleSided = 0;
+            material.name = readString(stream);
+            stream >> material.id >> doubleSided >> material.alphaThreshold;
+            material.doubleSided = (doubleSided != 0);
+            material.alphaMap = readString(stream);
+            material.normalMap = readString(stream);
+            material.heightMap = readString(stream);
+            material.aoMap = readString(stream);
+
+            uint32_t layerCount = 0;
+            if(readCount(stream, layerCount, 64) == false || layerCount > MatMaxLayers) return false;
+            material.layers.resize(layerCount);
+            for(auto& layer : material.layers)
+            {
+                stream >> layer.type >> layer.ndf >> layer.blend >> layer.albedo >> layer.roughness >> layer.extraParam;
+                layer.texture = readString(stream);
+            }
+        }
+
+        if(readCount(stream, count, 24) == false) return false;
+        content.models.resize(count);
+        for(auto& model : content.models)
+        {
+            model.fullpath = readString(stream);
+            stream >> model.loadFlags;
+            stream >> model.isShared;
+            model.filename = readString(stream);
+            model.name = readString(stream);
+            stream >> model.activeAnimation;
+
+            uint32_t instanceCount = 0;
+            if(readCount(stream, instanceCount, 52) == false) return false;
+            model.instances.resize(instanceCount);
+            for(auto& instance : model.instances)
+            {
+                instance.name = readString(stream);
+                stream >> instance.translation >> instance.target >> instance.up >> instance.scaling;
+            }
+        }
+
+        if(readCount(stream, count, sizeof(SnapshotContent::OverrideDesc)) == false) return false;
+        content.overrides.resize(count);
+        for(auto& materialOverride : content.overrides)
+        {
+            stream >> materialOverride.modelID >> materialOverride.meshID >> materialOverride.materialID;
+        }
+
+        if(readCount(stream, count, 52) == false) return false;
+        content.lights.resize(count);
+        for(auto& light : content.lights)
+        {
+            stream >> light.type;
+            light.name = readString(stream);
+            stream >> light.intensity >> light.direction >> light.position >> light.openingAngle >> light.penumbraAngle;
+        }
+
+        if(readCount(stream, count, 56) == false) return false;
+        content.cameras.resize(count);
+        for(auto& camera : content.cameras)
+        {
+            camera.name = readString(stream);
+            stream >> camera.position >> camera.target >> camera.up >> camera.focalLength >> camera.nearZ >> camera.farZ >> camera.aspectRatio;
+        }
+
+        if(readCount(stream, count, 13) == false) return false;
+        content.paths.resize(count);
+        for(auto& path : content.paths)
+        {
+            uint8_t repeat = 0;
+            path.name = readString(stream);
+            stream >> repeat;
+            path.repeat = (repeat != 0);
+
+            uint32_t frameCount = 0;
+            if(readCount(stream, frameCount, 40) == false) return false;
+            path.frames.resize(frameCount);
+            for(auto& frame : path.frames)
+            {
+                stream >> frame.time >> frame.position >> frame.target >> frame.up;
+            }
+
+            uint32_t objectCount = 0;
+            if(readCount(stream, objectCount, sizeof(SnapshotContent::AttachedObjectDesc)) == false) return false;
+            path.objects.resize(objectCount);
+            for(auto& object : path.objects)
+            {
+                stream >> object.type >> object.index >> object.subIndex;
+            }
+        }
+
+        if(readCount(stream, count, 8) == false) return false;
+        content.userVars.resize(count);
+        for(auto& userVar : content.userVars)
+        {
+            userVar.first = readString(stream);
+            if(readUserVariable(stream, userVar.second) == false) return false;
+        }
+
+        return stream.isFail() == false;
+    }
+
+    void SceneSnapshot::setEnabled(bool enabled)
+    {
+        SceneSnapshotData& data = getData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        data.enabled = enabled;
+    }
+
+    bool SceneSnapshot::isEnabled()
+    {
+        SceneSnapshotData& data = getData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        return data.enabled;
+    }
+
+    void SceneSnapshot::setDirectory(const std::string& directory)
+    {
+        SceneSnapshotData& data = getData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        data.directory = directory;
+    }
+
+    bool SceneSnapshot::load(Scene& scene, const std::string& sceneFile, Model::LoadFlags modelLoadFlags)
+    {
+        if(isEnabled() == false)
+        {
+            return false;
+        }
+
+        const std::string fullKey = getFullKey(sceneFile, modelLoadFlags);
+        const std::string path = getSnapshotPath(fullKey);
+        if(doesFileExist(path) == false)
+        {
+            return false;
+        }
+
+        SnapshotContent content;
+        {
+            BinaryFileStream stream(path, BinaryFileStream::Mode::MappedRead);
+            if(stream.isFail())
+            {
+                return false;
+            }
+
+            char tag[sizeof(kSnapshotTag)] = {};
+            uint32_t version = 0;
+            stream.read(tag, sizeof(kSnapshotTag) - 1);
+            stream >> version;
+            if(stream.isFail() || std::string(tag) != kSnapshotTag || version != kSnapshotFormatVersion)
+            {
+                return false;
+            }
+
+            // Make sure this is not a hash collision
+            if(readString(stream) != fullKey)
+            {
+                return false;
+            }
+
+            // Check that none of the files the scene was built from changed. Only files whose time stamp or size changed are hashed
+            uint32_t dependencyCount = 0;
+            if(readCount(stream, dependencyCount, 28) == false)
+            {
+                return false;
+            }
+            for(uint32_t i = 0; i < dependencyCount; i++)
+            {
+                std::string dependency = readString(stream);
+                int64_t modifiedTime = 0;
+                uint64_t size = 0;
+                uint64_t hash = 0;
+                stream >> modifiedTime >> size >> hash;
+                if(stream.isFail() || doesFileExist(dependency) == false)
+                {
+                    return false;
+                }
+                if((int64_t)getFileModifiedTime(dependency) != modifiedTime || getFileSize(dependency) != size)
+                {
+                    if(ShaderCache::getFileHash(dependency) != hash)
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            if(readContent(stream, content) == false)
+            {
+                logWarning("Scene snapshot '" + path + "' is corrupted. Loading the scene file instead.");
+                return false;
+            }
+        }
+
+        // Create all the objects before touching the scene, so that it's left empty if something fails
+        std::vector<Material::SharedPtr> materials;
+        for(const auto& desc : content.materials)
+        {
+            auto pMaterial = Material::create(desc.name);
+            pMaterial->setID(desc.id);
+            pMaterial->setDoubleSided(desc.doubleSided);
+            pMaterial->setAlphaThreshold(desc.alphaThreshold);
+
+            // Same texture settings as SceneImporter
+            MipGenDesc alphaMipDesc;
+            alphaMipDesc.alphaTestRef = desc.alphaThreshold;
+            alphaMipDesc.alphaTestChannel = 0;
+
+            Texture::SharedPtr pAlphaMap, pNormalMap, pHeightMap, pAOMap;
+            if((loadTexture(desc.alphaMap, false, pAlphaMap, alphaMipDesc) && loadTexture(desc.normalMap, false, pNormalMap) && loadTexture(desc.heightMap, false, pHeightMap) && loadTexture(desc.aoMap, true, pAOMap)) == false)
+            {
+                return false;
+            }
+            if(pAlphaMap) pMaterial->setAlphaMap(pAlphaMap);
+            if(pNormalMap) pMaterial->setNormalMap(pNormalMap);
+            if(pHeightMap) pMaterial->setHeightMap(pHeightMap);
+            if(pAOMap) pMaterial->setAmbientOcclusionMap(pAOMap);
+
+            for(const auto& layerDesc : desc.layers)
+            {
+                Material::Layer layer;
+                layer.type = (Material::Layer::Type)layerDesc.type;
+                layer.ndf = (Material::Layer::NDF)layerDesc.ndf;
+                layer.blend = (Material::Layer::Blend)layerDesc.blend;
+                layer.albedo = layerDesc.albedo;
+                layer.roughness = layerDesc.roughness;
+                layer.extraParam = layerDesc.extraParam;
+                if(loadTexture(layerDesc.texture, true, layer.pTexture) == false)
+                {
+                    return false;
+                }
+                pMaterial->addLayer(layer);
+            }
+            materials.push_back(pMaterial);
+        }
+
+        // Load the models in parallel, the same way SceneImporter does
+        std::vector<ModelCache::Request> requests(content.models.size());
+        std::vector<ModelCache::Request*> pRequests;
+        for(size_t i = 0; i < content.models.size(); i++)
+        {
+            const auto& desc = content.models[i];
+            requests[i].filename = desc.fullpath;
+            requests[i].flags = (Model::LoadFlags)desc.loadFlags;
+            requests[i].isShared = desc.isShared;
+            requests[i].properties.filename = desc.filename;
+            requests[i].properties.name = desc.name;
+            requests[i].properties.activeAnimation = desc.activeAnimation;
+            pRequests.push_back(&requests[i]);
+        }
+        ModelCache::loadModels(pRequests);
+
+        std::vector<Model::SharedPtr> models;
+        std::vector<std::vector<Scene::ModelInstance::SharedPtr>> instances;
+        for(size_t i = 0; i < content.models.size(); i++)
+        {
+            const auto& desc = content.models[i];
+            Model::SharedPtr pModel = std::move(requests[i].pModel);
+            if(pModel == nullptr)
+            {
+                return false;
+            }
+
+            instances.emplace_back();
+            for(const auto& instance : desc.instances)
+            {
+                auto pInstance = Scene::ModelInstance::create(pModel, instance.translation, instance.target, instance.up, instance.scaling, instance.name);
+                if(pInstance == nullptr)
+                {
+                    return false;
+                }
+                instances.back().push_back(pInstance);
+            }
+            models.push_back(pModel);
+        }
+
+        for(const auto& materialOverride : content.overrides)
+        {
+            if(materialOverride.modelID >= models.size() || materialOverride.meshID >= models[materialOverride.modelID]->getMeshCount() || materialOverride.materialID >= materials.size())
+            {
+                return false;
+            }
+        }
+
+        std::vector<Light::SharedPtr> lights;
+        for(const auto& desc : content.lights)
+        {
+            if(desc.type == LightDirectional)
+            {
+                auto pLight = DirectionalLight::create();
+                pLight->setName(desc.name);
+                pLight->setIntensity(desc.intensity);
+                pLight->setWorldDirection(desc.direction);
+                lights.push_back(pLight);
+            }
+            else if(desc.type == LightPoint)
+            {
+                auto pLight = PointLight::create();
+                pLight->setName(desc.name);
+                pLight->setIntensity(desc.intensity);
+                pLight->setWorldPosition(desc.position);
+                pLight->setWorldDirection(desc.direction);
+                pLight->setOpeningAngle(desc.openingAngle);
+                pLight->setPenumbraAngle(desc.penumbraAngle);
+                lights.push_back(pLight);
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        std::vector<Camera::SharedPtr> cameras;
+        for(const auto& desc : content.cameras)
+        {
+            auto pCamera = Camera::create();
+            pCamera->setName(desc.name);
+            pCamera->setPosition(desc.position);
+            pCamera->setTarget(desc.target);
+            pCamera->setUpVector(desc.up);
+            pCamera->setFocalLength(desc.focalLength);
+            pCamera->setDepthRange(desc.nearZ, desc.farZ);
+            pCamera->setAspectRatio(desc.aspectRatio);
+            cameras.push_back(pCamera);
+        }
+
+        std::vector<ObjectPath::SharedPtr> paths;
+        for(const auto& desc : content.paths)
+        {
+            auto pPath = ObjectPath::create();
+            pPath->setName(desc.name);
+            pPath->setAnimationRepeat(desc.repeat);
+            for(const auto& frame : desc.frames)
+            {
+                pPath->addKeyFrame(frame.time, frame.position, frame.target, frame.up);
+            }
+
+            for(const auto& object : desc.objects)
+            {
+                IMovableObject::SharedPtr pObject;
+                switch((AttachedObjectType)object.type)
+                {
+                case AttachedObjectType::ModelInstance:
+                    if(object.index < instances.size() && object.subIndex < instances[object.index].size()) pObject = instances[object.index][object.subIndex];
+                    break;
+                case AttachedObjectType::Camera:
+                    if(object.index < cameras.size()) pObject = cameras[object.index];
+                    break;
+                case AttachedObjectType::Light:
+                    if(object.index < lights.size()) pObject = lights[object.index];
+                    break;
+                }
+
+                if(pObject == nullptr)
+                {
+                    return false;
+                }
+                pPath->attachObject(pObject);
+            }
+            paths.push_back(pPath);
+        }
+
+        // Everything was created, fill the scene. The order matches the order in which SceneImporter adds the objects
+        scene.setVersion(content.version);
+        scene.setAmbientIntensity(content.ambientIntensity);
+        scene.setLightingScale(content.lightingScale);
+        scene.setCameraSpeed(content.cameraSpeed);
+
+        for(const auto& pMaterial : materials)
+        {
+            scene.addMaterial(pMaterial);
+        }
+
+        for(const auto& modelInstances : instances)
+        {
+            for(const auto& pInstance : modelInstances)
+            {
+                scene.addModelInstance(pInstance);
+            }
+        }
+
+        for(const auto& materialOverride : content.overrides)
+        {
+            Mesh* pMesh = models[materialOverride.modelID]->getMesh(materialOverride.meshID).get();
+            scene.getMaterialHistory()->replace(pMesh, materials[materialOverride.materialID]);
+        }
+
+        for(const auto& pLight : lights)
+        {
+            scene.addLight(pLight);
+        }
+
+        for(const auto& pCamera : cameras)
+        {
+            scene.addCamera(pCamera);
+        }
+        if(cameras.empty() == false)
+        {
+            scene.setActiveCamera(content.activeCamera);
+        }
+
+        for(const auto& pPath : paths)
+        {
+            scene.addPath(pPath);
+        }
+
+        for(const auto& userVar : content.userVars)
+        {
+            scene.addUserVariable(userVar.first, userVar.second);
+        }
+
+        // Mark the snapshot as recently used
+        touchFile(path);
+        return true;
+    }
+
+    void SceneSnapshot::store(const Scene& scene, const std::string& sceneFile, Model::LoadFlags modelLoadFlags, const Sources& sources)
+    {
+        if(isEnabled() == false)
+        {
+            return;
+        }
+
+        // Map the objects referenced by overrides and paths to their indices. If something can't be expressed in the snapshot, don't write one
+        std::unordered_map<const Model*, uint32_t> modelIDs;
+        std::unordered_map<const IMovableObject*, SnapshotContent::AttachedObjectDesc> movableObjects;
+        for(uint32_t modelID = 0; modelID < scene.getModelCount(); modelID++)
+        {
+            const Model* pModel = scene.getModel(modelID).get();
+            if(sources.models.find(pModel) == sources.models.end())
+            {
+                return;
+            }
+            modelIDs[pModel] = modelID;
+            for(uint32_t instanceID = 0; instanceID < scene.getModelInstanceCount(modelID); instanceID++)
+            {
+                movableObjects[scene.getModelInstance(modelID, instanceID).get()] = { (uint32_t)AttachedObjectType::ModelInstance, modelID, instanceID };
+            }
+        }
+
+        std::unordered_map<const Material*, uint32_t> materialIDs;
+        for(uint32_t i = 0; i < scene.getMaterialCount(); i++)
+        {
+            materialIDs[scene.getMaterial(i).get()] = i;
+        }
+
+        // Area lights are generated after loading, only the lights created by the importer are stored
+        std::vector<const Light*> lights;
+        for(const auto& pLight : scene.getLights())
+        {
+            if(pLight->getType() == LightPoint || pLight->getType() == LightDirectional)
+            {
+                movableObjects[pLight.get()] = { (uint32_t)AttachedObjectType::Light, (uint32_t)lights.size(), 0 };
+                lights.push_back(pLight.get());
+            }
+        }
+
+        for(uint32_t i = 0; i < scene.getCameraCount(); i++)
+        {
+            movableObjects[scene.getCamera(i).get()] = { (uint32_t)AttachedObjectType::Camera, i, 0 };
+        }
+
+        for(const auto& materialOverride : sources.materialOverrides)
+        {
+            if(modelIDs.find(materialOverride.pModel) == modelIDs.end() || materialIDs.find(materialOverride.pMaterial) == materialIDs.end())
+            {
+                return;
+            }
+        }
+
+        for(uint32_t pathID = 0; pathID < scene.getPathCount(); pathID++)
+        {
+            const auto& pPath = scene.getPath(pathID);
+            for(uint32_t i = 0; i < pPath->getAttachedObjectCount(); i++)
+            {
+                if(movableObjects.find(pPath->getAttachedObject(i).get()) == movableObjects.end())
+                {
+                    return;
+                }
+            }
+        }
+
+        std::vector<std::string> dependencies = sources.dependencies;
+        std::sort(dependencies.begin(), dependencies.end());
+        dependencies.erase(std::unique(dependencies.begin(), dependencies.end()), dependencies.end());
+
+        const std::string directory = getDirectory();
+        if(isDirectoryExists(directory) == false && createDirectory(directory) == false)
+        {
+            logWarning("Can't create the scene snapshot directory '" + directory + "'");
+            setEnabled(false);
+            return;
+        }
+
+        // Write into a temporary file, then atomically replace the snapshot. The temporary name is unique across processes, since thread IDs are unique system-wide.
+        const std::string fullKey = getFullKey(sceneFile, modelLoadFlags);
+        const std::string path = getSnapshotPath(fullKey);
+        const std::string tempPath = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+        {
+            BinaryFileStream stream(tempPath, BinaryFileStream::Mode::Write);
+            stream.write(kSnapshotTag, sizeof(kSnapshotTag) - 1);
+            stream << kSnapshotFormatVersion;
+            writeString(stream, fullKey);
+
+            stream << (uint32_t)dependencies.size();
+            for(const auto& dependency : dependencies)
+            {
+                uint64_t hash = ShaderCache::getFileHash(dependency);
+                if(hash == 0)
+                {
+                    stream.close();
+                    deleteFile(tempPath);
+                    return;
+                }
+                writeString(stream, dependency);
+                stream << (int64_t)getFileModifiedTime(dependency) << getFileSize(dependency) << hash;
+            }
+
+            // Global settings
+            stream << scene.getVersion() << scene.getAmbientIntensity() << scene.getLightingScale() << scene.getCameraSpeed() << scene.getActiveCameraIndex();
+
+            // Materials
+            stream << scene.getMaterialCount();
+            for(uint32_t i = 0; i < scene.getMaterialCount(); i++)
+            {
+                const Material* pMaterial = scene.getMaterial(i).get();
+                writeString(stream, pMaterial->getName());
+                stream << pMaterial->getId() << (uint8_t)(pMaterial->isDoubleSided() ? 1 : 0) << pMaterial->getAlphaThreshold();
+                writeString(stream, getTextureFilename(pMaterial->getAlphaMap()));
+                writeString(stream, getTextureFilename(pMaterial->getNormalMap()));
+                writeString(stream, getTextureFilename(pMaterial->getHeightMap()));
+                writeString(stream, getTextureFilename(pMaterial->getAmbientOcclusionMap()));
+
+                stream << pMaterial->getNumLayers();
+                for(uint32_t layerID = 0; layerID < pMaterial->getNumLayers(); layerID++)
+                {
+                    const Material::Layer layer = pMaterial->getLayer(layerID);
+                    stream << (uint32_t)layer.type << (uint32_t)layer.ndf << (uint32_t)layer.blend << layer.albedo << layer.roughness << layer.extraParam;
+                    writeString(stream, getTextureFilename(layer.pTexture));
+                }
+            }
+
+            // Models and their instances
+            stream << scene.getModelCount();
+            for(uint32_t modelID = 0; modelID < scene.getModelCount(); modelID++)
+            {
+                const Model* pModel = scene.getModel(modelID).get();
+                const auto& source = sources.models.at(pModel);
+                writeString(stream, source.fullpath);
+                stream << (uint32_t)source.loadFlags;
+                stream << (uint32_t)(source.isShared ? 1 : 0);
+                writeString(stream, source.properties.filename);
+                writeString(stream, source.properties.name);
+                stream << source.properties.activeAnimation;
+
+                stream << scene.getModelInstanceCount(modelID);
+                for(uint32_t instanceID = 0; instanceID < scene.getModelInstanceCount(modelID); instanceID++)
+                {
+                    const auto& pInstance = scene.getModelInstance(modelID, instanceID);
+                    writeString(stream, pInstance->getName());
+                    stream << pInstance->getTranslation() << pInstance->getTarget() << pInstance->getUpVector() << pInstance->getScaling();
+                }
+            }
+
+            stream << (uint32_t)sources.materialOverrides.size();
+            for(const auto& materialOverride : sources.materialOverrides)
+            {
+                stream << modelIDs[materialOverride.pModel] << materialOverride.meshID << materialIDs[materialOverride.pMaterial];
+            }
+
+            // Lights
+            stream << (uint32_t)lights.size();
+            for(const Light* pLight : lights)
+            {
+                stream << pLight->getType();
+                writeString(stream, pLight->getName());
+                if(pLight->getType() == LightPoint)
+                {
+                    const PointLight* pPointLight = (const PointLight*)pLight;
+                    stream << pPointLight->getIntensity() << pPointLight->getWorldDirection() << pPointLight->getWorldPosition() << pPointLight->getOpeningAngle() << pPointLight->getPenumbraAngle();
+                }
+                else
+                {
+                    const DirectionalLight* pDirLight = (const DirectionalLight*)pLight;
+                    stream << pDirLight->getIntensity() << pDirLight->getWorldDirection() << glm::vec3(0) << 0.0f << 0.0f;
+                }
+            }
+
+            // Cameras
+            stream << scene.getCameraCount();
+            for(uint32_t i = 0; i < scene.getCameraCount(); i++)
+            {
+                const auto& pCamera = scene.getCamera(i);
+                writeString(stream, pCamera->getName());
+                stream << pCamera->getPosition() << pCamera->getTarget() << pCamera->getUpVector() << pCamera->getFocalLength() << pCamera->getNearPlane() << pCamera->getFarPlane() << pCamera->getAspectRatio();
+            }
+
+            // Paths
+            stream << scene.getPathCount();
+            for(uint32_t pathID = 0; pathID < scene.getPathCount(); pathID++)
+            {
+                const auto& pPath = scene.getPath(pathID);
+                writeString(stream, pPath->getName());
+                stream << (uint8_t)(pPath->isRepeatOn() ? 1 : 0);
+
+                stream << pPath->getKeyFrameCount();
+                for(uint32_t frameID = 0; frameID < pPath->getKeyFrameCount(); frameID++)
+                {
+                    const auto& frame = pPath->getKeyFrame(frameID);
+                    stream << frame.time << frame.position << frame.target << frame.up;
+                }
+
+                stream << pPath->getAttachedObjectCount();
+                for(uint32_t i = 0; i < pPath->getAttachedObjectCount(); i++)
+                {
+                    const auto& object = movableObjects[pPath->getAttachedObject(i).get()];
+                    stream << object.type << object.index << object.subIndex;
+                }
+            }
+
+            // User variables
+            stream << scene.getUserVariableCount();
+            for(uint32_t varID = 0; varID < scene.getUserVariableCount(); varID++)
+            {
+                std::string name;
+                const auto& var = scene.getUserVariable(varID, name);
+                writeString(stream, name);
+                writeUserVariable(stream, var);
+            }
+
+            if(stream.isFail())
+            {
+                stream.close();
+                deleteFile(tempPath);
+                return;
+            }
+        }
+
+        if(moveFile(tempPath, path) == false)
+        {
+            // Another process is reading the snapshot. It was created from the same files, so there's nothing to update.
+            deleteFile(tempPath);
+        }
+    }
+}
@@ -0,0 +1,100 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "Graphics/Scene/Scene.h"
+#include "Graphics/Model/ModelCache.h"
+
+namespace Falcor
+{
+    /** Persistent on-disk cache of scenes loaded by SceneImporter.
+        A snapshot is a compact binary copy of a scene as it looks after the .fscene file and its includes were parsed: materials, models, model instances, lights, cameras, paths and user variables.
+        Models are not embedded. The snapshot records the file every model was loaded from and the properties the scene set on it, and loads it again the same way SceneImporter did, so shared models keep being shared through the ModelCache.
+        Each snapshot records the scene file and every file it depends on (include files, model files and material textures), with their modification time, size and content hash. A snapshot is only used if none of them changed.
+        A file whose modification time or size differs is hashed again, so touching a file without changing it doesn't invalidate the snapshot.
+        Snapshots are written to a temporary file which is then renamed, so several processes can safely share a snapshot directory.
+        Snapshots are disabled by default. Applications opt in with setEnabled(), and should choose a writable directory with setDirectory().
+    */
+    class SceneSnapshot
+    {
+    public:
+        /** Data gathered by SceneImporter while parsing a scene, which can't be recovered from the Scene object
+        */
+        struct Sources
+        {
+            struct ModelSource
+            {
+                std::string fullpath;               ///< The file the model was loaded from
+                Model::LoadFlags loadFlags;         ///< The flags the model was loaded with
+                bool isShared;                      ///< True if the model was loaded through ModelCache::getOrCreate(), false if it was loaded with ModelCache::create()
+                ModelCache::Properties properties;  ///< The properties the scene set on the model
+            };
+
+            struct MaterialOverride
+            {
+                const Model* pModel;
+                uint32_t meshID;
+                const Material* pMaterial;
+            };
+
+            std::vector<std::string> dependencies;                          ///< Full paths of the files read while parsing the scene, including the scene file itself
+            std::unordered_map<const Model*, ModelSource> models;           ///< How each model was loaded
+            std::vector<MaterialOverride> materialOverrides;                ///< Material overrides, in the order they were applied
+        };
+
+        /** Enable or disable snapshots. Snapshots are disabled by default, applications opt in by enabling them
+        */
+        static void setEnabled(bool enabled);
+
+        /** Check if snapshots are enabled
+        */
+        static bool isEnabled();
+
+        /** Set the directory containing the snapshots. If it's not set, snapshots are stored in a 'SceneCache' sub-directory of the executable directory
+        */
+        static void setDirectory(const std::string& directory);
+
+        /** Load a scene from its snapshot
+            \param[in] scene The scene to load into. Left untouched if the snapshot can't be used
+            \param[in] sceneFile Full path of the scene file
+            \param[in] modelLoadFlags The flags the scene's models are loaded with
+            \return true if an up-to-date snapshot was found and loaded, otherwise false
+        */
+        static bool load(Scene& scene, const std::string& sceneFile, Model::LoadFlags modelLoadFlags);
+
+        /** Store the snapshot of a scene which was just parsed. Must be called before area lights are generated, since they are recreated after loading
+            \param[in] scene The scene
+            \param[in] sceneFile Full path of the scene file
+            \param[in] modelLoadFlags The flags the scene's models were loaded with
+            \param[in] sources Data gathered while parsing the scene
+        */
+        static void store(const Scene& scene, const std::string& sceneFile, Model::LoadFlags modelLoadFlags, const Sources& sources);
+    };
+}
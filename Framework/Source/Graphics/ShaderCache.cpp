@@ -0,0 +1,367 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "ShaderCache.h"
+#include "Utils/OS.h"
+#include "Utils/BinaryFileStream.h"
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace Falcor
+{
+    // Defined in SlangSupport.cpp, which includes the Slang sources. Changes whenever Slang is rebuilt
+    const char* getSlangBuildTag();
+
+    // Bump the format version whenever the entry layout changes. Slang doesn't expose a version number, so entries are keyed by the build tag of the
+    // embedded Slang, which invalidates the entries created by a previous version.
+    static const uint32_t kCacheFormatVersion = 1;
+    static const char kEntryTag[] = "FalcorSC";
+    static const std::string kEntryExtension = ".shc";
+    static const uint64_t kDefaultMaxSize = 256 * 1024 * 1024;
+
+    struct FileHash
+    {
+        time_t modifiedTime;
+        uint64_t hash;
+    };
+
+    struct ShaderCacheData
+    {
+        std::mutex mutex;
+        bool enabled = false;
+        std::string directory;
+        uint64_t maxSize = kDefaultMaxSize;
+        bool isSizeKnown = false;
+        uint64_t currentSize = 0;
+        std::unordered_map<std::string, FileHash> fileHashes;
+    };
+
+    static ShaderCacheData& getData()
+    {
+        static ShaderCacheData sData;
+        return sData;
+    }
+
+    // 64-bit FNV-1a
+    static uint64_t hashData(const void* pData, size_t size)
+    {
+        const uint8_t* pBytes = (const uint8_t*)pData;
+        uint64_t hash = 14695981039346656037ull;
+        for(size_t i = 0; i < size; i++)
+        {
+            hash ^= pBytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static void writeString(BinaryFileStream& stream, const std::string& str)
+    {
+        stream << (uint32_t)str.size();
+        stream.write(str.data(), str.size());
+    }
+
+    static std::string readString(BinaryFileStream& stream)
+    {
+        uint32_t length = 0;
+        stream >> length;
+        if(stream.isFail() || length > stream.getRemainingStreamSize())
+        {
+            return std::string();
+        }
+        std::string str(length, '\0');
+        stream.read(&str[0], length);
+        return str;
+    }
+
+    static std::string getDirectory()
+    {
+        ShaderCacheData& data = getData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        if(data.directory.empty())
+        {
+            data.directory = getExecutableDirectory() + "\\ShaderCache";
+        }
+        return data.directory;
+    }
+
+    // The key description provided by the user doesn't depend on the compiler version, add it here
+    static std::string getFullKey(const std::string& keyDesc)
+    {
+        return std::string(getSlangBuildTag()) + "\n" + keyDesc;
+    }
+
+    static std::string getEntryPath(const std::string& keyDesc)
+    {
+        char name[17];
+        snprintf(name, sizeof(name), "%016llx", (unsigned long long)hashData(keyDesc.data(), keyDesc.size()));
+        return getDirectory() + "\\" + name + kEntryExtension;
+    }
+
+    void ShaderCache::setEnabled(bool enabled)
+    {
+        ShaderCacheData& data = getData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        data.enabled = enabled;
+    }
+
+    bool ShaderCache::isEnabled()
+    {
+        ShaderCacheData& data = getData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        return data.enabled;
+    }
+
+    void ShaderCache::setDirectory(const std::string& directory)
+    {
+        ShaderCacheData& data = getData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        data.directory = directory;
+        data.isSizeKnown = false;
+    }
+
+    void ShaderCache::setMaxSize(uint64_t maxSize)
+    {
+        ShaderCacheData& data = getData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        data.maxSize = maxSize;
+    }
+
+    uint64_t ShaderCache::getFileHash(const std::string& fullpath)
+    {
+        if(doesFileExist(fullpath) == false)
+        {
+            return 0;
+        }
+
+        ShaderCacheData& data = getData();
+        time_t modifiedTime = getFileModifiedTime(fullpath);
+        {
+            std::lock_guard<std::mutex> lock(data.mutex);
+            auto it = data.fileHashes.find(fullpath);
+            if(it != data.fileHashes.end() && it->second.modifiedTime == modifiedTime)
+            {
+                return it->second.hash;
+            }
+        }
+
+        MappedFile file;
+        if(mapFileToMemory(fullpath, file) == false)
+        {
+            return 0;
+        }
+        uint64_t hash = hashData(file.pData, (size_t)file.size);
+        unmapFileFromMemory(file);
+
+        // 0 is reserved for unreadable files
+        hash = (hash == 0) ? 1 : hash;
+        std::lock_guard<std::mutex> lock(data.mutex);
+        data.fileHashes[fullpath] = { modifiedTime, hash };
+        return hash;
+    }
+
+    bool ShaderCache::load(const std::string& keyDesc, Entry& entry)
+    {
+        if(isEnabled() == false)
+        {
+            return false;
+        }
+
+        const std::string fullKey = getFullKey(keyDesc);
+        const std::string path = getEntryPath(fullKey);
+        if(doesFileExist(path) == false)
+        {
+            return false;
+        }
+
+        BinaryFileStream stream(path, BinaryFileStream::Mode::MappedRead);
+        if(stream.isFail())
+        {
+            return false;
+        }
+
+        char tag[sizeof(kEntryTag)] = {};
+        uint32_t version = 0;
+        stream.read(tag, sizeof(kEntryTag) - 1);
+        stream >> version;
+        if(stream.isFail() || std::string(tag) != kEntryTag || version != kCacheFormatVersion)
+        {
+            return false;
+        }
+
+        // Make sure this is not a hash collision
+        if(readString(stream) != fullKey)
+        {
+            return false;
+        }
+
+        // Check that none of the files read by the compiler changed
+        uint32_t dependencyCount = 0;
+        stream >> dependencyCount;
+        entry.dependencies.clear();
+        for(uint32_t i = 0; i < dependencyCount; i++)
+        {
+            std::string dependency = readString(stream);
+            uint64_t hash = 0;
+            stream >> hash;
+            if(stream.isFail() || getFileHash(dependency) != hash)
+            {
+                return false;
+            }
+            entry.dependencies.push_back(dependency);
+        }
+
+        for(uint32_t i = 0; i < kShaderCount; i++)
+        {
+            entry.shaderStrings[i] = readString(stream);
+        }
+
+        entry.pReflector = ProgramReflection::deserialize(stream);
+        if(entry.pReflector == nullptr)
+        {
+            return false;
+        }
+        stream.close();
+
+        // Mark the entry as recently used
+        touchFile(path);
+        return true;
+    }
+
+    static void evictEntries(ShaderCacheData& data)
+    {
+        struct CacheFile
+        {
+            std::string path;
+            uint64_t size;
+            time_t lastUsed;
+        };
+
+        std::vector<std::string> filenames;
+        enumerateFiles(data.directory + "\\*" + kEntryExtension, filenames);
+
+        std::vector<CacheFile> files;
+        data.currentSize = 0;
+        for(const auto& filename : filenames)
+        {
+            CacheFile file;
+            file.path = data.directory + "\\" + filename;
+            file.size = getFileSize(file.path);
+            file.lastUsed = getFileModifiedTime(file.path);
+            data.currentSize += file.size;
+            files.push_back(file);
+        }
+        data.isSizeKnown = true;
+
+        if(data.currentSize <= data.maxSize)
+        {
+            return;
+        }
+
+        // Delete the least-recently-used entries until we're well below the limit, so that we don't have to evict again on the next store
+        std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b) { return a.lastUsed < b.lastUsed; });
+        const uint64_t targetSize = data.maxSize - data.maxSize / 4;
+        for(const auto& file : files)
+        {
+            if(data.currentSize <= targetSize)
+            {
+                break;
+            }
+            // Deletion fails if another process is reading the entry. That's fine, it was just used.
+            if(deleteFile(file.path))
+            {
+                data.currentSize -= file.size;
+            }
+        }
+    }
+
+    void ShaderCache::store(const std::string& keyDesc, const Entry& entry)
+    {
+        if(isEnabled() == false)
+        {
+            return;
+        }
+
+        const std::string directory = getDirectory();
+        if(isDirectoryExists(directory) == false && createDirectory(directory) == false)
+        {
+            logWarning("Can't create the shader cache directory '" + directory + "'");
+            setEnabled(false);
+            return;
+        }
+
+        // Write into a temporary file, then atomically replace the entry. The temporary name is unique across processes, since thread IDs are unique system-wide.
+        const std::string fullKey = getFullKey(keyDesc);
+        const std::string path = getEntryPath(fullKey);
+        const std::string tempPath = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+        {
+            BinaryFileStream stream(tempPath, BinaryFileStream::Mode::Write);
+            stream.write(kEntryTag, sizeof(kEntryTag) - 1);
+            stream << kCacheFormatVersion;
+            writeString(stream, fullKey);
+
+            stream << (uint32_t)entry.dependencies.size();
+            for(const auto& dependency : entry.dependencies)
+            {
+                writeString(stream, dependency);
+                stream << getFileHash(dependency);
+            }
+
+            for(uint32_t i = 0; i < kShaderCount; i++)
+            {
+                writeString(stream, entry.shaderStrings[i]);
+            }
+            entry.pReflector->serialize(stream);
+
+            if(stream.isFail())
+            {
+                stream.close();
+                deleteFile(tempPath);
+                return;
+            }
+        }
+
+        const uint64_t entrySize = getFileSize(tempPath);
+        if(moveFile(tempPath, path) == false)
+        {
+            // Another process is using the entry. It was created from the same key, so there's nothing to update.
+            deleteFile(tempPath);
+            return;
+        }
+
+        ShaderCacheData& data = getData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        data.currentSize += entrySize;
+        if(data.isSizeKnown == false || data.currentSize > data.maxSize)
+        {
+            evictEntries(data);
+        }
+    }
+}
@@ -0,0 +1,90 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include "API/Shader.h"
+#include "API/ProgramReflection.h"
+
+namespace Falcor
+{
+    /** Persistent on-disk cache of the Slang compilation results, used by Program to create program versions without running Slang.
+        Entries are keyed by a hash of a description of everything which affects the compilation (shader sources, defines, target, search paths and the Slang build).
+        Each entry also records the content hash of every file read during the compilation, and is only used if none of them changed.
+        Entries are written to a temporary file which is then renamed, so several processes can safely share a cache directory.
+        When the cache grows beyond its size limit, the least-recently-used entries are deleted.
+    */
+    class ShaderCache
+    {
+    public:
+        static const uint32_t kShaderCount = (uint32_t)ShaderType::Count;
+
+        /** Cached compilation result
+        */
+        struct Entry
+        {
+            std::string shaderStrings[kShaderCount];        ///< The code generated for each shader stage. Empty for unused stages
+            ProgramReflection::SharedPtr pReflector;        ///< The program reflection
+            std::vector<std::string> dependencies;          ///< Full paths of the files read during the compilation
+        };
+
+        /** Enable or disable the cache. The cache is disabled by default, applications opt in by enabling it
+        */
+        static void setEnabled(bool enabled);
+
+        /** Check if the cache is enabled
+        */
+        static bool isEnabled();
+
+        /** Set the directory containing the cache files. By default, the cache is stored in a 'ShaderCache' sub-directory of the executable directory
+        */
+        static void setDirectory(const std::string& directory);
+
+        /** Set the maximum size of the cache in bytes. Default is 256MB
+        */
+        static void setMaxSize(uint64_t maxSize);
+
+        /** Get the hash of a file's content. The result is memoized, and recomputed if the file's modification time changes.
+            \return The hash, or 0 if the file can't be read
+        */
+        static uint64_t getFileHash(const std::string& fullpath);
+
+        /** Look for a compilation result
+            \param[in] keyDesc Description of the compilation. Must contain everything which affects the result
+            \param[out] entry On success, the cached compilation result
+            \return true if a valid entry was found, otherwise false
+        */
+        static bool load(const std::string& keyDesc, Entry& entry);
+
+        /** Store a compilation result
+            \param[in] keyDesc Description of the compilation. Must contain everything which affects the result
+            \param[in] entry The compilation result
+        */
+        static void store(const std::string& keyDesc, const Entry& entry);
+    };
+}
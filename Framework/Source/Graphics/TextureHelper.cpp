@@ -32,6 +32,10 @@
 #include "Utils/DDSHeader.h"
 #include "Utils/BinaryFileStream.h"
 #include "Utils/StringUtils.h"
+#include "Utils/JobSystem.h"
+#include "Utils/Math/SimdOps.h"
+#include <algorithm>
+#include <cmath>
 
 #ifdef FALCOR_GL
 static const bool kTopDown = false;
@@ -497,72 +501,169 @@ namespace Falcor
 		}
 	}
 
-	//Flip the data so it follows opengl conventions
-	void flipData(DdsData& ddsData, ResourceFormat format, uint32_t width, uint32_t height, uint32_t depth, uint32_t mipDepth, bool isCubemap = false)
+	//Get the number of bytes the header says the file contains - all the mip-levels of every array slice, cube face and depth slice
+	size_t getDdsDataSize(const DdsData& ddsData, ResourceFormat format, uint32_t mipCount)
 	{
-		if (!isCompressedFormat(format) && !kTopDown)
+		uint32_t width = ddsData.header.width;
+		uint32_t height = ddsData.header.height;
+		uint32_t depth = 1;
+		uint32_t sliceCount = 1;
+		if (ddsData.hasDX10Header)
 		{
-			std::vector<uint8_t> oldData(ddsData.data.size());
-			oldData.swap(ddsData.data);
-			const uint8_t* currentTexture = oldData.data();
-			const uint8_t* currentDepth = oldData.data();
-			uint8_t* currentPos = ddsData.data.data();
-
-			for (uint32_t mipCounter = 0; mipCounter < mipDepth; ++mipCounter)
+			switch (ddsData.dx10Header.resourceDimension)
 			{
-				uint32_t heightPitch = max(width >> mipCounter, 1U) * getFormatBytesPerBlock(format);
-				uint32_t currentMipHeight = max(height >> mipCounter, 1U);
-				uint32_t depthPitch = currentMipHeight * heightPitch;	
-
-				for (uint32_t depthCounter = 0; depthCounter < depth; ++depthCounter)
-				{
-					currentTexture = currentDepth + depthPitch * depthCounter;
-					
-					if (isCubemap)
-					{
-						if (depthCounter % 6 == 2)
-						{
-							currentTexture += depthPitch;
-						}
-						else if (depthCounter % 6 == 3)
-						{
-							currentTexture -= depthPitch;
-						}
-					}
-					
-					for (uint32_t heightCounter = 1; heightCounter <= currentMipHeight; ++heightCounter)
-					{
-						memcpy(currentPos, currentTexture + (currentMipHeight - heightCounter) * heightPitch, heightPitch);
-						currentPos += heightPitch;
-					}
-					
-				}
-
-				currentDepth += depthPitch * depth;
+			case D3D10_RESOURCE_DIMENSION::D3D10_RESOURCE_DIMENSION_TEXTURE1D:
+				height = 1;
+				sliceCount = ddsData.dx10Header.arraySize;
+				break;
+			case D3D10_RESOURCE_DIMENSION::D3D10_RESOURCE_DIMENSION_TEXTURE3D:
+				depth = ddsData.header.depth;
+				break;
+			default:
+				sliceCount = ddsData.dx10Header.arraySize * ((ddsData.dx10Header.miscFlag & DdsHeaderDX10::kCubeMapMask) ? 6 : 1);
+				break;
 			}
 		}
+		else if (ddsData.header.flags & DdsHeader::kDepthMask)
+		{
+			depth = ddsData.header.depth;
+		}
+		else if (ddsData.header.caps[1] & DdsHeader::kCaps2CubeMapMask)
+		{
+			sliceCount = 6;
+		}
+
+		const uint32_t blockWidth = getFormatWidthCompressionRatio(format);
+		const uint32_t blockHeight = getFormatHeightCompressionRatio(format);
+		const uint32_t bytesPerBlock = getFormatBytesPerBlock(format);
+		size_t sliceSize = 0;
+		for (uint32_t mip = 0; mip < mipCount; ++mip)
+		{
+			size_t rowPitch = (size_t)((max(width >> mip, 1U) + blockWidth - 1) / blockWidth) * bytesPerBlock;
+			size_t rowCount = (max(height >> mip, 1U) + blockHeight - 1) / blockHeight;
+			sliceSize += rowPitch * rowCount * max(depth >> mip, 1U);
+		}
+		return sliceSize * sliceCount;
 	}
 
-	void loadDDSDataFromFile(const std::string filename, DdsData& ddsData)
+	//Flip the data so it follows opengl conventions. The mapped file is read-only, so the rows are copied into ddsData.flippedData in reverse order, in a single pass.
+	//The caller has already checked that the file contains the whole texture
+	void flipData(DdsData& ddsData, ResourceFormat format, uint32_t width, uint32_t height, uint32_t depth, uint32_t mipDepth, bool isCubemap = false, bool isVolume = false)
+	{
+		if (!isCompressedFormat(format) && !kTopDown)
+		{
+            // A band of rows of one mip-level of one slice
+            struct FlipBand
+            {
+                size_t srcOffset;   // Offset of the source image
+                size_t dstOffset;   // Offset of the destination image
+                uint32_t rowPitch;
+                uint32_t rowCount;
+                uint32_t firstRow;
+                uint32_t lastRow;
+            };
+            static const uint32_t kRowsPerBand = 256;
+
+            std::vector<FlipBand> bands;
+            auto addImage = [&bands](size_t srcOffset, size_t dstOffset, uint32_t rowPitch, uint32_t rowCount)
+            {
+                for (uint32_t row = 0; row < rowCount; row += kRowsPerBand)
+                {
+                    bands.push_back({srcOffset, dstOffset, rowPitch, rowCount, row, min(rowCount, row + kRowsPerBand)});
+                }
+            };
+
+            const uint32_t bytesPerPixel = getFormatBytesPerBlock(format);
+            size_t size = 0;
+            if (isVolume)
+            {
+                // Volumes store all the depth-slices of a mip-level together
+                for (uint32_t mip = 0; mip < mipDepth; ++mip)
+                {
+                    uint32_t rowPitch = max(width >> mip, 1U) * bytesPerPixel;
+                    uint32_t rowCount = max(height >> mip, 1U);
+                    for (uint32_t z = 0; z < max(depth >> mip, 1U); ++z)
+                    {
+                        addImage(size, size, rowPitch, rowCount);
+                        size += (size_t)rowPitch * rowCount;
+                    }
+                }
+            }
+            else
+            {
+                // Arrays store the whole mip-chain of every slice together
+                size_t sliceSize = 0;
+                for (uint32_t mip = 0; mip < mipDepth; ++mip)
+                {
+                    sliceSize += (size_t)max(width >> mip, 1U) * bytesPerPixel * max(height >> mip, 1U);
+                }
+
+                for (uint32_t slice = 0; slice < depth; ++slice)
+                {
+                    // Flipping the Y axis swaps the +Y and -Y cube faces
+                    uint32_t srcSlice = slice;
+                    if (isCubemap)
+                    {
+                        if (slice % 6 == 2)
+                        {
+                            srcSlice = slice + 1;
+                        }
+                        else if (slice % 6 == 3)
+                        {
+                            srcSlice = slice - 1;
+                        }
+                    }
+
+                    for (uint32_t mip = 0; mip < mipDepth; ++mip)
+                    {
+                        uint32_t rowPitch = max(width >> mip, 1U) * bytesPerPixel;
+                        uint32_t rowCount = max(height >> mip, 1U);
+                        addImage((size - (size_t)slice * sliceSize) + (size_t)srcSlice * sliceSize, size, rowPitch, rowCount);
+                        size += (size_t)rowPitch * rowCount;
+                    }
+                }
+            }
+
+            assert(size <= ddsData.dataSize);
+            ddsData.flippedData.resize(size);
+            const uint8_t* pSrc = ddsData.pData;
+            uint8_t* pDst = ddsData.flippedData.data();
+            JobSystem::parallelFor((uint32_t)bands.size(), [&](uint32_t i)
+            {
+                const FlipBand& band = bands[i];
+                for (uint32_t row = band.firstRow; row < band.lastRow; ++row)
+                {
+                    memcpy(pDst + band.dstOffset + (size_t)row * band.rowPitch, pSrc + band.srcOffset + (size_t)(band.rowCount - 1 - row) * band.rowPitch, band.rowPitch);
+                }
+            });
+
+            ddsData.pData = ddsData.flippedData.data();
+            ddsData.dataSize = size;
+		}
+	}
+
+	bool loadDDSDataFromFile(const std::string filename, DdsData& ddsData)
 	{
         std::string fullpath;
 		if (findFileInDataDirectories(filename, fullpath) == false)
 		{
 			logError(std::string("Can't find texture file ") + filename);
 			//could not find file
-			return;
+			return false;
 		}
 
-		BinaryFileStream stream(fullpath, BinaryFileStream::Mode::Read);
+        // Map the file, the texture data is uploaded directly from the mapping
+        BinaryFileStream& stream = ddsData.stream;
+        stream.open(fullpath, BinaryFileStream::Mode::MappedRead);
 
 		//check the dds identifier
-		uint32_t ddsIdentifier;
+		uint32_t ddsIdentifier = 0;
 		stream >> ddsIdentifier;
 		if (ddsIdentifier != kDdsMagicNumber)
 		{
 			//not valid dds file apparently
 			logError(std::string("The dds file ") + filename + std::string(" is not a valid dds file"));
-			return;
+			return false;
 		}
 
         stream >> ddsData.header;
@@ -577,12 +678,455 @@ namespace Falcor
             ddsData.hasDX10Header = false;
 		}
 
-        uint32_t dataSize = stream.getRemainingStreamSize();
-        ddsData.data.resize(dataSize);
-        stream.read(ddsData.data.data(), dataSize);
+        ddsData.dataSize = (size_t)stream.getRemainingStreamSize();
+        ddsData.pData = stream.readSpan(ddsData.dataSize);
+        if (stream.isFail())
+        {
+            logError(std::string("Can't read the dds file ") + filename);
+            return false;
+        }
+        return true;
 	}
 
-    Texture::SharedPtr createTextureFromDx10Dds(DdsData& ddsData, const std::string& filename, ResourceFormat format, uint32_t mipLevels, Texture::BindFlags bindFlags)
+    // Channel layout of the formats supported by the CPU mip generator. Offsets are in channel units, missing channels are read as (0, 0, 0, 1)
+    struct MipFormatDesc
+    {
+        uint32_t bytesPerPixel;
+        bool isFloat;
+        bool isSrgb;
+        int32_t offset[4];
+    };
+
+    static bool getMipFormatDesc(ResourceFormat format, MipFormatDesc& desc)
+    {
+        switch(format)
+        {
+        case ResourceFormat::R8Unorm:
+            desc = {1, false, false, {0, -1, -1, -1}};
+            return true;
+        case ResourceFormat::RG8Unorm:
+            desc = {2, false, false, {0, 1, -1, -1}};
+            return true;
+        case ResourceFormat::RGBA8Unorm:
+        case ResourceFormat::RGBA8UnormSrgb:
+            desc = {4, false, isSrgbFormat(format), {0, 1, 2, 3}};
+            return true;
+        case ResourceFormat::BGRA8Unorm:
+        case ResourceFormat::BGRA8UnormSrgb:
+            desc = {4, false, isSrgbFormat(format), {2, 1, 0, 3}};
+            return true;
+        case ResourceFormat::BGRX8Unorm:
+        case ResourceFormat::BGRX8UnormSrgb:
+            desc = {4, false, isSrgbFormat(format), {2, 1, 0, -1}};
+            return true;
+        case ResourceFormat::R32Float:
+            desc = {4, true, false, {0, -1, -1, -1}};
+            return true;
+        case ResourceFormat::RG32Float:
+            desc = {8, true, false, {0, 1, -1, -1}};
+            return true;
+        case ResourceFormat::RGB32Float:
+            desc = {12, true, false, {0, 1, 2, -1}};
+            return true;
+        case ResourceFormat::RGBA32Float:
+            desc = {16, true, false, {0, 1, 2, 3}};
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    struct SrgbTables
+    {
+        float toLinear[256];
+        float threshold[256];   // threshold[i] is the linear value halfway between sRGB values i - 1 and i
+    };
+
+    static float srgbToLinear(float value)
+    {
+        return (value <= 0.04045f) ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    static const SrgbTables& getSrgbTables()
+    {
+        static const SrgbTables sTables = []()
+        {
+            SrgbTables tables;
+            tables.threshold[0] = 0;
+            for(uint32_t i = 0; i < 256; i++)
+            {
+                tables.toLinear[i] = srgbToLinear((float)i / 255.0f);
+                if(i > 0)
+                {
+                    tables.threshold[i] = srgbToLinear(((float)i - 0.5f) / 255.0f);
+                }
+            }
+            return tables;
+        }();
+        return sTables;
+    }
+
+    static void decodeMipRow(const MipFormatDesc& format, const uint8_t* pSrc, uint32_t width, float* pDst)
+    {
+        const SrgbTables& srgb = getSrgbTables();
+        for(uint32_t x = 0; x < width; x++, pSrc += format.bytesPerPixel, pDst += 4)
+        {
+            for(uint32_t c = 0; c < 4; c++)
+            {
+                int32_t offset = format.offset[c];
+                if(offset < 0)
+                {
+                    pDst[c] = (c == 3) ? 1.0f : 0.0f;
+                }
+                else if(format.isFloat)
+                {
+                    pDst[c] = ((const float*)pSrc)[offset];
+                }
+                else
+                {
+                    uint8_t value = pSrc[offset];
+                    pDst[c] = (format.isSrgb && c < 3) ? srgb.toLinear[value] : (float)value * (1.0f / 255.0f);
+                }
+            }
+        }
+    }
+
+    static void encodeMipChannel(const MipFormatDesc& format, uint32_t channel, float value, uint8_t* pTexel)
+    {
+        int32_t offset = format.offset[channel];
+        if(offset < 0)
+        {
+            return;
+        }
+
+        if(format.isFloat)
+        {
+            ((float*)pTexel)[offset] = value;
+        }
+        else if(format.isSrgb && channel < 3)
+        {
+            // Find the last sRGB value whose threshold is below the linear value
+            const float* pThreshold = getSrgbTables().threshold;
+            uint32_t code = 0;
+            for(uint32_t step = 128; step > 0; step >>= 1)
+            {
+                code += (pThreshold[code + step] <= value) ? step : 0;
+            }
+            pTexel[offset] = (uint8_t)code;
+        }
+        else
+        {
+            pTexel[offset] = (uint8_t)(clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+    }
+
+    /** The source texels of every destination texel along one axis. Every destination texel uses tapCount taps, starting at index[dst * tapCount]
+    */
+    struct MipFilterTaps
+    {
+        uint32_t tapCount = 0;
+        std::vector<uint32_t> index;
+        std::vector<float> weight;
+    };
+
+    static const float kKaiserWidth = 3.0f;     // In destination texels
+    static const double kKaiserAlpha = 4.0;
+
+    static double besselI0(double x)
+    {
+        double sum = 1;
+        double term = 1;
+        for(uint32_t k = 1; k < 32; k++)
+        {
+            term *= (x * 0.5 / k) * (x * 0.5 / k);
+            sum += term;
+        }
+        return sum;
+    }
+
+    static float evalKaiser(float x)
+    {
+        float t = x / kKaiserWidth;
+        if(std::abs(t) >= 1)
+        {
+            return 0;
+        }
+
+        double sinc = (x == 0) ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+        return (float)(sinc * besselI0(kKaiserAlpha * std::sqrt(1.0 - t * t)) / besselI0(kKaiserAlpha));
+    }
+
+    static MipFilterTaps computeMipFilterTaps(uint32_t srcSize, uint32_t dstSize, MipFilter filter)
+    {
+        MipFilterTaps taps;
+        const float scale = (float)srcSize / (float)dstSize;
+        const float support = (filter == MipFilter::Box) ? scale * 0.5f : kKaiserWidth * scale;
+        taps.tapCount = (uint32_t)std::ceil(2 * support) + 1;
+        taps.index.resize(dstSize * taps.tapCount);
+        taps.weight.resize(dstSize * taps.tapCount);
+
+        for(uint32_t dst = 0; dst < dstSize; dst++)
+        {
+            float center = ((float)dst + 0.5f) * scale;
+            int32_t first = (int32_t)std::floor(center - support);
+            float sum = 0;
+            for(uint32_t t = 0; t < taps.tapCount; t++)
+            {
+                int32_t src = first + (int32_t)t;
+                float weight;
+                if(filter == MipFilter::Box)
+                {
+                    // The overlap between the source texel and the destination texel's footprint
+                    weight = std::max(0.0f, std::min(center + support, (float)src + 1) - std::max(center - support, (float)src));
+                }
+                else
+                {
+                    weight = evalKaiser(((float)src + 0.5f - center) / scale);
+                }
+
+                taps.index[dst * taps.tapCount + t] = (uint32_t)clamp(src, 0, (int32_t)srcSize - 1);
+                taps.weight[dst * taps.tapCount + t] = weight;
+                sum += weight;
+            }
+
+            for(uint32_t t = 0; t < taps.tapCount; t++)
+            {
+                taps.weight[dst * taps.tapCount + t] /= sum;
+            }
+        }
+        return taps;
+    }
+
+    struct MipLevelDesc
+    {
+        MipFormatDesc format;
+        const uint8_t* pSrc;
+        uint32_t srcWidth;
+        uint8_t* pDst;
+        uint32_t dstWidth;
+        const MipFilterTaps* pTapsX;
+        const MipFilterTaps* pTapsY;
+        int32_t alphaTestChannel;   // -1 if the alpha-test isn't used
+        float* pAlphaTest;          // Receives the alpha-test channel of every destination texel, before quantization
+    };
+
+    // Returns a 32-byte aligned row inside the vector, with room for 'floatCount' floats
+    static float* allocAlignedRow(std::vector<float>& storage, size_t floatCount)
+    {
+        storage.assign(floatCount + 8, 0.0f);
+        return (float*)align_to(32, (uintptr_t)storage.data());
+    }
+
+    template<typename Ops>
+    static void downsampleMipRows(const MipLevelDesc& level, uint32_t firstRow, uint32_t lastRow)
+    {
+        using Reg = typename Ops::Reg;
+
+        // Rows are filtered vertically and then horizontally. The decoded source rows are cached, since consecutive destination rows share most of their taps
+        const uint32_t tapsY = level.pTapsY->tapCount;
+        const uint32_t tapsX = level.pTapsX->tapCount;
+        const size_t rowFloats = align_to(8, (size_t)level.srcWidth * 4);
+        std::vector<std::vector<float>> cacheStorage(tapsY);
+        std::vector<float*> cache(tapsY);
+        std::vector<int64_t> cachedRow(tapsY, -1);
+        for(uint32_t i = 0; i < tapsY; i++)
+        {
+            cache[i] = allocAlignedRow(cacheStorage[i], rowFloats);
+        }
+        std::vector<float> accumStorage;
+        float* pAccum = allocAlignedRow(accumStorage, rowFloats);
+        alignas(16) float texel[4];
+
+        for(uint32_t y = firstRow; y < lastRow; y++)
+        {
+            for(size_t i = 0; i < rowFloats; i += Ops::kWidth)
+            {
+                Ops::store(pAccum + i, Ops::set1(0));
+            }
+
+            for(uint32_t t = 0; t < tapsY; t++)
+            {
+                float weight = level.pTapsY->weight[y * tapsY + t];
+                uint32_t srcY = level.pTapsY->index[y * tapsY + t];
+                if(weight == 0)
+                {
+                    continue;
+                }
+
+                // A destination row uses at most tapsY consecutive source rows, so they never share a slot
+                uint32_t slot = srcY % tapsY;
+                if(cachedRow[slot] != srcY)
+                {
+                    decodeMipRow(level.format, level.pSrc + (size_t)srcY * level.srcWidth * level.format.bytesPerPixel, level.srcWidth, cache[slot]);
+                    cachedRow[slot] = srcY;
+                }
+
+                const float* pRow = cache[slot];
+                Reg w = Ops::set1(weight);
+                for(size_t i = 0; i < rowFloats; i += Ops::kWidth)
+                {
+                    Ops::store(pAccum + i, Ops::add(Ops::load(pAccum + i), Ops::mul(w, Ops::load(pRow + i))));
+                }
+            }
+            Ops::finish();
+
+            // The horizontal pass works on one RGBA texel per register
+            uint8_t* pDst = level.pDst + (size_t)y * level.dstWidth * level.format.bytesPerPixel;
+            for(uint32_t x = 0; x < level.dstWidth; x++, pDst += level.format.bytesPerPixel)
+            {
+                SseOps::Reg sum = SseOps::set1(0);
+                for(uint32_t t = 0; t < tapsX; t++)
+                {
+                    const float* pTexel = pAccum + level.pTapsX->index[x * tapsX + t] * 4;
+                    sum = SseOps::add(sum, SseOps::mul(SseOps::set1(level.pTapsX->weight[x * tapsX + t]), SseOps::load(pTexel)));
+                }
+                SseOps::store(texel, sum);
+
+                for(uint32_t c = 0; c < 4; c++)
+                {
+                    encodeMipChannel(level.format, c, texel[c], pDst);
+                }
+
+                if(level.alphaTestChannel >= 0)
+                {
+                    level.pAlphaTest[(size_t)y * level.dstWidth + x] = clamp(texel[level.alphaTestChannel], 0.0f, 1.0f);
+                }
+            }
+        }
+    }
+
+    /** Get the fraction of the texels passing the alpha-test
+    */
+    static float computeAlphaTestCoverage(const MipFormatDesc& format, const uint8_t* pData, uint32_t width, uint32_t height, uint32_t channel, float alphaRef)
+    {
+        std::vector<float> row(width * 4);
+        uint64_t passCount = 0;
+        for(uint32_t y = 0; y < height; y++)
+        {
+            decodeMipRow(format, pData + (size_t)y * width * format.bytesPerPixel, width, row.data());
+            for(uint32_t x = 0; x < width; x++)
+            {
+                passCount += (row[x * 4 + channel] >= alphaRef) ? 1 : 0;
+            }
+        }
+        return (float)passCount / (float)((uint64_t)width * height);
+    }
+
+    /** Find the scale which makes the alpha-test coverage of a mip-level match the requested coverage
+        \param[in] alpha The alpha-test channel of the mip-level. The content is reordered
+    */
+    static float computeAlphaTestScale(std::vector<float>& alpha, float alphaRef, float coverage)
+    {
+        // The coverage after scaling by s is the fraction of texels with alpha >= alphaRef / s. Find the alpha value with the requested fraction above it
+        size_t passCount = (size_t)(coverage * (float)alpha.size() + 0.5f);
+        if(passCount == 0 || passCount > alpha.size())
+        {
+            return 1.0f;
+        }
+
+        auto threshold = alpha.end() - passCount;
+        std::nth_element(alpha.begin(), threshold, alpha.end());
+        return (*threshold > 0) ? alphaRef / *threshold : 1.0f;
+    }
+
+    bool isCpuMipGenerationSupported(ResourceFormat format)
+    {
+        MipFormatDesc desc;
+        return getMipFormatDesc(format, desc);
+    }
+
+    uint32_t generateMipChain(const void* pData, uint32_t width, uint32_t height, ResourceFormat format, const MipGenDesc& desc, std::vector<uint8_t>& mipChain)
+    {
+        MipLevelDesc level;
+        if(getMipFormatDesc(format, level.format) == false)
+        {
+            logError("generateMipChain() - unsupported format " + to_string(format));
+            return 0;
+        }
+
+        unsigned long bits;
+        _BitScanReverse(&bits, width | height);
+        const uint32_t mipCount = (uint32_t)bits + 1;
+        const uint32_t bytesPerPixel = level.format.bytesPerPixel;
+
+        std::vector<size_t> mipOffset(mipCount + 1, 0);
+        for(uint32_t mip = 0; mip < mipCount; mip++)
+        {
+            mipOffset[mip + 1] = mipOffset[mip] + (size_t)std::max(1u, width >> mip) * std::max(1u, height >> mip) * bytesPerPixel;
+        }
+        mipChain.assign(mipOffset[mipCount], 0);
+        memcpy(mipChain.data(), pData, mipOffset[1]);
+
+        const bool useAlphaTest = (desc.alphaTestRef > 0) && (desc.alphaTestChannel < 4) && (level.format.offset[desc.alphaTestChannel] >= 0);
+        level.alphaTestChannel = useAlphaTest ? (int32_t)desc.alphaTestChannel : -1;
+        const float coverage = useAlphaTest ? computeAlphaTestCoverage(level.format, mipChain.data(), width, height, desc.alphaTestChannel, desc.alphaTestRef) : 0;
+        const bool useAvx = isAvxSupported();
+        std::vector<float> alphaTest;
+
+        for(uint32_t mip = 1; mip < mipCount; mip++)
+        {
+            uint32_t srcWidth = std::max(1u, width >> (mip - 1));
+            uint32_t srcHeight = std::max(1u, height >> (mip - 1));
+            uint32_t dstWidth = std::max(1u, width >> mip);
+            uint32_t dstHeight = std::max(1u, height >> mip);
+
+            MipFilterTaps tapsX = computeMipFilterTaps(srcWidth, dstWidth, desc.filter);
+            MipFilterTaps tapsY = computeMipFilterTaps(srcHeight, dstHeight, desc.filter);
+            alphaTest.resize(useAlphaTest ? (size_t)dstWidth * dstHeight : 0);
+
+            level.pSrc = mipChain.data() + mipOffset[mip - 1];
+            level.srcWidth = srcWidth;
+            level.pDst = mipChain.data() + mipOffset[mip];
+            level.dstWidth = dstWidth;
+            level.pTapsX = &tapsX;
+            level.pTapsY = &tapsY;
+            level.pAlphaTest = alphaTest.data();
+
+            // Every chunk decodes its first rows again, so keep them reasonably large
+            const uint32_t rowsPerChunk = std::max(4u, 16384 / dstWidth);
+            JobSystem::parallelFor((dstHeight + rowsPerChunk - 1) / rowsPerChunk, [&](uint32_t chunk)
+            {
+                uint32_t firstRow = chunk * rowsPerChunk;
+                uint32_t lastRow = std::min(dstHeight, firstRow + rowsPerChunk);
+                if(useAvx)
+                {
+                    downsampleMipRows<AvxOps>(level, firstRow, lastRow);
+                }
+                else
+                {
+                    downsampleMipRows<SseOps>(level, firstRow, lastRow);
+                }
+            });
+
+            if(useAlphaTest)
+            {
+                // Write the scaled alpha-test channel. The values are read again since computeAlphaTestScale() reorders them
+                std::vector<float> sorted = alphaTest;
+                float scale = computeAlphaTestScale(sorted, desc.alphaTestRef, coverage);
+                for(size_t i = 0; i < alphaTest.size(); i++)
+                {
+                    encodeMipChannel(level.format, desc.alphaTestChannel, clamp(alphaTest[i] * scale, 0.0f, 1.0f), level.pDst + i * bytesPerPixel);
+                }
+            }
+        }
+
+        return mipCount;
+    }
+
+    /** Create a 2D texture. If a full mip-chain is requested, it is generated on the CPU when the format allows it, otherwise Texture::create2D() generates it on the GPU
+    */
+    static Texture::SharedPtr create2DTextureWithMips(uint32_t width, uint32_t height, ResourceFormat format, uint32_t arraySize, uint32_t mipLevels, const void* pData, Texture::BindFlags bindFlags, const MipGenDesc& mipDesc)
+    {
+        std::vector<uint8_t> mipChain;
+        if(mipLevels == Texture::kMaxPossible && arraySize == 1 && pData && isCpuMipGenerationSupported(format))
+        {
+            mipLevels = generateMipChain(pData, width, height, format, mipDesc, mipChain);
+            pData = mipChain.data();
+        }
+        return Texture::create2D(width, height, format, arraySize, mipLevels, pData, bindFlags);
+    }
+
+    Texture::SharedPtr createTextureFromDx10Dds(DdsData& ddsData, const std::string& filename, ResourceFormat format, uint32_t mipLevels, Texture::BindFlags bindFlags, const MipGenDesc& mipDesc)
     {
         uint32_t arraySize = ddsData.dx10Header.arraySize;
         assert(arraySize > 0);
@@ -590,21 +1134,21 @@ namespace Falcor
         switch(ddsData.dx10Header.resourceDimension)
         {
         case D3D10_RESOURCE_DIMENSION::D3D10_RESOURCE_DIMENSION_TEXTURE1D:
-            return Texture::create1D(ddsData.header.width, format, arraySize, mipLevels, ddsData.data.data(), bindFlags);
+            return Texture::create1D(ddsData.header.width, format, arraySize, mipLevels, ddsData.pData, bindFlags);
         case D3D10_RESOURCE_DIMENSION::D3D10_RESOURCE_DIMENSION_TEXTURE2D:
             if(ddsData.dx10Header.miscFlag & DdsHeaderDX10::kCubeMapMask)
             {
                 flipData(ddsData, format, ddsData.header.width, ddsData.header.height, 6 * arraySize, mipLevels == Texture::kMaxPossible ? 1 : mipLevels, true);
-                return Texture::createCube(ddsData.header.width, ddsData.header.height, format, arraySize, mipLevels, ddsData.data.data(), bindFlags);
+                return Texture::createCube(ddsData.header.width, ddsData.header.height, format, arraySize, mipLevels, ddsData.pData, bindFlags);
             }
             else
             {
                 flipData(ddsData, format, ddsData.header.width, ddsData.header.height, arraySize, mipLevels == Texture::kMaxPossible ? 1 : mipLevels);
-                return Texture::create2D(ddsData.header.width, ddsData.header.height, format, arraySize, mipLevels, ddsData.data.data(), bindFlags);
+                return create2DTextureWithMips(ddsData.header.width, ddsData.header.height, format, arraySize, mipLevels, ddsData.pData, bindFlags, mipDesc);
             }
         case D3D10_RESOURCE_DIMENSION::D3D10_RESOURCE_DIMENSION_TEXTURE3D:
-            flipData(ddsData, format, ddsData.header.width, ddsData.header.height, ddsData.header.depth, mipLevels == Texture::kMaxPossible ? 1 : mipLevels);
-            return Texture::create3D(ddsData.header.width, ddsData.header.height, ddsData.header.depth, format, mipLevels, ddsData.data.data(), bindFlags);
+            flipData(ddsData, format, ddsData.header.width, ddsData.header.height, ddsData.header.depth, mipLevels == Texture::kMaxPossible ? 1 : mipLevels, false, true);
+            return Texture::create3D(ddsData.header.width, ddsData.header.height, ddsData.header.depth, format, mipLevels, ddsData.pData, bindFlags);
         case D3D10_RESOURCE_DIMENSION::D3D10_RESOURCE_DIMENSION_BUFFER:
         case D3D10_RESOURCE_DIMENSION::D3D10_RESOURCE_DIMENSION_UNKNOWN:
             //these file formats are not supported 
@@ -615,61 +1159,67 @@ namespace Falcor
         }
     }
 
-    Texture::SharedPtr createTextureFromLegacyDds(DdsData& ddsData, const std::string& filename, ResourceFormat format, uint32_t mipLevels, Texture::BindFlags bindFlags)
+    Texture::SharedPtr createTextureFromLegacyDds(DdsData& ddsData, const std::string& filename, ResourceFormat format, uint32_t mipLevels, Texture::BindFlags bindFlags, const MipGenDesc& mipDesc)
     {
         //load the volume or 3D texture
         if(ddsData.header.flags & DdsHeader::kDepthMask)
         {
-            flipData(ddsData, format, ddsData.header.width, ddsData.header.height, ddsData.header.depth, mipLevels == Texture::kMaxPossible ? 1 : mipLevels);
-            return Texture::create3D(ddsData.header.width, ddsData.header.height, ddsData.header.depth, format, mipLevels, ddsData.data.data(), bindFlags);
+            flipData(ddsData, format, ddsData.header.width, ddsData.header.height, ddsData.header.depth, mipLevels == Texture::kMaxPossible ? 1 : mipLevels, false, true);
+            return Texture::create3D(ddsData.header.width, ddsData.header.height, ddsData.header.depth, format, mipLevels, ddsData.pData, bindFlags);
         }
         //load the cubemap texture
         else if(ddsData.header.caps[1] & DdsHeader::kCaps2CubeMapMask)
         {
-            return Texture::createCube(ddsData.header.width, ddsData.header.height, format, 1, mipLevels, ddsData.data.data(), bindFlags);
+            return Texture::createCube(ddsData.header.width, ddsData.header.height, format, 1, mipLevels, ddsData.pData, bindFlags);
         }
         //This is a 2D Texture
         else
         {
             flipData(ddsData, format, ddsData.header.width, ddsData.header.height, 1, mipLevels == Texture::kMaxPossible ? 1 : mipLevels);
-            return Texture::create2D(ddsData.header.width, ddsData.header.height, format, 1, mipLevels, ddsData.data.data(), bindFlags);
+            return create2DTextureWithMips(ddsData.header.width, ddsData.header.height, format, 1, mipLevels, ddsData.pData, bindFlags, mipDesc);
         }
 
         should_not_get_here();
         return nullptr;
     }
 
-	Texture::SharedPtr createTextureFromDDSFile(const std::string filename, bool generateMips, Texture::BindFlags bindFlags)
+	Texture::SharedPtr createTextureFromDDSFile(const std::string filename, bool generateMips, Texture::BindFlags bindFlags, const MipGenDesc& mipDesc)
 	{
 		DdsData ddsData;
-		loadDDSDataFromFile(filename, ddsData);
+		if (loadDDSDataFromFile(filename, ddsData) == false)
+		{
+			return nullptr;
+		}
 		
 		ResourceFormat format = getDdsResourceFormat(ddsData);
 		assert(format != ResourceFormat::Unknown);
 
-		uint32_t mipLevels;
-		if (generateMips)
+		uint32_t mipLevels = (ddsData.header.flags & DdsHeader::kMipCountMask) ? max(ddsData.header.mipCount, 1U) : 1;
+		if (getDdsDataSize(ddsData, format, mipLevels) > ddsData.dataSize)
 		{
-			mipLevels = Texture::kMaxPossible;
-		} 
-		else
+			logError(std::string("The dds file ") + filename + std::string(" doesn't contain enough data for the texture described by its header"));
+			return nullptr;
+		}
+
+		if (generateMips && mipLevels == 1)
 		{
-			mipLevels = (ddsData.header.flags & DdsHeader::kMipCountMask) ? max(ddsData.header.mipCount, 1U) : 1;
+			// Only generate the mip-chain if the file doesn't contain one
+			mipLevels = Texture::kMaxPossible;
 		}
 	
 		if (ddsData.hasDX10Header)
 		{
-            return createTextureFromDx10Dds(ddsData, filename, format, mipLevels, bindFlags);
+            return createTextureFromDx10Dds(ddsData, filename, format, mipLevels, bindFlags, mipDesc);
 		}
 		else
 		{
-            return createTextureFromLegacyDds(ddsData, filename, format, mipLevels, bindFlags);
+            return createTextureFromLegacyDds(ddsData, filename, format, mipLevels, bindFlags, mipDesc);
 		}
 		
 		return nullptr;
 	}
 
-	Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+	Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags, const MipGenDesc& mipDesc)
     {
 #define no_srgb()   \
     if(loadAsSrgb)  \
@@ -679,7 +1229,7 @@ namespace Falcor
 			
 		if (hasSuffix(filename, ".dds"))
 		{
-			return createTextureFromDDSFile(filename, generateMipLevels, bindFlags);
+			return createTextureFromDDSFile(filename, generateMipLevels, bindFlags, mipDesc);
 		}
 
         Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(filename, kTopDown);
@@ -687,16 +1237,26 @@ namespace Falcor
 
         if(pBitmap)
         {
-            ResourceFormat texFormat = pBitmap->getFormat();
-            if(loadAsSrgb)
-            {
-                texFormat = linearToSrgbFormat(texFormat);
-            }
-
-            pTex = Texture::create2D(pBitmap->getWidth(), pBitmap->getHeight(), texFormat, 1, generateMipLevels ? Texture::kMaxPossible : 1, pBitmap->getData(), bindFlags);
+            pTex = createTextureFromBitmap(pBitmap.get(), generateMipLevels, loadAsSrgb, bindFlags, mipDesc);
             pTex->setSourceFilename(stripDataDirectories(filename));
         }
         return pTex;
     }
 #undef no_srgb
+
+    Bitmap::AsyncLoadHandle decodeTextureFileAsync(const std::string& filename)
+    {
+        return Bitmap::createFromFileAsync(filename, kTopDown);
+    }
+
+    Texture::SharedPtr createTextureFromBitmap(const Bitmap* pBitmap, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags, const MipGenDesc& mipDesc)
+    {
+        ResourceFormat texFormat = pBitmap->getFormat();
+        if(loadAsSrgb)
+        {
+            texFormat = linearToSrgbFormat(texFormat);
+        }
+
+        return create2DTextureWithMips(pBitmap->getWidth(), pBitmap->getHeight(), texFormat, 1, generateMipLevels ? Texture::kMaxPossible : 1, pBitmap->getData(), bindFlags, mipDesc);
+    }
 }
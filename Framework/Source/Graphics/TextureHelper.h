@@ -27,7 +27,9 @@
 ***************************************************************************/
 #pragma once
 #include <string>
+#include <vector>
 #include "API/Texture.h"
+#include "Utils/Bitmap.h"
 namespace Falcor
 {
     /*!
@@ -35,13 +37,61 @@ namespace Falcor
     *  @{
     */
 
+    /** Filter used to generate mip-levels on the CPU
+    */
+    enum class MipFilter
+    {
+        Box,        ///< Average of the texels covered by the destination texel
+        Kaiser,     ///< Kaiser-windowed sinc. Sharper than the box filter, but can ring around hard edges
+    };
+
+    /** Options for the CPU mip-chain generation
+    */
+    struct MipGenDesc
+    {
+        MipFilter filter = MipFilter::Box;
+        float alphaTestRef = 0;             ///< If larger than 0, the alpha-test channel of every mip-level is scaled so that the fraction of texels passing the alpha-test (value >= alphaTestRef) matches the top level
+        uint32_t alphaTestChannel = 3;      ///< The channel used by the alpha-test. Note that material alpha maps are sampled from the first channel
+    };
+
     /** create a new texture from an a file
         \param[in] Filename Filename
+        \param[in] generateMipLevels true is mip-chain should be generated, otherwise false. If the file doesn't contain mip-levels they are generated on the CPU when the format allows it, otherwise by Texture::generateMips()
+        \param[in] loadAsSrgb Load the texture using sRGB format. Only valid for 3/4 component textures.
+        \param[in] bindFlags The bind flags to create the texture with
+        \param[in] mipDesc Options for the CPU mip-chain generation
+    */
+	Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource, const MipGenDesc& mipDesc = MipGenDesc());
+
+    /** Start decoding an image file on the JobSystem workers. The bitmap has the row order createTextureFromBitmap() expects.
+        \param[in] filename Filename. DDS files are not supported
+        \return A handle to pass to Bitmap::waitForLoad()
+    */
+    Bitmap::AsyncLoadHandle decodeTextureFileAsync(const std::string& filename);
+
+    /** create a new 2D texture from a bitmap. Together with decodeTextureFileAsync() it allows decoding many image files concurrently
+        \param[in] pBitmap The bitmap, loaded by decodeTextureFileAsync()
         \param[in] generateMipLevels true is mip-chain should be generated, otherwise false
         \param[in] loadAsSrgb Load the texture using sRGB format. Only valid for 3/4 component textures.
         \param[in] bindFlags The bind flags to create the texture with
+        \param[in] mipDesc Options for the CPU mip-chain generation
+    */
+    Texture::SharedPtr createTextureFromBitmap(const Bitmap* pBitmap, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource, const MipGenDesc& mipDesc = MipGenDesc());
+
+    /** Check if generateMipChain() supports a format. Supports the 8-bit unorm R, RG, RGBA, BGRA and BGRX formats (including sRGB) and the 32-bit float formats
+    */
+    bool isCpuMipGenerationSupported(ResourceFormat format);
+
+    /** Generate a full mip-chain on the CPU. sRGB formats are filtered in linear space. The rows of every level are distributed between the JobSystem workers.
+        \param[in] pData The top mip-level, tightly packed
+        \param[in] width The width of the top mip-level
+        \param[in] height The height of the top mip-level
+        \param[in] format The texture format. See isCpuMipGenerationSupported()
+        \param[in] desc Generation options
+        \param[out] mipChain Receives all the mip-levels, starting with a copy of the top level, in the layout expected by Texture::create2D()
+        \return The number of mip-levels, or 0 if the format isn't supported
     */
-	Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
+    uint32_t generateMipChain(const void* pData, uint32_t width, uint32_t height, ResourceFormat format, const MipGenDesc& desc, std::vector<uint8_t>& mipChain);
     
     /*! @} */
 }
\ No newline at end of file
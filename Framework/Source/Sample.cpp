@@ -35,6 +35,7 @@
 #include "API/FBO.h"
 #include "VR\OpenVR\VRSystem.h"
 #include "Utils\ProgressBar.h"
+#include "Graphics/Material/TextureResidencyManager.h"
 #include <sstream>
 #include <iomanip>
 
@@ -237,6 +238,7 @@ namespace Falcor
         pBar = nullptr;
         mpWindow->msgLoop();
 
+        Bitmap::waitForAsyncSaves();
         onShutdown();
         Logger::shutdown();
     }
@@ -358,6 +360,7 @@ namespace Falcor
             PROFILE(present);
             gpDevice->present();
         }
+        TextureResidencyManager::endFrame();
     }
 
     void Sample::captureScreen()
@@ -371,7 +374,8 @@ namespace Falcor
         if (findAvailableFilename(prefix, executableDir, "png", pngFile))
         {
             Texture::SharedPtr pTexture = gpDevice->getSwapChainFbo()->getColorTexture(0);
-            pTexture->captureToFile(0, 0, pngFile);
+            // Encode on the job system, so the screenshot doesn't stall the frame loop
+            pTexture->captureToFile(0, 0, pngFile, Bitmap::FileFormat::PngFile, Bitmap::ExportFlags::None, true);
         }
         else
         {
@@ -27,6 +27,8 @@
 ***************************************************************************/
 #pragma once
 #include <fstream>
+#include <cstring>
+#include "Utils/OS.h"
 
 namespace Falcor
 {    
@@ -38,7 +40,9 @@ namespace Falcor
             Read    = 0x1,
             Write   = 0x2,
 
-            ReadWrite = 0x3
+            ReadWrite = 0x3,
+
+            MappedRead = 0x4,   ///< Read-only, the file is mapped into memory. Enables readSpan()
         };
 
         BinaryFileStream() {};
@@ -47,6 +51,24 @@ namespace Falcor
             open(filename, mode);
         }
 
+        /** Create a read-only view of a memory-mapped stream. The view has its own read position but shares the mapping, so several views can be read concurrently.
+            The view must not outlive the stream it was created from.
+            \param[in] mappedStream A stream opened with Mode::MappedRead
+            \param[in] offset Initial read position
+        */
+        BinaryFileStream(const BinaryFileStream& mappedStream, uint64_t offset)
+        {
+            assert(mappedStream.mIsMapped);
+            mFilename = mappedStream.mFilename;
+            mMode = Mode::MappedRead;
+            mIsMapped = true;
+            mOwnsMapping = false;
+            mMappedFile.pData = mappedStream.mMappedFile.pData;
+            mMappedFile.size = mappedStream.mMappedFile.size;
+            mMappedFail = mappedStream.mMappedFail;
+            seek(offset);
+        }
+
         ~BinaryFileStream()
         {
             close();
@@ -54,47 +76,150 @@ namespace Falcor
 
         void open(const std::string& filename, Mode mode = Mode::ReadWrite)
         { 
+            mFilename = filename;
+            mMode = mode;
+            mIsMapped = (mode == Mode::MappedRead);
+            mOwnsMapping = mIsMapped;
+            if(mIsMapped)
+            {
+                mMappedOffset = 0;
+                mMappedEof = false;
+                mMappedFail = (mapFileToMemory(filename, mMappedFile) == false);
+                return;
+            }
+
             std::ios::openmode iosMode = std::ios::binary;
             iosMode |= ((mode == Mode::Read) || (mode == Mode::ReadWrite)) ? std::ios::in : 0;
             iosMode |= ((mode == Mode::Write) || (mode == Mode::ReadWrite))? std::ios::out : 0;
             mStream.open(filename.c_str(), iosMode);
-            mFilename = filename;
         }
 
         void close()
         {
+            if(mIsMapped)
+            {
+                if(mOwnsMapping)
+                {
+                    unmapFileFromMemory(mMappedFile);
+                }
+                mMappedFile = MappedFile();
+                mMappedOffset = 0;
+                return;
+            }
             mStream.close();
         }
 
-        void skip(uint32_t count)
+        void skip(uint64_t count)
         {
+            if(mIsMapped)
+            {
+                readSpan(count);
+                return;
+            }
             mStream.ignore(count);
         }
 
         void remove()
         {
-            if(mStream.is_open())
+            if(mIsMapped || mStream.is_open())
             {
                 close();
             }
             std::remove(mFilename.c_str());
         }
 
-		uint32_t getRemainingStreamSize()
-		{	
-			std::streamoff currentPos = mStream.tellg();
-			mStream.seekg(0, mStream.end);
-			std::streamoff length = mStream.tellg();
-			mStream.seekg(currentPos);
-			return (uint32_t)(length - currentPos); 
-		}
+        /** Get the current position in bytes from the start of the file. For write-only streams this is the write position, otherwise the read position.
+        */
+        uint64_t getPosition()
+        {
+            if(mIsMapped)
+            {
+                return mMappedOffset;
+            }
+            return (uint64_t)((mMode == Mode::Write) ? mStream.tellp() : mStream.tellg());
+        }
 
-        bool isGood() { return mStream.good(); }
-        bool isBad()  { return mStream.bad(); }
-        bool isFail() { return mStream.fail(); }
-        bool isEof() { return mStream.eof(); }
+        /** Move the read and write positions to an absolute byte offset from the start of the file.
+        */
+        void seek(uint64_t offset)
+        {
+            if(mIsMapped)
+            {
+                if(offset > mMappedFile.size)
+                {
+                    mMappedFail = true;
+                    return;
+                }
+                mMappedOffset = offset;
+                mMappedEof = false;
+                return;
+            }
+            mStream.clear();
+            if(mMode != Mode::Write)
+            {
+                mStream.seekg((std::streamoff)offset);
+            }
+            if(mMode != Mode::Read)
+            {
+                mStream.seekp((std::streamoff)offset);
+            }
+        }
 
-        BinaryFileStream& read(void* pData, size_t Count) { mStream.read((char*)pData, Count); return *this; }
+        uint64_t getRemainingStreamSize()
+        {
+            if(mIsMapped)
+            {
+                return mMappedFile.size - mMappedOffset;
+            }
+            std::streamoff currentPos = mStream.tellg();
+            mStream.seekg(0, mStream.end);
+            std::streamoff length = mStream.tellg();
+            mStream.seekg(currentPos);
+            return (uint64_t)(length - currentPos); 
+        }
+
+        bool isMapped() const { return mIsMapped; }
+        bool isGood() { return mIsMapped ? (mMappedFail == false) : mStream.good(); }
+        bool isBad()  { return mIsMapped ? false : mStream.bad(); }
+        bool isFail() { return mIsMapped ? mMappedFail : mStream.fail(); }
+        bool isEof() { return mIsMapped ? mMappedEof : mStream.eof(); }
+
+        /** Get a pointer to the next 'count' bytes of a mapped stream and advance past them. No data is copied.
+            The pointer stays valid until the stream is closed. The data is not guaranteed to be aligned.
+            \return A pointer into the mapping, or nullptr if the stream is not mapped or doesn't have enough data left. In the latter case the stream enters the fail state
+        */
+        const uint8_t* readSpan(uint64_t count)
+        {
+            if(mIsMapped == false || mMappedFail)
+            {
+                return nullptr;
+            }
+            if(count > mMappedFile.size - mMappedOffset)
+            {
+                mMappedOffset = mMappedFile.size;
+                mMappedEof = true;
+                mMappedFail = true;
+                return nullptr;
+            }
+            const uint8_t* pData = mMappedFile.pData + mMappedOffset;
+            mMappedOffset += count;
+            return pData;
+        }
+
+        BinaryFileStream& read(void* pData, size_t Count)
+        {
+            if(mIsMapped)
+            {
+                const uint8_t* pSrc = readSpan(Count);
+                if(pSrc)
+                {
+                    std::memcpy(pData, pSrc, Count);
+                }
+                return *this;
+            }
+            mStream.read((char*)pData, Count);
+            return *this;
+        }
 
         BinaryFileStream& write(const void* pData, size_t Count) { mStream.write((char*)pData, Count); return *this; }
 
@@ -107,5 +232,13 @@ namespace Falcor
     private:
         std::fstream mStream;
         std::string mFilename;
+        Mode mMode = Mode::ReadWrite;
+
+        bool mIsMapped = false;
+        bool mOwnsMapping = false;
+        MappedFile mMappedFile;
+        uint64_t mMappedOffset = 0;
+        bool mMappedEof = false;
+        bool mMappedFail = false;
     };
 }
\ No newline at end of file
@@ -29,6 +29,10 @@
 #include "Bitmap.h"
 #include "FreeImage.h"
 #include "OS.h"
+#include "JobSystem.h"
+#include "Math/SimdOps.h"
+#include <deque>
+#include <mutex>
 
 namespace Falcor
 {
@@ -39,6 +43,53 @@ namespace Falcor
         return nullptr;
     }
 
+    static void expandBgrToBgrx(const uint8_t* pSrc, uint8_t* pDst, uint32_t width)
+    {
+        uint32_t x = 0;
+        if(isSsse3Supported())
+        {
+            // Every iteration expands 4 pixels, but reads 16 bytes. Stop before reading past the end of the row
+            const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+            const __m128i alpha = _mm_set1_epi32(0xFF000000);
+            for(; (x + 4) * 3 + 4 <= width * 3; x += 4)
+            {
+                __m128i bgr = _mm_loadu_si128((const __m128i*)(pSrc + x * 3));
+                __m128i bgrx = _mm_or_si128(_mm_shuffle_epi8(bgr, shuffle), alpha);
+                _mm_storeu_si128((__m128i*)(pDst + x * 4), bgrx);
+            }
+        }
+
+        for(; x < width; x++)
+        {
+            pDst[x * 4 + 0] = pSrc[x * 3 + 0];
+            pDst[x * 4 + 1] = pSrc[x * 3 + 1];
+            pDst[x * 4 + 2] = pSrc[x * 3 + 2];
+            pDst[x * 4 + 3] = 0xff;
+        }
+    }
+
+    static void swapRedBlueSetAlpha(uint32_t* pPixels, size_t count)
+    {
+        size_t i = 0;
+        const __m128i byteMask = _mm_set1_epi32(0xFF);
+        const __m128i greenMask = _mm_set1_epi32(0xFF00);
+        const __m128i alpha = _mm_set1_epi32(0xFF000000);
+        for(; i + 4 <= count; i += 4)
+        {
+            __m128i rgba = _mm_loadu_si128((const __m128i*)(pPixels + i));
+            __m128i red = _mm_slli_epi32(_mm_and_si128(rgba, byteMask), 16);
+            __m128i blue = _mm_and_si128(_mm_srli_epi32(rgba, 16), byteMask);
+            __m128i bgra = _mm_or_si128(_mm_or_si128(red, blue), _mm_or_si128(_mm_and_si128(rgba, greenMask), alpha));
+            _mm_storeu_si128((__m128i*)(pPixels + i), bgra);
+        }
+
+        for(; i < count; i++)
+        {
+            uint32_t p = pPixels[i];
+            pPixels[i] = ((p & 0xFF) << 16) | ((p >> 16) & 0xFF) | (p & 0xFF00) | 0xFF000000;
+        }
+    }
+
     Bitmap::UniqueConstPtr Bitmap::createFromFile(const std::string& filename, bool isTopDown)
     {
         std::string fullpath;
@@ -116,23 +167,67 @@ namespace Falcor
             return nullptr;
         }
 
-        // Convert the image to RGBX image
-        if(bpp == 24)
+        // Copy the scanlines. FreeImage stores the image bottom-up, and 24-bit images are expanded to BGRX
+        const uint32_t dstBytesPerPixel = (bpp == 24) ? 4 : bpp / 8;
+        const size_t dstPitch = (size_t)pBmp->mWidth * dstBytesPerPixel;
+        pBmp->mpData = new uint8_t[pBmp->mHeight * dstPitch];
+        for(uint32_t y = 0; y < pBmp->mHeight; y++)
         {
-            bpp = 32;
-            auto pNew = FreeImage_ConvertTo32Bits(pDib);
-            FreeImage_Unload(pDib);
-            pDib = pNew;
+            const uint8_t* pSrc = FreeImage_GetScanLine(pDib, isTopDown ? pBmp->mHeight - y - 1 : y);
+            uint8_t* pDst = pBmp->mpData + y * dstPitch;
+            if(bpp == 24)
+            {
+                expandBgrToBgrx(pSrc, pDst, pBmp->mWidth);
+            }
+            else
+            {
+                memcpy(pDst, pSrc, dstPitch);
+            }
         }
-        uint32_t bytesPerPixel = bpp / 8;
-
-        pBmp->mpData = new uint8_t[pBmp->mHeight * pBmp->mWidth * bytesPerPixel];
-        FreeImage_ConvertToRawBits(pBmp->mpData, pDib, pBmp->mWidth * bytesPerPixel, bpp, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, isTopDown);
 
         FreeImage_Unload(pDib);
         return UniqueConstPtr(pBmp);
     }
 
+    struct Bitmap::AsyncLoad
+    {
+        JobSystem::JobHandle pJob;
+        UniqueConstPtr pBitmap;
+    };
+
+    Bitmap::AsyncLoadHandle Bitmap::createFromFileAsync(const std::string& filename, bool isTopDown)
+    {
+        AsyncLoadHandle pLoad = std::make_shared<AsyncLoad>();
+        // The job holds a weak reference, since the handle references the job. If the handle was released, the result is dropped
+        std::weak_ptr<AsyncLoad> pWeakLoad = pLoad;
+        pLoad->pJob = JobSystem::run([pWeakLoad, filename, isTopDown]()
+        {
+            UniqueConstPtr pBitmap = createFromFile(filename, isTopDown);
+            AsyncLoadHandle pLoad = pWeakLoad.lock();
+            if(pLoad)
+            {
+                pLoad->pBitmap = std::move(pBitmap);
+            }
+        });
+        return pLoad;
+    }
+
+    Bitmap::UniqueConstPtr Bitmap::waitForLoad(const AsyncLoadHandle& pLoad)
+    {
+        JobSystem::wait(pLoad->pJob);
+        return std::move(pLoad->pBitmap);
+    }
+
+    std::vector<Bitmap::UniqueConstPtr> Bitmap::createFromFiles(const std::vector<std::string>& filenames, bool isTopDown)
+    {
+        std::vector<UniqueConstPtr> bitmaps(filenames.size());
+        JobSystem::parallelFor((uint32_t)filenames.size(), [&](uint32_t i)
+        {
+            bitmaps[i] = createFromFile(filenames[i], isTopDown);
+        });
+        return bitmaps;
+    }
+
     Bitmap::~Bitmap()
     {
         delete[] mpData;
@@ -189,18 +284,10 @@ namespace Falcor
         FIBITMAP* pImage;
         uint32_t bytesPerPixel = getFormatBytesPerBlock(resourceFormat);
 
-        //TODO replace this code for swapping channels. Can't use freeimage masks b/c they only care about 16 bpp images
-        //issue #74 in gitlab
+        // FreeImage expects BGRA. Can't use FreeImage masks b/c they only care about 16 bpp images
         if (resourceFormat == ResourceFormat::RGBA8Uint || resourceFormat == ResourceFormat::RGBA8Snorm || resourceFormat == ResourceFormat::RGBA8UnormSrgb)
         {
-            for (uint32_t a = 0; a < width*height; a++)
-            {
-                uint32_t* pPixel = (uint32_t*)pData;
-                pPixel += a;
-                uint8_t* ch = (uint8_t*)pPixel;
-                std::swap(ch[0], ch[2]);                
-                ch[3] = 0xff;
-            }
+            swapRedBlueSetAlpha((uint32_t*)pData, (size_t)width * height);
         }
         if (fileFormat == Bitmap::FileFormat::PngFile)
         {
@@ -325,4 +412,76 @@ namespace Falcor
         FreeImage_Save(toFreeImageFormat(fileFormat), pImage, filename.c_str(), flags);
         FreeImage_Unload(pImage);
     }
-}
\ No newline at end of file
+
+    // Limits the memory held by pending asynchronous saves. saveImageAsync() blocks until enough saves complete
+    static const size_t kMaxPendingSaveBytes = 256 * 1024 * 1024;
+
+    struct AsyncSaveData
+    {
+        struct PendingSave
+        {
+            JobSystem::JobHandle pJob;
+            size_t size;
+        };
+
+        std::mutex mutex;
+        std::deque<PendingSave> pending;
+        size_t pendingBytes = 0;
+    };
+
+    static AsyncSaveData& getAsyncSaveData()
+    {
+        static AsyncSaveData sData;
+        return sData;
+    }
+
+    static void waitForPendingSaves(size_t maxPendingBytes)
+    {
+        AsyncSaveData& data = getAsyncSaveData();
+        while(true)
+        {
+            JobSystem::JobHandle pJob;
+            {
+                std::lock_guard<std::mutex> lock(data.mutex);
+                while(data.pending.empty() == false && JobSystem::isFinished(data.pending.front().pJob))
+                {
+                    data.pendingBytes -= data.pending.front().size;
+                    data.pending.pop_front();
+                }
+
+                if(data.pendingBytes <= maxPendingBytes)
+                {
+                    return;
+                }
+                pJob = data.pending.front().pJob;
+            }
+
+            // Don't hold the lock while waiting. The thread executes other jobs in the meantime, which may save images as well
+            JobSystem::wait(pJob);
+        }
+    }
+
+    void Bitmap::saveImageAsync(const std::string& filename, uint32_t width, uint32_t height, FileFormat fileFormat, ExportFlags exportFlags, ResourceFormat resourceFormat, bool isTopDown, std::vector<uint8_t> data)
+    {
+        const size_t size = data.size();
+        waitForPendingSaves((size < kMaxPendingSaveBytes) ? kMaxPendingSaveBytes - size : 0);
+
+        auto pData = std::make_shared<std::vector<uint8_t>>(std::move(data));
+        JobSystem::JobHandle pJob = JobSystem::run([=]()
+        {
+            saveImage(filename, width, height, fileFormat, exportFlags, resourceFormat, isTopDown, pData->data());
+            // Release the buffer now. The job object is referenced until the save is retired
+            std::vector<uint8_t>().swap(*pData);
+        });
+
+        AsyncSaveData& saves = getAsyncSaveData();
+        std::lock_guard<std::mutex> lock(saves.mutex);
+        saves.pending.push_back({pJob, size});
+        saves.pendingBytes += size;
+    }
+
+    void Bitmap::waitForAsyncSaves()
+    {
+        waitForPendingSaves(0);
+    }
+}
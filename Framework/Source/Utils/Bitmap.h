@@ -26,7 +26,9 @@
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ***************************************************************************/
 #pragma once
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace Falcor
 {
@@ -60,6 +62,29 @@ namespace Falcor
             \return If loading was successful, a new object. Otherwise, nullptr.
         */
         static UniqueConstPtr createFromFile(const std::string& filename, bool isTopDown);
+
+        struct AsyncLoad;
+        using AsyncLoadHandle = std::shared_ptr<AsyncLoad>;
+
+        /** Start loading a file on the JobSystem workers. Decoding is CPU-bound, so loading many files this way scales with the number of cores.
+            \param[in] filename Filename, including a path. If the file can't be found relative to the current directory, Falcor will search for it in the common directories.
+            \param[in] isTopDown Control the memory layout of the image. If true, the top-left pixel is the first pixel in the buffer, otherwise the bottom-left pixel is first.
+            \return A handle to pass to waitForLoad()
+        */
+        static AsyncLoadHandle createFromFileAsync(const std::string& filename, bool isTopDown);
+
+        /** Wait for a load started by createFromFileAsync() to complete. The calling thread executes other jobs while waiting. The result can only be retrieved once.
+            \return If loading was successful, a new object. Otherwise, nullptr.
+        */
+        static UniqueConstPtr waitForLoad(const AsyncLoadHandle& pLoad);
+
+        /** Load a list of files concurrently
+            \param[in] filenames The files to load
+            \param[in] isTopDown Control the memory layout of the images
+            \return The loaded objects, in the order of the filenames. Entries of files which failed to load are nullptr.
+        */
+        static std::vector<UniqueConstPtr> createFromFiles(const std::vector<std::string>& filenames, bool isTopDown);
+
         /** Store a memory buffer to a PNG file.
             \param[in] filename Output filename. Can include a path - absolute or relative to the executable directory.
             \param[in] width The width of the image.
@@ -71,6 +96,16 @@ namespace Falcor
             \param[in] pData Pointer to the buffer containing the image
         */
         static void saveImage(const std::string& filename, uint32_t width, uint32_t height, FileFormat fileFormat, ExportFlags exportFlags, ResourceFormat resourceFormat, bool isTopDown, void* pData);
+
+        /** Store a memory buffer to a file on the JobSystem workers. Returns once the buffer was queued, so the calling thread doesn't wait for the encoding. If the queued images exceed a memory limit, the call blocks until enough of them are written.
+            The parameters are the same as in saveImage(), except that the function takes ownership of the image data.
+        */
+        static void saveImageAsync(const std::string& filename, uint32_t width, uint32_t height, FileFormat fileFormat, ExportFlags exportFlags, ResourceFormat resourceFormat, bool isTopDown, std::vector<uint8_t> data);
+
+        /** Wait for all the images queued by saveImageAsync() to be written
+        */
+        static void waitForAsyncSaves();
+
         ~Bitmap();
 
         /** Get a pointer to the bitmap's data store
@@ -0,0 +1,735 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "BlockCompressor.h"
+#include "Utils/JobSystem.h"
+#include "Utils/Math/SimdOps.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace Falcor
+{
+    // The texels of a block, one array per channel. Values are in [0, 255]
+    struct BlockTexels
+    {
+        alignas(32) float c[4][16];
+    };
+
+    // Channel layout of a source format. Missing channels are set to kConstant[channel]
+    struct SourceLayout
+    {
+        uint32_t bytesPerPixel;
+        int32_t offset[4];
+    };
+
+    static const float kConstant[4] = {0, 0, 0, 255};
+
+    static bool getSourceLayout(ResourceFormat format, SourceLayout& layout)
+    {
+        switch(format)
+        {
+        case ResourceFormat::R8Unorm:
+            layout = {1, {0, -1, -1, -1}};
+            return true;
+        case ResourceFormat::RG8Unorm:
+            layout = {2, {0, 1, -1, -1}};
+            return true;
+        case ResourceFormat::RGBA8Unorm:
+        case ResourceFormat::RGBA8UnormSrgb:
+            layout = {4, {0, 1, 2, 3}};
+            return true;
+        case ResourceFormat::BGRA8Unorm:
+        case ResourceFormat::BGRA8UnormSrgb:
+            layout = {4, {2, 1, 0, 3}};
+            return true;
+        case ResourceFormat::BGRX8Unorm:
+        case ResourceFormat::BGRX8UnormSrgb:
+            layout = {4, {2, 1, 0, -1}};
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    static uint32_t quantize(float value, uint32_t maxValue)
+    {
+        float q = value * (float)maxValue / 255.0f + 0.5f;
+        return (uint32_t)std::max(0.0f, std::min((float)maxValue, q));
+    }
+
+    static float clamp255(float value)
+    {
+        return std::max(0.0f, std::min(255.0f, value));
+    }
+
+    /** Find the principal axis of the block's colors using power iteration
+    */
+    static void computePrincipalAxis(const float* const* pChannels, uint32_t channelCount, float mean[4], float axis[4])
+    {
+        for(uint32_t c = 0; c < channelCount; c++)
+        {
+            float sum = 0;
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                sum += pChannels[c][i];
+            }
+            mean[c] = sum / 16.0f;
+        }
+
+        float cov[4][4] = {};
+        for(uint32_t i = 0; i < 16; i++)
+        {
+            for(uint32_t a = 0; a < channelCount; a++)
+            {
+                float da = pChannels[a][i] - mean[a];
+                for(uint32_t b = a; b < channelCount; b++)
+                {
+                    cov[a][b] += da * (pChannels[b][i] - mean[b]);
+                }
+            }
+        }
+
+        // Start from the channel with the largest variance
+        uint32_t maxChannel = 0;
+        for(uint32_t c = 0; c < channelCount; c++)
+        {
+            cov[c][c] += 1e-3f;     // Keeps the iteration stable for constant blocks
+            for(uint32_t b = 0; b < c; b++)
+            {
+                cov[c][b] = cov[b][c];
+            }
+            maxChannel = (cov[c][c] > cov[maxChannel][maxChannel]) ? c : maxChannel;
+        }
+
+        float v[4] = {};
+        for(uint32_t c = 0; c < channelCount; c++)
+        {
+            v[c] = cov[maxChannel][c];
+        }
+
+        for(uint32_t iter = 0; iter < 8; iter++)
+        {
+            float w[4] = {};
+            float lengthSq = 0;
+            for(uint32_t a = 0; a < channelCount; a++)
+            {
+                for(uint32_t b = 0; b < channelCount; b++)
+                {
+                    w[a] += cov[a][b] * v[b];
+                }
+                lengthSq += w[a] * w[a];
+            }
+
+            float invLength = 1.0f / std::sqrt(lengthSq);
+            for(uint32_t c = 0; c < channelCount; c++)
+            {
+                v[c] = w[c] * invLength;
+            }
+        }
+
+        for(uint32_t c = 0; c < channelCount; c++)
+        {
+            axis[c] = v[c];
+        }
+    }
+
+    /** Initialize the endpoints to the extents of the block's colors along the principal axis
+    */
+    static void initEndpoints(const float* const* pChannels, uint32_t channelCount, float e0[4], float e1[4])
+    {
+        float mean[4];
+        float axis[4];
+        computePrincipalAxis(pChannels, channelCount, mean, axis);
+
+        float minT = FLT_MAX;
+        float maxT = -FLT_MAX;
+        for(uint32_t i = 0; i < 16; i++)
+        {
+            float t = 0;
+            for(uint32_t c = 0; c < channelCount; c++)
+            {
+                t += (pChannels[c][i] - mean[c]) * axis[c];
+            }
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+
+        for(uint32_t c = 0; c < channelCount; c++)
+        {
+            e0[c] = clamp255(mean[c] + axis[c] * minT);
+            e1[c] = clamp255(mean[c] + axis[c] * maxT);
+        }
+    }
+
+    /** Select the closest palette entry for every texel
+        \param[in] pChannels The channels to compare
+        \param[in] palette The palette entries. palette[k][c] is channel c of entry k
+        \param[out] indices The index of the closest entry of every texel
+        \return The squared error
+    */
+    template<typename Ops>
+    static float fitIndices(const float* const* pChannels, uint32_t channelCount, const float palette[16][4], uint32_t paletteSize, uint8_t indices[16])
+    {
+        using Reg = typename Ops::Reg;
+        alignas(32) float bestIndex[16];
+        alignas(32) float bestError[16];
+
+        for(uint32_t v = 0; v < 16; v += Ops::kWidth)
+        {
+            Reg best = Ops::set1(FLT_MAX);
+            Reg index = Ops::set1(0);
+            for(uint32_t k = 0; k < paletteSize; k++)
+            {
+                Reg error = Ops::set1(0);
+                for(uint32_t c = 0; c < channelCount; c++)
+                {
+                    Reg d = Ops::sub(Ops::load(pChannels[c] + v), Ops::set1(palette[k][c]));
+                    error = Ops::add(error, Ops::mul(d, d));
+                }
+
+                Reg isBetter = Ops::cmpLt(error, best);
+                best = Ops::bitOr(Ops::bitAnd(isBetter, error), Ops::bitAndNot(isBetter, best));
+                index = Ops::bitOr(Ops::bitAnd(isBetter, Ops::set1((float)k)), Ops::bitAndNot(isBetter, index));
+            }
+            Ops::store(bestIndex + v, index);
+            Ops::store(bestError + v, best);
+        }
+
+        float totalError = 0;
+        for(uint32_t i = 0; i < 16; i++)
+        {
+            indices[i] = (uint8_t)bestIndex[i];
+            totalError += bestError[i];
+        }
+        return totalError;
+    }
+
+    /** Find the endpoints which minimize the squared error for the given indices
+        \param[in] weights The interpolation weight of every palette entry. Entry k is e0 * (1 - weights[k]) + e1 * weights[k]
+        \return false if the system is singular (all the texels use the same weight)
+    */
+    static bool refineEndpoints(const float* const* pChannels, uint32_t channelCount, const uint8_t indices[16], const float* weights, float e0[4], float e1[4])
+    {
+        float aa = 0, ab = 0, bb = 0;
+        float ax[4] = {};
+        float bx[4] = {};
+        for(uint32_t i = 0; i < 16; i++)
+        {
+            float t = weights[indices[i]];
+            float s = 1.0f - t;
+            aa += s * s;
+            ab += s * t;
+            bb += t * t;
+            for(uint32_t c = 0; c < channelCount; c++)
+            {
+                ax[c] += s * pChannels[c][i];
+                bx[c] += t * pChannels[c][i];
+            }
+        }
+
+        float det = aa * bb - ab * ab;
+        if(std::abs(det) < 1e-6f)
+        {
+            return false;
+        }
+
+        float invDet = 1.0f / det;
+        for(uint32_t c = 0; c < channelCount; c++)
+        {
+            e0[c] = clamp255((bb * ax[c] - ab * bx[c]) * invDet);
+            e1[c] = clamp255((aa * bx[c] - ab * ax[c]) * invDet);
+        }
+        return true;
+    }
+
+    static uint32_t getRefinementCount(BlockCompressor::Preset preset)
+    {
+        switch(preset)
+        {
+        case BlockCompressor::Preset::Fast:
+            return 0;
+        case BlockCompressor::Preset::Normal:
+            return 1;
+        case BlockCompressor::Preset::HighQuality:
+            return 4;
+        default:
+            should_not_get_here();
+            return 0;
+        }
+    }
+
+    // BC1 color block. Palette entries are sorted by weight, kBC1Codes maps them to the 2-bit codes (when color0 > color1)
+    static const float kBC1Weights[4] = {0, 1.0f / 3.0f, 2.0f / 3.0f, 1.0f};
+    static const uint32_t kBC1Codes[4] = {0, 2, 3, 1};
+
+    static uint16_t packColor565(const float e[4], float decoded[4])
+    {
+        uint32_t r = quantize(e[0], 31);
+        uint32_t g = quantize(e[1], 63);
+        uint32_t b = quantize(e[2], 31);
+        decoded[0] = (float)((r << 3) | (r >> 2));
+        decoded[1] = (float)((g << 2) | (g >> 4));
+        decoded[2] = (float)((b << 3) | (b >> 2));
+        return (uint16_t)((r << 11) | (g << 5) | b);
+    }
+
+    template<typename Ops>
+    static void encodeBC1Block(const BlockTexels& texels, uint32_t refinementCount, uint8_t* pBlock)
+    {
+        const float* pChannels[3] = {texels.c[0], texels.c[1], texels.c[2]};
+        float e0[4], e1[4];
+        initEndpoints(pChannels, 3, e0, e1);
+
+        float bestError = FLT_MAX;
+        uint16_t bestColor[2] = {0, 0};
+        uint8_t bestIndices[16] = {};
+        for(uint32_t iter = 0; iter <= refinementCount; iter++)
+        {
+            float q0[4], q1[4];
+            uint16_t color0 = packColor565(e0, q0);
+            uint16_t color1 = packColor565(e1, q1);
+
+            float palette[16][4];
+            for(uint32_t k = 0; k < 4; k++)
+            {
+                for(uint32_t c = 0; c < 3; c++)
+                {
+                    palette[k][c] = q0[c] + (q1[c] - q0[c]) * kBC1Weights[k];
+                }
+            }
+
+            uint8_t indices[16];
+            float error = fitIndices<Ops>(pChannels, 3, palette, (color0 == color1) ? 1 : 4, indices);
+            if(error < bestError)
+            {
+                bestError = error;
+                bestColor[0] = color0;
+                bestColor[1] = color1;
+                std::copy(indices, indices + 16, bestIndices);
+            }
+
+            if(iter == refinementCount || refineEndpoints(pChannels, 3, indices, kBC1Weights, e0, e1) == false)
+            {
+                break;
+            }
+        }
+
+        // The 4-color mode requires color0 > color1. Swapping the endpoints reverses the palette
+        bool swap = bestColor[0] < bestColor[1];
+        uint16_t color0 = swap ? bestColor[1] : bestColor[0];
+        uint16_t color1 = swap ? bestColor[0] : bestColor[1];
+        uint32_t codes = 0;
+        if(color0 != color1)
+        {
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                uint32_t k = swap ? 3 - bestIndices[i] : bestIndices[i];
+                codes |= kBC1Codes[k] << (2 * i);
+            }
+        }
+
+        pBlock[0] = (uint8_t)(color0 & 0xff);
+        pBlock[1] = (uint8_t)(color0 >> 8);
+        pBlock[2] = (uint8_t)(color1 & 0xff);
+        pBlock[3] = (uint8_t)(color1 >> 8);
+        for(uint32_t b = 0; b < 4; b++)
+        {
+            pBlock[4 + b] = (uint8_t)(codes >> (8 * b));
+        }
+    }
+
+    // BC4 block, using the 8-value mode. Palette entries are sorted by weight, the first and last ones are the endpoints
+    static const float kBC4Weights[8] = {0, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f, 1.0f};
+    static const uint32_t kBC4Codes[8] = {0, 2, 3, 4, 5, 6, 7, 1};
+
+    template<typename Ops>
+    static void encodeBC4Block(const BlockTexels& texels, uint32_t channel, uint32_t refinementCount, uint8_t* pBlock)
+    {
+        const float* pChannels[1] = {texels.c[channel]};
+        float e0[4] = {0}, e1[4] = {255};
+        for(uint32_t i = 0; i < 16; i++)
+        {
+            e0[0] = std::max(e0[0], pChannels[0][i]);
+            e1[0] = std::min(e1[0], pChannels[0][i]);
+        }
+
+        float bestError = FLT_MAX;
+        uint32_t bestValue[2] = {0, 0};
+        uint8_t bestIndices[16] = {};
+        for(uint32_t iter = 0; iter <= refinementCount; iter++)
+        {
+            // The 8-value mode requires value0 > value1
+            uint32_t value0 = quantize(e0[0], 255);
+            uint32_t value1 = quantize(e1[0], 255);
+            if(value0 < value1)
+            {
+                std::swap(value0, value1);
+            }
+
+            float palette[16][4];
+            for(uint32_t k = 0; k < 8; k++)
+            {
+                palette[k][0] = (float)value0 + ((float)value1 - (float)value0) * kBC4Weights[k];
+            }
+
+            uint8_t indices[16];
+            float error = fitIndices<Ops>(pChannels, 1, palette, (value0 == value1) ? 1 : 8, indices);
+            if(error < bestError)
+            {
+                bestError = error;
+                bestValue[0] = value0;
+                bestValue[1] = value1;
+                std::copy(indices, indices + 16, bestIndices);
+            }
+
+            if(iter == refinementCount || refineEndpoints(pChannels, 1, indices, kBC4Weights, e0, e1) == false)
+            {
+                break;
+            }
+        }
+
+        uint64_t codes = 0;
+        for(uint32_t i = 0; i < 16; i++)
+        {
+            codes |= (uint64_t)kBC4Codes[bestIndices[i]] << (3 * i);
+        }
+
+        pBlock[0] = (uint8_t)bestValue[0];
+        pBlock[1] = (uint8_t)bestValue[1];
+        for(uint32_t b = 0; b < 6; b++)
+        {
+            pBlock[2 + b] = (uint8_t)(codes >> (8 * b));
+        }
+    }
+
+    // BC7 mode 6: 7-bit RGBA endpoints with a p-bit each, and 4-bit indices
+    static const uint32_t kBC7Weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    struct BitWriter
+    {
+        uint64_t bits[2] = {0, 0};
+        uint32_t position = 0;
+
+        void write(uint32_t value, uint32_t count)
+        {
+            for(uint32_t i = 0; i < count; i++, position++)
+            {
+                bits[position / 64] |= (uint64_t)((value >> i) & 1) << (position % 64);
+            }
+        }
+    };
+
+    /** Quantize a mode 6 endpoint, selecting the p-bit with the smallest error
+    */
+    static void quantizeBC7Endpoint(const float e[4], uint32_t quantized[4], uint32_t& pBit)
+    {
+        float bestError = FLT_MAX;
+        for(uint32_t p = 0; p < 2; p++)
+        {
+            uint32_t q[4];
+            float error = 0;
+            for(uint32_t c = 0; c < 4; c++)
+            {
+                q[c] = std::min(127u, quantize(std::max(0.0f, e[c] - (float)p) * 0.5f, 255));
+                float d = (float)((q[c] << 1) | p) - e[c];
+                error += d * d;
+            }
+
+            if(error < bestError)
+            {
+                bestError = error;
+                pBit = p;
+                std::copy(q, q + 4, quantized);
+            }
+        }
+    }
+
+    template<typename Ops>
+    static void encodeBC7Block(const BlockTexels& texels, uint32_t refinementCount, uint8_t* pBlock)
+    {
+        const float* pChannels[4] = {texels.c[0], texels.c[1], texels.c[2], texels.c[3]};
+        float e0[4], e1[4];
+        initEndpoints(pChannels, 4, e0, e1);
+
+        float weights[16];
+        for(uint32_t k = 0; k < 16; k++)
+        {
+            weights[k] = (float)kBC7Weights4[k] / 64.0f;
+        }
+
+        float bestError = FLT_MAX;
+        uint32_t bestEndpoints[2][4] = {};
+        uint32_t bestPBits[2] = {0, 0};
+        uint8_t bestIndices[16] = {};
+        for(uint32_t iter = 0; iter <= refinementCount; iter++)
+        {
+            uint32_t q[2][4];
+            uint32_t pBits[2];
+            quantizeBC7Endpoint(e0, q[0], pBits[0]);
+            quantizeBC7Endpoint(e1, q[1], pBits[1]);
+
+            // Interpolate exactly like the decoder
+            float palette[16][4];
+            for(uint32_t c = 0; c < 4; c++)
+            {
+                uint32_t v0 = (q[0][c] << 1) | pBits[0];
+                uint32_t v1 = (q[1][c] << 1) | pBits[1];
+                for(uint32_t k = 0; k < 16; k++)
+                {
+                    palette[k][c] = (float)(((64 - kBC7Weights4[k]) * v0 + kBC7Weights4[k] * v1 + 32) >> 6);
+                }
+            }
+
+            uint8_t indices[16];
+            float error = fitIndices<Ops>(pChannels, 4, palette, 16, indices);
+            if(error < bestError)
+            {
+                bestError = error;
+                std::copy(&q[0][0], &q[0][0] + 8, &bestEndpoints[0][0]);
+                bestPBits[0] = pBits[0];
+                bestPBits[1] = pBits[1];
+                std::copy(indices, indices + 16, bestIndices);
+            }
+
+            if(iter == refinementCount || refineEndpoints(pChannels, 4, indices, weights, e0, e1) == false)
+            {
+                break;
+            }
+        }
+
+        // The most significant bit of the first texel's index is implicitly 0. Swapping the endpoints reverses the indices
+        uint32_t first = 0;
+        if(bestIndices[0] >= 8)
+        {
+            first = 1;
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                bestIndices[i] = (uint8_t)(15 - bestIndices[i]);
+            }
+        }
+
+        BitWriter writer;
+        writer.write(1 << 6, 7);
+        for(uint32_t c = 0; c < 4; c++)
+        {
+            writer.write(bestEndpoints[first][c], 7);
+            writer.write(bestEndpoints[1 - first][c], 7);
+        }
+        writer.write(bestPBits[first], 1);
+        writer.write(bestPBits[1 - first], 1);
+        writer.write(bestIndices[0], 3);
+        for(uint32_t i = 1; i < 16; i++)
+        {
+            writer.write(bestIndices[i], 4);
+        }
+        assert(writer.position == 128);
+
+        for(uint32_t b = 0; b < 16; b++)
+        {
+            pBlock[b] = (uint8_t)(writer.bits[b / 8] >> (8 * (b % 8)));
+        }
+    }
+
+    struct CompressionDesc
+    {
+        const uint8_t* pSrc;
+        uint32_t width;
+        uint32_t height;
+        uint32_t srcRowPitch;
+        SourceLayout layout;
+        ResourceFormat dstFormat;
+        uint32_t refinementCount;
+        uint8_t* pDst;
+        uint32_t blocksPerRow;
+        uint32_t blockSize;
+    };
+
+    static void loadBlock(const CompressionDesc& desc, uint32_t blockX, uint32_t blockY, BlockTexels& texels)
+    {
+        for(uint32_t y = 0; y < 4; y++)
+        {
+            // Partial blocks repeat the last row and column
+            uint32_t srcY = std::min(blockY * 4 + y, desc.height - 1);
+            const uint8_t* pRow = desc.pSrc + (size_t)srcY * desc.srcRowPitch;
+            for(uint32_t x = 0; x < 4; x++)
+            {
+                uint32_t srcX = std::min(blockX * 4 + x, desc.width - 1);
+                const uint8_t* pTexel = pRow + srcX * desc.layout.bytesPerPixel;
+                for(uint32_t c = 0; c < 4; c++)
+                {
+                    int32_t offset = desc.layout.offset[c];
+                    texels.c[c][y * 4 + x] = (offset >= 0) ? (float)pTexel[offset] : kConstant[c];
+                }
+            }
+        }
+    }
+
+    template<typename Ops>
+    static void compressBlockRows(const CompressionDesc& desc, uint32_t firstRow, uint32_t lastRow)
+    {
+        BlockTexels texels;
+        for(uint32_t blockY = firstRow; blockY < lastRow; blockY++)
+        {
+            uint8_t* pBlock = desc.pDst + (size_t)blockY * desc.blocksPerRow * desc.blockSize;
+            for(uint32_t blockX = 0; blockX < desc.blocksPerRow; blockX++, pBlock += desc.blockSize)
+            {
+                loadBlock(desc, blockX, blockY, texels);
+                switch(desc.dstFormat)
+                {
+                case ResourceFormat::BC1Unorm:
+                case ResourceFormat::BC1UnormSrgb:
+                    encodeBC1Block<Ops>(texels, desc.refinementCount, pBlock);
+                    break;
+                case ResourceFormat::BC3Unorm:
+                case ResourceFormat::BC3UnormSrgb:
+                    encodeBC4Block<Ops>(texels, 3, desc.refinementCount, pBlock);
+                    encodeBC1Block<Ops>(texels, desc.refinementCount, pBlock + 8);
+                    break;
+                case ResourceFormat::BC4Unorm:
+                    encodeBC4Block<Ops>(texels, 0, desc.refinementCount, pBlock);
+                    break;
+                case ResourceFormat::BC5Unorm:
+                    encodeBC4Block<Ops>(texels, 0, desc.refinementCount, pBlock);
+                    encodeBC4Block<Ops>(texels, 1, desc.refinementCount, pBlock + 8);
+                    break;
+                case ResourceFormat::BC7Unorm:
+                case ResourceFormat::BC7UnormSrgb:
+                    encodeBC7Block<Ops>(texels, desc.refinementCount, pBlock);
+                    break;
+                default:
+                    should_not_get_here();
+                }
+            }
+        }
+        Ops::finish();
+    }
+
+    bool BlockCompressor::isSupportedSourceFormat(ResourceFormat format)
+    {
+        SourceLayout layout;
+        return getSourceLayout(format, layout);
+    }
+
+    bool BlockCompressor::isSupportedCompressedFormat(ResourceFormat format)
+    {
+        switch(format)
+        {
+        case ResourceFormat::BC1Unorm:
+        case ResourceFormat::BC1UnormSrgb:
+        case ResourceFormat::BC3Unorm:
+        case ResourceFormat::BC3UnormSrgb:
+        case ResourceFormat::BC4Unorm:
+        case ResourceFormat::BC5Unorm:
+        case ResourceFormat::BC7Unorm:
+        case ResourceFormat::BC7UnormSrgb:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    ResourceFormat BlockCompressor::getDefaultCompressedFormat(ResourceFormat format)
+    {
+        switch(format)
+        {
+        case ResourceFormat::R8Unorm:
+            return ResourceFormat::BC4Unorm;
+        case ResourceFormat::RG8Unorm:
+            return ResourceFormat::BC5Unorm;
+        case ResourceFormat::BGRX8Unorm:
+            return ResourceFormat::BC1Unorm;
+        case ResourceFormat::BGRX8UnormSrgb:
+            return ResourceFormat::BC1UnormSrgb;
+        case ResourceFormat::RGBA8Unorm:
+        case ResourceFormat::BGRA8Unorm:
+            return ResourceFormat::BC3Unorm;
+        case ResourceFormat::RGBA8UnormSrgb:
+        case ResourceFormat::BGRA8UnormSrgb:
+            return ResourceFormat::BC3UnormSrgb;
+        default:
+            return ResourceFormat::Unknown;
+        }
+    }
+
+    size_t BlockCompressor::getCompressedSize(uint32_t width, uint32_t height, ResourceFormat format)
+    {
+        size_t blockCount = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+        return blockCount * getFormatBytesPerBlock(format);
+    }
+
+    bool BlockCompressor::compress(const void* pSrc, uint32_t width, uint32_t height, uint32_t srcRowPitch, ResourceFormat srcFormat, ResourceFormat dstFormat, Preset preset, void* pDst)
+    {
+        CompressionDesc desc;
+        if(getSourceLayout(srcFormat, desc.layout) == false)
+        {
+            logError("BlockCompressor::compress() - unsupported source format " + to_string(srcFormat));
+            return false;
+        }
+
+        if(isSupportedCompressedFormat(dstFormat) == false)
+        {
+            logError("BlockCompressor::compress() - unsupported compressed format " + to_string(dstFormat));
+            return false;
+        }
+
+        if(width == 0 || height == 0)
+        {
+            return true;
+        }
+
+        desc.pSrc = (const uint8_t*)pSrc;
+        desc.width = width;
+        desc.height = height;
+        desc.srcRowPitch = srcRowPitch;
+        desc.dstFormat = dstFormat;
+        desc.refinementCount = getRefinementCount(preset);
+        desc.pDst = (uint8_t*)pDst;
+        desc.blocksPerRow = (width + 3) / 4;
+        desc.blockSize = getFormatBytesPerBlock(dstFormat);
+
+        // Give every chunk at least a few hundred blocks, so small mip levels don't pay the scheduling cost
+        uint32_t rowCount = (height + 3) / 4;
+        uint32_t grainSize = std::max(1u, 256 / desc.blocksPerRow);
+        const bool useAvx = isAvxSupported();
+        JobSystem::parallelFor((rowCount + grainSize - 1) / grainSize, [&](uint32_t chunk)
+        {
+            uint32_t firstRow = chunk * grainSize;
+            uint32_t lastRow = std::min(rowCount, firstRow + grainSize);
+            if(useAvx)
+            {
+                compressBlockRows<AvxOps>(desc, firstRow, lastRow);
+            }
+            else
+            {
+                compressBlockRows<SseOps>(desc, firstRow, lastRow);
+            }
+        });
+        return true;
+    }
+}
@@ -0,0 +1,89 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "API/Formats.h"
+
+namespace Falcor
+{
+    /*!
+    *  \addtogroup Falcor
+    *  @{
+    */
+
+    /** CPU encoder for the BC1, BC3, BC4, BC5 and BC7 block-compressed formats.
+        The encoder doesn't use the device, so it can be used by offline tools as well as by Texture::compress2DTexture().
+        Every block is encoded using SSE or AVX, selected at runtime, and the rows of blocks are distributed between the JobSystem workers.
+        The endpoints are initialized from the principal axis of the block's colors and then refined with least-squares passes, depending on the preset.
+        BC7 blocks are always encoded with mode 6 (a single RGBA endpoint pair with 16 interpolation steps).
+    */
+    class BlockCompressor
+    {
+    public:
+        /** Quality/speed trade-off
+        */
+        enum class Preset
+        {
+            Fast,           ///< Endpoints from the principal axis, no refinement
+            Normal,         ///< One refinement pass
+            HighQuality,    ///< Several refinement passes
+        };
+
+        /** Check if a format can be used as the source of compress(). Supports the 8-bit unorm R, RG, RGBA, BGRA and BGRX formats
+        */
+        static bool isSupportedSourceFormat(ResourceFormat format);
+
+        /** Check if a format can be used as the destination of compress()
+        */
+        static bool isSupportedCompressedFormat(ResourceFormat format);
+
+        /** Get the compressed format used for a source format when none is specified. Follows the channel count: BC4 for R, BC5 for RG, BC1 for BGRX and BC3 for formats with alpha.
+            The sRGB-ness of the source format is preserved.
+            \return The compressed format, or ResourceFormat::Unknown if the format isn't supported
+        */
+        static ResourceFormat getDefaultCompressedFormat(ResourceFormat format);
+
+        /** Get the size in bytes of a compressed image
+        */
+        static size_t getCompressedSize(uint32_t width, uint32_t height, ResourceFormat format);
+
+        /** Compress an image
+            \param[in] pSrc The source image
+            \param[in] width The image width. Doesn't have to be a multiple of 4
+            \param[in] height The image height. Doesn't have to be a multiple of 4
+            \param[in] srcRowPitch The distance in bytes between the source rows
+            \param[in] srcFormat The source format. See isSupportedSourceFormat()
+            \param[in] dstFormat The compressed format. See isSupportedCompressedFormat()
+            \param[in] preset Quality/speed trade-off
+            \param[out] pDst Receives the blocks, row after row. Must hold getCompressedSize() bytes
+            \return true on success, false if one of the formats isn't supported
+        */
+        static bool compress(const void* pSrc, uint32_t width, uint32_t height, uint32_t srcRowPitch, ResourceFormat srcFormat, ResourceFormat dstFormat, Preset preset, void* pDst);
+    };
+
+    /*! @} */
+}
@@ -27,6 +27,7 @@
 ***************************************************************************/
 #pragma once
 #include "Utils/OS.h"
+#include "Utils/BinaryFileStream.h"
 #include "Framework.h"
 #include <D3D11.h>
 
@@ -116,7 +117,10 @@ namespace Falcor
             DdsHeader header;
             DdsHeaderDX10 dx10Header;
             bool hasDX10Header;
-            std::vector<uint8_t> data;
+            BinaryFileStream stream;            ///< The file is mapped into memory and the texture data is used in place
+            const uint8_t* pData = nullptr;     ///< The texture data. Points into the mapped file, or into flippedData if the data had to be flipped
+            size_t dataSize = 0;
+            std::vector<uint8_t> flippedData;
         };
     }
 }
\ No newline at end of file
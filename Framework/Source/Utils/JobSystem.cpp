@@ -0,0 +1,403 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "JobSystem.h"
+#include "Utils/OS.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace Falcor
+{
+    struct JobSystem::Job
+    {
+        JobFunc func;
+        std::atomic<int32_t> pendingCount;      // Number of unfinished dependencies, plus 1 until the job is submitted
+        std::atomic<bool> finished;
+        std::mutex mutex;                       // Protects dependents
+        std::vector<JobHandle> dependents;      // Jobs waiting for this one to complete
+
+        Job(const JobFunc& f) : func(f), pendingCount(1), finished(false) {}
+    };
+
+    /** Job queue. The owning worker pushes and pops at the back, other threads steal from the front
+    */
+    struct JobQueue
+    {
+        std::mutex mutex;
+        std::deque<JobSystem::JobHandle> jobs;
+
+        void push(const JobSystem::JobHandle& pJob)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(pJob);
+        }
+
+        JobSystem::JobHandle pop(bool fromBack)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(jobs.empty())
+            {
+                return nullptr;
+            }
+            JobSystem::JobHandle pJob;
+            if(fromBack)
+            {
+                pJob = std::move(jobs.back());
+                jobs.pop_back();
+            }
+            else
+            {
+                pJob = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            return pJob;
+        }
+    };
+
+    struct JobSystemData
+    {
+        std::mutex initMutex;
+        std::atomic<bool> running;
+        std::vector<std::thread> workers;
+        std::vector<std::unique_ptr<JobQueue>> workerQueues;
+        JobQueue sharedQueue;                   // Jobs submitted by non-worker threads
+
+        // Sleeping. A thread only sleeps after checking queuedCount (or its job's finished flag) under sleepMutex, and the threads which change them notify only if
+        // someone is sleeping, so the counters must be sequentially consistent.
+        std::mutex sleepMutex;
+        std::condition_variable wakeUp;
+        std::atomic<uint32_t> queuedCount;
+        std::atomic<uint32_t> sleeperCount;
+        std::atomic<uint32_t> waiterCount;      // Sleepers waiting for a job to complete
+        std::atomic<bool> stopping;
+
+        JobSystemData() : running(false), queuedCount(0), sleeperCount(0), waiterCount(0), stopping(false) {}
+        ~JobSystemData() { JobSystem::shutdown(); }
+    };
+
+    static JobSystemData& getData()
+    {
+        static JobSystemData data;
+        return data;
+    }
+
+    // Index of the worker running on the current thread, or -1 for other threads
+    static thread_local int32_t tWorkerIndex = -1;
+
+    static void enqueue(const JobSystem::JobHandle& pJob)
+    {
+        JobSystemData& data = getData();
+        if(tWorkerIndex >= 0)
+        {
+            data.workerQueues[tWorkerIndex]->push(pJob);
+        }
+        else
+        {
+            data.sharedQueue.push(pJob);
+        }
+
+        data.queuedCount++;
+        if(data.sleeperCount > 0)
+        {
+            std::lock_guard<std::mutex> lock(data.sleepMutex);
+            data.wakeUp.notify_one();
+        }
+    }
+
+    static JobSystem::JobHandle findJob()
+    {
+        JobSystemData& data = getData();
+        if(data.queuedCount == 0)
+        {
+            return nullptr;
+        }
+
+        JobSystem::JobHandle pJob;
+        uint32_t queueCount = (uint32_t)data.workerQueues.size();
+        if(tWorkerIndex >= 0)
+        {
+            // Newest job from our own queue
+            pJob = data.workerQueues[tWorkerIndex]->pop(true);
+        }
+
+        if(pJob == nullptr)
+        {
+            pJob = data.sharedQueue.pop(false);
+        }
+
+        // Steal the oldest job from another worker, starting with our neighbor to spread the contention
+        uint32_t first = (uint32_t)(tWorkerIndex + 1);
+        for(uint32_t i = 0; i < queueCount && pJob == nullptr; i++)
+        {
+            uint32_t victim = (first + i) % queueCount;
+            if((int32_t)victim != tWorkerIndex)
+            {
+                pJob = data.workerQueues[victim]->pop(false);
+            }
+        }
+
+        if(pJob)
+        {
+            data.queuedCount--;
+        }
+        return pJob;
+    }
+
+    static void execute(const JobSystem::JobHandle& pJob)
+    {
+        pJob->func();
+        pJob->func = nullptr;
+
+        std::vector<JobSystem::JobHandle> dependents;
+        {
+            std::lock_guard<std::mutex> lock(pJob->mutex);
+            pJob->finished = true;
+            dependents.swap(pJob->dependents);
+        }
+
+        for(const auto& pDependent : dependents)
+        {
+            if(--pDependent->pendingCount == 0)
+            {
+                enqueue(pDependent);
+            }
+        }
+
+        JobSystemData& data = getData();
+        if(data.waiterCount > 0)
+        {
+            std::lock_guard<std::mutex> lock(data.sleepMutex);
+            data.wakeUp.notify_all();
+        }
+    }
+
+    static void workerFunc(int32_t workerIndex)
+    {
+        tWorkerIndex = workerIndex;
+        JobSystemData& data = getData();
+        while(true)
+        {
+            JobSystem::JobHandle pJob = findJob();
+            if(pJob)
+            {
+                execute(pJob);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(data.sleepMutex);
+            data.sleeperCount++;
+            data.wakeUp.wait(lock, [&data]() { return data.stopping || data.queuedCount > 0; });
+            data.sleeperCount--;
+            if(data.stopping && data.queuedCount == 0)
+            {
+                break;
+            }
+        }
+        tWorkerIndex = -1;
+    }
+
+    void JobSystem::init(uint32_t workerCount, bool setAffinity)
+    {
+        JobSystemData& data = getData();
+        std::lock_guard<std::mutex> lock(data.initMutex);
+        if(data.running)
+        {
+            return;
+        }
+
+        uint32_t coreCount = std::max(1u, std::thread::hardware_concurrency());
+        if(workerCount == 0)
+        {
+            workerCount = std::max(1u, coreCount - 1);
+        }
+
+        data.stopping = false;
+        data.workerQueues.clear();
+        for(uint32_t i = 0; i < workerCount; i++)
+        {
+            data.workerQueues.push_back(std::make_unique<JobQueue>());
+        }
+
+        for(uint32_t i = 0; i < workerCount; i++)
+        {
+            data.workers.push_back(std::thread(workerFunc, (int32_t)i));
+            if(setAffinity && coreCount <= 32)
+            {
+                // Leave core 0 to the main thread
+                setThreadAffinity(data.workers.back().native_handle(), 1u << ((i + 1) % coreCount));
+            }
+        }
+        data.running = true;
+    }
+
+    void JobSystem::shutdown()
+    {
+        JobSystemData& data = getData();
+        std::lock_guard<std::mutex> initLock(data.initMutex);
+        if(data.running == false)
+        {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(data.sleepMutex);
+            data.stopping = true;
+            data.wakeUp.notify_all();
+        }
+
+        for(auto& t : data.workers)
+        {
+            t.join();
+        }
+        data.workers.clear();
+        data.running = false;
+    }
+
+    uint32_t JobSystem::getWorkerCount()
+    {
+        JobSystemData& data = getData();
+        if(data.running == false)
+        {
+            init();
+        }
+        return (uint32_t)data.workerQueues.size();
+    }
+
+    JobSystem::JobHandle JobSystem::createJob(const JobFunc& func)
+    {
+        return std::make_shared<Job>(func);
+    }
+
+    void JobSystem::addDependency(const JobHandle& pJob, const JobHandle& pDependency)
+    {
+        std::lock_guard<std::mutex> lock(pDependency->mutex);
+        if(pDependency->finished == false)
+        {
+            pJob->pendingCount++;
+            pDependency->dependents.push_back(pJob);
+        }
+    }
+
+    void JobSystem::submit(const JobHandle& pJob)
+    {
+        if(getData().running == false)
+        {
+            init();
+        }
+
+        if(--pJob->pendingCount == 0)
+        {
+            enqueue(pJob);
+        }
+    }
+
+    JobSystem::JobHandle JobSystem::run(const JobFunc& func, const std::vector<JobHandle>& dependencies)
+    {
+        JobHandle pJob = createJob(func);
+        for(const auto& pDependency : dependencies)
+        {
+            addDependency(pJob, pDependency);
+        }
+        submit(pJob);
+        return pJob;
+    }
+
+    bool JobSystem::isFinished(const JobHandle& pJob)
+    {
+        return pJob->finished;
+    }
+
+    void JobSystem::wait(const JobHandle& pJob)
+    {
+        JobSystemData& data = getData();
+        while(pJob->finished == false)
+        {
+            // Help while waiting
+            JobHandle pOther = findJob();
+            if(pOther)
+            {
+                execute(pOther);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(data.sleepMutex);
+            data.sleeperCount++;
+            data.waiterCount++;
+            data.wakeUp.wait(lock, [&]() { return pJob->finished || data.queuedCount > 0; });
+            data.waiterCount--;
+            data.sleeperCount--;
+        }
+    }
+
+    void JobSystem::wait(const std::vector<JobHandle>& jobs)
+    {
+        for(const auto& pJob : jobs)
+        {
+            wait(pJob);
+        }
+    }
+
+    void JobSystem::parallelForRange(uint32_t count, uint32_t grainSize, const RangeFunc& func)
+    {
+        grainSize = std::max(1u, grainSize);
+        uint32_t chunkCount = (count + grainSize - 1) / grainSize;
+        if(chunkCount <= 1)
+        {
+            if(count > 0)
+            {
+                func(0, count);
+            }
+            return;
+        }
+
+        // Chunks are claimed dynamically, so the helpers which start late find nothing to do and exit immediately
+        std::atomic<uint32_t> nextChunk(0);
+        auto body = [&]()
+        {
+            for(uint32_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++)
+            {
+                uint32_t begin = chunk * grainSize;
+                func(begin, begin + std::min(count - begin, grainSize));
+            }
+        };
+
+        uint32_t helperCount = std::min(chunkCount - 1, getWorkerCount());
+        std::vector<JobHandle> helpers;
+        helpers.reserve(helperCount);
+        for(uint32_t i = 0; i < helperCount; i++)
+        {
+            helpers.push_back(run(body));
+        }
+
+        body();
+        wait(helpers);
+    }
+}
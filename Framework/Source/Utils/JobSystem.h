@@ -0,0 +1,126 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace Falcor
+{
+    /*!
+    *  \addtogroup Falcor
+    *  @{
+    */
+
+    /** Process-wide task scheduler.
+        Jobs run on a pool of worker threads. Every worker has its own job queue: jobs submitted by a job are pushed to the queue of the worker running it and executed last-in first-out,
+        and idle workers steal the oldest jobs from the other queues. Jobs submitted by other threads go into a shared queue.
+        A thread which waits for a job executes other queued jobs in the meantime, so jobs can wait for the jobs they submitted without blocking a worker.
+        The workers are started on first use, or by calling init().
+    */
+    class JobSystem
+    {
+    public:
+        struct Job;
+        using JobHandle = std::shared_ptr<Job>;
+        using JobFunc = std::function<void()>;
+
+        /** Start the worker threads. Does nothing if the workers are already running.
+            \param[in] workerCount Number of worker threads. 0 creates one worker for every core except the one running the calling thread
+            \param[in] setAffinity Bind every worker to its own core. Only used when the machine has no more than 32 cores
+        */
+        static void init(uint32_t workerCount = 0, bool setAffinity = false);
+
+        /** Wait for the queued jobs to complete and stop the worker threads. Called automatically when the process exits
+        */
+        static void shutdown();
+
+        /** Get the number of worker threads. Starts the workers if needed
+        */
+        static uint32_t getWorkerCount();
+
+        /** Create a job. The job will not run until it is submitted, which allows adding dependencies first
+            \param[in] func The function to execute
+        */
+        static JobHandle createJob(const JobFunc& func);
+
+        /** Make a job run only after another job completed. Must be called before the job is submitted
+            \param[in] pJob The job
+            \param[in] pDependency The job which has to complete first. Can already be submitted or completed
+        */
+        static void addDependency(const JobHandle& pJob, const JobHandle& pDependency);
+
+        /** Submit a job. It runs once all its dependencies completed
+        */
+        static void submit(const JobHandle& pJob);
+
+        /** Create and submit a job
+            \param[in] func The function to execute
+            \param[in] dependencies Jobs which have to complete before this job starts
+            \return The new job, which can be waited on or used as a dependency of other jobs (to create continuations)
+        */
+        static JobHandle run(const JobFunc& func, const std::vector<JobHandle>& dependencies = {});
+
+        /** Check if a job completed
+        */
+        static bool isFinished(const JobHandle& pJob);
+
+        /** Wait for a job to complete. The calling thread executes other jobs while waiting
+        */
+        static void wait(const JobHandle& pJob);
+
+        /** Wait for a list of jobs to complete. The calling thread executes other jobs while waiting
+        */
+        static void wait(const std::vector<JobHandle>& jobs);
+
+        /** Call func(index) for every index in [0, count). The indices are processed in chunks by the calling thread and the workers, and the function returns once all of them completed.
+            func may be called concurrently, so it must only write to data owned by its index. It can call parallelFor() itself.
+            \param[in] count Number of indices
+            \param[in] func Callable with a uint32_t parameter
+            \param[in] grainSize Number of consecutive indices processed by a single call to the scheduler. Use larger values when func is cheap
+        */
+        template<typename Func>
+        static void parallelFor(uint32_t count, const Func& func, uint32_t grainSize = 1)
+        {
+            parallelForRange(count, grainSize, [&func](uint32_t begin, uint32_t end)
+            {
+                for(uint32_t i = begin; i < end; i++)
+                {
+                    func(i);
+                }
+            });
+        }
+
+    private:
+        using RangeFunc = std::function<void(uint32_t, uint32_t)>;
+        static void parallelForRange(uint32_t count, uint32_t grainSize, const RangeFunc& func);
+    };
+
+    /*! @} */
+}
@@ -26,6 +26,9 @@
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ***************************************************************************/
 #pragma once
+#include <algorithm>
+#include <vector>
+#include "glm/geometric.hpp"
 
 namespace Falcor
 {
@@ -134,11 +137,67 @@ namespace Falcor
             T result = (((coeff.d * point) + coeff.c) * point + coeff.b) * point + coeff.a;
             return result;
         }
+
+        /** Build the table used to sample the spline by arc length. Every section is approximated by a polyline
+            \param[in] samplesPerSection Number of polyline segments per section
+        */
+        void buildArcLengthTable(uint32_t samplesPerSection = 16)
+        {
+            mSamplesPerSection = samplesPerSection;
+            mArcLengths.clear();
+            if(mCoefficient.empty())
+            {
+                return;
+            }
+
+            mArcLengths.resize(mCoefficient.size() * samplesPerSection + 1);
+            mArcLengths[0] = 0;
+            T prev = interpolate(0, 0);
+            uint32_t index = 1;
+            for(uint32_t section = 0; section < (uint32_t)mCoefficient.size(); section++)
+            {
+                for(uint32_t i = 1; i <= samplesPerSection; i++)
+                {
+                    T current = interpolate(section, float(i) / float(samplesPerSection));
+                    mArcLengths[index] = mArcLengths[index - 1] + glm::length(current - prev);
+                    prev = current;
+                    index++;
+                }
+            }
+        }
+
+        /** Get the length of the spline. Requires buildArcLengthTable()
+        */
+        float getArcLength() const { return mArcLengths.empty() ? 0 : mArcLengths.back(); }
+
+        /** Find the point at a distance along the spline. Requires buildArcLengthTable()
+            \param[in] distance Distance from the start of the spline. Clamped to the spline's length
+            \param[out] section The section containing the point
+            \param[out] point The interpolation factor of the point inside the section, to be used with interpolate()
+        */
+        void getPointAtArcLength(float distance, uint32_t& section, float& point) const
+        {
+            assert(mArcLengths.size() >= 2);
+            distance = std::max(0.0f, std::min(distance, getArcLength()));
+
+            // Find the polyline segment with a binary search, then interpolate inside it
+            uint32_t sample = (uint32_t)(std::upper_bound(mArcLengths.begin(), mArcLengths.end(), distance) - mArcLengths.begin());
+            sample = std::max(1u, std::min(sample, (uint32_t)mArcLengths.size() - 1)) - 1;
+            float segmentLength = mArcLengths[sample + 1] - mArcLengths[sample];
+            float f = (segmentLength > 0) ? (distance - mArcLengths[sample]) / segmentLength : 0;
+
+            section = sample / mSamplesPerSection;
+            point = (float(sample % mSamplesPerSection) + f) / float(mSamplesPerSection);
+        }
+
     private:
         struct CubicCoeff
         {
             T a, b, c, d;
         };
         std::vector<CubicCoeff> mCoefficient;
+
+        std::vector<float> mArcLengths;         ///< Distance from the start of the spline to every polyline point
+        uint32_t mSamplesPerSection = 0;
     };
 }
\ No newline at end of file
@@ -0,0 +1,128 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <intrin.h>
+#include <immintrin.h>
+
+namespace Falcor
+{
+    /*!
+    *  \addtogroup Falcor
+    *  @{
+    */
+
+    /** Thin wrappers around the SSE and AVX float intrinsics, used to write a kernel once as a template and instantiate it for every instruction set.
+        Kernels should call finish() before returning, to avoid AVX/SSE transition penalties.
+    */
+    struct SseOps
+    {
+        using Reg = __m128;
+        static const uint32_t kWidth = 4;
+
+        static Reg load(const float* p)             { return _mm_load_ps(p); }
+        static Reg loadu(const float* p)            { return _mm_loadu_ps(p); }
+        static void store(float* p, Reg a)          { _mm_store_ps(p, a); }
+        static Reg set1(float f)                    { return _mm_set1_ps(f); }
+        static Reg add(Reg a, Reg b)                { return _mm_add_ps(a, b); }
+        static Reg sub(Reg a, Reg b)                { return _mm_sub_ps(a, b); }
+        static Reg mul(Reg a, Reg b)                { return _mm_mul_ps(a, b); }
+        static Reg div(Reg a, Reg b)                { return _mm_div_ps(a, b); }
+        static Reg sqrt(Reg a)                      { return _mm_sqrt_ps(a); }
+        static Reg cmpEq(Reg a, Reg b)              { return _mm_cmpeq_ps(a, b); }
+        static Reg cmpLt(Reg a, Reg b)              { return _mm_cmplt_ps(a, b); }
+        static Reg cmpGt(Reg a, Reg b)              { return _mm_cmpgt_ps(a, b); }
+        static Reg cmpNotLe(Reg a, Reg b)           { return _mm_cmpnle_ps(a, b); }
+        static Reg bitAnd(Reg a, Reg b)             { return _mm_and_ps(a, b); }
+        static Reg bitOr(Reg a, Reg b)              { return _mm_or_ps(a, b); }
+        static Reg bitXor(Reg a, Reg b)             { return _mm_xor_ps(a, b); }
+        static Reg bitAndNot(Reg a, Reg b)          { return _mm_andnot_ps(a, b); }
+        static uint32_t moveMask(Reg a)             { return (uint32_t)_mm_movemask_ps(a); }
+        static void finish()                        {}
+    };
+
+    struct AvxOps
+    {
+        using Reg = __m256;
+        static const uint32_t kWidth = 8;
+
+        static Reg load(const float* p)             { return _mm256_load_ps(p); }
+        static Reg loadu(const float* p)            { return _mm256_loadu_ps(p); }
+        static void store(float* p, Reg a)          { _mm256_store_ps(p, a); }
+        static Reg set1(float f)                    { return _mm256_set1_ps(f); }
+        static Reg add(Reg a, Reg b)                { return _mm256_add_ps(a, b); }
+        static Reg sub(Reg a, Reg b)                { return _mm256_sub_ps(a, b); }
+        static Reg mul(Reg a, Reg b)                { return _mm256_mul_ps(a, b); }
+        static Reg div(Reg a, Reg b)                { return _mm256_div_ps(a, b); }
+        static Reg sqrt(Reg a)                      { return _mm256_sqrt_ps(a); }
+        static Reg cmpEq(Reg a, Reg b)              { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+        static Reg cmpLt(Reg a, Reg b)              { return _mm256_cmp_ps(a, b, _CMP_LT_OS); }
+        static Reg cmpGt(Reg a, Reg b)              { return _mm256_cmp_ps(a, b, _CMP_GT_OS); }
+        static Reg cmpNotLe(Reg a, Reg b)           { return _mm256_cmp_ps(a, b, _CMP_NLE_US); }
+        static Reg bitAnd(Reg a, Reg b)             { return _mm256_and_ps(a, b); }
+        static Reg bitOr(Reg a, Reg b)              { return _mm256_or_ps(a, b); }
+        static Reg bitXor(Reg a, Reg b)             { return _mm256_xor_ps(a, b); }
+        static Reg bitAndNot(Reg a, Reg b)          { return _mm256_andnot_ps(a, b); }
+        static uint32_t moveMask(Reg a)             { return (uint32_t)_mm256_movemask_ps(a); }
+        static void finish()                        { _mm256_zeroupper(); }
+    };
+
+    /** Check if the CPU supports SSSE3. The result is computed once and cached.
+    */
+    inline bool isSsse3Supported()
+    {
+        static const bool sIsSupported = []()
+        {
+            int32_t info[4];
+            __cpuid(info, 1);
+            return (info[2] & (1 << 9)) != 0;
+        }();
+        return sIsSupported;
+    }
+
+    /** Check if the CPU and the OS support AVX. The result is computed once and cached.
+    */
+    inline bool isAvxSupported()
+    {
+        static const bool sIsSupported = []()
+        {
+            int32_t info[4];
+            __cpuid(info, 1);
+            const bool hasOsxsave = (info[2] & (1 << 27)) != 0;
+            const bool hasAvx = (info[2] & (1 << 28)) != 0;
+            if(hasOsxsave && hasAvx)
+            {
+                // Make sure the OS saves the YMM registers on context switches
+                return (_xgetbv(0) & 0x6) == 0x6;
+            }
+            return false;
+        }();
+        return sIsSupported;
+    }
+
+    /*! @} */
+}
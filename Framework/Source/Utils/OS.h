@@ -147,6 +147,27 @@ namespace Falcor
     */
     bool readFileToString(const std::string& fullpath, std::string& str);
 
+    /** Read-only view of a file mapped into the process address space. Created by mapFileToMemory() and released by unmapFileFromMemory().
+    */
+    struct MappedFile
+    {
+        const uint8_t* pData = nullptr;     ///< Start of the mapped view. nullptr for empty files or if the mapping failed
+        uint64_t size = 0;                  ///< Size of the view in bytes
+        void* pFileHandle = nullptr;        ///< OS file handle
+        void* pMappingHandle = nullptr;     ///< OS file-mapping handle
+    };
+
+    /** Map a file into memory for reading. The function expects a full path to the file, and will not look in the common directories.
+        \param[in] fullpath The path to the requested file
+        \param[out] mappedFile On successful return, describes the mapped view
+        \return true if the file was mapped successfully, otherwise false
+    */
+    bool mapFileToMemory(const std::string& fullpath, MappedFile& mappedFile);
+
+    /** Release a mapping created with mapFileToMemory(). Pointers into the view are invalid after this call.
+    */
+    void unmapFileFromMemory(MappedFile& mappedFile);
+
     /** Adds a folder into the search directory. Once added, calls to FindFileInCommonDirs() will seach that directory as well
         \param[in] dir The new directory to add to the common directories.
     */
@@ -206,6 +227,27 @@ namespace Falcor
     */
     time_t getFileModifiedTime(const std::string& filename);
 
+    /** Set the last time a file was modified to the current time
+        \return true if the file time was updated, otherwise false
+    */
+    bool touchFile(const std::string& filename);
+
+    /** Get the size of a file in bytes. If the file is not found will return 0
+    */
+    uint64_t getFileSize(const std::string& filename);
+
+    /** Rename a file, replacing the destination file if it exists. When both files are on the same volume the destination is replaced atomically, so readers see either the old or the new file.
+        \param[in] src The file to rename
+        \param[in] dst The new name
+        \return true on success, otherwise false (for example, if the destination file is in use)
+    */
+    bool moveFile(const std::string& src, const std::string& dst);
+
+    /** Delete a file
+        \return true if the file was deleted, otherwise false
+    */
+    bool deleteFile(const std::string& filename);
+
     enum class ThreadPriorityType : int32_t
     {
         BackgroundBegin     = -2,   //< Indicates I/O-intense thread
@@ -32,31 +32,202 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <algorithm>
 
 namespace Falcor
 {
     bool gProfileEnabled = false;
 
     std::map<size_t, Profiler::EventData*> Profiler::sProfilerEvents;
-    uint32_t Profiler::sCurrentLevel = 0;
     uint32_t Profiler::sGpuTimerIndex = 0;
     std::vector<Profiler::EventData*> Profiler::sProfilerVector;
     
     std::hash<std::string> HashedString::hashFunc;
 
-	void Profiler::initNewEvent(EventData *pEvent, const HashedString& name)
+    // Number of events kept by every thread. Must be a power of 2
+    static const uint64_t kTraceBufferSize = 64 * 1024;
+
+    // Statics are initialized by the main thread
+    static const std::thread::id kMainThreadId = std::this_thread::get_id();
+
+    /** Reference point for measuring the frequency of the time stamp counter against QueryPerformanceCounter(). The counter is invariant on all the CPUs D3D12 runs on, so it's measured once
+    */
+    struct TimestampCalibration
+    {
+        uint64_t timestamp;
+        LARGE_INTEGER qpc;
+
+        TimestampCalibration()
+        {
+            QueryPerformanceCounter(&qpc);
+            timestamp = __rdtsc();
+        }
+    };
+
+    static const TimestampCalibration kCalibrationStart;
+    static const int64_t kCalibrationTimeMs = 50;
+
+    static double measureTicksPerMs()
+    {
+        // The measurement needs at least kCalibrationTimeMs to be accurate. Only the first conversion can wait, if it happens right after startup
+        LARGE_INTEGER frequency, qpc;
+        QueryPerformanceFrequency(&frequency);
+        do
+        {
+            QueryPerformanceCounter(&qpc);
+        } while((qpc.QuadPart - kCalibrationStart.qpc.QuadPart) * 1000 < kCalibrationTimeMs * frequency.QuadPart);
+        uint64_t timestamp = __rdtsc();
+
+        double elapsedMs = double(qpc.QuadPart - kCalibrationStart.qpc.QuadPart) * 1000.0 / double(frequency.QuadPart);
+        return double(timestamp - kCalibrationStart.timestamp) / elapsedMs;
+    }
+
+    double Profiler::timestampToMs(uint64_t ticks)
+    {
+        static const double ticksPerMs = measureTicksPerMs();
+        return double(ticks) / ticksPerMs;
+    }
+
+    /** Event begin/end record. The fields are atomic so that exportChromeTrace() can read the ring buffer while the owning thread overwrites it. On x86, the stores and loads compile to plain moves.
+    */
+    struct TraceRecord
+    {
+        std::atomic<uint64_t> time;         // Profiler::getTimestamp()
+        std::atomic<uintptr_t> event;       // The EventData pointer. The lowest bit is set for end records
+    };
+
+    /** Per-thread profiler state. Only the owning thread writes into the ring buffer. When a thread exits, its state is recycled by the next new thread.
+    */
+    struct ThreadData
+    {
+        uint32_t id;
+        bool isMainThread = false;
+        bool inUse = false;
+        uint32_t level = 0;
+
+        // Event lookup cache, so that the shared event map is only accessed the first time a thread uses an event
+        std::unordered_map<size_t, Profiler::EventData*> eventCache;
+        uint32_t cacheGeneration = 0;
+
+        std::unique_ptr<TraceRecord[]> pRecords;
+        std::atomic<uint64_t> writeIndex;
+        uint64_t firstIndex = 0;            // Records before this index reference deleted events
+
+        void record(uint64_t time, const Profiler::EventData* pEvent, bool isEnd)
+        {
+            uint64_t index = writeIndex.load(std::memory_order_relaxed);
+            TraceRecord& r = pRecords[index & (kTraceBufferSize - 1)];
+            r.time.store(time, std::memory_order_release);
+            r.event.store((uintptr_t)pEvent | (isEnd ? 1 : 0), std::memory_order_release);
+            writeIndex.store(index + 1, std::memory_order_release);
+        }
+    };
+
+    struct ProfilerData
+    {
+        std::mutex mutex;                                   // Protects the event map and list, and the thread list
+        std::vector<std::unique_ptr<ThreadData>> threads;
+        std::atomic<uint32_t> generation;                   // Incremented by clearEvents() to invalidate the threads' event caches
+
+        ProfilerData() : generation(0) {}
+    };
+
+    static ProfilerData& getProfilerData()
+    {
+        static ProfilerData data;
+        return data;
+    }
+
+    static ThreadData* acquireThreadData()
+    {
+        ProfilerData& data = getProfilerData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        ThreadData* pThread = nullptr;
+        for(auto& t : data.threads)
+        {
+            if(t->inUse == false)
+            {
+                pThread = t.get();
+                break;
+            }
+        }
+
+        if(pThread == nullptr)
+        {
+            data.threads.push_back(std::make_unique<ThreadData>());
+            pThread = data.threads.back().get();
+            pThread->id = (uint32_t)data.threads.size() - 1;
+            pThread->pRecords = std::make_unique<TraceRecord[]>(kTraceBufferSize);
+            pThread->writeIndex = 0;
+        }
+
+        pThread->inUse = true;
+        pThread->isMainThread = (std::this_thread::get_id() == kMainThreadId);
+        pThread->level = 0;
+        pThread->eventCache.clear();
+        pThread->cacheGeneration = data.generation.load();
+        return pThread;
+    }
+
+    /** Returns the thread's state to the pool when the thread exits
+    */
+    struct ThreadDataHolder
+    {
+        ThreadData* pThread = nullptr;
+        ~ThreadDataHolder()
+        {
+            if(pThread)
+            {
+                std::lock_guard<std::mutex> lock(getProfilerData().mutex);
+                pThread->inUse = false;
+            }
+        }
+    };
+
+    static ThreadData& getThreadData()
+    {
+        static thread_local ThreadDataHolder holder;
+        if(holder.pThread == nullptr)
+        {
+            holder.pThread = acquireThreadData();
+        }
+        return *holder.pThread;
+    }
+
+    static void createGpuTimers(Profiler::EventData* pEvent, uint32_t gpuTimerIndex)
     {
-	    pEvent->name = name.str;
-        pEvent->level = sCurrentLevel;
         pEvent->pGpuTimer[0] = GpuTimer::create();
         pEvent->pGpuTimer[1] = GpuTimer::create();
 
         // Call begin/end for the next-frame GPU timer to fool it, otherwise it will report an error when calling GetData() (double-buffering issue).
-        pEvent->pGpuTimer[1 - sGpuTimerIndex]->begin();
-        pEvent->pGpuTimer[1 - sGpuTimerIndex]->end();
+        pEvent->pGpuTimer[1 - gpuTimerIndex]->begin();
+        pEvent->pGpuTimer[1 - gpuTimerIndex]->end();
+    }
 
-		sProfilerEvents[name.hash] = pEvent;
-        sProfilerVector.push_back(pEvent);
+	void Profiler::initNewEvent(EventData *pEvent, const HashedString& name)
+    {
+        ThreadData& thread = getThreadData();
+	    pEvent->name = name.str;
+        pEvent->level = thread.level;
+        pEvent->label = std::string(pEvent->level * 2 + 1, ' ') + pEvent->name + ' ';
+
+        // GPU timers can only be used by the main thread. Events created by other threads get them when the main thread starts them
+        if(thread.isMainThread)
+        {
+            createGpuTimers(pEvent, sGpuTimerIndex);
+        }
+
+        // If another thread registered the same event in the meantime, keep the existing one
+        std::lock_guard<std::mutex> lock(getProfilerData().mutex);
+        if(sProfilerEvents.find(name.hash) == sProfilerEvents.end())
+        {
+		    sProfilerEvents[name.hash] = pEvent;
+            sProfilerVector.push_back(pEvent);
+        }
 	}
 
     Profiler::EventData* Profiler::createNewEvent(const HashedString& name)
@@ -68,13 +239,30 @@ namespace Falcor
 
     Profiler::EventData* Profiler::isEventRegistered(const HashedString& name)
 	{
-        auto& event = sProfilerEvents.find(name.hash);
+        ThreadData& thread = getThreadData();
+        ProfilerData& data = getProfilerData();
+        uint32_t generation = data.generation.load(std::memory_order_relaxed);
+        if(thread.cacheGeneration != generation)
+        {
+            thread.eventCache.clear();
+            thread.cacheGeneration = generation;
+        }
+
+        auto cached = thread.eventCache.find(name.hash);
+        if(cached != thread.eventCache.end())
+        {
+            return cached->second;
+        }
+
+        std::lock_guard<std::mutex> lock(data.mutex);
+        auto event = sProfilerEvents.find(name.hash);
         if(event == sProfilerEvents.end())
 		{
 			return nullptr;
 		}
 		else
 		{
+            thread.eventCache[name.hash] = event->second;
 			return event->second;
 		}
 	}
@@ -88,41 +276,72 @@ namespace Falcor
 		}
 		else
         {
-            return createNewEvent(name);
+            // Another thread might have created the event after the lookup. Keep the first one
+            EventData* pData = createNewEvent(name);
+            EventData* pRegistered = isEventRegistered(name);
+            if(pRegistered != pData)
+            {
+                delete pData;
+            }
+            return pRegistered;
         }
     }
 
     void Profiler::startEvent(const HashedString& name, EventData* pData)
     {
-        pData->cpuStart = CpuTimer::getCurrentTimePoint();
-        pData->pGpuTimer[sGpuTimerIndex]->begin();
+        ThreadData& thread = getThreadData();
+        uint64_t now = getTimestamp();
+        thread.record(now, pData, false);
+        thread.level++;
 
-        sCurrentLevel++;
+        if(thread.isMainThread)
+        {
+            if(pData->pGpuTimer[0] == nullptr)
+            {
+                createGpuTimers(pData, sGpuTimerIndex);
+            }
+            pData->cpuStart = now;
+            pData->pGpuTimer[sGpuTimerIndex]->begin();
+        }
     }
 
 	void Profiler::endEvent(const HashedString& name, EventData* pData)
     {
-        pData->cpuEnd = CpuTimer::getCurrentTimePoint();
-        pData->cpuTotal += CpuTimer::calcDuration(pData->cpuStart, pData->cpuEnd);
+        ThreadData& thread = getThreadData();
+        uint64_t now = getTimestamp();
 
-        pData->pGpuTimer[sGpuTimerIndex]->end();
+        if(thread.isMainThread)
+        {
+            pData->cpuEnd = now;
+            pData->cpuTotal += (float)timestampToMs(pData->cpuEnd - pData->cpuStart);
+            pData->pGpuTimer[sGpuTimerIndex]->end();
+        }
 
-        sCurrentLevel--;
+        thread.record(now, pData, true);
+        thread.level--;
     }
 
     void Profiler::endFrame(std::string& profileResults)
     {
+        std::lock_guard<std::mutex> lock(getProfilerData().mutex);
         profileResults = "Name\t\t\tCPU time(ms)\t\t\tGPU time(ms)\n";
+        profileResults.reserve(profileResults.size() + sProfilerVector.size() * 80);
 
 		for (EventData* pData : sProfilerVector)
 		{
+            // Skip events which were only recorded by other threads
+            if(pData->pGpuTimer[0] == nullptr)
+            {
+                continue;
+            }
+
             double gpuTime;
 			pData->pGpuTimer[1 - sGpuTimerIndex]->getElapsedTime(true, gpuTime);
 
-			char event[1000];
-			uint32_t nameIndent = pData->level * 2 + 1;
-			uint32_t cpuIndent = 32 - (nameIndent + (uint32_t)pData->name.size());
-			sprintf_s(event, "%#*s%s %*.3f %36.3f\n", nameIndent, " ", pData->name.c_str(), cpuIndent, pData->cpuTotal, gpuTime);
+            // The label is formatted when the event is created, only the times need to be formatted every frame
+			char event[100];
+			int32_t cpuIndent = std::max(0, 32 - (int32_t)pData->label.size());
+			sprintf_s(event, "%*.3f %36.3f\n", cpuIndent, pData->cpuTotal, gpuTime);
 #if _PROFILING_LOG == 1
 			pData->cpuMs[pData->stepNr] = pData->cpuTotal;
 			pData->gpuMs[pData->stepNr] = gpuTime;
@@ -143,6 +362,7 @@ namespace Falcor
 #endif
             pData->cpuTotal = 0;
 			pData->gpuTotal = 0;
+            profileResults += pData->label;
             profileResults += event;
         }
 
@@ -169,13 +389,130 @@ namespace Falcor
 
     void Profiler::clearEvents()
     {
+        ThreadData& callingThread = getThreadData();
+        ProfilerData& data = getProfilerData();
+        std::lock_guard<std::mutex> lock(data.mutex);
         for (EventData* pData : sProfilerVector)
         {
             delete pData;
         }
         sProfilerEvents.clear();
         sProfilerVector.clear();
-        sCurrentLevel = 0;
+        callingThread.level = 0;
         sGpuTimerIndex = 0;
+
+        // Invalidate the cached and recorded references to the deleted events
+        data.generation++;
+        for(auto& pThread : data.threads)
+        {
+            pThread->firstIndex = pThread->writeIndex.load();
+        }
+    }
+
+    static void writeJsonString(std::ostream& stream, const std::string& str)
+    {
+        stream << '"';
+        for(char c : str)
+        {
+            if(c == '"' || c == '\\')
+            {
+                stream << '\\' << c;
+            }
+            else if((unsigned char)c < 0x20)
+            {
+                char escaped[8];
+                sprintf_s(escaped, "\\u%04x", c);
+                stream << escaped;
+            }
+            else
+            {
+                stream << c;
+            }
+        }
+        stream << '"';
+    }
+
+    bool Profiler::exportChromeTrace(const std::string& filename)
+    {
+        struct Record
+        {
+            uint64_t time;
+            uintptr_t event;
+        };
+
+        ProfilerData& data = getProfilerData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+
+        // Copy the records. The threads keep writing while we read, so drop the records which might have been overwritten during the copy
+        std::vector<std::vector<Record>> threadRecords(data.threads.size());
+        uint64_t baseTime = UINT64_MAX;
+        for(size_t i = 0; i < data.threads.size(); i++)
+        {
+            ThreadData& thread = *data.threads[i];
+            uint64_t end = thread.writeIndex.load(std::memory_order_acquire);
+            uint64_t begin = std::max(thread.firstIndex, end > kTraceBufferSize ? end - kTraceBufferSize : 0);
+
+            std::vector<Record> records;
+            records.reserve((size_t)(end - begin));
+            for(uint64_t r = begin; r < end; r++)
+            {
+                const TraceRecord& src = thread.pRecords[r & (kTraceBufferSize - 1)];
+                records.push_back({src.time.load(std::memory_order_acquire), src.event.load(std::memory_order_acquire)});
+            }
+
+            // The slot after the last published record might be in the middle of a write
+            uint64_t newEnd = thread.writeIndex.load(std::memory_order_acquire);
+            uint64_t firstValid = newEnd + 1 > kTraceBufferSize ? newEnd + 1 - kTraceBufferSize : 0;
+            size_t skip = (size_t)(std::min(end, std::max(begin, firstValid)) - begin);
+            records.erase(records.begin(), records.begin() + skip);
+
+            if(records.empty() == false)
+            {
+                baseTime = std::min(baseTime, records.front().time);
+            }
+            threadRecords[i] = std::move(records);
+        }
+
+        std::ofstream stream(filename);
+        if(stream.fail())
+        {
+            logError("Can't open profiler trace file " + filename);
+            return false;
+        }
+
+        stream << "{\"traceEvents\":[\n";
+        bool first = true;
+        char buffer[128];
+        for(size_t i = 0; i < threadRecords.size(); i++)
+        {
+            // Thread-name metadata
+            stream << (first ? "" : ",\n");
+            first = false;
+            sprintf_s(buffer, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":", (uint32_t)i);
+            stream << buffer;
+            writeJsonString(stream, data.threads[i]->isMainThread ? "Main thread" : "Thread " + std::to_string(i));
+            stream << "}}";
+
+            // Records which were overwritten can leave end records without a matching begin record
+            uint32_t depth = 0;
+            for(const Record& r : threadRecords[i])
+            {
+                bool isEnd = (r.event & 1) != 0;
+                if(isEnd && depth == 0)
+                {
+                    continue;
+                }
+                depth = isEnd ? depth - 1 : depth + 1;
+
+                const EventData* pEvent = (const EventData*)(r.event & ~(uintptr_t)1);
+                double us = timestampToMs(r.time - baseTime) * 1000.0;
+                stream << ",\n{\"name\":";
+                writeJsonString(stream, pEvent->name);
+                sprintf_s(buffer, ",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":0,\"tid\":%u}", isEnd ? 'E' : 'B', us, (uint32_t)i);
+                stream << buffer;
+            }
+        }
+        stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+        return stream.good();
     }
 }
\ No newline at end of file
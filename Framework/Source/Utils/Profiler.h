@@ -30,6 +30,7 @@
 #include <map>
 #include <functional>
 #include <vector>
+#include <intrin.h>
 #include "API/GpuTimer.h"
 #include "Utils/CpuTimer.h"
 #include "FalcorConfig.h"
@@ -55,6 +56,8 @@ namespace Falcor
         This class uses the most accurately available CPU and GPU timers to profile given events. It automatically creates event hierarchies based on the order of the calls made.
         This class uses a double-buffering scheme for GPU profiling to avoid GPU stalls.
         CProfilerEvent is a wrapper class which together with scoping can simplify event profiling.
+        Events can be recorded from any thread. Every thread writes its events into its own ring buffer, which can be saved using exportChromeTrace(). Only the events recorded by the main thread
+        are timed on the GPU and reported by endFrame().
     */
     class Profiler
     {
@@ -69,11 +72,12 @@ namespace Falcor
 			virtual ~EventData() {}
             std::string name;
             GpuTimer::SharedPtr pGpuTimer[2];    // Double-buffering, to avoid GPU flushes
-            CpuTimer::TimePoint cpuStart;
-            CpuTimer::TimePoint cpuEnd;
+            uint64_t cpuStart;                   // CPU timestamps, see Profiler::getTimestamp()
+            uint64_t cpuEnd;
             float cpuTotal = 0;
 			float gpuTotal = 0;
             uint32_t level;
+            std::string label;                   // The indented name, as printed by endFrame()
 #if _PROFILING_LOG == 1
 			int stepNr = 0;
 			int filesWritten = 0;
@@ -91,6 +95,7 @@ namespace Falcor
             \param[in] Name The event name.
 			\param[in] Event The event if previously looked up.
 			\note This version supports dropping the event-lookup if the event is already available.
+			\note The event must be ended by the thread which started it.
         */
 		static void startEvent(const HashedString& name, EventData *pEvent);
 
@@ -132,13 +137,28 @@ namespace Falcor
 
         /** Clears all the events. 
             Useful if you want to start profiling a different technique with different events.
+            Must not be called while other threads are recording events.
         */
         static void clearEvents();
 
+        /** Write the events recorded by all the threads to a file in the Chrome Trace Event format, which can be opened in chrome://tracing or Perfetto.
+            Every thread only keeps its most recent events, so for long runs the file contains the last few seconds.
+            \param[in] filename The output file
+            \return true on success, otherwise false
+        */
+        static bool exportChromeTrace(const std::string& filename);
+
+        /** Read the CPU timestamp used to time the events. This reads the time stamp counter directly, which is several times cheaper than CpuTimer::getCurrentTimePoint()
+        */
+        static uint64_t getTimestamp() { return __rdtsc(); }
+
+        /** Convert a difference between two timestamps to milliseconds
+        */
+        static double timestampToMs(uint64_t ticks);
+
     private:
         static std::map<size_t, EventData*> sProfilerEvents;
         static std::vector<EventData*> sProfilerVector;
-        static uint32_t sCurrentLevel;
         static uint32_t sGpuTimerIndex;
     };
 
@@ -150,14 +170,16 @@ namespace Falcor
     {
     public:
         /** C'tor
+            \param[in] name The event name. Must outlive the object
         */
-        ProfilerEvent(const HashedString& name) : mName(name) { if(gProfileEnabled) { Profiler::startEvent(name); } }
+        ProfilerEvent(const HashedString& name) : mName(name) { if(gProfileEnabled) { mpEvent = Profiler::getEvent(name); Profiler::startEvent(name, mpEvent); } }
         /** D'tor
         */
-        ~ProfilerEvent() { if(gProfileEnabled) {Profiler::endEvent(mName); }}
+        ~ProfilerEvent() { if(mpEvent) {Profiler::endEvent(mName, mpEvent); }}
 
     private:
-        const HashedString mName;
+        const HashedString& mName;
+        Profiler::EventData* mpEvent = nullptr;
     };
 
 #if _PROFILING_ENABLED
@@ -0,0 +1,102 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "RadixSort.h"
+#include <algorithm>
+#include <string.h>
+
+namespace Falcor
+{
+    static const uint32_t kDigitBits = 8;
+    static const uint32_t kDigitCount = 1 << kDigitBits;
+    static const uint32_t kPassCount = 64 / kDigitBits;
+
+    void RadixSort::sort(uint64_t* pKeys, uint32_t* pValues, uint32_t count)
+    {
+        if(count < 2)
+        {
+            return;
+        }
+
+        uint32_t histograms[kPassCount][kDigitCount];
+        memset(histograms, 0, sizeof(histograms));
+        for(uint32_t i = 0; i < count; i++)
+        {
+            uint64_t key = pKeys[i];
+            for(uint32_t pass = 0; pass < kPassCount; pass++)
+            {
+                histograms[pass][(key >> (pass * kDigitBits)) & (kDigitCount - 1)]++;
+            }
+        }
+
+        mScratchKeys.resize(count);
+        mScratchValues.resize(count);
+        uint64_t* pSrcKeys = pKeys;
+        uint32_t* pSrcValues = pValues;
+        uint64_t* pDstKeys = mScratchKeys.data();
+        uint32_t* pDstValues = mScratchValues.data();
+
+        for(uint32_t pass = 0; pass < kPassCount; pass++)
+        {
+            uint32_t* pHistogram = histograms[pass];
+            const uint32_t shift = pass * kDigitBits;
+
+            // All the keys have the same digit, the pass wouldn't change the order
+            if(pHistogram[(pSrcKeys[0] >> shift) & (kDigitCount - 1)] == count)
+            {
+                continue;
+            }
+
+            // Convert the counts into the first output index of every digit
+            uint32_t offset = 0;
+            for(uint32_t digit = 0; digit < kDigitCount; digit++)
+            {
+                uint32_t digitCount = pHistogram[digit];
+                pHistogram[digit] = offset;
+                offset += digitCount;
+            }
+
+            for(uint32_t i = 0; i < count; i++)
+            {
+                uint32_t dst = pHistogram[(pSrcKeys[i] >> shift) & (kDigitCount - 1)]++;
+                pDstKeys[dst] = pSrcKeys[i];
+                pDstValues[dst] = pSrcValues[i];
+            }
+
+            std::swap(pSrcKeys, pDstKeys);
+            std::swap(pSrcValues, pDstValues);
+        }
+
+        // After an odd number of passes the result is in the scratch buffers
+        if(pSrcKeys != pKeys)
+        {
+            memcpy(pKeys, pSrcKeys, count * sizeof(uint64_t));
+            memcpy(pValues, pSrcValues, count * sizeof(uint32_t));
+        }
+    }
+}
@@ -0,0 +1,58 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+
+namespace Falcor
+{
+    /*!
+    *  \addtogroup Falcor
+    *  @{
+    */
+
+    /** Least-significant-digit radix sort of 64-bit keys with a 32-bit value each.
+        The sort is stable and runs in 8 passes of 8 bits. All the digit histograms are computed in a single pass over the keys, and passes in which every key has the same digit are skipped, so sorting keys which only use a few bits is cheap.
+        The object owns the scratch buffers, so reusing it avoids allocations.
+    */
+    class RadixSort
+    {
+    public:
+        /** Sort keys in ascending order and reorder the values with them
+            \param[in,out] pKeys The keys
+            \param[in,out] pValues The values. pValues[i] is moved together with pKeys[i]
+            \param[in] count Number of keys
+        */
+        void sort(uint64_t* pKeys, uint32_t* pValues, uint32_t count);
+
+    private:
+        std::vector<uint64_t> mScratchKeys;
+        std::vector<uint32_t> mScratchValues;
+    };
+
+    /*! @} */
+}
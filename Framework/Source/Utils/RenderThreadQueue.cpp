@@ -0,0 +1,122 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "RenderThreadQueue.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace Falcor
+{
+    struct QueuedFunc
+    {
+        const RenderThreadQueue::Func* pFunc;
+        bool done = false;
+    };
+
+    struct RenderThreadQueueData
+    {
+        std::mutex mutex;
+        std::condition_variable cond;           // Signaled when a function is queued or executed, and when the jobs complete
+        std::deque<QueuedFunc*> queue;
+        bool isWaiting = false;
+        bool jobsFinished = false;
+        std::thread::id renderThread;
+    };
+
+    static RenderThreadQueueData& getData()
+    {
+        static RenderThreadQueueData sData;
+        return sData;
+    }
+
+    void RenderThreadQueue::execute(const Func& func)
+    {
+        auto& data = getData();
+        std::unique_lock<std::mutex> lock(data.mutex);
+        if(data.isWaiting == false || data.renderThread == std::this_thread::get_id())
+        {
+            lock.unlock();
+            func();
+            return;
+        }
+
+        QueuedFunc entry;
+        entry.pFunc = &func;
+        data.queue.push_back(&entry);
+        data.cond.notify_all();
+        data.cond.wait(lock, [&entry]() { return entry.done; });
+    }
+
+    void RenderThreadQueue::runJobs(uint32_t count, const JobFunc& func)
+    {
+        auto& data = getData();
+        {
+            std::lock_guard<std::mutex> lock(data.mutex);
+            assert(data.isWaiting == false);
+            data.isWaiting = true;
+            data.jobsFinished = false;
+            data.renderThread = std::this_thread::get_id();
+        }
+
+        std::vector<JobSystem::JobHandle> jobs(count);
+        for(uint32_t i = 0; i < count; i++)
+        {
+            jobs[i] = JobSystem::run([&func, i]() { func(i); });
+        }
+
+        // Waiting with JobSystem::wait() could run one of the jobs on this thread, and block it while the job waits for a job which is itself blocked in execute(). A continuation signals the completion instead
+        JobSystem::run([&data]()
+        {
+            std::lock_guard<std::mutex> lock(data.mutex);
+            data.jobsFinished = true;
+            data.cond.notify_all();
+        }, jobs);
+
+        std::unique_lock<std::mutex> lock(data.mutex);
+        while(true)
+        {
+            data.cond.wait(lock, [&data]() { return data.jobsFinished || data.queue.empty() == false; });
+            if(data.queue.empty())
+            {
+                break;
+            }
+
+            QueuedFunc* pEntry = data.queue.front();
+            data.queue.pop_front();
+            lock.unlock();
+            (*pEntry->pFunc)();
+            lock.lock();
+            pEntry->done = true;
+            data.cond.notify_all();
+        }
+
+        data.isWaiting = false;
+    }
+}
@@ -0,0 +1,71 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <functional>
+#include <vector>
+#include "Utils/JobSystem.h"
+
+namespace Falcor
+{
+    /*!
+    *  \addtogroup Falcor
+    *  @{
+    */
+
+    /** Forwards work which must run on the render thread from jobs to the render thread.
+        The render thread starts the jobs with runJobs(), and executes the functions queued by the jobs until they complete. Use it for work which records commands on the render context, such as creating resources with initial data.
+        Outside of runJobs(), functions are executed directly by the calling thread.
+    */
+    class RenderThreadQueue
+    {
+    public:
+        using Func = std::function<void()>;
+        using JobFunc = std::function<void(uint32_t)>;
+
+        /** Execute a function on the render thread. If a thread is inside runJobs() and it isn't the calling thread, the function is queued and the call blocks until it was executed. Otherwise the function is called directly
+        */
+        static void execute(const Func& func);
+
+        /** Execute a function which returns a value on the render thread. See execute()
+        */
+        template<typename ResultFunc>
+        static auto call(const ResultFunc& func) -> decltype(func())
+        {
+            decltype(func()) result;
+            execute([&result, &func]() { result = func(); });
+            return result;
+        }
+
+        /** Call func(index) for every index in [0, count), each one in its own job, and execute the functions the jobs queue on the calling thread until they all complete.
+            The calling thread doesn't run any jobs itself, so it must not be a job. Only one thread can run jobs this way at a time.
+        */
+        static void runJobs(uint32_t count, const JobFunc& func);
+    };
+
+    /*! @} */
+}
@@ -30,3 +30,13 @@
 
 #define SLANG_INCLUDE_IMPLEMENTATION
 #include "Externals/slang/slang.h"
+
+namespace Falcor
+{
+    /** Identifies the build of the Slang sources included above. This file is recompiled whenever one of them changes, so the tag changes with them
+    */
+    const char* getSlangBuildTag()
+    {
+        return "slang " __DATE__ " " __TIME__;
+    }
+}
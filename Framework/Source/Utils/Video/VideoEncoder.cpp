@@ -29,6 +29,7 @@
 #include "VideoEncoder.h"
 #include "Utils/BinaryFileStream.h"
 #include <direct.h>
+#include <algorithm>
 extern "C"
 {
 #include "libavcodec/avcodec.h"
@@ -38,6 +39,8 @@ extern "C"
 
 namespace Falcor
 {
+    static const uint32_t kMaxConvertThreads = 4;
+
     AVPixelFormat getPictureFormatFromCodec(AVCodecID codec)
     {
         switch(codec)
@@ -175,7 +178,7 @@ namespace Falcor
         return pFrame;
     }
 
-    bool openVideo(AVCodec* pCodec, AVCodecContext* pCodecCtx, AVFrame*& pFrame, const std::string& filename)
+    bool openVideo(AVCodec* pCodec, AVCodecContext* pCodecCtx, const std::string& filename)
     {
         AVDictionary* param = nullptr;
 
@@ -197,13 +200,6 @@ namespace Falcor
             return error(filename, "Can't open video codec.");
         }
         av_dict_free(&param);
-
-        // create a frame
-        pFrame = allocateFrame(pCodecCtx->pix_fmt, pCodecCtx->width, pCodecCtx->height, filename);
-        if(pFrame == nullptr)
-        {
-            return false;
-        }
         return true;
     }
 
@@ -264,7 +260,7 @@ namespace Falcor
         }
 
         // Open the video stream
-        if(openVideo(pVideoCodec, mpCodecContext, mpFrame, mFilename) == false)
+        if(openVideo(pVideoCodec, mpCodecContext, mFilename) == false)
         {
             return false;
         }
@@ -292,20 +288,44 @@ namespace Falcor
 
         mForamt = desc.format;
         mRowPitch = getInputFormatBytesPerPixel(desc.format) * desc.width;
-        if(desc.flipY)
+        mHeight = desc.height;
+        mFlipY = desc.flipY;
+
+        // The codec is usually multi-threaded itself, so leave some cores for it
+        uint32_t convertThreadCount = std::max(1u, std::min(kMaxConvertThreads, std::thread::hardware_concurrency() / 2));
+        for(uint32_t i = 0; i < convertThreadCount; i++)
+        {
+            SwsContext* pSwsContext = sws_getContext(desc.width, desc.height, getPictureFormatFromFalcorFormat(desc.format), desc.width, desc.height, mpCodecContext->pix_fmt, SWS_POINT, nullptr, nullptr, nullptr);
+            if(pSwsContext == nullptr)
+            {
+                return error(mFilename, "Failed to allocate SWScale context");
+            }
+            mSwsContexts.push_back(pSwsContext);
+        }
+
+        // Allocate the frame pool. It holds the frames being converted, plus one frame being filled by appendFrame() and one being encoded
+        mFramePool.resize(convertThreadCount + 2);
+        for(auto& frame : mFramePool)
         {
-            mpFlippedImage = new uint8_t[desc.height * mRowPitch];
+            frame.image.resize(mHeight * mRowPitch);
+            frame.pFrame = allocateFrame(mpCodecContext->pix_fmt, mpCodecContext->width, mpCodecContext->height, mFilename);
+            if(frame.pFrame == nullptr)
+            {
+                return false;
+            }
+            mFreeFrames.push_back(&frame);
         }
 
-        mpSwsContext = sws_getContext(desc.width, desc.height, getPictureFormatFromFalcorFormat(desc.format), desc.width, desc.height, mpCodecContext->pix_fmt, SWS_POINT, nullptr, nullptr, nullptr);
-        if(mpSwsContext == nullptr)
+        // Start the pipeline
+        for(uint32_t i = 0; i < convertThreadCount; i++)
         {
-            return error(mFilename, "Failed to allocate SWScale context");
+            mConvertThreads.push_back(std::thread(&VideoEncoder::convertFramesThreadFunc, this, i));
         }
+        mEncodeThread = std::thread(&VideoEncoder::encodeFramesThreadFunc, this);
         return true;
     }
 
-    bool flush(AVCodecContext* pCodecContext, AVFormatContext* pOutputContext, AVStream* pOutputStream, const std::string& filename)
+    bool flush(AVCodecContext* pCodecContext, AVFormatContext* pOutputContext, AVStream* pOutputStream, std::string& errorMsg)
     {
         while(true)
         {
@@ -320,7 +340,7 @@ namespace Falcor
             }
             else if(r < 0)
             {
-                error(filename, "Can't retrieve packet");
+                errorMsg = "Can't retrieve packet";
                 return false;
             }
 
@@ -332,71 +352,225 @@ namespace Falcor
             {
                 char msg[1024];
                 av_make_error_string(msg, 1024, r);
-                error(filename, "Failed when writing encoded frame to file");
+                errorMsg = std::string("Failed when writing encoded frame to file. ") + msg;
                 return false;
             }
         }
     }
 
+    void VideoEncoder::setWorkerError(const std::string& msg)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if(mWorkerError.empty())
+        {
+            mWorkerError = msg;
+        }
+    }
+
+    void VideoEncoder::convertFramesThreadFunc(uint32_t threadIndex)
+    {
+        SwsContext* pSwsContext = mSwsContexts[threadIndex];
+        while(true)
+        {
+            Frame* pFrame;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mFrameQueued.wait(lock, [this]() { return mStopping || mQueuedFrames.empty() == false; });
+                if(mQueuedFrames.empty())
+                {
+                    return;
+                }
+                pFrame = mQueuedFrames.front();
+                mQueuedFrames.pop_front();
+            }
+
+            // The codec might still hold a reference to the frame's buffers from the last time the frame was encoded
+            if(av_frame_make_writable(pFrame->pFrame) < 0)
+            {
+                setWorkerError("Can't make video frame writable");
+            }
+            else
+            {
+                uint8_t* src[AV_NUM_DATA_POINTERS] = {0};
+                int32_t rowPitch[AV_NUM_DATA_POINTERS] = {0};
+                src[0] = pFrame->image.data();
+                rowPitch[0] = (int32_t)mRowPitch;
+
+                // Scale and convert the image
+                sws_scale(pSwsContext, src, rowPitch, 0, (int)mHeight, pFrame->pFrame->data, pFrame->pFrame->linesize);
+            }
+            pFrame->pFrame->pts = (int64_t)pFrame->index;
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mConvertedFrames.push_back(pFrame);
+            }
+            mFrameConverted.notify_one();
+        }
+    }
+
+    void VideoEncoder::encodeFramesThreadFunc()
+    {
+        bool failed = false;
+        while(true)
+        {
+            Frame* pFrame = nullptr;
+            {
+                // Frames can finish the conversion out of order. Wait for the next one
+                std::unique_lock<std::mutex> lock(mMutex);
+                auto findNextFrame = [this]() { return std::find_if(mConvertedFrames.begin(), mConvertedFrames.end(), [this](const Frame* pFrame) { return pFrame->index == mNextEncodeIndex; }); };
+                mFrameConverted.wait(lock, [&]() { return (mStopping && mNextEncodeIndex == mNextFrameIndex) || findNextFrame() != mConvertedFrames.end(); });
+                auto it = findNextFrame();
+                if(it == mConvertedFrames.end())
+                {
+                    return;
+                }
+                pFrame = *it;
+                mConvertedFrames.erase(it);
+                failed = failed || (mWorkerError.empty() == false);
+            }
+
+            // Once an error occurred, keep draining the pipeline so that appendFrame() doesn't block
+            if(failed == false)
+            {
+                std::string errorMsg;
+                int r = avcodec_send_frame(mpCodecContext, pFrame->pFrame);
+                if(r == AVERROR(EAGAIN))
+                {
+                    // The codec's output queue is full. Write the pending packets and try again
+                    if(flush(mpCodecContext, mpOutputContext, mpOutputStream, errorMsg))
+                    {
+                        r = avcodec_send_frame(mpCodecContext, pFrame->pFrame);
+                    }
+                }
+
+                if(errorMsg.empty() && r < 0)
+                {
+                    errorMsg = "Can't send video frame";
+                }
+
+                if(errorMsg.empty() == false || flush(mpCodecContext, mpOutputContext, mpOutputStream, errorMsg) == false)
+                {
+                    setWorkerError(errorMsg);
+                    failed = true;
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mNextEncodeIndex++;
+                mFreeFrames.push_back(pFrame);
+            }
+            mFrameFreed.notify_one();
+        }
+    }
+
     void VideoEncoder::endCapture()
     {
+        // Wait for the queued frames to be encoded
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopping = true;
+        }
+        mFrameQueued.notify_all();
+        mFrameConverted.notify_all();
+        for(auto& t : mConvertThreads)
+        {
+            t.join();
+        }
+        mConvertThreads.clear();
+        if(mEncodeThread.joinable())
+        {
+            mEncodeThread.join();
+        }
+
+        if(mWorkerError.empty() == false && mWorkerErrorLogged == false)
+        {
+            error(mFilename, mWorkerError);
+            mWorkerErrorLogged = true;
+        }
+
         if(mpOutputContext)
         {
             // Flush the codex
+            std::string errorMsg;
             avcodec_send_frame(mpCodecContext, nullptr);
-            flush(mpCodecContext, mpOutputContext, mpOutputStream, mFilename);
+            if(flush(mpCodecContext, mpOutputContext, mpOutputStream, errorMsg) == false)
+            {
+                error(mFilename, errorMsg);
+            }
 
             av_write_trailer(mpOutputContext);
 
             avio_closep(&mpOutputContext->pb);
             avcodec_free_context(&mpCodecContext);
-            av_frame_free(&mpFrame);
-            sws_freeContext(mpSwsContext);
             avformat_free_context(mpOutputContext);
             mpOutputContext = nullptr;
             mpOutputStream = nullptr;
         }
-        safe_delete(mpFlippedImage)
+
+        for(auto& frame : mFramePool)
+        {
+            av_frame_free(&frame.pFrame);
+        }
+        mFramePool.clear();
+        mFreeFrames.clear();
+        mQueuedFrames.clear();
+        mConvertedFrames.clear();
+
+        for(SwsContext* pSwsContext : mSwsContexts)
+        {
+            sws_freeContext(pSwsContext);
+        }
+        mSwsContexts.clear();
     }
 
     void VideoEncoder::appendFrame(const void* pData)
     {
-        if(mpFlippedImage)
+        Frame* pFrame;
         {
-            // Flip the image
-            for(int32_t h = 0; h < mpCodecContext->height; h++)
+            std::unique_lock<std::mutex> lock(mMutex);
+            if(mWorkerError.empty() == false)
+            {
+                if(mWorkerErrorLogged == false)
+                {
+                    error(mFilename, mWorkerError);
+                    mWorkerErrorLogged = true;
+                }
+                return;
+            }
+
+            if(mStopping || mFramePool.empty())
             {
-                const uint8_t* pSrc = (uint8_t*)pData + h * mRowPitch;
-                uint8_t* pDst = mpFlippedImage + (mpCodecContext->height - 1 - h) * mRowPitch;
-                memcpy(pDst, pSrc, mRowPitch);
+                return;
             }
 
-            pData = mpFlippedImage;
+            // Wait for a free frame. This throttles the caller if the encoder can't keep up
+            mFrameFreed.wait(lock, [this]() { return mFreeFrames.empty() == false; });
+            pFrame = mFreeFrames.back();
+            mFreeFrames.pop_back();
         }
 
-        uint8_t* src[AV_NUM_DATA_POINTERS] = {0};
-        int32_t rowPitch[AV_NUM_DATA_POINTERS] = {0};
-        src[0] = (uint8_t*)pData;
-        rowPitch[0] = (int32_t)mRowPitch;
-
-        // Scale and convert the image
-        sws_scale(mpSwsContext, src, rowPitch, 0, mpCodecContext->height, mpFrame->data, mpFrame->linesize);
-
-        // Encode the frame
-        int r = avcodec_send_frame(mpCodecContext, mpFrame);
-        mpFrame->pts++;
-        if(r == AVERROR(EAGAIN))
+        // Copy the image. We copy it anyway, so flipping it here is free
+        const uint8_t* pSrc = (const uint8_t*)pData;
+        if(mFlipY)
         {
-            if(flush(mpCodecContext, mpOutputContext, mpOutputStream, mFilename) == false)
+            for(uint32_t h = 0; h < mHeight; h++)
             {
-                return;
+                memcpy(pFrame->image.data() + (mHeight - 1 - h) * mRowPitch, pSrc + h * mRowPitch, mRowPitch);
             }
         }
-        else if(r < 0)
+        else
+        {
+            memcpy(pFrame->image.data(), pSrc, pFrame->image.size());
+        }
+
         {
-            error(mFilename, "Can't send video frame");
-            return;
+            std::lock_guard<std::mutex> lock(mMutex);
+            pFrame->index = mNextFrameIndex++;
+            mQueuedFrames.push_back(pFrame);
         }
+        mFrameQueued.notify_one();
     }
 
     const std::string VideoEncoder::getSupportedContainerForCodec(CodecID codec)
@@ -27,6 +27,11 @@
 ***************************************************************************/
 #pragma once
 #include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 struct AVFormatContext;
 struct AVStream;
@@ -72,7 +77,15 @@ namespace Falcor
         ~VideoEncoder();
 
         static UniquePtr create(const Desc& desc);
+
+        /** Queue a frame for encoding. The image is copied into a buffer from the frame pool and the function returns without waiting for the conversion and encoding, which are done by worker threads.
+            If all the buffers in the pool are in use, the function waits until the oldest queued frame is encoded.
+            \param[in] pData The image. Its layout is described by the Desc passed to create()
+        */
         void appendFrame(const void* pData);
+
+        /** Wait for all the queued frames to be encoded, and close the file
+        */
         void endCapture();
 
         static const std::string getSupportedContainerForCodec(CodecID codec);
@@ -80,15 +93,45 @@ namespace Falcor
         VideoEncoder(const std::string& filename);
         bool init(const Desc& desc);
 
+        struct Frame
+        {
+            std::vector<uint8_t> image;     // The input image, top row first
+            AVFrame* pFrame = nullptr;      // The image converted to the codec's pixel format
+            uint64_t index = 0;             // The frame's position in the video
+        };
+
+        void convertFramesThreadFunc(uint32_t threadIndex);
+        void encodeFramesThreadFunc();
+        void setWorkerError(const std::string& msg);
+
         AVFormatContext* mpOutputContext = nullptr;
         AVStream*        mpOutputStream  = nullptr;
-        AVFrame*         mpFrame         = nullptr;
-        SwsContext*      mpSwsContext    = nullptr;
         AVCodecContext*  mpCodecContext = nullptr;
 
         const std::string mFilename;
         InputFormat mForamt;
         uint32_t mRowPitch = 0;
-        uint8_t* mpFlippedImage = nullptr; // Used in case the image memory layout if bottom->top
+        uint32_t mHeight = 0;
+        bool mFlipY = false;
+
+        // Frame pipeline. appendFrame() copies the image into a free frame, the conversion threads convert queued frames into the codec's pixel format (in any order),
+        // and the encode thread encodes the converted frames in order and returns them to the pool.
+        std::vector<Frame> mFramePool;
+        std::vector<Frame*> mFreeFrames;
+        std::deque<Frame*> mQueuedFrames;
+        std::vector<Frame*> mConvertedFrames;
+        std::vector<SwsContext*> mSwsContexts;      // One per conversion thread
+        std::vector<std::thread> mConvertThreads;
+        std::thread mEncodeThread;
+
+        std::mutex mMutex;
+        std::condition_variable mFrameFreed;
+        std::condition_variable mFrameQueued;
+        std::condition_variable mFrameConverted;
+        uint64_t mNextFrameIndex = 0;               // Index of the next frame passed to appendFrame()
+        uint64_t mNextEncodeIndex = 0;              // Index of the next frame to encode
+        bool mStopping = false;
+        std::string mWorkerError;                   // First error reported by the worker threads. The logger isn't thread-safe, so it's logged by the main thread
+        bool mWorkerErrorLogged = false;
     };
 }
\ No newline at end of file
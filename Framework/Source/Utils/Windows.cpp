@@ -267,6 +267,64 @@ namespace Falcor
         return false;
     }
 
+    bool mapFileToMemory(const std::string& fullpath, MappedFile& mappedFile)
+    {
+        mappedFile = MappedFile();
+        HANDLE hFile = CreateFileA(fullpath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+        if (GetFileSizeEx(hFile, &fileSize) == FALSE)
+        {
+            CloseHandle(hFile);
+            return false;
+        }
+        mappedFile.pFileHandle = hFile;
+        mappedFile.size = (uint64_t)fileSize.QuadPart;
+
+        // Empty files can't be mapped. Treat them as a valid, zero-sized view
+        if (mappedFile.size == 0)
+        {
+            return true;
+        }
+
+        HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (hMapping == nullptr)
+        {
+            unmapFileFromMemory(mappedFile);
+            return false;
+        }
+        mappedFile.pMappingHandle = hMapping;
+
+        mappedFile.pData = (const uint8_t*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+        if (mappedFile.pData == nullptr)
+        {
+            unmapFileFromMemory(mappedFile);
+            return false;
+        }
+        return true;
+    }
+
+    void unmapFileFromMemory(MappedFile& mappedFile)
+    {
+        if (mappedFile.pData)
+        {
+            UnmapViewOfFile(mappedFile.pData);
+        }
+        if (mappedFile.pMappingHandle)
+        {
+            CloseHandle((HANDLE)mappedFile.pMappingHandle);
+        }
+        if (mappedFile.pFileHandle)
+        {
+            CloseHandle((HANDLE)mappedFile.pFileHandle);
+        }
+        mappedFile = MappedFile();
+    }
+
     bool findAvailableFilename(const std::string& prefix, const std::string& directory, const std::string& extension, std::string& filename)
     {
         for (UINT32 i = 0; i < UINT32_MAX; i++)
@@ -463,6 +521,41 @@ namespace Falcor
         return s.st_mtime;
     }
 
+    bool touchFile(const std::string& filename)
+    {
+        HANDLE hFile = CreateFileA(filename.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        FILETIME now;
+        GetSystemTimeAsFileTime(&now);
+        BOOL res = SetFileTime(hFile, nullptr, nullptr, &now);
+        CloseHandle(hFile);
+        return res == TRUE;
+    }
+
+    uint64_t getFileSize(const std::string& filename)
+    {
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (GetFileAttributesExA(filename.c_str(), GetFileExInfoStandard, &data) == FALSE)
+        {
+            return 0;
+        }
+        return ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    }
+
+    bool moveFile(const std::string& src, const std::string& dst)
+    {
+        return MoveFileExA(src.c_str(), dst.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) == TRUE;
+    }
+
+    bool deleteFile(const std::string& filename)
+    {
+        return DeleteFileA(filename.c_str()) == TRUE;
+    }
+
     uint64_t getTotalVirtualMemory()
     {
         MEMORYSTATUSEX memInfo;
@@ -0,0 +1,113 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "BinaryModelImporterTest.h"
+#include "TestHelper.h"
+#include "Utils/CpuTimer.h"
+#include "Utils/JobSystem.h"
+#include <thread>
+
+const std::string BinaryModelImporterTest::kModelFile = "BinaryModelImporterTest.bin";
+
+static const uint32_t kMeshCount = 4096;
+static const uint32_t kGridSize = 32;    // Vertices per side of every mesh
+static const uint32_t kLoadCount = 5;
+
+void BinaryModelImporterTest::addTests()
+{
+    addTestToList<TestDecodeThroughput>();
+}
+
+void BinaryModelImporterTest::onInit()
+{
+    Model::SharedPtr pModel = Model::create();
+    for(uint32_t i = 0; i < kMeshCount; i++)
+    {
+        pModel->addMeshInstance(TestHelper::createGridMesh(i, kGridSize), glm::mat4());
+    }
+    pModel->exportToBinaryFile(kModelFile);
+}
+
+testing_func(BinaryModelImporterTest, TestDecodeThroughput)
+{
+    if(doesFileExist(kModelFile) == false)
+    {
+        return test_fail("Failed to export the test model");
+    }
+
+    // The meshes are decoded by the job system, so compare a single worker with all the cores
+    const uint32_t workerCounts[] = { 1, std::max(1u, std::thread::hardware_concurrency()) };
+    const double fileSizeMB = double(getFileSize(kModelFile)) / (1024 * 1024);
+    std::string perf;
+    float singleWorkerTime = 0;
+    for(uint32_t workerCount : workerCounts)
+    {
+        JobSystem::shutdown();
+        JobSystem::init(workerCount);
+
+        float totalTime = 0;
+        for(uint32_t i = 0; i < kLoadCount; i++)
+        {
+            CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+            Model::SharedPtr pModel = Model::createFromFile(kModelFile.c_str(), Model::LoadFlags::None);
+            totalTime += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+            if(pModel == nullptr)
+            {
+                return test_fail("Failed to load the test model");
+            }
+            if(pModel->getMeshCount() != kMeshCount || pModel->getVertexCount() != kMeshCount * kGridSize * kGridSize)
+            {
+                return test_fail("Loaded model doesn't match the exported model");
+            }
+        }
+
+        const float loadTime = totalTime / kLoadCount;
+        if(workerCount == 1)
+        {
+            singleWorkerTime = loadTime;
+        }
+
+        const std::string workers = std::to_string(workerCount) + (workerCount == 1 ? " worker" : " workers");
+        perf += TestHelper::formatPerfResult(workers + " load time", loadTime, "ms");
+        perf += TestHelper::formatPerfResult(workers + " throughput", fileSizeMB * 1000 / loadTime, "MB/s");
+        perf += TestHelper::formatPerfResult(workers + " meshes", kMeshCount * 1000 / loadTime, "meshes/s");
+        perf += TestHelper::formatPerfResult(workers + " speedup", singleWorkerTime / loadTime, "x");
+    }
+
+    JobSystem::shutdown();
+    JobSystem::init();
+    return test_pass_perf(perf);
+}
+
+int main()
+{
+    BinaryModelImporterTest bmit;
+    bmit.init(true);
+    bmit.run();
+    return 0;
+}
@@ -0,0 +1,238 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "BitmapTest.h"
+#include "TestHelper.h"
+#include "Utils/Bitmap.h"
+#include "Utils/CpuTimer.h"
+
+// A smooth gradient with some noise, so that the files don't compress unrealistically well
+static std::vector<uint8_t> createImage(uint32_t width, uint32_t height, uint32_t seed)
+{
+    std::vector<uint8_t> image((size_t)width * height * 4);
+    uint32_t noise = seed * 2654435761u + 1;
+    for(uint32_t y = 0; y < height; y++)
+    {
+        for(uint32_t x = 0; x < width; x++)
+        {
+            noise = noise * 1664525u + 1013904223u;
+            uint8_t* pPixel = image.data() + ((size_t)y * width + x) * 4;
+            pPixel[0] = uint8_t(x * 255 / width + (noise >> 29));
+            pPixel[1] = uint8_t(y * 255 / height + (noise >> 26 & 7));
+            pPixel[2] = uint8_t((x + y + seed * 16) + (noise >> 23 & 7));
+            pPixel[3] = uint8_t(noise >> 8);
+        }
+    }
+    return image;
+}
+
+static bool isSameBitmap(const Bitmap* pA, const Bitmap* pB)
+{
+    if(pA == nullptr || pB == nullptr)
+    {
+        return pA == pB;
+    }
+    if(pA->getWidth() != pB->getWidth() || pA->getHeight() != pB->getHeight() || pA->getFormat() != pB->getFormat())
+    {
+        return false;
+    }
+    size_t size = (size_t)pA->getWidth() * pA->getHeight() * getFormatBytesPerBlock(pA->getFormat());
+    return memcmp(pA->getData(), pB->getData(), size) == 0;
+}
+
+void BitmapTest::addTests()
+{
+    addTestToList<TestRoundTrip>();
+    addTestToList<TestConcurrentLoads>();
+    addTestToList<TestDecodeThroughput>();
+}
+
+testing_func(BitmapTest, TestRoundTrip)
+{
+    // An odd width exercises both the vectorized and the scalar parts of the row conversions
+    const uint32_t width = 37;
+    const uint32_t height = 19;
+    const std::vector<uint8_t> image = createImage(width, height, 0);
+
+    // 32-bit BGRA files are loaded as-is
+    std::vector<uint8_t> data = image;
+    Bitmap::saveImage("BitmapTestBgra.png", width, height, Bitmap::FileFormat::PngFile, Bitmap::ExportFlags::ExportAlpha, ResourceFormat::BGRA8Unorm, true, data.data());
+    Bitmap::UniqueConstPtr pBgra = Bitmap::createFromFile("BitmapTestBgra.png", true);
+    if(pBgra == nullptr || pBgra->getFormat() != ResourceFormat::BGRA8Unorm || pBgra->getWidth() != width || pBgra->getHeight() != height)
+    {
+        return test_fail("Failed to load the 32-bit file");
+    }
+    if(memcmp(pBgra->getData(), image.data(), image.size()) != 0)
+    {
+        return test_fail("The 32-bit file doesn't match the saved image");
+    }
+
+    // 24-bit files are expanded to BGRX with an opaque alpha
+    data = image;
+    Bitmap::saveImage("BitmapTestBgr.png", width, height, Bitmap::FileFormat::PngFile, Bitmap::ExportFlags::None, ResourceFormat::BGRA8Unorm, true, data.data());
+    Bitmap::UniqueConstPtr pBgrx = Bitmap::createFromFile("BitmapTestBgr.png", true);
+    if(pBgrx == nullptr || pBgrx->getFormat() != ResourceFormat::BGRX8Unorm || pBgrx->getWidth() != width || pBgrx->getHeight() != height)
+    {
+        return test_fail("Failed to load the 24-bit file");
+    }
+    for(size_t i = 0; i < image.size(); i++)
+    {
+        uint8_t expected = ((i & 3) == 3) ? 0xff : image[i];
+        if(pBgrx->getData()[i] != expected)
+        {
+            return test_fail("The 24-bit file doesn't match the saved image at pixel " + std::to_string(i / 4));
+        }
+    }
+
+    // RGBA images are swizzled to BGRA before they are saved, and their alpha is dropped
+    data = image;
+    Bitmap::saveImage("BitmapTestRgba.png", width, height, Bitmap::FileFormat::PngFile, Bitmap::ExportFlags::ExportAlpha, ResourceFormat::RGBA8UnormSrgb, true, data.data());
+    Bitmap::UniqueConstPtr pRgba = Bitmap::createFromFile("BitmapTestRgba.png", true);
+    if(pRgba == nullptr || pRgba->getFormat() != ResourceFormat::BGRA8Unorm)
+    {
+        return test_fail("Failed to load the swizzled file");
+    }
+    for(size_t i = 0; i < image.size(); i += 4)
+    {
+        const uint8_t* pPixel = pRgba->getData() + i;
+        if(pPixel[0] != image[i + 2] || pPixel[1] != image[i + 1] || pPixel[2] != image[i + 0] || pPixel[3] != 0xff)
+        {
+            return test_fail("The swizzled file doesn't match the saved image at pixel " + std::to_string(i / 4));
+        }
+    }
+
+    // Loading bottom-up reverses the rows
+    Bitmap::UniqueConstPtr pBottomUp = Bitmap::createFromFile("BitmapTestBgra.png", false);
+    const size_t pitch = width * 4;
+    for(uint32_t y = 0; y < height; y++)
+    {
+        if(pBottomUp == nullptr || memcmp(pBottomUp->getData() + y * pitch, image.data() + (height - y - 1) * pitch, pitch) != 0)
+        {
+            return test_fail("The bottom-up layout doesn't match the saved image");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(BitmapTest, TestConcurrentLoads)
+{
+    const uint32_t fileCount = 12;
+    const uint32_t width = 256;
+    const uint32_t height = 128;
+    std::vector<std::string> filenames;
+    for(uint32_t i = 0; i < fileCount; i++)
+    {
+        std::vector<uint8_t> image = createImage(width, height, i);
+        bool isJpeg = (i % 3) == 2;
+        filenames.push_back("BitmapTestConcurrent" + std::to_string(i) + (isJpeg ? ".jpg" : ".png"));
+        Bitmap::ExportFlags flags = (i % 3) == 0 ? Bitmap::ExportFlags::ExportAlpha : Bitmap::ExportFlags::None;
+        Bitmap::saveImage(filenames.back(), width, height, isJpeg ? Bitmap::FileFormat::JpegFile : Bitmap::FileFormat::PngFile, flags, ResourceFormat::BGRA8Unorm, true, image.data());
+    }
+
+    // A file that doesn't exist. The error is expected, so don't block on the message box
+    filenames.push_back("BitmapTestMissing.png");
+    Logger::showBoxOnError(false);
+    std::vector<Bitmap::UniqueConstPtr> batch = Bitmap::createFromFiles(filenames, true);
+    std::vector<Bitmap::AsyncLoadHandle> loads;
+    for(const auto& filename : filenames)
+    {
+        loads.push_back(Bitmap::createFromFileAsync(filename, true));
+    }
+
+    // Decoding on the workers must produce exactly the same pixels as decoding on the calling thread
+    for(size_t i = 0; i < filenames.size(); i++)
+    {
+        Bitmap::UniqueConstPtr pSerial = Bitmap::createFromFile(filenames[i], true);
+        Bitmap::UniqueConstPtr pAsync = Bitmap::waitForLoad(loads[i]);
+        if(isSameBitmap(pSerial.get(), batch[i].get()) == false || isSameBitmap(pSerial.get(), pAsync.get()) == false)
+        {
+            Logger::showBoxOnError(true);
+            return test_fail("The concurrent load of " + filenames[i] + " doesn't match the serial load");
+        }
+    }
+    Logger::showBoxOnError(true);
+
+    if(batch.back() != nullptr)
+    {
+        return test_fail("Loading a missing file didn't fail");
+    }
+    return test_pass();
+}
+
+testing_func(BitmapTest, TestDecodeThroughput)
+{
+    // A typical batch of material textures, half PNG and half JPEG
+    const uint32_t fileCount = 32;
+    const uint32_t width = 1024;
+    const uint32_t height = 1024;
+    std::vector<std::string> filenames;
+    for(uint32_t i = 0; i < fileCount; i++)
+    {
+        std::vector<uint8_t> image = createImage(width, height, i);
+        bool isJpeg = (i & 1) != 0;
+        filenames.push_back("BitmapTestThroughput" + std::to_string(i) + (isJpeg ? ".jpg" : ".png"));
+        Bitmap::saveImage(filenames.back(), width, height, isJpeg ? Bitmap::FileFormat::JpegFile : Bitmap::FileFormat::PngFile, Bitmap::ExportFlags::None, ResourceFormat::BGRA8Unorm, false, image.data());
+    }
+
+    // Load once first, so that both measurements read the files from the OS cache
+    Bitmap::createFromFiles(filenames, false);
+
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    for(const auto& filename : filenames)
+    {
+        if(Bitmap::createFromFile(filename, false) == nullptr)
+        {
+            return test_fail("Failed to load " + filename);
+        }
+    }
+    double serialTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    start = CpuTimer::getCurrentTimePoint();
+    std::vector<Bitmap::UniqueConstPtr> bitmaps = Bitmap::createFromFiles(filenames, false);
+    double concurrentTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    for(const auto& pBitmap : bitmaps)
+    {
+        if(pBitmap == nullptr)
+        {
+            return test_fail("Failed to load the files concurrently");
+        }
+    }
+
+    const double megapixels = (double)fileCount * width * height * 1.0e-6;
+    std::string perf = TestHelper::formatPerfResult("Serial decode", megapixels * 1000 / serialTime, "MPix/s");
+    perf += TestHelper::formatPerfResult("Concurrent decode", megapixels * 1000 / concurrentTime, "MPix/s");
+    perf += TestHelper::formatPerfResult("Speedup", serialTime / concurrentTime, "x");
+    return test_pass_perf(perf);
+}
+
+int main()
+{
+    BitmapTest bt;
+    bt.init();
+    bt.run();
+    return 0;
+}
@@ -0,0 +1,417 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "BlockCompressorTest.h"
+#include "TestHelper.h"
+#include "Utils/BlockCompressor.h"
+#include "Utils/CpuTimer.h"
+#include <random>
+
+static const uint32_t kImageSize = 512;
+
+struct CompressedFormat
+{
+    ResourceFormat format;
+    const char* name;
+    uint32_t channelMask;       // Channels stored by the format
+    double minPsnr;             // Lowest accepted PSNR for the test image with the Normal preset
+};
+
+static const CompressedFormat kFormats[] =
+{
+    { ResourceFormat::BC1Unorm, "BC1", 0x7, 38 },
+    { ResourceFormat::BC3Unorm, "BC3", 0xf, 39 },
+    { ResourceFormat::BC4Unorm, "BC4", 0x1, 51 },
+    { ResourceFormat::BC5Unorm, "BC5", 0x3, 51 },
+    { ResourceFormat::BC7Unorm, "BC7", 0xf, 41 },
+};
+
+// Smooth gradients with some noise in the color channels and an alpha ramp. The result is deterministic
+static std::vector<uint8_t> createTestImage(uint32_t width, uint32_t height)
+{
+    std::vector<uint8_t> image(width * height * 4);
+    std::mt19937 rng(1);
+    for(uint32_t y = 0; y < height; y++)
+    {
+        for(uint32_t x = 0; x < width; x++)
+        {
+            uint8_t* pPixel = &image[(y * width + x) * 4];
+            int32_t color[3];
+            color[0] = int32_t(128 + 100 * sin(x * 0.03));
+            color[1] = int32_t(128 + 100 * cos(y * 0.021 + x * 0.01));
+            color[2] = int32_t((x * y) >> 10) & 0xff;
+            for(uint32_t c = 0; c < 3; c++)
+            {
+                pPixel[c] = (uint8_t)glm::clamp(color[c] + int32_t(rng() % 9) - 4, 0, 255);
+            }
+            pPixel[3] = uint8_t(255 * y / height);
+        }
+    }
+    return image;
+}
+
+// Reference decoders, written from the format specifications. Each decodes a 4x4 block into RGBA texels, leaving the channels the format doesn't store untouched
+
+static void expand565(uint16_t color, int32_t rgb[3])
+{
+    int32_t r = color >> 11;
+    int32_t g = (color >> 5) & 0x3f;
+    int32_t b = color & 0x1f;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+static void decodeBC1(const uint8_t* pBlock, uint8_t texels[16][4])
+{
+    uint16_t c0 = pBlock[0] | (pBlock[1] << 8);
+    uint16_t c1 = pBlock[2] | (pBlock[3] << 8);
+    int32_t palette[4][3];
+    expand565(c0, palette[0]);
+    expand565(c1, palette[1]);
+    for(uint32_t c = 0; c < 3; c++)
+    {
+        if(c0 > c1)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+
+    uint32_t indices = pBlock[4] | (pBlock[5] << 8) | (pBlock[6] << 16) | ((uint32_t)pBlock[7] << 24);
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        uint32_t index = (indices >> (2 * i)) & 3;
+        for(uint32_t c = 0; c < 3; c++)
+        {
+            texels[i][c] = (uint8_t)palette[index][c];
+        }
+    }
+}
+
+static void decodeBC4(const uint8_t* pBlock, uint8_t texels[16][4], uint32_t channel)
+{
+    int32_t palette[8] = { pBlock[0], pBlock[1] };
+    if(palette[0] > palette[1])
+    {
+        for(int32_t k = 1; k < 7; k++)
+        {
+            palette[k + 1] = ((7 - k) * palette[0] + k * palette[1] + 3) / 7;
+        }
+    }
+    else
+    {
+        for(int32_t k = 1; k < 5; k++)
+        {
+            palette[k + 1] = ((5 - k) * palette[0] + k * palette[1] + 2) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t indices = 0;
+    for(uint32_t i = 0; i < 6; i++)
+    {
+        indices |= (uint64_t)pBlock[2 + i] << (8 * i);
+    }
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        texels[i][channel] = (uint8_t)palette[(indices >> (3 * i)) & 7];
+    }
+}
+
+static uint32_t readBits(const uint8_t* pBlock, uint32_t& bit, uint32_t count)
+{
+    uint32_t value = 0;
+    for(uint32_t i = 0; i < count; i++, bit++)
+    {
+        value |= ((pBlock[bit / 8] >> (bit % 8)) & 1) << i;
+    }
+    return value;
+}
+
+// Only mode 6, which is the mode the compressor uses
+static bool decodeBC7(const uint8_t* pBlock, uint8_t texels[16][4])
+{
+    uint32_t bit = 0;
+    uint32_t mode = 0;
+    while(mode < 8 && readBits(pBlock, bit, 1) == 0)
+    {
+        mode++;
+    }
+    if(mode != 6)
+    {
+        return false;
+    }
+
+    int32_t endpoints[2][4];
+    for(uint32_t c = 0; c < 4; c++)
+    {
+        endpoints[0][c] = readBits(pBlock, bit, 7);
+        endpoints[1][c] = readBits(pBlock, bit, 7);
+    }
+    uint32_t pBits[2] = { readBits(pBlock, bit, 1), readBits(pBlock, bit, 1) };
+    for(uint32_t c = 0; c < 4; c++)
+    {
+        endpoints[0][c] = (endpoints[0][c] << 1) | pBits[0];
+        endpoints[1][c] = (endpoints[1][c] << 1) | pBits[1];
+    }
+
+    static const int32_t kWeights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        // The anchor index has an implicit 0 most significant bit
+        uint32_t index = readBits(pBlock, bit, i == 0 ? 3 : 4);
+        for(uint32_t c = 0; c < 4; c++)
+        {
+            texels[i][c] = uint8_t(((64 - kWeights[index]) * endpoints[0][c] + kWeights[index] * endpoints[1][c] + 32) >> 6);
+        }
+    }
+    return true;
+}
+
+static bool decodeBlock(const uint8_t* pBlock, ResourceFormat format, uint8_t texels[16][4])
+{
+    switch(format)
+    {
+    case ResourceFormat::BC1Unorm:
+        decodeBC1(pBlock, texels);
+        return true;
+    case ResourceFormat::BC3Unorm:
+        decodeBC4(pBlock, texels, 3);
+        decodeBC1(pBlock + 8, texels);
+        return true;
+    case ResourceFormat::BC4Unorm:
+        decodeBC4(pBlock, texels, 0);
+        return true;
+    case ResourceFormat::BC5Unorm:
+        decodeBC4(pBlock, texels, 0);
+        decodeBC4(pBlock + 8, texels, 1);
+        return true;
+    case ResourceFormat::BC7Unorm:
+        return decodeBC7(pBlock, texels);
+    default:
+        return false;
+    }
+}
+
+// Compress an RGBA8 image, decode it and compute the PSNR over the channels the format stores. Returns a negative value if a block can't be decoded
+static double compressAndMeasurePsnr(const std::vector<uint8_t>& image, uint32_t width, uint32_t height, const CompressedFormat& desc, BlockCompressor::Preset preset)
+{
+    std::vector<uint8_t> blocks(BlockCompressor::getCompressedSize(width, height, desc.format));
+    if(BlockCompressor::compress(image.data(), width, height, width * 4, ResourceFormat::RGBA8Unorm, desc.format, preset, blocks.data()) == false)
+    {
+        return -1;
+    }
+
+    const uint32_t blockSize = getFormatBytesPerBlock(desc.format);
+    const uint32_t blocksPerRow = (width + 3) / 4;
+    double squaredError = 0;
+    uint64_t sampleCount = 0;
+    for(uint32_t by = 0; by < (height + 3) / 4; by++)
+    {
+        for(uint32_t bx = 0; bx < blocksPerRow; bx++)
+        {
+            uint8_t texels[16][4] = {};
+            if(decodeBlock(&blocks[(by * blocksPerRow + bx) * blockSize], desc.format, texels) == false)
+            {
+                return -1;
+            }
+
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                // Texels outside of the image are padding
+                uint32_t x = bx * 4 + i % 4;
+                uint32_t y = by * 4 + i / 4;
+                if(x >= width || y >= height)
+                {
+                    continue;
+                }
+                for(uint32_t c = 0; c < 4; c++)
+                {
+                    if(desc.channelMask & (1 << c))
+                    {
+                        double diff = double(texels[i][c]) - double(image[(y * width + x) * 4 + c]);
+                        squaredError += diff * diff;
+                        sampleCount++;
+                    }
+                }
+            }
+        }
+    }
+
+    double mse = squaredError / double(sampleCount);
+    return (mse == 0) ? 99.0 : 10 * log10(255.0 * 255.0 / mse);
+}
+
+void BlockCompressorTest::addTests()
+{
+    addTestToList<TestPsnr>();
+    addTestToList<TestPresets>();
+    addTestToList<TestPartialBlocks>();
+    addTestToList<TestSourceFormats>();
+    addTestToList<TestThroughput>();
+}
+
+testing_func(BlockCompressorTest, TestPsnr)
+{
+    const std::vector<uint8_t> image = createTestImage(kImageSize, kImageSize);
+    for(const CompressedFormat& desc : kFormats)
+    {
+        double psnr = compressAndMeasurePsnr(image, kImageSize, kImageSize, desc, BlockCompressor::Preset::Normal);
+        if(psnr < 0)
+        {
+            return test_fail(std::string(desc.name) + " produced an invalid block");
+        }
+        if(psnr < desc.minPsnr)
+        {
+            return test_fail(std::string(desc.name) + " PSNR " + std::to_string(psnr) + " dB is below " + std::to_string(desc.minPsnr) + " dB");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(BlockCompressorTest, TestPresets)
+{
+    // The refinement passes must never make the result worse
+    const std::vector<uint8_t> image = createTestImage(kImageSize, kImageSize);
+    for(const CompressedFormat& desc : kFormats)
+    {
+        double fast = compressAndMeasurePsnr(image, kImageSize, kImageSize, desc, BlockCompressor::Preset::Fast);
+        double normal = compressAndMeasurePsnr(image, kImageSize, kImageSize, desc, BlockCompressor::Preset::Normal);
+        double highQuality = compressAndMeasurePsnr(image, kImageSize, kImageSize, desc, BlockCompressor::Preset::HighQuality);
+        if(normal < fast - 0.01 || highQuality < normal - 0.01)
+        {
+            return test_fail(std::string(desc.name) + " quality decreases with the slower presets");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(BlockCompressorTest, TestPartialBlocks)
+{
+    // Images which are not a multiple of 4 are padded by clamping to the edge, so a solid color must survive exactly, and a gradient must keep the quality of full blocks.
+    // The solid color can be represented exactly by all the formats: RGB565, and BC7 mode 6 endpoints with the same P-bit in all the channels
+    const uint8_t solidColor[4] = { 132, 130, 132, 254 };
+    const uint32_t sizes[] = { 1, 2, 3, 5, 13, 31 };
+    for(uint32_t width : sizes)
+    {
+        for(uint32_t height : sizes)
+        {
+            std::vector<uint8_t> solid(width * height * 4);
+            for(size_t i = 0; i < solid.size(); i++)
+            {
+                solid[i] = solidColor[i % 4];
+            }
+            const std::vector<uint8_t> gradient = createTestImage(width, height);
+            for(const CompressedFormat& desc : kFormats)
+            {
+                const std::string size = std::to_string(width) + "x" + std::to_string(height);
+                if(compressAndMeasurePsnr(solid, width, height, desc, BlockCompressor::Preset::Normal) < 99)
+                {
+                    return test_fail(std::string(desc.name) + " failed to encode a " + size + " solid image");
+                }
+                if(compressAndMeasurePsnr(gradient, width, height, desc, BlockCompressor::Preset::Normal) < desc.minPsnr - 3)
+                {
+                    return test_fail(std::string(desc.name) + " failed to encode a " + size + " image");
+                }
+            }
+        }
+    }
+    return test_pass();
+}
+
+testing_func(BlockCompressorTest, TestSourceFormats)
+{
+    // A BGRA image must produce the same blocks as the same image stored as RGBA. The compressor doesn't read the alpha of BGRX images, so BC1 must ignore it
+    const std::vector<uint8_t> rgba = createTestImage(kImageSize, kImageSize);
+    std::vector<uint8_t> bgra = rgba;
+    std::vector<uint8_t> bgrx = rgba;
+    for(size_t i = 0; i < bgra.size(); i += 4)
+    {
+        std::swap(bgra[i], bgra[i + 2]);
+        std::swap(bgrx[i], bgrx[i + 2]);
+        bgrx[i + 3] = uint8_t(i * 7);
+    }
+
+    const ResourceFormat formats[] = { ResourceFormat::BC1Unorm, ResourceFormat::BC3Unorm, ResourceFormat::BC7Unorm };
+    for(ResourceFormat format : formats)
+    {
+        const size_t size = BlockCompressor::getCompressedSize(kImageSize, kImageSize, format);
+        std::vector<uint8_t> fromRgba(size), fromBgra(size);
+        BlockCompressor::compress(rgba.data(), kImageSize, kImageSize, kImageSize * 4, ResourceFormat::RGBA8Unorm, format, BlockCompressor::Preset::Normal, fromRgba.data());
+        BlockCompressor::compress(bgra.data(), kImageSize, kImageSize, kImageSize * 4, ResourceFormat::BGRA8Unorm, format, BlockCompressor::Preset::Normal, fromBgra.data());
+        if(fromRgba != fromBgra)
+        {
+            return test_fail("BGRA and RGBA sources produced different blocks");
+        }
+    }
+
+    const size_t size = BlockCompressor::getCompressedSize(kImageSize, kImageSize, ResourceFormat::BC1Unorm);
+    std::vector<uint8_t> fromBgra(size), fromBgrx(size);
+    BlockCompressor::compress(bgra.data(), kImageSize, kImageSize, kImageSize * 4, ResourceFormat::BGRA8Unorm, ResourceFormat::BC1Unorm, BlockCompressor::Preset::Normal, fromBgra.data());
+    BlockCompressor::compress(bgrx.data(), kImageSize, kImageSize, kImageSize * 4, ResourceFormat::BGRX8Unorm, ResourceFormat::BC1Unorm, BlockCompressor::Preset::Normal, fromBgrx.data());
+    if(fromBgra != fromBgrx)
+    {
+        return test_fail("BC1 blocks depend on the alpha of a BGRX source");
+    }
+    return test_pass();
+}
+
+testing_func(BlockCompressorTest, TestThroughput)
+{
+    // Compression speed with the Normal preset, including the distribution of the rows between the JobSystem workers
+    const uint32_t size = 2048;
+    const uint32_t repeatCount = 3;
+    const std::vector<uint8_t> image = createTestImage(size, size);
+    std::string perf;
+    for(const CompressedFormat& desc : kFormats)
+    {
+        std::vector<uint8_t> blocks(BlockCompressor::getCompressedSize(size, size, desc.format));
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        for(uint32_t i = 0; i < repeatCount; i++)
+        {
+            BlockCompressor::compress(image.data(), size, size, size * 4, ResourceFormat::RGBA8Unorm, desc.format, BlockCompressor::Preset::Normal, blocks.data());
+        }
+        const float time = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        perf += TestHelper::formatPerfResult(desc.name, double(size) * size * repeatCount / (time * 1000.0), "MPix/s");
+    }
+    return test_pass_perf(perf);
+}
+
+int main()
+{
+    BlockCompressorTest bct;
+    bct.init();
+    bct.run();
+    return 0;
+}
@@ -0,0 +1,169 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "FrustumCullingTest.h"
+#include <random>
+
+static const uint32_t kCameraCount = 20;
+
+// Point the camera at a random target from a random position. Alternates between wide and narrow fields of view.
+static Camera::SharedPtr createRandomCamera(std::mt19937& rng, uint32_t cameraIdx)
+{
+    std::uniform_real_distribution<float> dist(-20, 20);
+    Camera::SharedPtr pCamera = Camera::create();
+    pCamera->setPosition(glm::vec3(dist(rng), dist(rng), dist(rng)));
+    pCamera->setTarget(glm::vec3(dist(rng), dist(rng), dist(rng)));
+    pCamera->setUpVector(glm::vec3(0, 1, 0));
+    pCamera->setFocalLength((cameraIdx & 1) ? 10.0f : 50.0f);
+    pCamera->setAspectRatio(16.0f / 9.0f);
+    pCamera->setDepthRange(0.1f, 30.0f);
+    return pCamera;
+}
+
+// Random boxes, from degenerate points up to boxes larger than the frustum
+static std::vector<BoundingBox> createRandomBoxes(std::mt19937& rng, size_t count)
+{
+    std::uniform_real_distribution<float> dist(-30, 30);
+    std::uniform_real_distribution<float> size(0, 1);
+    std::vector<BoundingBox> boxes(count);
+    for(auto& box : boxes)
+    {
+        box.center = glm::vec3(dist(rng), dist(rng), dist(rng));
+        float scale = (rng() % 10 == 0) ? 20.0f : 2.0f;
+        box.extent = (rng() % 10 == 0) ? glm::vec3(0) : glm::vec3(size(rng), size(rng), size(rng)) * scale;
+    }
+    return boxes;
+}
+
+// Compare the batched results with isObjectCulled()
+static bool compareWithReference(const Camera* pCamera, const std::vector<BoundingBox>& boxes, const std::vector<uint8_t>& visibleMask)
+{
+    for(size_t i = 0; i < boxes.size(); i++)
+    {
+        if((visibleMask[i] != 0) == pCamera->isObjectCulled(boxes[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FrustumCullingTest::addTests()
+{
+    addTestToList<TestCullBoxes>();
+    addTestToList<TestCullBoxesSoA>();
+    addTestToList<TestPlaneBoundary>();
+}
+
+testing_func(FrustumCullingTest, TestCullBoxes)
+{
+    std::mt19937 rng(1);
+    for(uint32_t i = 0; i < kCameraCount; i++)
+    {
+        Camera::SharedPtr pCamera = createRandomCamera(rng, i);
+
+        // Counts which are not a multiple of the SIMD width test the remainder handling
+        std::vector<BoundingBox> boxes = createRandomBoxes(rng, 1 + rng() % 10000);
+        std::vector<uint8_t> visibleMask(boxes.size(), 0xff);
+        pCamera->cullBoxes(boxes.data(), boxes.size(), visibleMask.data());
+        if(compareWithReference(pCamera.get(), boxes, visibleMask) == false)
+        {
+            return test_fail("cullBoxes() doesn't match isObjectCulled()");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(FrustumCullingTest, TestCullBoxesSoA)
+{
+    std::mt19937 rng(2);
+    for(uint32_t i = 0; i < kCameraCount; i++)
+    {
+        Camera::SharedPtr pCamera = createRandomCamera(rng, i);
+        std::vector<BoundingBox> boxes = createRandomBoxes(rng, 1 + rng() % 10000);
+
+        std::vector<float> soa[6];
+        for(uint32_t c = 0; c < 3; c++)
+        {
+            for(const auto& box : boxes)
+            {
+                soa[c].push_back(box.center[c]);
+                soa[c + 3].push_back(box.extent[c]);
+            }
+        }
+        const float* pCenter[3] = { soa[0].data(), soa[1].data(), soa[2].data() };
+        const float* pExtent[3] = { soa[3].data(), soa[4].data(), soa[5].data() };
+
+        std::vector<uint8_t> visibleMask(boxes.size(), 0xff);
+        pCamera->cullBoxes(pCenter, pExtent, boxes.size(), visibleMask.data());
+        if(compareWithReference(pCamera.get(), boxes, visibleMask) == false)
+        {
+            return test_fail("Structure-of-arrays cullBoxes() doesn't match isObjectCulled()");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(FrustumCullingTest, TestPlaneBoundary)
+{
+    // Boxes touching the frustum planes are where a different evaluation order would change the result
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> dist(-1, 1);
+    for(uint32_t i = 0; i < kCameraCount; i++)
+    {
+        Camera::SharedPtr pCamera = createRandomCamera(rng, i);
+        const Camera::FrustumPlane* pPlanes = pCamera->getFrustumPlanes();
+
+        std::vector<BoundingBox> boxes(1000);
+        for(auto& box : boxes)
+        {
+            // Move a random point onto a plane, then place a box corner on it
+            const Camera::FrustumPlane& plane = pPlanes[rng() % 6];
+            glm::vec3 point = glm::vec3(dist(rng), dist(rng), dist(rng)) * 20.0f;
+            float lengthSq = glm::dot(plane.xyz, plane.xyz);
+            point -= plane.xyz * ((glm::dot(point, plane.xyz) - plane.negW) / lengthSq);
+            box.extent = glm::abs(glm::vec3(dist(rng), dist(rng), dist(rng)));
+            box.center = point - box.extent * plane.sign;
+        }
+
+        std::vector<uint8_t> visibleMask(boxes.size(), 0xff);
+        pCamera->cullBoxes(boxes.data(), boxes.size(), visibleMask.data());
+        if(compareWithReference(pCamera.get(), boxes, visibleMask) == false)
+        {
+            return test_fail("cullBoxes() doesn't match isObjectCulled() for boxes touching the frustum planes");
+        }
+    }
+    return test_pass();
+}
+
+int main()
+{
+    FrustumCullingTest fct;
+    fct.init();
+    fct.run();
+    return 0;
+}
@@ -0,0 +1,380 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "InstanceTransformStoreTest.h"
+#include "TestHelper.h"
+#include "Graphics/Model/InstanceTransformStore.h"
+#include "Utils/Math/FalcorMath.h"
+#include "Utils/JobSystem.h"
+#include "Utils/CpuTimer.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using Store = InstanceTransformStore;
+
+struct LayerDesc
+{
+    glm::vec3 translation;
+    glm::vec3 target;
+    glm::vec3 up;
+    glm::vec3 scale;
+};
+
+// The transforms of a slot, and the reference world matrix computed the way ObjectInstance did before the store existed
+struct SlotDesc
+{
+    LayerDesc base;
+    LayerDesc movable;
+    glm::mat4 world;
+};
+
+static glm::mat4 calculateTransformMatrix(const LayerDesc& layer)
+{
+    glm::mat4 translationMtx = glm::translate(glm::mat4(), layer.translation);
+    glm::mat4 rotationMtx = glm::mat4(createMatrixFromLookAt(layer.translation, layer.target, layer.up));
+    glm::mat4 scalingMtx = glm::scale(glm::mat4(), layer.scale);
+    return translationMtx * rotationMtx * scalingMtx;
+}
+
+static LayerDesc createRandomLayer(std::mt19937& rng, float range, bool isScaled)
+{
+    std::uniform_real_distribution<float> dist(-1, 1);
+    LayerDesc layer;
+    layer.translation = glm::vec3(dist(rng), dist(rng), dist(rng)) * range;
+    layer.target = layer.translation + glm::vec3(dist(rng), dist(rng), dist(rng));
+    layer.up = glm::normalize(glm::vec3(dist(rng), dist(rng), dist(rng)));
+    layer.scale = isScaled ? glm::vec3(1.0f) + glm::vec3(dist(rng), dist(rng), dist(rng)) * 0.5f : glm::vec3(1.0f);
+    return layer;
+}
+
+static SlotDesc setRandomTransform(std::mt19937& rng, Store::Handle handle)
+{
+    SlotDesc desc;
+    desc.base = createRandomLayer(rng, 100, true);
+    desc.movable = createRandomLayer(rng, 1, false);
+    desc.world = calculateTransformMatrix(desc.movable) * calculateTransformMatrix(desc.base);
+    Store::setTransform(handle, Store::Layer::Base, desc.base.translation, desc.base.target, desc.base.up, desc.base.scale);
+    Store::setTransform(handle, Store::Layer::Movable, desc.movable.translation, desc.movable.target, desc.movable.up, desc.movable.scale);
+    return desc;
+}
+
+static BoundingBox getLocalBounds()
+{
+    BoundingBox box;
+    box.center = glm::vec3(0.1f, 0.2f, 0.3f);
+    box.extent = glm::vec3(1.0f, 2.0f, 0.5f);
+    return box;
+}
+
+static bool isNear(const glm::vec3& a, const glm::vec3& b, float epsilon)
+{
+    return glm::all(glm::lessThanEqual(glm::abs(a - b), glm::vec3(epsilon) * (glm::vec3(1.0f) + glm::abs(b))));
+}
+
+// Compare the derived data of a slot with the reference. The world matrix must be identical, the other values are computed in a different order
+static bool checkSlot(Store::Handle handle, const glm::mat4& world, const BoundingBox& localBounds)
+{
+    if(Store::getWorldMatrix(handle) != world)
+    {
+        return false;
+    }
+
+    const glm::mat3 invTranspose = glm::transpose(glm::inverse(glm::mat3(world)));
+    const glm::mat3x4& stored = Store::getInvTransposeMatrix(handle);
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        if(isNear(glm::vec3(stored[i]), invTranspose[i], 1e-3f) == false || stored[i][3] != 0)
+        {
+            return false;
+        }
+    }
+
+    BoundingBox bounds = localBounds.transform(world);
+    const BoundingBox& storedBounds = Store::getWorldBounds(handle);
+    return isNear(storedBounds.center, bounds.center, 1e-5f) && isNear(storedBounds.extent, bounds.extent, 1e-5f);
+}
+
+static void releaseAll(const std::vector<Store::Handle>& handles)
+{
+    for(Store::Handle handle : handles)
+    {
+        Store::release(handle);
+    }
+}
+
+void InstanceTransformStoreTest::addTests()
+{
+    addTestToList<TestWorldData>();
+    addTestToList<TestOnDemandUpdate>();
+    addTestToList<TestLocalBoundsRefresh>();
+    addTestToList<TestGenerations>();
+    addTestToList<TestConcurrentReads>();
+    addTestToList<TestUpdateThroughput>();
+}
+
+testing_func(InstanceTransformStoreTest, TestWorldData)
+{
+    // Enough slots for several blocks, so that update() splits the work
+    const uint32_t slotCount = 10000;
+    const BoundingBox localBounds = getLocalBounds();
+    std::mt19937 rng(1);
+    std::vector<Store::Handle> handles(slotCount);
+    std::vector<SlotDesc> descs(slotCount);
+    for(uint32_t i = 0; i < slotCount; i++)
+    {
+        handles[i] = Store::allocate(&localBounds);
+        descs[i] = setRandomTransform(rng, handles[i]);
+
+        // Every 10th slot sets its base matrix directly
+        if(i % 10 == 0)
+        {
+            glm::mat4 base = calculateTransformMatrix(createRandomLayer(rng, 10, true));
+            Store::setMatrix(handles[i], Store::Layer::Base, base);
+            descs[i].world = calculateTransformMatrix(descs[i].movable) * base;
+        }
+    }
+
+    Store::update();
+    for(uint32_t i = 0; i < slotCount; i++)
+    {
+        if(checkSlot(handles[i], descs[i].world, localBounds) == false)
+        {
+            releaseAll(handles);
+            return test_fail("The derived data of slot " + std::to_string(i) + " doesn't match the reference");
+        }
+    }
+
+    releaseAll(handles);
+    return test_pass();
+}
+
+testing_func(InstanceTransformStoreTest, TestOnDemandUpdate)
+{
+    // The getters must return the current transform without waiting for update()
+    const BoundingBox localBounds = getLocalBounds();
+    std::mt19937 rng(2);
+    Store::Handle handle = Store::allocate(&localBounds);
+    if(checkSlot(handle, glm::mat4(), localBounds) == false)
+    {
+        Store::release(handle);
+        return test_fail("A new slot doesn't have an identity transform");
+    }
+
+    for(uint32_t i = 0; i < 100; i++)
+    {
+        SlotDesc desc = setRandomTransform(rng, handle);
+        if(checkSlot(handle, desc.world, localBounds) == false)
+        {
+            Store::release(handle);
+            return test_fail("A dirty slot wasn't updated when it was read");
+        }
+    }
+
+    Store::release(handle);
+    return test_pass();
+}
+
+testing_func(InstanceTransformStoreTest, TestLocalBoundsRefresh)
+{
+    // The store reads the object's bounds when it recomputes the world bounds, so a change of the object's bounds is picked up with the next transform change
+    BoundingBox localBounds = getLocalBounds();
+    std::mt19937 rng(3);
+    Store::Handle handle = Store::allocate(&localBounds);
+    SlotDesc desc = setRandomTransform(rng, handle);
+    Store::update();
+
+    localBounds.center = glm::vec3(-4.0f, 2.0f, 7.0f);
+    localBounds.extent = glm::vec3(3.0f, 0.25f, 1.0f);
+    desc = setRandomTransform(rng, handle);
+    bool isCurrent = checkSlot(handle, desc.world, localBounds);
+    Store::release(handle);
+    if(isCurrent == false)
+    {
+        return test_fail("The world bounds weren't recomputed from the current object bounds");
+    }
+    return test_pass();
+}
+
+testing_func(InstanceTransformStoreTest, TestGenerations)
+{
+    // Every setter must change the slot's generation and the store's change count, so moves can be detected without notifications. Reading and updating must not
+    const BoundingBox localBounds = getLocalBounds();
+    std::mt19937 rng(4);
+    Store::Handle handle = Store::allocate(&localBounds);
+    Store::Handle other = Store::allocate(&localBounds);
+    std::string error;
+
+    uint32_t generation = Store::getGeneration(handle);
+    uint64_t changeCount = Store::getChangeCount();
+    auto checkChanged = [&](const std::string& setter)
+    {
+        if(error.empty() && (Store::getGeneration(handle) == generation || Store::getChangeCount() == changeCount))
+        {
+            error = setter + " didn't change the generation";
+        }
+        generation = Store::getGeneration(handle);
+        changeCount = Store::getChangeCount();
+    };
+
+    Store::setTranslation(handle, Store::Layer::Base, glm::vec3(1, 2, 3));
+    checkChanged("setTranslation()");
+    Store::setTarget(handle, Store::Layer::Movable, glm::vec3(0, 0, -1));
+    checkChanged("setTarget()");
+    Store::setUpVector(handle, Store::Layer::Base, glm::vec3(1, 0, 0));
+    checkChanged("setUpVector()");
+    Store::setScaling(handle, Store::Layer::Movable, glm::vec3(2));
+    checkChanged("setScaling()");
+    setRandomTransform(rng, handle);
+    checkChanged("setTransform()");
+    Store::setMatrix(handle, Store::Layer::Base, glm::mat4());
+    checkChanged("setMatrix()");
+
+    Store::getWorldMatrix(handle);
+    Store::setTranslation(other, Store::Layer::Base, glm::vec3(4, 5, 6));
+    Store::update();
+    if(error.empty() && Store::getGeneration(handle) != generation)
+    {
+        error = "Reading the slot or moving another slot changed the generation";
+    }
+
+    Store::release(handle);
+    Store::release(other);
+    if(error.size())
+    {
+        return test_fail(error);
+    }
+    return test_pass();
+}
+
+testing_func(InstanceTransformStoreTest, TestConcurrentReads)
+{
+    // Many jobs read the same dirty slots at the same time, while update() runs. Every slot must be updated by exactly one of them and all the readers must see the result
+    const uint32_t slotCount = 64 * 1024;
+    const uint32_t readerCount = 64;
+    const BoundingBox localBounds = getLocalBounds();
+    std::mt19937 rng(4);
+    std::vector<Store::Handle> handles(slotCount);
+    std::vector<SlotDesc> descs(slotCount);
+    for(uint32_t i = 0; i < slotCount; i++)
+    {
+        handles[i] = Store::allocate(&localBounds);
+    }
+
+    for(uint32_t iteration = 0; iteration < 4; iteration++)
+    {
+        for(uint32_t i = 0; i < slotCount; i++)
+        {
+            descs[i] = setRandomTransform(rng, handles[i]);
+        }
+
+        std::vector<uint8_t> isValid(readerCount, 1);
+        JobSystem::JobHandle pUpdate = JobSystem::run([]() { Store::update(); });
+        JobSystem::parallelFor(readerCount, [&](uint32_t reader)
+        {
+            // Readers start at different slots and walk in different directions, so that they collide on slots
+            for(uint32_t i = 0; i < slotCount; i++)
+            {
+                uint32_t index = (reader & 1) ? (reader * 997 + i) % slotCount : (slotCount - 1 - (reader * 997 + i) % slotCount);
+                if(checkSlot(handles[index], descs[index].world, localBounds) == false)
+                {
+                    isValid[reader] = 0;
+                }
+            }
+        }, 1);
+        JobSystem::wait(pUpdate);
+
+        if(std::find(isValid.begin(), isValid.end(), uint8_t(0)) != isValid.end())
+        {
+            releaseAll(handles);
+            return test_fail("A concurrent reader saw a stale or partially updated slot");
+        }
+    }
+
+    releaseAll(handles);
+    return test_pass();
+}
+
+testing_func(InstanceTransformStoreTest, TestUpdateThroughput)
+{
+    const uint32_t slotCount = 1000000;
+    const BoundingBox localBounds = getLocalBounds();
+    std::mt19937 rng(5);
+    std::vector<Store::Handle> handles(slotCount);
+    for(uint32_t i = 0; i < slotCount; i++)
+    {
+        handles[i] = Store::allocate(&localBounds);
+        setRandomTransform(rng, handles[i]);
+    }
+
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    Store::update();
+    double fullUpdateTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    // A typical frame, where paths move a tenth of the instances
+    std::vector<LayerDesc> moves(slotCount / 10);
+    for(auto& move : moves)
+    {
+        move = createRandomLayer(rng, 1, false);
+    }
+    start = CpuTimer::getCurrentTimePoint();
+    for(uint32_t i = 0; i < (uint32_t)moves.size(); i++)
+    {
+        Store::setTransform(handles[i * 10], Store::Layer::Movable, moves[i].translation, moves[i].target, moves[i].up, moves[i].scale);
+    }
+    Store::update();
+    double partialUpdateTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    // What the renderer reads every frame
+    start = CpuTimer::getCurrentTimePoint();
+    float sum = 0;
+    for(Store::Handle handle : handles)
+    {
+        sum += Store::getWorldMatrix(handle)[3][0] + Store::getInvTransposeMatrix(handle)[0][0] + Store::getWorldBounds(handle).extent.x;
+    }
+    double readTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    releaseAll(handles);
+
+    if(std::isfinite(sum) == false)
+    {
+        return test_fail("Invalid transforms");
+    }
+
+    std::string perf = TestHelper::formatPerfResult("Update all", fullUpdateTime, "ms");
+    perf += TestHelper::formatPerfResult("Move 10% and update", partialUpdateTime, "ms");
+    perf += TestHelper::formatPerfResult("Read all", readTime, "ms");
+    return test_pass_perf(perf);
+}
+
+int main()
+{
+    InstanceTransformStoreTest itst;
+    itst.init();
+    itst.run();
+    return 0;
+}
@@ -0,0 +1,232 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "JobSystemTest.h"
+#include "TestHelper.h"
+#include "Utils/JobSystem.h"
+#include "Utils/CpuTimer.h"
+#include <atomic>
+#include <thread>
+
+static const uint32_t kStressIterations = 50;
+
+void JobSystemTest::addTests()
+{
+    addTestToList<TestNestedParallelFor>();
+    addTestToList<TestDependencies>();
+    addTestToList<TestExternalSubmitters>();
+    addTestToList<TestRestart>();
+    addTestToList<TestScaling>();
+}
+
+testing_func(JobSystemTest, TestNestedParallelFor)
+{
+    // Every outer index waits for an inner parallelFor, which only completes if the waiting threads execute other jobs
+    const uint32_t outerCount = 1000;
+    const uint32_t innerCount = 100;
+    for(uint32_t iter = 0; iter < kStressIterations; iter++)
+    {
+        std::vector<uint64_t> sums(outerCount);
+        JobSystem::parallelFor(outerCount, [&sums](uint32_t i)
+        {
+            std::atomic<uint64_t> sum(0);
+            JobSystem::parallelFor(innerCount, [&sum, i](uint32_t j) { sum += i * j; }, 7);
+            sums[i] = sum;
+        }, 3);
+
+        for(uint32_t i = 0; i < outerCount; i++)
+        {
+            if(sums[i] != (uint64_t)i * (innerCount * (innerCount - 1) / 2))
+            {
+                return test_fail("Nested parallelFor skipped or repeated an index");
+            }
+        }
+    }
+    return test_pass();
+}
+
+testing_func(JobSystemTest, TestDependencies)
+{
+    for(uint32_t iter = 0; iter < kStressIterations; iter++)
+    {
+        // Diamond: a -> (b, c) -> d. The root is submitted last, so the other jobs wait for it
+        std::atomic<uint32_t> stage(0);
+        std::atomic<bool> orderValid(true);
+        JobSystem::JobHandle a = JobSystem::createJob([&]() { if(stage != 0) orderValid = false; stage = 1; });
+        JobSystem::JobHandle b = JobSystem::run([&]() { if(stage != 1) orderValid = false; }, { a });
+        JobSystem::JobHandle c = JobSystem::run([&]() { if(stage != 1) orderValid = false; }, { a });
+        JobSystem::JobHandle d = JobSystem::run([&]() { if(stage != 1) orderValid = false; stage = 2; }, { b, c });
+        JobSystem::submit(a);
+        JobSystem::wait(d);
+        if(orderValid == false || stage != 2)
+        {
+            return test_fail("A job ran before its dependencies completed");
+        }
+
+        // Chain of continuations
+        const uint32_t chainLength = 200;
+        std::atomic<uint32_t> next(0);
+        JobSystem::JobHandle pPrev;
+        for(uint32_t i = 0; i < chainLength; i++)
+        {
+            std::vector<JobSystem::JobHandle> dependencies;
+            if(pPrev)
+            {
+                dependencies.push_back(pPrev);
+            }
+            pPrev = JobSystem::run([&next, &orderValid, i]() { if(next.exchange(i + 1) != i) orderValid = false; }, dependencies);
+        }
+        JobSystem::wait(pPrev);
+        if(orderValid == false || next != chainLength)
+        {
+            return test_fail("Continuations ran out of order");
+        }
+
+        // Dependency on a job which already completed
+        JobSystem::JobHandle pDone = JobSystem::run([]() {});
+        JobSystem::wait(pDone);
+        JobSystem::JobHandle pAfter = JobSystem::run([]() {}, { pDone });
+        JobSystem::wait(pAfter);
+        if(JobSystem::isFinished(pAfter) == false)
+        {
+            return test_fail("A job depending on a completed job didn't run");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(JobSystemTest, TestExternalSubmitters)
+{
+    // Threads which are not workers submit small jobs with continuations concurrently, through the shared queue
+    const uint32_t threadCount = 4;
+    const uint32_t jobsPerThread = 500;
+    for(uint32_t iter = 0; iter < kStressIterations; iter++)
+    {
+        std::atomic<uint32_t> counter(0);
+        std::vector<std::thread> threads;
+        for(uint32_t t = 0; t < threadCount; t++)
+        {
+            threads.emplace_back([&counter, jobsPerThread]()
+            {
+                std::vector<JobSystem::JobHandle> jobs;
+                for(uint32_t j = 0; j < jobsPerThread; j++)
+                {
+                    JobSystem::JobHandle pJob = JobSystem::run([&counter]() { counter++; });
+                    jobs.push_back(JobSystem::run([&counter]() { counter++; }, { pJob }));
+                }
+                JobSystem::wait(jobs);
+            });
+        }
+        for(auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        if(counter != threadCount * jobsPerThread * 2)
+        {
+            return test_fail("Jobs submitted by external threads were lost");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(JobSystemTest, TestRestart)
+{
+    // shutdown() must complete the queued jobs, and the system must be usable again with a different worker count
+    const uint32_t workerCounts[] = { 1, 2, 3, 0 };
+    for(uint32_t workerCount : workerCounts)
+    {
+        JobSystem::shutdown();
+        JobSystem::init(workerCount);
+        if(workerCount != 0 && JobSystem::getWorkerCount() != workerCount)
+        {
+            return test_fail("init() didn't create the requested number of workers");
+        }
+
+        std::atomic<uint32_t> counter(0);
+        for(uint32_t i = 0; i < 1000; i++)
+        {
+            JobSystem::run([&counter]() { counter++; });
+        }
+        JobSystem::shutdown();
+        if(counter != 1000)
+        {
+            return test_fail("shutdown() didn't complete the queued jobs");
+        }
+    }
+    JobSystem::init();
+    return test_pass();
+}
+
+testing_func(JobSystemTest, TestScaling)
+{
+    // parallelFor throughput over a large array with 1, 2, 4, ... workers, up to one worker per core
+    std::vector<float> data(1 << 24, 1.0f);
+    const uint32_t repeatCount = 10;
+    const uint32_t maxWorkers = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<uint32_t> workerCounts;
+    for(uint32_t workerCount = 1; workerCount < maxWorkers; workerCount *= 2)
+    {
+        workerCounts.push_back(workerCount);
+    }
+    workerCounts.push_back(maxWorkers);
+
+    std::string perf;
+    float singleWorkerTime = 0;
+    for(uint32_t workerCount : workerCounts)
+    {
+        JobSystem::shutdown();
+        JobSystem::init(workerCount);
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        for(uint32_t r = 0; r < repeatCount; r++)
+        {
+            JobSystem::parallelFor((uint32_t)data.size(), [&data](uint32_t i) { data[i] = sqrt(data[i] * 1.0001f + 0.5f); }, 4096);
+        }
+        const float time = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / repeatCount;
+        if(workerCount == 1)
+        {
+            singleWorkerTime = time;
+        }
+
+        const std::string workers = std::to_string(workerCount) + (workerCount == 1 ? " worker" : " workers");
+        perf += TestHelper::formatPerfResult(workers, time, "ms");
+        perf += TestHelper::formatPerfResult(workers + " speedup", singleWorkerTime / time, "x");
+    }
+
+    JobSystem::shutdown();
+    JobSystem::init();
+    return test_pass_perf(perf);
+}
+
+int main()
+{
+    JobSystemTest jst;
+    jst.init();
+    jst.run();
+    return 0;
+}
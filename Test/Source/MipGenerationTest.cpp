@@ -0,0 +1,238 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "MipGenerationTest.h"
+#include "TestHelper.h"
+#include "Utils/CpuTimer.h"
+#include <random>
+
+static const MipFilter kFilters[] = { MipFilter::Box, MipFilter::Kaiser };
+
+// Fraction of the texels of an RGBA8 level which pass the alpha-test
+static float computeCoverage(const uint8_t* pLevel, uint32_t width, uint32_t height, uint32_t channel, float alphaTestRef)
+{
+    uint32_t passed = 0;
+    for(uint32_t i = 0; i < width * height; i++)
+    {
+        passed += (pLevel[i * 4 + channel] / 255.0f >= alphaTestRef) ? 1 : 0;
+    }
+    return float(passed) / float(width * height);
+}
+
+void MipGenerationTest::addTests()
+{
+    addTestToList<TestChainLayout>();
+    addTestToList<TestSrgbFiltering>();
+    addTestToList<TestAlphaCoverage>();
+    addTestToList<TestThroughput>();
+}
+
+testing_func(MipGenerationTest, TestChainLayout)
+{
+    // A constant image must stay constant in every level, for every filter and channel order. The levels are tightly packed one after the other
+    const uint32_t width = 37;
+    const uint32_t height = 21;
+    const uint8_t color[4] = { 10, 128, 250, 77 };
+    std::vector<uint8_t> image(width * height * 4);
+    for(size_t i = 0; i < image.size(); i++)
+    {
+        image[i] = color[i % 4];
+    }
+
+    const ResourceFormat formats[] = { ResourceFormat::RGBA8Unorm, ResourceFormat::RGBA8UnormSrgb, ResourceFormat::BGRA8Unorm };
+    for(MipFilter filter : kFilters)
+    {
+        for(ResourceFormat format : formats)
+        {
+            MipGenDesc desc;
+            desc.filter = filter;
+            std::vector<uint8_t> mipChain;
+            uint32_t mipCount = generateMipChain(image.data(), width, height, format, desc, mipChain);
+            if(mipCount != 6)
+            {
+                return test_fail("Wrong number of mip-levels");
+            }
+
+            size_t expectedSize = 0;
+            for(uint32_t mip = 0; mip < mipCount; mip++)
+            {
+                expectedSize += std::max(1u, width >> mip) * std::max(1u, height >> mip) * 4;
+            }
+            if(mipChain.size() != expectedSize)
+            {
+                return test_fail("The mip-chain doesn't have the expected size");
+            }
+
+            for(size_t i = 0; i < mipChain.size(); i++)
+            {
+                if(mipChain[i] != color[i % 4])
+                {
+                    return test_fail("A constant image changed after filtering");
+                }
+            }
+        }
+    }
+
+    // Float formats are averaged exactly by the box filter
+    std::vector<float> floatImage(16 * 16 * 3);
+    double average[3] = {};
+    for(size_t i = 0; i < floatImage.size(); i++)
+    {
+        floatImage[i] = float(i % 7);
+        average[i % 3] += floatImage[i] / 256.0;
+    }
+    std::vector<uint8_t> mipChain;
+    if(generateMipChain(floatImage.data(), 16, 16, ResourceFormat::RGB32Float, MipGenDesc(), mipChain) != 5)
+    {
+        return test_fail("Wrong number of mip-levels for a float image");
+    }
+    const float* pLastLevel = (const float*)(mipChain.data() + mipChain.size() - 3 * sizeof(float));
+    for(uint32_t c = 0; c < 3; c++)
+    {
+        if(std::abs(pLastLevel[c] - average[c]) > 1e-4)
+        {
+            return test_fail("The last mip-level of a float image isn't the image's average");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(MipGenerationTest, TestSrgbFiltering)
+{
+    // A black and white checkerboard averages to 0.5 in linear space, which is 188 in sRGB. A unorm texture stores 128
+    const uint32_t size = 8;
+    std::vector<uint8_t> image(size * size * 4);
+    for(uint32_t y = 0; y < size; y++)
+    {
+        for(uint32_t x = 0; x < size; x++)
+        {
+            uint8_t value = ((x + y) & 1) ? 255 : 0;
+            uint8_t* pPixel = &image[(y * size + x) * 4];
+            pPixel[0] = pPixel[1] = pPixel[2] = value;
+            pPixel[3] = 255;
+        }
+    }
+
+    std::vector<uint8_t> srgbChain, linearChain;
+    generateMipChain(image.data(), size, size, ResourceFormat::RGBA8UnormSrgb, MipGenDesc(), srgbChain);
+    generateMipChain(image.data(), size, size, ResourceFormat::RGBA8Unorm, MipGenDesc(), linearChain);
+
+    // The first texel of mip 1
+    const size_t mip1 = size * size * 4;
+    if(srgbChain[mip1] != 188 || linearChain[mip1] < 127 || linearChain[mip1] > 128)
+    {
+        return test_fail("sRGB textures are not filtered in linear space");
+    }
+    if(srgbChain[mip1 + 3] != 255)
+    {
+        return test_fail("The alpha channel of an sRGB texture must not be converted");
+    }
+    return test_pass();
+}
+
+testing_func(MipGenerationTest, TestAlphaCoverage)
+{
+    // A sparse foliage-like mask loses most of its coverage when filtered. With coverage preservation every level must stay close to the top level
+    const uint32_t size = 512;
+    const float alphaTestRef = 0.5f;
+    std::vector<uint8_t> image(size * size * 4);
+    std::mt19937 rng(3);
+    for(uint32_t y = 0; y < size; y++)
+    {
+        for(uint32_t x = 0; x < size; x++)
+        {
+            float v = 0.5f + 0.5f * sin(x * 0.35f) * sin(y * 0.27f);
+            uint8_t alpha = (rng() % 100 < 30 && v > 0.6f) ? 255 : uint8_t(v * 90);
+            uint8_t* pPixel = &image[(y * size + x) * 4];
+            pPixel[0] = pPixel[1] = pPixel[2] = 128;
+            pPixel[3] = alpha;
+        }
+    }
+
+    MipGenDesc desc;
+    desc.alphaTestRef = alphaTestRef;
+    desc.alphaTestChannel = 3;
+    std::vector<uint8_t> mipChain;
+    uint32_t mipCount = generateMipChain(image.data(), size, size, ResourceFormat::RGBA8Unorm, desc, mipChain);
+
+    const float topCoverage = computeCoverage(image.data(), size, size, 3, alphaTestRef);
+    size_t offset = 0;
+    for(uint32_t mip = 0; mip < mipCount; mip++)
+    {
+        uint32_t mipSize = std::max(1u, size >> mip);
+        // Small levels can't represent the coverage accurately
+        if(mipSize >= 32)
+        {
+            float coverage = computeCoverage(mipChain.data() + offset, mipSize, mipSize, 3, alphaTestRef);
+            if(std::abs(coverage - topCoverage) > 0.02f)
+            {
+                return test_fail("Mip " + std::to_string(mip) + " coverage " + std::to_string(coverage) + " doesn't match the top level coverage " + std::to_string(topCoverage));
+            }
+        }
+        offset += mipSize * mipSize * 4;
+    }
+    return test_pass();
+}
+
+testing_func(MipGenerationTest, TestThroughput)
+{
+    // Time to generate the full chain of a 2048x2048 sRGB image, which is the common case for material textures
+    const uint32_t size = 2048;
+    const uint32_t repeatCount = 5;
+    std::vector<uint8_t> image(size * size * 4);
+    std::mt19937 rng(5);
+    for(auto& value : image)
+    {
+        value = uint8_t(rng());
+    }
+
+    const std::string names[] = { "Box", "Kaiser" };
+    std::string perf;
+    for(uint32_t f = 0; f < arraysize(kFilters); f++)
+    {
+        MipGenDesc desc;
+        desc.filter = kFilters[f];
+        std::vector<uint8_t> mipChain;
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        for(uint32_t i = 0; i < repeatCount; i++)
+        {
+            generateMipChain(image.data(), size, size, ResourceFormat::RGBA8UnormSrgb, desc, mipChain);
+        }
+        const float time = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / repeatCount;
+        perf += TestHelper::formatPerfResult(names[f], time, "ms");
+        perf += TestHelper::formatPerfResult(names[f] + " source", double(size) * size / (time * 1000.0), "MPix/s");
+    }
+    return test_pass_perf(perf);
+}
+
+int main()
+{
+    MipGenerationTest mgt;
+    mgt.init();
+    mgt.run();
+    return 0;
+}
@@ -0,0 +1,320 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "OcclusionCullerTest.h"
+#include "TestHelper.h"
+#include "Graphics/Scene/OcclusionCuller.h"
+#include "Utils/CpuTimer.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+static const float kNearZ = 0.1f;
+static const uint32_t kSceneCount = 4;
+
+/** An occluder scene seen from a camera, with the depth buffer of a double-precision raycast through every pixel center
+*/
+struct TestScene
+{
+    glm::vec3 eye;
+    glm::mat4 viewProj;
+    glm::mat4 world;
+    OcclusionCuller::OccluderMesh mesh;
+    std::vector<double> referenceDepth;     // 1/w of the closest hit, 0 where nothing was hit
+};
+
+// Moller-Trumbore ray-triangle intersection. Returns the ray parameter of the hit, or 0 if the ray misses
+static double intersectTriangle(const glm::dvec3& origin, const glm::dvec3& direction, const glm::dvec3& a, const glm::dvec3& b, const glm::dvec3& c)
+{
+    glm::dvec3 e1 = b - a;
+    glm::dvec3 e2 = c - a;
+    glm::dvec3 p = glm::cross(direction, e2);
+    double det = glm::dot(e1, p);
+    if(std::abs(det) < 1e-14)
+    {
+        return 0;
+    }
+    double invDet = 1 / det;
+    glm::dvec3 s = origin - a;
+    double u = glm::dot(s, p) * invDet;
+    glm::dvec3 q = glm::cross(s, e1);
+    double v = glm::dot(direction, q) * invDet;
+    if(u < 0 || u > 1 || v < 0 || u + v > 1)
+    {
+        return 0;
+    }
+    return std::max(glm::dot(e2, q) * invDet, 0.0);
+}
+
+// Random triangles in front of the camera, and a wall which crosses the near plane and extends behind the camera, so that clipping is exercised
+static TestScene createScene(std::mt19937& rng, uint32_t width, uint32_t height, uint32_t triangleCount, float triangleSize)
+{
+    std::uniform_real_distribution<float> dist(0, 1);
+    TestScene scene;
+    scene.eye = glm::vec3(0, 1.5f, 0);
+    glm::vec3 target = glm::vec3(dist(rng) * 2 - 1, 1.5f, 5);
+    scene.viewProj = glm::perspective(1.2f, (float)width / height, kNearZ, 200.0f) * glm::lookAt(scene.eye, target, glm::vec3(0, 1, 0));
+    scene.world = glm::translate(glm::mat4(), glm::vec3(0.3f, 0, 0));
+
+    auto& mesh = scene.mesh;
+    for(uint32_t i = 0; i < triangleCount; i++)
+    {
+        glm::vec3 center = glm::vec3(dist(rng) * 30 - 15, dist(rng) * 4, dist(rng) * 30 - 10);
+        for(uint32_t v = 0; v < 3; v++)
+        {
+            mesh.positions.push_back(center + (glm::vec3(dist(rng), dist(rng), dist(rng)) - 0.5f) * triangleSize);
+            mesh.indices.push_back((uint32_t)mesh.indices.size());
+        }
+    }
+
+    const glm::vec3 wall[] = { glm::vec3(-20, -5, -3), glm::vec3(-0.5f, -5, 20), glm::vec3(-0.5f, 8, 20), glm::vec3(-20, 8, -3) };
+    const uint32_t wallIndices[] = { 0, 1, 2, 0, 2, 3 };
+    uint32_t firstVertex = (uint32_t)mesh.positions.size();
+    mesh.positions.insert(mesh.positions.end(), std::begin(wall), std::end(wall));
+    for(uint32_t index : wallIndices)
+    {
+        mesh.indices.push_back(firstVertex + index);
+    }
+
+    // The reference depth. Hits in front of the near plane are clipped away by the rasterizer as well
+    std::vector<glm::dvec3> worldPositions;
+    for(const auto& position : mesh.positions)
+    {
+        worldPositions.push_back(glm::dvec3(scene.world * glm::vec4(position, 1)));
+    }
+    const glm::dmat4 viewProj = glm::dmat4(scene.viewProj);
+    const glm::dmat4 invViewProj = glm::inverse(viewProj);
+    const glm::dvec3 origin = glm::dvec3(scene.eye);
+    scene.referenceDepth.resize(width * height);
+    for(uint32_t y = 0; y < height; y++)
+    {
+        for(uint32_t x = 0; x < width; x++)
+        {
+            glm::dvec4 point = invViewProj * glm::dvec4((x + 0.5) / width * 2 - 1, 1 - (y + 0.5) / height * 2, 0.5, 1);
+            glm::dvec3 direction = glm::dvec3(point) / point.w - origin;
+            double depth = 0;
+            for(size_t i = 0; i < mesh.indices.size(); i += 3)
+            {
+                double t = intersectTriangle(origin, direction, worldPositions[mesh.indices[i]], worldPositions[mesh.indices[i + 1]], worldPositions[mesh.indices[i + 2]]);
+                if(t > 0)
+                {
+                    double w = (viewProj * glm::dvec4(origin + direction * t, 1)).w;
+                    depth = (w >= kNearZ) ? std::max(depth, 1 / w) : depth;
+                }
+            }
+            scene.referenceDepth[y * width + x] = depth;
+        }
+    }
+    return scene;
+}
+
+static void rasterizeScene(OcclusionCuller* pCuller, const TestScene& scene)
+{
+    pCuller->beginFrame(scene.viewProj, kNearZ);
+    pCuller->addOccluder(scene.mesh, scene.world);
+    pCuller->rasterize();
+}
+
+void OcclusionCullerTest::addTests()
+{
+    addTestToList<TestDepthMatchesRaycast>();
+    addTestToList<TestNoFalseCulls>();
+    addTestToList<TestEmptyFrame>();
+    addTestToList<TestThroughput>();
+}
+
+testing_func(OcclusionCullerTest, TestDepthMatchesRaycast)
+{
+    std::mt19937 rng(7);
+    for(uint32_t i = 0; i < kSceneCount; i++)
+    {
+        // The requested size isn't a multiple of the tile size, so the partial tiles are covered as well
+        OcclusionCuller::SharedPtr pCuller = OcclusionCuller::create(200, 100);
+        const uint32_t width = pCuller->getWidth();
+        const uint32_t height = pCuller->getHeight();
+
+        // The last scene has many small triangles, so that the binning is split between several jobs
+        TestScene scene = (i == kSceneCount - 1) ? createScene(rng, width, height, 2000, 1.0f) : createScene(rng, width, height, 40, 8.0f);
+        rasterizeScene(pCuller.get(), scene);
+
+        // The rasterizer interpolates 1/w in single precision, so the depths are compared with a relative tolerance
+        const float* pDepth = pCuller->getDepthBuffer();
+        for(uint32_t p = 0; p < width * height; p++)
+        {
+            double reference = scene.referenceDepth[p];
+            if(std::abs(pDepth[p] - reference) > 1e-4 * std::max(reference, (double)pDepth[p]))
+            {
+                return test_fail("Scene " + std::to_string(i) + ": the depth of pixel (" + std::to_string(p % width) + ", " + std::to_string(p / width) + ") doesn't match the raycast");
+            }
+        }
+    }
+    return test_pass();
+}
+
+testing_func(OcclusionCullerTest, TestNoFalseCulls)
+{
+    // A culled box must be hidden at every pixel center its projection covers. The box's nearest corner is used as its depth, which is conservative
+    std::mt19937 rng(8);
+    std::uniform_real_distribution<float> dist(0, 1);
+    uint32_t culledCount = 0;
+    for(uint32_t i = 0; i < kSceneCount; i++)
+    {
+        OcclusionCuller::SharedPtr pCuller = OcclusionCuller::create(200, 100);
+        const uint32_t width = pCuller->getWidth();
+        const uint32_t height = pCuller->getHeight();
+        TestScene scene = createScene(rng, width, height, 40, 8.0f);
+        rasterizeScene(pCuller.get(), scene);
+
+        for(uint32_t b = 0; b < 3000; b++)
+        {
+            BoundingBox box;
+            box.center = glm::vec3(dist(rng) * 40 - 20, dist(rng) * 6 - 1, dist(rng) * 40 - 10);
+            box.extent = glm::vec3(dist(rng), dist(rng), dist(rng)) * (dist(rng) < 0.5f ? 0.3f : 2.0f);
+            if(pCuller->isVisible(box))
+            {
+                continue;
+            }
+            culledCount++;
+
+            double nearestDepth = 0;
+            glm::vec2 screenMin = glm::vec2(FLT_MAX);
+            glm::vec2 screenMax = glm::vec2(-FLT_MAX);
+            for(uint32_t corner = 0; corner < 8; corner++)
+            {
+                glm::vec3 sign = glm::vec3((corner & 1) ? 1 : -1, (corner & 2) ? 1 : -1, (corner & 4) ? 1 : -1);
+                glm::vec4 clip = scene.viewProj * glm::vec4(box.center + box.extent * sign, 1);
+                nearestDepth = std::max(nearestDepth, 1.0 / clip.w);
+                glm::vec2 screen = glm::vec2((clip.x / clip.w + 1) * 0.5f * width, (1 - clip.y / clip.w) * 0.5f * height);
+                screenMin = glm::min(screenMin, screen);
+                screenMax = glm::max(screenMax, screen);
+            }
+
+            for(int32_t y = std::max(0, (int32_t)floorf(screenMin.y)); y <= std::min((int32_t)height - 1, (int32_t)floorf(screenMax.y)); y++)
+            {
+                for(int32_t x = std::max(0, (int32_t)floorf(screenMin.x)); x <= std::min((int32_t)width - 1, (int32_t)floorf(screenMax.x)); x++)
+                {
+                    if(scene.referenceDepth[y * width + x] < nearestDepth)
+                    {
+                        return test_fail("Scene " + std::to_string(i) + ": a visible box was culled");
+                    }
+                }
+            }
+        }
+    }
+
+    if(culledCount == 0)
+    {
+        return test_fail("No box was culled");
+    }
+    return test_pass();
+}
+
+testing_func(OcclusionCullerTest, TestEmptyFrame)
+{
+    // Without occluders nothing may be culled, and the previous frame's occluders must be gone
+    std::mt19937 rng(9);
+    OcclusionCuller::SharedPtr pCuller = OcclusionCuller::create();
+    TestScene scene = createScene(rng, pCuller->getWidth(), pCuller->getHeight(), 40, 8.0f);
+    rasterizeScene(pCuller.get(), scene);
+
+    pCuller->beginFrame(scene.viewProj, kNearZ);
+    pCuller->rasterize();
+    const float* pDepth = pCuller->getDepthBuffer();
+    if(std::any_of(pDepth, pDepth + pCuller->getWidth() * pCuller->getHeight(), [](float depth) { return depth != 0; }))
+    {
+        return test_fail("The depth buffer wasn't cleared");
+    }
+
+    BoundingBox box;
+    box.center = glm::vec3(0, 1.5f, 10);
+    box.extent = glm::vec3(0.1f);
+    if(pCuller->isVisible(box) == false || pCuller->getStats().occluderTriangles != 0)
+    {
+        return test_fail("A box was culled without occluders");
+    }
+    return test_pass();
+}
+
+testing_func(OcclusionCullerTest, TestThroughput)
+{
+    // A typical occluder budget: many small triangles spread in front of the camera
+    const uint32_t triangleCount = 200000;
+    const uint32_t frameCount = 10;
+    const uint32_t boxCount = 100000;
+    std::mt19937 rng(10);
+    std::uniform_real_distribution<float> dist(0, 1);
+    OcclusionCuller::SharedPtr pCuller = OcclusionCuller::create(256, 128);
+    OcclusionCuller::OccluderMesh mesh;
+    for(uint32_t i = 0; i < triangleCount; i++)
+    {
+        glm::vec3 center = glm::vec3(dist(rng) * 60 - 30, dist(rng) * 4, dist(rng) * 60);
+        for(uint32_t v = 0; v < 3; v++)
+        {
+            mesh.positions.push_back(center + glm::vec3(dist(rng), dist(rng), dist(rng)) - 0.5f);
+            mesh.indices.push_back((uint32_t)mesh.indices.size());
+        }
+    }
+    const glm::mat4 viewProj = glm::perspective(1.2f, 2.0f, kNearZ, 200.0f) * glm::lookAt(glm::vec3(0, 1.5f, -1), glm::vec3(0, 1.5f, 5), glm::vec3(0, 1, 0));
+
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    for(uint32_t i = 0; i < frameCount; i++)
+    {
+        pCuller->beginFrame(viewProj, kNearZ);
+        pCuller->addOccluder(mesh, glm::mat4());
+        pCuller->rasterize();
+    }
+    double rasterizeTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / frameCount;
+
+    std::vector<BoundingBox> boxes(boxCount);
+    for(auto& box : boxes)
+    {
+        box.center = glm::vec3(dist(rng) * 60 - 30, dist(rng) * 4, dist(rng) * 60);
+        box.extent = glm::vec3(0.5f);
+    }
+    uint32_t visibleCount = 0;
+    start = CpuTimer::getCurrentTimePoint();
+    for(const auto& box : boxes)
+    {
+        visibleCount += pCuller->isVisible(box) ? 1 : 0;
+    }
+    double testTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    std::string perf = TestHelper::formatPerfResult("Rasterize 200K triangles", rasterizeTime, "ms");
+    perf += TestHelper::formatPerfResult("Box test", testTime * 1.0e6 / boxCount, "ns");
+    perf += TestHelper::formatPerfResult("Visible boxes", 100.0 * visibleCount / boxCount, "%");
+    return test_pass_perf(perf);
+}
+
+int main()
+{
+    OcclusionCullerTest oct;
+    oct.init();
+    oct.run();
+    return 0;
+}
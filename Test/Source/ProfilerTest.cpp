@@ -0,0 +1,164 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ProfilerTest.h"
+#include "TestHelper.h"
+#include "Utils/CpuTimer.h"
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+// The events are recorded on a worker thread. Only the main thread uses GPU timers, so the test doesn't need a device
+static void runOnWorkerThread(const std::function<void()>& func)
+{
+    std::thread worker(func);
+    worker.join();
+}
+
+// Find the time of the first begin or end record of an event in a Chrome trace
+static bool findTraceTime(const std::string& trace, const std::string& eventName, char phase, double& time)
+{
+    const std::string key = "{\"name\":\"" + eventName + "\",\"ph\":\"" + phase + "\",\"ts\":";
+    size_t pos = trace.find(key);
+    if(pos == std::string::npos)
+    {
+        return false;
+    }
+    time = atof(trace.c_str() + pos + key.size());
+    return true;
+}
+
+void ProfilerTest::addTests()
+{
+    addTestToList<TestTimestampCalibration>();
+    addTestToList<TestChromeTrace>();
+    addTestToList<TestEventCost>();
+}
+
+testing_func(ProfilerTest, TestTimestampCalibration)
+{
+    // Timestamp differences must agree with CpuTimer
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    uint64_t startTimestamp = Profiler::getTimestamp();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    uint64_t endTimestamp = Profiler::getTimestamp();
+    float reference = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    double duration = Profiler::timestampToMs(endTimestamp - startTimestamp);
+    if(std::abs(duration - reference) > reference * 0.01)
+    {
+        return test_fail("Timestamp duration " + std::to_string(duration) + "ms doesn't match the CpuTimer duration " + std::to_string(reference) + "ms");
+    }
+    return test_pass();
+}
+
+testing_func(ProfilerTest, TestChromeTrace)
+{
+    static const HashedString kOuter("ProfilerTestOuter");
+    static const HashedString kInner("ProfilerTestInner");
+    runOnWorkerThread([]()
+    {
+        Profiler::startEvent(kOuter);
+        Profiler::startEvent(kInner);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        Profiler::endEvent(kInner);
+        Profiler::endEvent(kOuter);
+    });
+
+    const std::string filename = "ProfilerTest.json";
+    if(Profiler::exportChromeTrace(filename) == false)
+    {
+        return test_fail("Failed to export the trace");
+    }
+    std::ifstream file(filename);
+    std::stringstream trace;
+    trace << file.rdbuf();
+
+    double outerBegin, outerEnd, innerBegin, innerEnd;
+    if(findTraceTime(trace.str(), kOuter.str, 'B', outerBegin) == false || findTraceTime(trace.str(), kOuter.str, 'E', outerEnd) == false ||
+        findTraceTime(trace.str(), kInner.str, 'B', innerBegin) == false || findTraceTime(trace.str(), kInner.str, 'E', innerEnd) == false)
+    {
+        return test_fail("The events are missing from the trace");
+    }
+
+    // The inner event is nested in the outer one, and lasts at least as long as the sleep. Times are in microseconds
+    if(innerBegin < outerBegin || innerEnd > outerEnd || innerBegin > innerEnd)
+    {
+        return test_fail("The events are not nested");
+    }
+    if(innerEnd - innerBegin < 20000 || innerEnd - innerBegin > 1000000)
+    {
+        return test_fail("The event duration " + std::to_string(innerEnd - innerBegin) + "us doesn't match the recorded sleep");
+    }
+    return test_pass();
+}
+
+testing_func(ProfilerTest, TestEventCost)
+{
+    // Cost of a startEvent()/endEvent() pair, with the event looked up once like the PROFILE macro does
+    static const HashedString kEvent("ProfilerTestCost");
+    static const HashedString kNestedEvent("ProfilerTestCostNested");
+    const uint32_t pairCount = 1000000;
+    float lookupTime = 0;
+    float cachedTime = 0;
+    runOnWorkerThread([&]()
+    {
+        Profiler::EventData* pEvent = Profiler::getEvent(kEvent);
+        Profiler::EventData* pNestedEvent = Profiler::getEvent(kNestedEvent);
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        for(uint32_t i = 0; i < pairCount / 2; i++)
+        {
+            Profiler::startEvent(kEvent, pEvent);
+            Profiler::startEvent(kNestedEvent, pNestedEvent);
+            Profiler::endEvent(kNestedEvent, pNestedEvent);
+            Profiler::endEvent(kEvent, pEvent);
+        }
+        cachedTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        // Looking the event up by name every time
+        start = CpuTimer::getCurrentTimePoint();
+        for(uint32_t i = 0; i < pairCount; i++)
+        {
+            Profiler::startEvent(kEvent);
+            Profiler::endEvent(kEvent);
+        }
+        lookupTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    });
+
+    std::string perf = TestHelper::formatPerfResult("Event pair", cachedTime * 1.0e6 / pairCount, "ns");
+    perf += TestHelper::formatPerfResult("Event pair with lookup", lookupTime * 1.0e6 / pairCount, "ns");
+    return test_pass_perf(perf);
+}
+
+int main()
+{
+    ProfilerTest pt;
+    pt.init();
+    pt.run();
+    return 0;
+}
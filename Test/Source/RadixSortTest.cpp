@@ -0,0 +1,241 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "RadixSortTest.h"
+#include "TestHelper.h"
+#include "Utils/RadixSort.h"
+#include "Utils/CpuTimer.h"
+#include "Graphics/Scene/SceneRenderer.h"
+#include <algorithm>
+#include <limits>
+#include <random>
+
+enum class KeyDistribution
+{
+    Random,         // All 64 bits are random
+    SparseBits,     // Only a few digits differ, so most passes are skipped
+    FewDistinct,    // Many duplicates, which tests stability
+    DrawKeys,       // Keys from makeDrawSortKey(), for a scene with a few hundred materials
+    Count
+};
+
+static std::vector<uint64_t> createKeys(std::mt19937_64& rng, uint32_t count, KeyDistribution distribution)
+{
+    std::vector<uint64_t> keys(count);
+    std::uniform_real_distribution<float> depth(0, 1);
+    for(auto& key : keys)
+    {
+        switch(distribution)
+        {
+        case KeyDistribution::Random:
+            key = rng();
+            break;
+        case KeyDistribution::SparseBits:
+            key = rng() & 0xff00ff0000ull;
+            break;
+        case KeyDistribution::FewDistinct:
+            key = (rng() % 7) << 40;
+            break;
+        case KeyDistribution::DrawKeys:
+            key = SceneRenderer::makeDrawSortKey(0, (uint32_t)(rng() % 2), (uint32_t)(rng() % 300), (uint32_t)(rng() % 5000), depth(rng));
+            break;
+        default:
+            should_not_get_here();
+        }
+    }
+    return keys;
+}
+
+// Sort the keys with the indices as values, and compare with std::stable_sort
+static bool checkSort(RadixSort& sorter, const std::vector<uint64_t>& keys)
+{
+    std::vector<uint64_t> sortedKeys = keys;
+    std::vector<uint32_t> values(keys.size());
+    for(uint32_t i = 0; i < (uint32_t)values.size(); i++)
+    {
+        values[i] = i;
+    }
+    sorter.sort(sortedKeys.data(), values.data(), (uint32_t)keys.size());
+
+    std::vector<uint32_t> reference(keys.size());
+    for(uint32_t i = 0; i < (uint32_t)reference.size(); i++)
+    {
+        reference[i] = i;
+    }
+    std::stable_sort(reference.begin(), reference.end(), [&keys](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+
+    for(size_t i = 0; i < keys.size(); i++)
+    {
+        if(values[i] != reference[i] || sortedKeys[i] != keys[reference[i]])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void RadixSortTest::addTests()
+{
+    addTestToList<TestMatchesStableSort>();
+    addTestToList<TestReuse>();
+    addTestToList<TestDrawSortKeys>();
+    addTestToList<TestThroughput>();
+}
+
+testing_func(RadixSortTest, TestMatchesStableSort)
+{
+    // The small counts test the early outs. The large ones have enough keys for all 256 digits of every pass
+    std::mt19937_64 rng(1);
+    RadixSort sorter;
+    const uint32_t counts[] = { 0, 1, 2, 3, 17, 1000, 100003 };
+    for(uint32_t count : counts)
+    {
+        for(uint32_t distribution = 0; distribution < (uint32_t)KeyDistribution::Count; distribution++)
+        {
+            if(checkSort(sorter, createKeys(rng, count, (KeyDistribution)distribution)) == false)
+            {
+                return test_fail("The result doesn't match std::stable_sort for " + std::to_string(count) + " keys of distribution " + std::to_string(distribution));
+            }
+        }
+    }
+
+    // Keys which are all the same skip every pass, and keys which differ in every digit run all of them
+    std::vector<uint64_t> keys(1000, 0x0123456789abcdefull);
+    if(checkSort(sorter, keys) == false)
+    {
+        return test_fail("Sorting equal keys changed their order");
+    }
+    for(uint32_t i = 0; i < (uint32_t)keys.size(); i++)
+    {
+        keys[i] = (i & 1) ? std::numeric_limits<uint64_t>::max() - i : 0x0101010101010101ull * (i & 0xff);
+    }
+    if(checkSort(sorter, keys) == false)
+    {
+        return test_fail("The result doesn't match std::stable_sort for keys which differ in every digit");
+    }
+    return test_pass();
+}
+
+testing_func(RadixSortTest, TestReuse)
+{
+    // The scratch buffers are kept between calls. Shrinking and growing them must not leak data between sorts
+    std::mt19937_64 rng(2);
+    RadixSort sorter;
+    const uint32_t counts[] = { 50000, 10, 70000, 1, 30000 };
+    for(uint32_t count : counts)
+    {
+        if(checkSort(sorter, createKeys(rng, count, KeyDistribution::Random)) == false)
+        {
+            return test_fail("Reusing the sorter for " + std::to_string(count) + " keys gave a wrong result");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(RadixSortTest, TestDrawSortKeys)
+{
+    // The fields are ordered from the most significant one down
+    const uint64_t key = SceneRenderer::makeDrawSortKey(1, 0, 5, 7, 0.5f);
+    if(key >= SceneRenderer::makeDrawSortKey(2, 0, 0, 0, 0) || key >= SceneRenderer::makeDrawSortKey(1, 1, 0, 0, 0))
+    {
+        return test_fail("The pass and the program variant must be the most significant fields");
+    }
+    if(key >= SceneRenderer::makeDrawSortKey(1, 0, 6, 0, 0) || key <= SceneRenderer::makeDrawSortKey(1, 0, 4, 1000, 1))
+    {
+        return test_fail("The material must be more significant than the mesh and the depth");
+    }
+    if(key >= SceneRenderer::makeDrawSortKey(1, 0, 5, 8, 0) || key <= SceneRenderer::makeDrawSortKey(1, 0, 5, 6, 1))
+    {
+        return test_fail("The mesh must be more significant than the depth");
+    }
+    if(key >= SceneRenderer::makeDrawSortKey(1, 0, 5, 7, 0.51f) || key <= SceneRenderer::makeDrawSortKey(1, 0, 5, 7, 0.49f))
+    {
+        return test_fail("Draws of the same mesh must be sorted front-to-back");
+    }
+
+    // Out-of-range depths are clamped, and don't overflow into the mesh ID
+    const uint64_t nearKey = SceneRenderer::makeDrawSortKey(0, 0, 3, 3, 0);
+    const uint64_t farKey = SceneRenderer::makeDrawSortKey(0, 0, 3, 3, 1);
+    if(SceneRenderer::makeDrawSortKey(0, 0, 3, 3, -2.0f) != nearKey || SceneRenderer::makeDrawSortKey(0, 0, 3, 3, std::numeric_limits<float>::quiet_NaN()) != nearKey)
+    {
+        return test_fail("Negative and NaN depths must map to the nearest depth");
+    }
+    if(SceneRenderer::makeDrawSortKey(0, 0, 3, 3, 1000.0f) != farKey || (farKey >> 16) != (nearKey >> 16))
+    {
+        return test_fail("Depths beyond the far plane must map to the farthest depth");
+    }
+    return test_pass();
+}
+
+testing_func(RadixSortTest, TestThroughput)
+{
+    const uint32_t count = 1000000;
+    const char* names[] = { "random keys", "sparse keys", "few distinct keys", "draw keys" };
+    std::mt19937_64 rng(3);
+    RadixSort sorter;
+    std::string perf;
+    for(uint32_t distribution = 0; distribution < (uint32_t)KeyDistribution::Count; distribution++)
+    {
+        const std::vector<uint64_t> keys = createKeys(rng, count, (KeyDistribution)distribution);
+        std::vector<uint64_t> sortedKeys = keys;
+        std::vector<uint32_t> values(count);
+
+        // Warm up the scratch buffers, as a renderer reusing the sorter every frame would
+        sorter.sort(sortedKeys.data(), values.data(), count);
+        sortedKeys = keys;
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        sorter.sort(sortedKeys.data(), values.data(), count);
+        double radixTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        // The same key-value sort with the standard library
+        std::vector<std::pair<uint64_t, uint32_t>> pairs(count);
+        for(uint32_t i = 0; i < count; i++)
+        {
+            pairs[i] = std::make_pair(keys[i], i);
+        }
+        start = CpuTimer::getCurrentTimePoint();
+        std::stable_sort(pairs.begin(), pairs.end(), [](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b) { return a.first < b.first; });
+        double stableSortTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        if(std::is_sorted(sortedKeys.begin(), sortedKeys.end()) == false)
+        {
+            return test_fail(std::string("The ") + names[distribution] + " are not sorted");
+        }
+        perf += TestHelper::formatPerfResult(std::string("RadixSort, ") + names[distribution], radixTime, "ms");
+        perf += TestHelper::formatPerfResult(std::string("std::stable_sort, ") + names[distribution], stableSortTime, "ms");
+    }
+    return test_pass_perf(perf);
+}
+
+int main()
+{
+    RadixSortTest rst;
+    rst.init();
+    rst.run();
+    return 0;
+}
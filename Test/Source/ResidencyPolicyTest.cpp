@@ -0,0 +1,295 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ResidencyPolicyTest.h"
+#include "Graphics/Material/TextureResidencyManager.h"
+#include <map>
+#include <random>
+
+// The policy only compares the IDs, so fake textures are just numbers
+static ResidencyPolicy::ObjectID getFakeTexture(uint32_t index)
+{
+    return (ResidencyPolicy::ObjectID)(uintptr_t)(index + 1);
+}
+
+/** Straightforward model of the policy. Every touch gets a sequence number, and the eviction scans all the objects for the least-recently-used one
+*/
+class ReferencePolicy
+{
+public:
+    ReferencePolicy(uint64_t budget, uint32_t minIdleFrames) : mBudget(budget), mMinIdleFrames(minIdleFrames) {}
+
+    bool touch(ResidencyPolicy::ObjectID id, uint64_t size)
+    {
+        auto it = mObjects.find(id);
+        bool wasEvicted = (it != mObjects.end()) && (it->second.isResident == false);
+        Object& object = mObjects[id];
+        if(it == mObjects.end())
+        {
+            object.size = size;
+        }
+        object.lastUsedFrame = mFrameIndex;
+        object.sequence = mSequence++;
+        object.isResident = true;
+        return wasEvicted;
+    }
+
+    void remove(ResidencyPolicy::ObjectID id)
+    {
+        mObjects.erase(id);
+    }
+
+    void endFrame(std::vector<ResidencyPolicy::ObjectID>& evicted)
+    {
+        while(getResidentBytes() > mBudget)
+        {
+            Object* pLru = nullptr;
+            ResidencyPolicy::ObjectID lruID = nullptr;
+            for(auto& o : mObjects)
+            {
+                if(o.second.isResident && (pLru == nullptr || o.second.sequence < pLru->sequence))
+                {
+                    pLru = &o.second;
+                    lruID = o.first;
+                }
+            }
+            if(pLru == nullptr || pLru->lastUsedFrame + mMinIdleFrames > mFrameIndex)
+            {
+                break;
+            }
+            pLru->isResident = false;
+            evicted.push_back(lruID);
+        }
+        mFrameIndex++;
+    }
+
+    uint64_t getResidentBytes() const
+    {
+        uint64_t bytes = 0;
+        for(const auto& o : mObjects)
+        {
+            bytes += o.second.isResident ? o.second.size : 0;
+        }
+        return bytes;
+    }
+
+private:
+    struct Object
+    {
+        uint64_t size = 0;
+        uint64_t lastUsedFrame = 0;
+        uint64_t sequence = 0;
+        bool isResident = true;
+    };
+
+    std::map<ResidencyPolicy::ObjectID, Object> mObjects;
+    uint64_t mBudget;
+    uint32_t mMinIdleFrames;
+    uint64_t mFrameIndex = 0;
+    uint64_t mSequence = 0;
+};
+
+void ResidencyPolicyTest::addTests()
+{
+    addTestToList<TestLruEviction>();
+    addTestToList<TestMinIdleFrames>();
+    addTestToList<TestRestoreAndRemove>();
+    addTestToList<TestRandomWorkload>();
+}
+
+testing_func(ResidencyPolicyTest, TestLruEviction)
+{
+    // Four 1KB textures with a 2KB budget. After the first frame only textures 0 and 1 are used, so textures 2 and 3 are evicted, least-recently-used first
+    ResidencyPolicy policy;
+    policy.setBudget(2048);
+    policy.setMinIdleFrames(2);
+    std::vector<ResidencyPolicy::ObjectID> evicted;
+    for(uint32_t i = 0; i < 4; i++)
+    {
+        policy.touch(getFakeTexture(i), 1024);
+    }
+    policy.endFrame(evicted);
+    if(evicted.empty() == false || policy.getResidentBytes() != 4096)
+    {
+        return test_fail("Textures were evicted before they were idle long enough");
+    }
+
+    for(uint32_t frame = 1; frame < 4; frame++)
+    {
+        policy.touch(getFakeTexture(1), 1024);
+        policy.touch(getFakeTexture(0), 1024);
+        policy.endFrame(evicted);
+    }
+
+    if(evicted.size() != 2 || evicted[0] != getFakeTexture(2) || evicted[1] != getFakeTexture(3))
+    {
+        return test_fail("The least-recently-used textures were not evicted first");
+    }
+    if(policy.getResidentBytes() != 2048 || policy.getTrackedBytes() != 4096 || policy.getObjectCount() != 4)
+    {
+        return test_fail("Wrong resident or tracked size after the eviction");
+    }
+    return test_pass();
+}
+
+testing_func(ResidencyPolicyTest, TestMinIdleFrames)
+{
+    // Textures used in the last minIdleFrames frames may still be in use by the GPU, so they must not be evicted even if the budget is exceeded
+    const uint32_t minIdleFrames = 3;
+    ResidencyPolicy policy;
+    policy.setBudget(1024);
+    policy.setMinIdleFrames(minIdleFrames);
+    std::vector<ResidencyPolicy::ObjectID> evicted;
+
+    policy.touch(getFakeTexture(0), 1024);
+    policy.touch(getFakeTexture(1), 1024);
+    for(uint32_t frame = 0; frame < minIdleFrames; frame++)
+    {
+        policy.endFrame(evicted);
+        if(evicted.empty() == false)
+        {
+            return test_fail("A texture was evicted " + std::to_string(frame) + " frames after its last use");
+        }
+    }
+
+    policy.endFrame(evicted);
+    if(evicted.size() != 1 || evicted[0] != getFakeTexture(0) || policy.getResidentBytes() != 1024)
+    {
+        return test_fail("The idle texture wasn't evicted once the idle period passed");
+    }
+    return test_pass();
+}
+
+testing_func(ResidencyPolicyTest, TestRestoreAndRemove)
+{
+    ResidencyPolicy policy;
+    policy.setBudget(0);
+    policy.setMinIdleFrames(0);
+    std::vector<ResidencyPolicy::ObjectID> evicted;
+
+    if(policy.touch(getFakeTexture(0), 100) || policy.touch(getFakeTexture(1), 200))
+    {
+        return test_fail("New textures must be reported as resident");
+    }
+    policy.endFrame(evicted);
+    if(evicted.size() != 2 || policy.getResidentBytes() != 0)
+    {
+        return test_fail("A zero budget must evict all the idle textures");
+    }
+
+    // Touching an evicted texture reports that it has to be made resident again
+    if(policy.touch(getFakeTexture(0), 100) == false || policy.touch(getFakeTexture(0), 100))
+    {
+        return test_fail("Restores are not reported exactly once");
+    }
+    if(policy.getResidentBytes() != 100 || policy.getTrackedBytes() != 300)
+    {
+        return test_fail("Wrong resident or tracked size after a restore");
+    }
+
+    // Removing a resident and an evicted texture
+    policy.remove(getFakeTexture(0));
+    policy.remove(getFakeTexture(1));
+    policy.remove(getFakeTexture(2));
+    if(policy.getResidentBytes() != 0 || policy.getTrackedBytes() != 0 || policy.getObjectCount() != 0)
+    {
+        return test_fail("Removed textures are still tracked");
+    }
+
+    evicted.clear();
+    policy.endFrame(evicted);
+    if(evicted.empty() == false)
+    {
+        return test_fail("A removed texture was evicted");
+    }
+    return test_pass();
+}
+
+testing_func(ResidencyPolicyTest, TestRandomWorkload)
+{
+    // Random working sets of textures with random sizes, with some textures released. Every frame must evict the same textures as the reference model
+    const uint32_t textureCount = 200;
+    const uint32_t frameCount = 2000;
+    const uint64_t budget = 64 * 1024 * 1024;
+    const uint32_t minIdleFrames = 3;
+
+    std::mt19937 rng(7);
+    std::vector<uint64_t> sizes(textureCount);
+    for(auto& size : sizes)
+    {
+        size = 64 * 1024 << (rng() % 8);
+    }
+
+    ResidencyPolicy policy;
+    policy.setBudget(budget);
+    policy.setMinIdleFrames(minIdleFrames);
+    ReferencePolicy reference(budget, minIdleFrames);
+    std::vector<ResidencyPolicy::ObjectID> evicted, referenceEvicted;
+    for(uint32_t frame = 0; frame < frameCount; frame++)
+    {
+        // The working set drifts over time, like a camera moving through a scene
+        const uint32_t first = (frame / 20) % textureCount;
+        const uint32_t count = 10 + rng() % 40;
+        for(uint32_t i = 0; i < count; i++)
+        {
+            const uint32_t index = (first + rng() % 60) % textureCount;
+            if(policy.touch(getFakeTexture(index), sizes[index]) != reference.touch(getFakeTexture(index), sizes[index]))
+            {
+                return test_fail("A restore doesn't match the reference in frame " + std::to_string(frame));
+            }
+        }
+
+        if(rng() % 50 == 0)
+        {
+            const uint32_t index = rng() % textureCount;
+            policy.remove(getFakeTexture(index));
+            reference.remove(getFakeTexture(index));
+        }
+
+        evicted.clear();
+        referenceEvicted.clear();
+        policy.endFrame(evicted);
+        reference.endFrame(referenceEvicted);
+        if(evicted != referenceEvicted)
+        {
+            return test_fail("The evicted textures don't match the reference in frame " + std::to_string(frame));
+        }
+        if(policy.getResidentBytes() != reference.getResidentBytes())
+        {
+            return test_fail("The resident size doesn't match the reference in frame " + std::to_string(frame));
+        }
+    }
+    return test_pass();
+}
+
+int main()
+{
+    ResidencyPolicyTest rpt;
+    rpt.init();
+    rpt.run();
+    return 0;
+}
@@ -0,0 +1,353 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "SceneBVHTest.h"
+#include "TestHelper.h"
+#include "Graphics/Scene/SceneBVH.h"
+#include "Utils/CpuTimer.h"
+#include <algorithm>
+#include <cfloat>
+#include <random>
+
+static const float kWorldSize = 1000;
+static const uint32_t kQueryCount = 20;
+
+// Instances scattered over a large, flat world, like a city or a forest. Every 100th instance is stacked at the same position, which forces the builder to split boxes it can't separate
+static std::vector<BoundingBox> createInstanceBoxes(std::mt19937& rng, uint32_t count)
+{
+    std::uniform_real_distribution<float> dist(0, 1);
+    std::vector<BoundingBox> boxes(count);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        boxes[i].center = (i % 100 == 0) ? glm::vec3(5) : glm::vec3(dist(rng), dist(rng) * 0.2f, dist(rng)) * kWorldSize;
+        boxes[i].extent = glm::vec3(0.2f) + glm::vec3(dist(rng), dist(rng), dist(rng));
+    }
+    return boxes;
+}
+
+static Camera::SharedPtr createRandomCamera(std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> dist(0, 1);
+    Camera::SharedPtr pCamera = Camera::create();
+    pCamera->setPosition(glm::vec3(dist(rng) * kWorldSize, 50 + dist(rng) * 100, dist(rng) * kWorldSize));
+    pCamera->setTarget(glm::vec3(dist(rng) * kWorldSize, 0, dist(rng) * kWorldSize));
+    pCamera->setUpVector(glm::vec3(0, 1, 0));
+    pCamera->setAspectRatio(16.0f / 9.0f);
+    pCamera->setDepthRange(0.5f, 200 + dist(rng) * 400);
+    return pCamera;
+}
+
+static bool isOverlapping(const BoundingBox& a, const BoundingBox& b)
+{
+    return glm::all(glm::lessThanEqual(a.getMinPos(), b.getMaxPos())) && glm::all(glm::lessThanEqual(b.getMinPos(), a.getMaxPos()));
+}
+
+// The brute-force versions of the queries. They return the items in increasing order
+static std::vector<uint32_t> findVisible(const Camera* pCamera, float minProjectedSize, const std::vector<BoundingBox>& boxes)
+{
+    const glm::vec3& eye = pCamera->getPosition();
+    const float sizeScale = pCamera->getProjMatrix()[1][1];
+    std::vector<uint32_t> items;
+    for(uint32_t i = 0; i < (uint32_t)boxes.size(); i++)
+    {
+        glm::vec3 min = boxes[i].getMinPos();
+        glm::vec3 max = boxes[i].getMaxPos();
+        bool isTooSmall = 0.5f * glm::length(max - min) * sizeScale < minProjectedSize * glm::length(eye - glm::clamp(eye, min, max));
+        if(pCamera->isObjectCulled(boxes[i]) == false && (minProjectedSize == 0 || isTooSmall == false))
+        {
+            items.push_back(i);
+        }
+    }
+    return items;
+}
+
+static std::vector<uint32_t> findOverlapping(const BoundingBox& box, const std::vector<BoundingBox>& boxes)
+{
+    std::vector<uint32_t> items;
+    for(uint32_t i = 0; i < (uint32_t)boxes.size(); i++)
+    {
+        if(isOverlapping(box, boxes[i]))
+        {
+            items.push_back(i);
+        }
+    }
+    return items;
+}
+
+static std::vector<uint32_t> findInSphere(const glm::vec3& center, float radius, const std::vector<BoundingBox>& boxes)
+{
+    std::vector<uint32_t> items;
+    for(uint32_t i = 0; i < (uint32_t)boxes.size(); i++)
+    {
+        glm::vec3 d = center - glm::clamp(center, boxes[i].getMinPos(), boxes[i].getMaxPos());
+        if(glm::dot(d, d) <= radius * radius)
+        {
+            items.push_back(i);
+        }
+    }
+    return items;
+}
+
+// Returns the closest hit distance, or -1 if nothing was hit
+static float findClosestHit(const glm::vec3& origin, const glm::vec3& direction, const std::vector<BoundingBox>& boxes)
+{
+    float closest = -1;
+    const glm::vec3 invDirection = 1.0f / direction;
+    for(const auto& box : boxes)
+    {
+        glm::vec3 t0 = (box.getMinPos() - origin) * invDirection;
+        glm::vec3 t1 = (box.getMaxPos() - origin) * invDirection;
+        glm::vec3 tMin = glm::min(t0, t1);
+        glm::vec3 tMax = glm::max(t0, t1);
+        float entry = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+        float exit = std::min(std::min(tMax.x, tMax.y), tMax.z);
+        if(entry <= exit && (closest < 0 || entry < closest))
+        {
+            closest = entry;
+        }
+    }
+    return closest;
+}
+
+static bool isSameItems(std::vector<uint32_t>& items, const std::vector<uint32_t>& reference)
+{
+    std::sort(items.begin(), items.end());
+    return items == reference;
+}
+
+// Run every kind of query from random cameras and compare with the brute-force results. Returns an empty string on success
+static std::string checkQueries(const SceneBVH* pBvh, const std::vector<BoundingBox>& boxes, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<uint32_t> items;
+    for(uint32_t i = 0; i < kQueryCount; i++)
+    {
+        Camera::SharedPtr pCamera = createRandomCamera(rng);
+        pBvh->queryFrustum(pCamera.get(), items);
+        if(isSameItems(items, findVisible(pCamera.get(), 0, boxes)) == false)
+        {
+            return "The frustum query doesn't match isObjectCulled()";
+        }
+
+        const float minProjectedSize = 0.002f * (1 + i % 4);
+        pBvh->queryFrustum(pCamera.get(), minProjectedSize, items);
+        if(isSameItems(items, findVisible(pCamera.get(), minProjectedSize, boxes)) == false)
+        {
+            return "The frustum query with a minimum projected size doesn't match the brute-force result";
+        }
+
+        BoundingBox box;
+        box.center = pCamera->getTarget();
+        box.extent = glm::vec3(30);
+        pBvh->queryBox(box, items);
+        if(isSameItems(items, findOverlapping(box, boxes)) == false)
+        {
+            return "The box query doesn't match the brute-force result";
+        }
+
+        pBvh->querySphere(box.center, 25, items);
+        if(isSameItems(items, findInSphere(box.center, 25, boxes)) == false)
+        {
+            return "The sphere query doesn't match the brute-force result";
+        }
+
+        const glm::vec3 direction = pCamera->getTarget() - pCamera->getPosition();
+        float distance = 0;
+        uint32_t hit = pBvh->intersectRay(pCamera->getPosition(), direction, FLT_MAX, distance);
+        float reference = findClosestHit(pCamera->getPosition(), direction, boxes);
+        if((hit == SceneBVH::kInvalidItem) != (reference < 0) || (hit != SceneBVH::kInvalidItem && distance != reference))
+        {
+            return "The closest ray hit doesn't match the brute-force result";
+        }
+    }
+    return "";
+}
+
+void SceneBVHTest::addTests()
+{
+    addTestToList<TestQueries>();
+    addTestToList<TestRefit>();
+    addTestToList<TestSmallHierarchies>();
+    addTestToList<TestMillionInstances>();
+}
+
+testing_func(SceneBVHTest, TestQueries)
+{
+    // Large enough for the parallel binning and the parallel subtree builds
+    std::mt19937 rng(1);
+    std::vector<BoundingBox> boxes = createInstanceBoxes(rng, 200000);
+    SceneBVH::SharedPtr pBvh = SceneBVH::create();
+    pBvh->build(boxes.data(), (uint32_t)boxes.size());
+    if(pBvh->getItemCount() != boxes.size())
+    {
+        return test_fail("Wrong item count");
+    }
+
+    std::string error = checkQueries(pBvh.get(), boxes, 2);
+    if(error.empty() == false)
+    {
+        return test_fail(error);
+    }
+    return test_pass();
+}
+
+testing_func(SceneBVHTest, TestRefit)
+{
+    std::mt19937 rng(3);
+    std::vector<BoundingBox> boxes = createInstanceBoxes(rng, 100000);
+    SceneBVH::SharedPtr pBvh = SceneBVH::create();
+    pBvh->build(boxes.data(), (uint32_t)boxes.size());
+
+    // Move every instance a little, and a few of them across the world. The topology stays the same, so only the bounds change
+    std::uniform_real_distribution<float> dist(-1, 1);
+    for(uint32_t i = 0; i < (uint32_t)boxes.size(); i++)
+    {
+        float scale = (i % 1000 == 0) ? kWorldSize : 2.0f;
+        boxes[i].center += glm::vec3(dist(rng), dist(rng), dist(rng)) * scale;
+    }
+    pBvh->refit(boxes.data());
+
+    BoundingBox bounds = pBvh->getBounds();
+    for(uint32_t i = 0; i < (uint32_t)boxes.size(); i++)
+    {
+        if(pBvh->getItemBounds(i).center != boxes[i].center || isOverlapping(bounds, boxes[i]) == false)
+        {
+            return test_fail("The refitted bounds don't contain the moved items");
+        }
+    }
+
+    std::string error = checkQueries(pBvh.get(), boxes, 4);
+    if(error.empty() == false)
+    {
+        return test_fail(error);
+    }
+    return test_pass();
+}
+
+testing_func(SceneBVHTest, TestSmallHierarchies)
+{
+    // Empty hierarchies, single leaves, and partially filled leaves
+    std::mt19937 rng(5);
+    std::vector<BoundingBox> boxes = createInstanceBoxes(rng, 40);
+    std::vector<uint32_t> items;
+    for(uint32_t count = 0; count <= (uint32_t)boxes.size(); count++)
+    {
+        SceneBVH::SharedPtr pBvh = SceneBVH::create();
+        pBvh->build(boxes.data(), count);
+        std::vector<BoundingBox> subset(boxes.begin(), boxes.begin() + count);
+        for(uint32_t i = 0; i < count; i++)
+        {
+            pBvh->queryBox(boxes[i], items);
+            if(isSameItems(items, findOverlapping(boxes[i], subset)) == false)
+            {
+                return test_fail("The box query doesn't match the brute-force result for " + std::to_string(count) + " items");
+            }
+        }
+
+        float distance;
+        BoundingBox world;
+        world.center = glm::vec3(kWorldSize / 2);
+        world.extent = glm::vec3(kWorldSize);
+        pBvh->queryBox(world, items);
+        if(items.size() != count || (count == 0 && pBvh->intersectRay(glm::vec3(0), glm::vec3(1), FLT_MAX, distance) != SceneBVH::kInvalidItem))
+        {
+            return test_fail("Wrong result for " + std::to_string(count) + " items");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(SceneBVHTest, TestMillionInstances)
+{
+    const uint32_t itemCount = 1000000;
+    std::mt19937 rng(6);
+    std::vector<BoundingBox> boxes = createInstanceBoxes(rng, itemCount);
+    SceneBVH::SharedPtr pBvh = SceneBVH::create();
+
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    pBvh->build(boxes.data(), itemCount);
+    double buildTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    std::uniform_real_distribution<float> dist(-1, 1);
+    for(auto& box : boxes)
+    {
+        box.center += glm::vec3(dist(rng), dist(rng), dist(rng));
+    }
+    start = CpuTimer::getCurrentTimePoint();
+    pBvh->refit(boxes.data());
+    double refitTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    // Compare the frustum query with culling every instance, which is what the renderer does without the hierarchy
+    double queryTime = 0;
+    double linearTime = 0;
+    std::vector<uint32_t> items;
+    std::vector<uint8_t> visibleMask(itemCount);
+    for(uint32_t i = 0; i < kQueryCount; i++)
+    {
+        // Update the camera matrices before timing
+        Camera::SharedPtr pCamera = createRandomCamera(rng);
+        pCamera->getFrustumPlanes();
+        start = CpuTimer::getCurrentTimePoint();
+        pBvh->queryFrustum(pCamera.get(), items);
+        queryTime += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        start = CpuTimer::getCurrentTimePoint();
+        pCamera->cullBoxes(boxes.data(), itemCount, visibleMask.data());
+        linearTime += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        if(items.size() != (size_t)std::count(visibleMask.begin(), visibleMask.end(), uint8_t(1)))
+        {
+            return test_fail("The frustum query doesn't match cullBoxes()");
+        }
+    }
+
+    const uint32_t rayCount = 100000;
+    uint32_t hitCount = 0;
+    start = CpuTimer::getCurrentTimePoint();
+    for(uint32_t i = 0; i < rayCount; i++)
+    {
+        glm::vec3 origin = glm::vec3(dist(rng) + 1, 0.2f, dist(rng) + 1) * (kWorldSize / 2);
+        float distance;
+        hitCount += pBvh->intersectRay(origin, glm::vec3(dist(rng), -1, dist(rng)), FLT_MAX, distance) != SceneBVH::kInvalidItem ? 1 : 0;
+    }
+    double rayTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    std::string perf = TestHelper::formatPerfResult("Build", buildTime, "ms");
+    perf += TestHelper::formatPerfResult("Refit", refitTime, "ms");
+    perf += TestHelper::formatPerfResult("Frustum query", queryTime / kQueryCount, "ms");
+    perf += TestHelper::formatPerfResult("Linear cull", linearTime / kQueryCount, "ms");
+    perf += TestHelper::formatPerfResult("Closest hit", rayCount / rayTime / 1000, "Mrays/s");
+    return test_pass_perf(perf);
+}
+
+int main()
+{
+    SceneBVHTest sbt;
+    sbt.init();
+    sbt.run();
+    return 0;
+}
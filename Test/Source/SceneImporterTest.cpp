@@ -0,0 +1,486 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "SceneImporterTest.h"
+#include "TestHelper.h"
+#include "Graphics/Model/ModelCache.h"
+#include "Graphics/Scene/SceneSnapshot.h"
+#include "Utils/CpuTimer.h"
+#include "Externals/RapidJson/include/rapidjson/document.h"
+#include "glm/gtx/euler_angles.hpp"
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <thread>
+
+const std::string SceneImporterTest::kModelFile = "SceneImporterTest.obj";
+const std::string SceneImporterTest::kSmallSceneFile = "SceneImporterTestSmall.fscene";
+const std::string SceneImporterTest::kLargeSceneFile = "SceneImporterTestLarge.fscene";
+const std::string SceneImporterTest::kBinaryModelFile = "SceneImporterTest.bin";
+const std::string SceneImporterTest::kModelsSceneFile = "SceneImporterTestModels.fscene";
+const std::string SceneImporterTest::kIncludeSceneFile = "SceneImporterTestInclude.fscene";
+
+static const uint32_t kSmallInstanceCount = 10000;     // Per model
+static const uint32_t kLargeInstanceCount = 1000000;
+static const uint32_t kBinaryMeshCount = 16;            // The binary importer decodes the meshes in parallel
+static const uint32_t kGridSize = 64;                   // Vertices per side of every mesh
+static const uint32_t kParallelLoadCount = 8;
+
+/** Write a scene with random model instances. The values are written with enough digits to be read back exactly
+*/
+static void writeScene(const std::string& filename, const std::string& modelFile, uint32_t modelCount, uint32_t instanceCount)
+{
+    std::mt19937 rng(modelCount * instanceCount);
+    std::uniform_real_distribution<float> position(-1000, 1000);
+    std::uniform_real_distribution<float> angle(-180, 180);
+    std::uniform_real_distribution<float> scale(0.1f, 10);
+
+    FILE* pFile = nullptr;
+    if(fopen_s(&pFile, filename.c_str(), "w") != 0)
+    {
+        return;
+    }
+    fprintf(pFile, "{\n    \"version\": 2,\n    \"camera_speed\": 1.0,\n    \"models\": [\n");
+    for(uint32_t m = 0; m < modelCount; m++)
+    {
+        fprintf(pFile, "        {\n            \"file\": \"%s\",\n            \"name\": \"Model%u\",\n            \"instances\": [\n", modelFile.c_str(), m);
+        for(uint32_t i = 0; i < instanceCount; i++)
+        {
+            const char* separator = (i + 1 < instanceCount) ? "," : "";
+            // Every third instance relies on the default rotation and scaling
+            if(i % 3 == 2)
+            {
+                fprintf(pFile, "                { \"name\": \"Instance %u.%u\", \"translation\": [%.9g, %.9g, %.9g] }%s\n", m, i, position(rng), position(rng), position(rng), separator);
+            }
+            else
+            {
+                fprintf(pFile, "                { \"name\": \"Instance %u.%u\", \"translation\": [%.9g, %.9g, %.9g], \"scaling\": [%.9g, %.9g, %.9g], \"rotation\": [%.9g, %.9g, %.9g] }%s\n",
+                    m, i, position(rng), position(rng), position(rng), scale(rng), scale(rng), scale(rng), angle(rng), angle(rng), angle(rng), separator);
+            }
+        }
+        fprintf(pFile, "            ]\n        }%s\n", (m + 1 < modelCount) ? "," : "");
+    }
+    fprintf(pFile, "    ]\n}\n");
+    fclose(pFile);
+}
+
+/** Describe the models and model instances of a scene, including the model, mesh and material IDs, which must not depend on the order the models were loaded
+*/
+static std::string describeScene(const Scene* pScene)
+{
+    std::string desc;
+    for(uint32_t m = 0; m < pScene->getModelCount(); m++)
+    {
+        const Model* pModel = pScene->getModel(m).get();
+        desc += pModel->getName() + " (" + pModel->getFilename() + ", ID " + std::to_string(pModel->getId()) + "): " + std::to_string(pModel->getMeshCount()) + " meshes, " + std::to_string(pModel->getVertexCount()) + " vertices\n";
+        for(uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+        {
+            const Mesh* pMesh = pModel->getMesh(meshID).get();
+            desc += "    Mesh " + std::to_string(pMesh->getId()) + ", material " + pMesh->getMaterial()->getName() + " (ID " + std::to_string(pMesh->getMaterial()->getId()) + ")\n";
+        }
+        for(uint32_t i = 0; i < pScene->getModelInstanceCount(m); i++)
+        {
+            const auto& pInstance = pScene->getModelInstance(m, i);
+            const glm::vec3& t = pInstance->getTranslation();
+            desc += "    Instance " + pInstance->getName() + " at " + std::to_string(t.x) + ", " + std::to_string(t.y) + ", " + std::to_string(t.z) + "\n";
+        }
+    }
+    return desc;
+}
+
+/** Check that the two models loaded from the binary model file ("Grid" and "Grid Copy") share their meshes
+*/
+static bool sharesBinaryModelMeshes(const Scene* pScene)
+{
+    const Model* pGrid = pScene->getModel(0).get();
+    const Model* pGridCopy = pScene->getModel(2).get();
+    if(pGrid == pGridCopy || pGrid->getMeshCount() != pGridCopy->getMeshCount())
+    {
+        return false;
+    }
+    for(uint32_t meshID = 0; meshID < pGrid->getMeshCount(); meshID++)
+    {
+        if(pGrid->getMesh(meshID) != pGridCopy->getMesh(meshID))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Read a scene file into a DOM, the way SceneImporter::load() did before it streamed the model instances
+*/
+static bool readSceneDom(const std::string& filename, rapidjson::Document& doc)
+{
+    std::ifstream fileStream(filename);
+    std::stringstream strStream;
+    strStream << fileStream.rdbuf();
+    std::string jsonData = strStream.str();
+    rapidjson::StringStream JStream(jsonData.c_str());
+    doc.ParseStream(JStream);
+    return doc.HasParseError() == false;
+}
+
+static glm::vec3 getDomVec(const rapidjson::Value& jsonInstance, const char* key, const glm::vec3& defaultValue)
+{
+    const auto& member = jsonInstance.FindMember(key);
+    if(member == jsonInstance.MemberEnd())
+    {
+        return defaultValue;
+    }
+    return glm::vec3(member->value[0u].GetDouble(), member->value[1u].GetDouble(), member->value[2u].GetDouble());
+}
+
+/** Read a vector the way SceneImporter::getFloatVec() did before the model instances were streamed
+*/
+static bool getDomFloatVec3(const rapidjson::Value& jsonVal, glm::vec3& vec)
+{
+    if(jsonVal.IsArray() == false || jsonVal.Size() != 3)
+    {
+        return false;
+    }
+    for(uint32_t i = 0; i < jsonVal.Size(); i++)
+    {
+        if(jsonVal[i].IsNumber() == false)
+        {
+            return false;
+        }
+        vec[i] = (float)(jsonVal[i].GetDouble());
+    }
+    return true;
+}
+
+/** Create the model instances of a DOM model instance array. A copy of SceneImporter::createModelInstances() as it was before the model instances were streamed, including the instance name map used to detect duplicates
+*/
+static bool createDomModelInstances(const rapidjson::Value& jsonVal, const Model::SharedPtr& pModel, Scene& scene, std::map<std::string, IMovableObject::SharedPtr>& instanceMap)
+{
+    if(jsonVal.IsArray() == false)
+    {
+        return false;
+    }
+
+    for(uint32_t i = 0; i < jsonVal.Size(); i++)
+    {
+        const auto& instance = jsonVal[i];
+        glm::vec3 scaling(1, 1, 1);
+        glm::vec3 translation(0, 0, 0);
+        glm::vec3 rotation(0, 0, 0);
+        std::string name = "Instance " + std::to_string(i);
+
+        for(auto m = instance.MemberBegin(); m < instance.MemberEnd(); m++)
+        {
+            std::string key(m->name.GetString());
+            if(key == "name")
+            {
+                if(m->value.IsString() == false)
+                {
+                    return false;
+                }
+                name = std::string(m->value.GetString());
+            }
+            else if(key == "translation")
+            {
+                if(getDomFloatVec3(m->value, translation) == false)
+                {
+                    return false;
+                }
+            }
+            else if(key == "scaling")
+            {
+                if(getDomFloatVec3(m->value, scaling) == false)
+                {
+                    return false;
+                }
+            }
+            else if(key == "rotation")
+            {
+                if(getDomFloatVec3(m->value, rotation) == false)
+                {
+                    return false;
+                }
+                rotation = glm::radians(rotation);
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        if(instanceMap.find(name) != instanceMap.end())
+        {
+            return false;
+        }
+        auto pInstance = Scene::ModelInstance::create(pModel, translation, rotation, scaling, name);
+        if(pInstance == nullptr)
+        {
+            return false;
+        }
+        instanceMap[pInstance->getName()] = pInstance;
+        scene.addModelInstance(pInstance);
+    }
+    return true;
+}
+
+/** Samples the memory used by the process on a separate thread, and keeps the peak growth since the sampler was started
+*/
+class PeakMemorySampler
+{
+public:
+    PeakMemorySampler() : mStartMemory(getProcessUsedVirtualMemory()), mPeakMemory(mStartMemory), mStop(false)
+    {
+        mThread = std::thread([this]()
+        {
+            while(mStop.load() == false)
+            {
+                sample();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+    }
+
+    /** Stop sampling
+        \return The peak growth, in MB
+    */
+    double stop()
+    {
+        mStop = true;
+        mThread.join();
+        sample();
+        return double(mPeakMemory - mStartMemory) / (1024 * 1024);
+    }
+
+private:
+    void sample()
+    {
+        mPeakMemory = std::max(mPeakMemory, getProcessUsedVirtualMemory());
+    }
+
+    uint64_t mStartMemory;
+    uint64_t mPeakMemory;
+    std::atomic<bool> mStop;
+    std::thread mThread;
+};
+
+void SceneImporterTest::addTests()
+{
+    addTestToList<TestInstancesMatchDom>();
+    addTestToList<TestParseThroughput>();
+    addTestToList<TestParallelLoadDeterminism>();
+}
+
+void SceneImporterTest::onInit()
+{
+    // Every load has to parse the scene file
+    SceneSnapshot::setEnabled(false);
+
+    std::ofstream modelFile(kModelFile);
+    modelFile << "v 0 0 0\nv 1 0 0\nv 0 1 0\nvn 0 0 1\nf 1//1 2//1 3//1\n";
+    modelFile.close();
+
+    writeScene(kSmallSceneFile, kModelFile, 2, kSmallInstanceCount);
+    writeScene(kLargeSceneFile, kModelFile, 1, kLargeInstanceCount);
+
+    Model::SharedPtr pModel = Model::create();
+    for(uint32_t i = 0; i < kBinaryMeshCount; i++)
+    {
+        pModel->addMeshInstance(TestHelper::createGridMesh(i, kGridSize), glm::mat4());
+    }
+    pModel->exportToBinaryFile(kBinaryModelFile);
+
+    // The binary model is referenced several times, by both files. Entries with the same name share the model, and all of them share the meshes
+    std::ofstream sceneFile(kModelsSceneFile);
+    sceneFile << "{\n    \"version\": 2,\n    \"models\": [\n";
+    sceneFile << "        { \"file\": \"" << kBinaryModelFile << "\", \"name\": \"Grid\", \"instances\": [ { \"name\": \"Grid 0\" }, { \"name\": \"Grid 1\", \"translation\": [10, 0, 0] } ] },\n";
+    sceneFile << "        { \"file\": \"" << kModelFile << "\", \"name\": \"Triangle\", \"instances\": [ { \"name\": \"Triangle 0\" } ] },\n";
+    sceneFile << "        { \"file\": \"" << kBinaryModelFile << "\", \"name\": \"Grid\", \"instances\": [ { \"name\": \"Grid 2\", \"translation\": [20, 0, 0] } ] },\n";
+    sceneFile << "        { \"file\": \"" << kBinaryModelFile << "\", \"name\": \"Grid Copy\", \"instances\": [ { \"name\": \"Grid Copy 0\", \"translation\": [0, 10, 0] } ] },\n";
+    sceneFile << "        { \"file\": \"" << kModelFile << "\", \"name\": \"Triangle\", \"instances\": [ { \"name\": \"Triangle 1\", \"translation\": [0, 20, 0] } ] }\n";
+    sceneFile << "    ],\n    \"include\": [ \"" << kIncludeSceneFile << "\" ]\n}\n";
+    sceneFile.close();
+
+    std::ofstream includeFile(kIncludeSceneFile);
+    includeFile << "{\n    \"version\": 2,\n    \"models\": [\n";
+    includeFile << "        { \"file\": \"" << kBinaryModelFile << "\", \"name\": \"Grid\", \"instances\": [ { \"name\": \"Included Grid 0\", \"translation\": [30, 0, 0] } ] },\n";
+    includeFile << "        { \"file\": \"" << kModelFile << "\", \"name\": \"Included Triangle\", \"instances\": [ { \"name\": \"Included Triangle 0\" } ] }\n";
+    includeFile << "    ]\n}\n";
+    includeFile.close();
+}
+
+testing_func(SceneImporterTest, TestInstancesMatchDom)
+{
+    Scene::SharedPtr pScene = Scene::loadFromFile(kSmallSceneFile);
+    rapidjson::Document doc;
+    if(pScene == nullptr || readSceneDom(kSmallSceneFile, doc) == false)
+    {
+        return test_fail("Failed to load the test scene");
+    }
+
+    const auto& jsonModels = doc["models"];
+    if(pScene->getModelCount() != jsonModels.Size())
+    {
+        return test_fail("Scene has the wrong number of models");
+    }
+
+    for(uint32_t m = 0; m < jsonModels.Size(); m++)
+    {
+        const auto& jsonInstances = jsonModels[m]["instances"];
+        if(pScene->getModel(m)->getName() != jsonModels[m]["name"].GetString() || pScene->getModelInstanceCount(m) != jsonInstances.Size())
+        {
+            return test_fail("Model " + std::to_string(m) + " doesn't match the scene file");
+        }
+
+        for(uint32_t i = 0; i < jsonInstances.Size(); i++)
+        {
+            const auto& pInstance = pScene->getModelInstance(m, i);
+            const std::string desc = "Instance " + std::to_string(i) + " of model " + std::to_string(m);
+            if(pInstance->getName() != jsonInstances[i]["name"].GetString())
+            {
+                return test_fail(desc + " has the wrong name");
+            }
+            if(pInstance->getTranslation() != getDomVec(jsonInstances[i], "translation", glm::vec3(0)) || pInstance->getScaling() != getDomVec(jsonInstances[i], "scaling", glm::vec3(1)))
+            {
+                return test_fail(desc + " has the wrong translation or scaling");
+            }
+
+            // The rotation is stored as a look-at frame
+            glm::vec3 yawPitchRoll = glm::radians(getDomVec(jsonInstances[i], "rotation", glm::vec3(0)));
+            glm::mat3 rotation(glm::yawPitchRoll(yawPitchRoll[0], yawPitchRoll[1], yawPitchRoll[2]));
+            glm::vec3 forward = pInstance->getTarget() - pInstance->getTranslation();
+            if(glm::length(pInstance->getUpVector() - rotation[1]) > 1e-4f || glm::length(forward - rotation[2]) > 1e-3f)
+            {
+                return test_fail(desc + " has the wrong rotation");
+            }
+        }
+    }
+    return test_pass();
+}
+
+testing_func(SceneImporterTest, TestParseThroughput)
+{
+    // The first load grows the instance transform store, which keeps its memory. Both measured loads reuse it
+    if(Scene::loadFromFile(kLargeSceneFile) == nullptr)
+    {
+        return test_fail("Failed to load the test scene");
+    }
+
+    // Streaming import
+    PeakMemorySampler streamSampler;
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    Scene::SharedPtr pScene = Scene::loadFromFile(kLargeSceneFile);
+    const float streamTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    const double streamMemory = streamSampler.stop();
+    if(pScene == nullptr || pScene->getModelCount() != 1 || pScene->getModelInstanceCount(0) != kLargeInstanceCount)
+    {
+        return test_fail("Streaming import created the wrong instances");
+    }
+    Model::SharedPtr pModel = pScene->getModel(0);
+    pScene = nullptr;
+
+    // Reference: the previous importer's path for the instances. The file is copied into a string and parsed into a DOM, then the instances are created from it
+    // with the previous SceneImporter::createModelInstances() code. The model is already loaded, which the streaming import gets from the model cache
+    PeakMemorySampler domSampler;
+    start = CpuTimer::getCurrentTimePoint();
+    {
+        rapidjson::Document doc;
+        if(readSceneDom(kLargeSceneFile, doc) == false)
+        {
+            return test_fail("Failed to parse the test scene");
+        }
+        pScene = Scene::create();
+        std::map<std::string, IMovableObject::SharedPtr> instanceMap;
+        if(createDomModelInstances(doc["models"][0u]["instances"], pModel, *pScene, instanceMap) == false)
+        {
+            return test_fail("Previous DOM import failed");
+        }
+    }
+    const float domTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    const double domMemory = domSampler.stop();
+    if(pScene->getModelInstanceCount(0) != kLargeInstanceCount)
+    {
+        return test_fail("Previous DOM import created the wrong instances");
+    }
+
+    const double fileSizeMB = double(getFileSize(kLargeSceneFile)) / (1024 * 1024);
+    std::string perf = TestHelper::formatPerfResult("File size", fileSizeMB, "MB");
+    perf += TestHelper::formatPerfResult("Streaming import time", streamTime, "ms");
+    perf += TestHelper::formatPerfResult("Streaming import throughput", kLargeInstanceCount / (streamTime * 1000), "M instances/s");
+    perf += TestHelper::formatPerfResult("Streaming import peak memory", streamMemory, "MB");
+    perf += TestHelper::formatPerfResult("Previous DOM import time", domTime, "ms");
+    perf += TestHelper::formatPerfResult("Previous DOM import throughput", kLargeInstanceCount / (domTime * 1000), "M instances/s");
+    perf += TestHelper::formatPerfResult("Previous DOM import peak memory", domMemory, "MB");
+    return test_pass_perf(perf);
+}
+
+testing_func(SceneImporterTest, TestParallelLoadDeterminism)
+{
+    // The cache is cleared before every import, so the models are loaded again
+    ModelCache::clear();
+    Scene::SharedPtr pScene = Scene::loadFromFile(kModelsSceneFile, Model::LoadFlags::None, Scene::LoadFlags::DontLoadModelsInParallel);
+    if(pScene == nullptr)
+    {
+        return test_fail("Serial import failed");
+    }
+    if(pScene->getModelCount() != 4)
+    {
+        return test_fail("Serial import didn't share the models referenced several times");
+    }
+    if(sharesBinaryModelMeshes(pScene.get()) == false)
+    {
+        return test_fail("Serial import loaded the binary model more than once");
+    }
+    const std::string serialDesc = describeScene(pScene.get());
+
+    for(uint32_t i = 0; i < kParallelLoadCount; i++)
+    {
+        ModelCache::clear();
+        pScene = Scene::loadFromFile(kModelsSceneFile);
+        if(pScene == nullptr)
+        {
+            return test_fail("Parallel import failed");
+        }
+        if(sharesBinaryModelMeshes(pScene.get()) == false)
+        {
+            return test_fail("Parallel import loaded the binary model more than once");
+        }
+        const std::string desc = describeScene(pScene.get());
+        if(desc != serialDesc)
+        {
+            return test_fail("Parallel import doesn't match the serial import.\nSerial:\n" + serialDesc + "Parallel:\n" + desc);
+        }
+    }
+    return test_pass();
+}
+
+int main()
+{
+    SceneImporterTest sit;
+    sit.init(true);
+    sit.run();
+    return 0;
+}
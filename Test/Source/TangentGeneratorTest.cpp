@@ -0,0 +1,206 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "TangentGeneratorTest.h"
+#include "Graphics/Model/Loaders/TangentGenerator.h"
+#include <random>
+
+// Scalar reference implementation. This is the glm code generateSubmeshTangentData() replaced, the SIMD kernels have to match it bit-for-bit.
+static bool isSpecialFloat(float f)
+{
+    uint32_t d = *(uint32_t*)&f;
+    // Check the exponent
+    d = (d >> 23) & 0xff;
+    return d == 0xff;
+}
+
+template<typename T>
+static const T& getElement(const T* pData, uint32_t stride, uint32_t index)
+{
+    return *(const T*)((const uint8_t*)pData + (size_t)stride * index);
+}
+
+static void generateReferenceTangentData(const uint32_t* pIndices, size_t indexCount, const float* pPositions, uint32_t positionStride, const glm::vec3* pNormals, const glm::vec2* pTexCrd, uint32_t texCrdStride, glm::vec3* pBitangents)
+{
+    const glm::vec3* pPositionData = (const glm::vec3*)pPositions;
+
+    size_t primCount = indexCount / 3;
+    for(size_t primID = 0; primID < primCount; primID++)
+    {
+        glm::vec3 position[3];
+        glm::vec3 normal[3];
+        glm::vec2 uv[3];
+        for(uint32_t i = 0; i < 3; i++)
+        {
+            uint32_t index = pIndices[primID * 3 + i];
+            position[i] = getElement(pPositionData, positionStride, index);
+            normal[i] = pNormals[index];
+            uv[i] = pTexCrd ? getElement(pTexCrd, texCrdStride, index) : glm::vec2(0.f, 0.f);
+        }
+
+        glm::vec3 posDelta[2];
+        posDelta[0] = position[1] - position[0];
+        posDelta[1] = position[2] - position[0];
+
+        glm::vec2 s = uv[1] - uv[0];
+        glm::vec2 t = uv[2] - uv[0];
+        s.y = -s.y;
+        t.y = -t.y;
+
+        glm::vec3 tangent;
+        glm::vec3 bitangent;
+        if((s == glm::vec2(0, 0)) || (t == glm::vec2(0, 0)))
+        {
+            const glm::vec3& n = normal[0];
+            if(glm::abs(n.x) > glm::abs(n.y))
+            {
+                bitangent = glm::vec3(n.z, 0.f, -n.x) / glm::length(glm::vec2(n.x, n.z));
+            }
+            else
+            {
+                bitangent = glm::vec3(0.f, n.z, -n.y) / glm::length(glm::vec2(n.y, n.z));
+            }
+            tangent = glm::cross(bitangent, n);
+        }
+        else
+        {
+            float dirCorrection = (t.x * s.y - t.y * s.x) < 0.0f ? -1.0f : 1.0f;
+            tangent.x = (posDelta[1].x * s.y - posDelta[0].x * t.y) * dirCorrection;
+            tangent.y = (posDelta[1].y * s.y - posDelta[0].y * t.y) * dirCorrection;
+            tangent.z = (posDelta[1].z * s.y - posDelta[0].z * t.y) * dirCorrection;
+
+            bitangent.x = (posDelta[1].x * s.x - posDelta[0].x * t.x) * dirCorrection;
+            bitangent.y = (posDelta[1].y * s.x - posDelta[0].y * t.x) * dirCorrection;
+            bitangent.z = (posDelta[1].z * s.x - posDelta[0].z * t.x) * dirCorrection;
+        }
+
+        for(uint32_t i = 0; i < 3; i++)
+        {
+            glm::vec3 localTangent = tangent - normal[i] * (glm::dot(tangent, normal[i]));
+            localTangent = glm::normalize(localTangent);
+            glm::vec3 localBitangent = bitangent - normal[i] * (glm::dot(bitangent, normal[i]));
+            localBitangent = glm::normalize(localBitangent);
+            localBitangent = localBitangent - localTangent * (glm::dot(localBitangent, localTangent));
+            localBitangent = glm::normalize(localBitangent);
+
+            if(isSpecialFloat(localBitangent.x) || isSpecialFloat(localBitangent.y) || isSpecialFloat(localBitangent.z))
+            {
+                localBitangent = glm::cross(localTangent, normal[i]);
+                localBitangent = glm::normalize(localBitangent);
+            }
+
+            pBitangents[pIndices[primID * 3 + i]] = localBitangent;
+        }
+    }
+}
+
+// Generate a random mesh, including the degenerate cases the kernels handle with masks: zero normals and coincident texture coordinates.
+// Positions are stored as vec4 to exercise the position stride.
+// Returns true if the SIMD output matches the reference bit-for-bit.
+static bool compareRandomMesh(std::mt19937& rng, uint32_t vertexCount, uint32_t triangleCount, bool hasTexCrd)
+{
+    std::uniform_real_distribution<float> dist(-1, 1);
+    std::vector<glm::vec4> positions(vertexCount);
+    std::vector<glm::vec3> normals(vertexCount);
+    std::vector<glm::vec2> texCrds(vertexCount);
+    for(uint32_t i = 0; i < vertexCount; i++)
+    {
+        positions[i] = glm::vec4(dist(rng), dist(rng), dist(rng), 1);
+        normals[i] = (rng() % 7 == 0) ? glm::vec3(0, 0, float(rng() % 2)) : glm::vec3(dist(rng), dist(rng), dist(rng));
+        texCrds[i] = (rng() % 5 == 0) ? glm::vec2(0, 0) : glm::vec2(dist(rng), dist(rng));
+    }
+
+    std::vector<uint32_t> indices(triangleCount * 3);
+    for(auto& index : indices)
+    {
+        index = rng() % vertexCount;
+    }
+
+    // Unreferenced vertices keep their initial value in both outputs
+    std::vector<glm::vec3> reference(vertexCount, glm::vec3(7));
+    std::vector<glm::vec3> result(vertexCount, glm::vec3(7));
+    const glm::vec2* pTexCrd = hasTexCrd ? texCrds.data() : nullptr;
+    generateReferenceTangentData(indices.data(), indices.size(), (const float*)positions.data(), sizeof(glm::vec4), normals.data(), pTexCrd, sizeof(glm::vec2), reference.data());
+    generateSubmeshTangentData(indices.data(), indices.size(), (const float*)positions.data(), sizeof(glm::vec4), normals.data(), pTexCrd, sizeof(glm::vec2), result.data());
+    return memcmp(reference.data(), result.data(), vertexCount * sizeof(glm::vec3)) == 0;
+}
+
+void TangentGeneratorTest::addTests()
+{
+    addTestToList<TestSmallMeshes>();
+    addTestToList<TestLargeMeshes>();
+    addTestToList<TestMissingTexCoords>();
+}
+
+testing_func(TangentGeneratorTest, TestSmallMeshes)
+{
+    // Triangle counts which are not a multiple of the SIMD width test the partially filled last batch
+    std::mt19937 rng(1);
+    for(uint32_t i = 0; i < 50; i++)
+    {
+        if(compareRandomMesh(rng, 1 + rng() % 500, rng() % 1000, true) == false)
+        {
+            return test_fail("Bitangents don't match the scalar reference");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(TangentGeneratorTest, TestLargeMeshes)
+{
+    // Large meshes are split between threads
+    std::mt19937 rng(2);
+    for(uint32_t i = 0; i < 5; i++)
+    {
+        if(compareRandomMesh(rng, 20000 + rng() % 100000, 40000 + rng() % 200000, true) == false)
+        {
+            return test_fail("Bitangents of a multithreaded mesh don't match the scalar reference");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(TangentGeneratorTest, TestMissingTexCoords)
+{
+    std::mt19937 rng(3);
+    for(uint32_t i = 0; i < 10; i++)
+    {
+        if(compareRandomMesh(rng, 1 + rng() % 500, rng() % 1000, false) == false)
+        {
+            return test_fail("Bitangents of a mesh without texture coordinates don't match the scalar reference");
+        }
+    }
+    return test_pass();
+}
+
+int main()
+{
+    TangentGeneratorTest tgt;
+    tgt.init();
+    tgt.run();
+    return 0;
+}
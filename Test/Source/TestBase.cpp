@@ -128,6 +128,10 @@ std::string TestBase::XMLFromTestResult(const TestData& d)
         xml += "\tPassed=\"-1\"\n";
 
     xml += "\tErrorMessage=\"" + d.error + "\"\n";
+    if(d.perfResults.size())
+    {
+        xml += "\tPerfResults=\"" + d.perfResults + "\"\n";
+    }
     xml += "/>\n";
     return xml;
 }
\ No newline at end of file
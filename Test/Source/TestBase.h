@@ -34,6 +34,7 @@ using namespace Falcor;
 #define testing_func(className_, functorName_) TestBase::TestData className_::functorName_::operator()()
 #define test_pass() TestBase::TestData(TestBase::TestResult::Pass, mName);
 #define test_fail(errorMessage_) TestBase::TestData(TestBase::TestResult::Fail, mName, errorMessage_);
+#define test_pass_perf(perfResults_) TestBase::TestData(TestBase::TestResult::Pass, mName, "", perfResults_);
 
 class TestBase
 {
@@ -51,10 +52,13 @@ public:
         TestData(TestResult r, std::string testName) : result(r), testName(testName) {}
         TestData(TestResult r, std::string testName, std::string err) :
             result(r), testName(testName), error(err) {}
+        TestData(TestResult r, std::string testName, std::string err, std::string perf) :
+            result(r), testName(testName), error(err), perfResults(perf) {}
 
         TestResult result;
         std::string testName;
         std::string error;
+        std::string perfResults;    // Benchmark results, written to the log as-is
     };
 
     virtual ~TestBase();
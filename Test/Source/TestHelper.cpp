@@ -89,5 +89,62 @@ namespace Falcor
         {
             return nearCompare(lhs.x, rhs.x) && nearCompare(lhs.y, rhs.y) && nearCompare(lhs.z, rhs.z) && nearCompare(lhs.w, rhs.w);
         }
+
+        std::string formatPerfResult(const std::string& name, double value, const std::string& unit)
+        {
+            char valueStr[64];
+            snprintf(valueStr, arraysize(valueStr), "%.2f", value);
+            return name + ": " + valueStr + " " + unit + "; ";
+        }
+
+        Mesh::SharedPtr createGridMesh(uint32_t meshIdx, uint32_t gridSize)
+        {
+            const uint32_t vertexCount = gridSize * gridSize;
+            std::vector<glm::vec3> positions(vertexCount);
+            std::vector<glm::vec3> normals(vertexCount);
+            std::vector<glm::vec2> texCrds(vertexCount);
+            for(uint32_t y = 0; y < gridSize; y++)
+            {
+                for(uint32_t x = 0; x < gridSize; x++)
+                {
+                    uint32_t v = y * gridSize + x;
+                    texCrds[v] = glm::vec2(x, y) / float(gridSize - 1);
+                    positions[v] = glm::vec3(texCrds[v].x + meshIdx, sin(texCrds[v].x * 6.0f) * cos(texCrds[v].y * 6.0f), texCrds[v].y);
+                    normals[v] = glm::vec3(0, 1, 0);
+                }
+            }
+
+            std::vector<uint32_t> indices;
+            indices.reserve((gridSize - 1) * (gridSize - 1) * 6);
+            for(uint32_t y = 0; y < gridSize - 1; y++)
+            {
+                for(uint32_t x = 0; x < gridSize - 1; x++)
+                {
+                    uint32_t v = y * gridSize + x;
+                    uint32_t quad[] = { v, v + gridSize, v + 1, v + 1, v + gridSize, v + gridSize + 1 };
+                    indices.insert(indices.end(), quad, quad + arraysize(quad));
+                }
+            }
+
+            const std::string names[] = { VERTEX_POSITION_NAME, VERTEX_NORMAL_NAME, VERTEX_TEXCOORD_NAME };
+            const ResourceFormat formats[] = { ResourceFormat::RGB32Float, ResourceFormat::RGB32Float, ResourceFormat::RG32Float };
+            const uint32_t locations[] = { VERTEX_POSITION_LOC, VERTEX_NORMAL_LOC, VERTEX_TEXCOORD_LOC };
+            const void* pData[] = { positions.data(), normals.data(), texCrds.data() };
+
+            VertexLayout::SharedPtr pLayout = VertexLayout::create();
+            Vao::BufferVec vbs;
+            for(uint32_t i = 0; i < arraysize(names); i++)
+            {
+                VertexBufferLayout::SharedPtr pBufferLayout = VertexBufferLayout::create();
+                pBufferLayout->addElement(names[i], 0, formats[i], 1, locations[i]);
+                pLayout->addBufferLayout(i, pBufferLayout);
+                vbs.push_back(Buffer::create(getFormatBytesPerBlock(formats[i]) * vertexCount, Resource::BindFlags::Vertex, Buffer::CpuAccess::Read, pData[i]));
+            }
+            Buffer::SharedPtr pIB = Buffer::create(indices.size() * sizeof(uint32_t), Resource::BindFlags::Index, Buffer::CpuAccess::Read, indices.data());
+
+            BoundingBox box = BoundingBox::fromMinMax(glm::vec3(meshIdx, -1, 0), glm::vec3(meshIdx + 1, 1, 1));
+            Material::SharedPtr pMaterial = Material::create("Grid" + std::to_string(meshIdx));
+            return Mesh::create(vbs, vertexCount, pIB, (uint32_t)indices.size(), pLayout, Vao::Topology::TriangleList, pMaterial, box, false);
+        }
     }
 }
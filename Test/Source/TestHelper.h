@@ -38,5 +38,12 @@ namespace Falcor
         vec4 randVec4ZeroToOne();
         bool nearCompare(const float lhs, const float rhs);
         bool nearVec4(const vec4& lhs, const vec4& rhs);
+        std::string formatPerfResult(const std::string& name, double value, const std::string& unit);
+
+        /** Create a grid mesh with positions, normals and texture coordinates. The buffers are CPU-readable so the mesh can be exported.
+            \param[in] meshIdx Offsets the mesh along the X axis and names its material
+            \param[in] gridSize Number of vertices per side
+        */
+        Mesh::SharedPtr createGridMesh(uint32_t meshIdx, uint32_t gridSize);
     }
 }
@@ -0,0 +1,273 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "VideoEncoderTest.h"
+#include "TestHelper.h"
+#include "Utils/Video/VideoEncoder.h"
+#include "Utils/CpuTimer.h"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+static const uint32_t kWidth = 320;
+static const uint32_t kHeight = 240;
+static const uint32_t kFrameCount = 60;
+
+static VideoEncoder::Desc createDesc(const std::string& filename, VideoEncoder::CodecID codec, uint32_t width, uint32_t height, bool flipY)
+{
+    VideoEncoder::Desc desc;
+    desc.width = width;
+    desc.height = height;
+    desc.codec = codec;
+    desc.flipY = flipY;
+    desc.filename = filename;
+    return desc;
+}
+
+static std::vector<uint8_t> readFile(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// A frame where every pixel has the same color, which is unique to the frame
+static void fillSolidFrame(std::vector<uint8_t>& image, uint32_t frameIdx)
+{
+    for(size_t i = 0; i < image.size(); i += 4)
+    {
+        image[i + 0] = uint8_t(frameIdx * 3);
+        image[i + 1] = uint8_t(255 - frameIdx);
+        image[i + 2] = uint8_t(frameIdx * 7 + 1);
+        image[i + 3] = 255;
+    }
+}
+
+// A row of a solid frame as stored by the raw video codec, which uses BGR24
+static std::vector<uint8_t> getRawRow(uint32_t frameIdx)
+{
+    std::vector<uint8_t> row(kWidth * 3);
+    for(size_t i = 0; i < row.size(); i += 3)
+    {
+        row[i + 0] = uint8_t(frameIdx * 7 + 1);
+        row[i + 1] = uint8_t(255 - frameIdx);
+        row[i + 2] = uint8_t(frameIdx * 3);
+    }
+    return row;
+}
+
+// Find the BGR24 image of the TestFlipY frame. It starts with the frame's first or last row, depending on the order the container stores the rows
+static size_t findRawImage(const std::vector<uint8_t>& file, const std::vector<uint8_t>& firstRow, const std::vector<uint8_t>& lastRow)
+{
+    auto first = std::search(file.begin(), file.end(), firstRow.begin(), firstRow.end());
+    auto last = std::search(file.begin(), file.end(), lastRow.begin(), lastRow.end());
+    return (size_t)(std::min(first, last) - file.begin());
+}
+
+void VideoEncoderTest::addTests()
+{
+    addTestToList<TestRawFramesInOrder>();
+    addTestToList<TestFlipY>();
+    addTestToList<TestCompressedCodecs>();
+    addTestToList<TestAppendThroughput>();
+}
+
+testing_func(VideoEncoderTest, TestRawFramesInOrder)
+{
+    const std::string filename = "VideoEncoderTestRaw.avi";
+    VideoEncoder::UniquePtr pEncoder = VideoEncoder::create(createDesc(filename, VideoEncoder::CodecID::RawVideo, kWidth, kHeight, false));
+    if(pEncoder == nullptr)
+    {
+        return test_fail("Failed to create the encoder");
+    }
+
+    // The frames are copied when they are queued, so the same buffer can be reused for all the frames
+    std::vector<uint8_t> image(kWidth * kHeight * 4);
+    for(uint32_t i = 0; i < kFrameCount; i++)
+    {
+        fillSolidFrame(image, i);
+        pEncoder->appendFrame(image.data());
+    }
+    pEncoder->endCapture();
+    pEncoder = nullptr;
+
+    // The raw codec stores the frames uncompressed, so every frame must be found in the file, in the order it was appended
+    const std::vector<uint8_t> file = readFile(filename);
+    if(file.size() < (size_t)kFrameCount * kWidth * kHeight * 3)
+    {
+        return test_fail("The file is smaller than the frames it should contain");
+    }
+
+    auto pos = file.begin();
+    for(uint32_t i = 0; i < kFrameCount; i++)
+    {
+        std::vector<uint8_t> frame;
+        for(uint32_t y = 0; y < kHeight; y++)
+        {
+            std::vector<uint8_t> row = getRawRow(i);
+            frame.insert(frame.end(), row.begin(), row.end());
+        }
+        pos = std::search(pos, file.end(), frame.begin(), frame.end());
+        if(pos == file.end())
+        {
+            return test_fail("Frame " + std::to_string(i) + " is missing or out of order");
+        }
+        pos += frame.size();
+    }
+    return test_pass();
+}
+
+testing_func(VideoEncoderTest, TestFlipY)
+{
+    // Every row has a different color, so the order of the rows can be checked
+    std::vector<uint8_t> image(kWidth * kHeight * 4);
+    for(uint32_t y = 0; y < kHeight; y++)
+    {
+        for(uint32_t x = 0; x < kWidth; x++)
+        {
+            uint8_t* pPixel = &image[(y * kWidth + x) * 4];
+            pPixel[0] = uint8_t(y == 0 ? 255 : 0);
+            pPixel[1] = uint8_t(y);
+            pPixel[2] = uint8_t(y == kHeight - 1 ? 255 : 0);
+            pPixel[3] = 255;
+        }
+    }
+
+    const std::string filenames[] = { "VideoEncoderTestNoFlip.avi", "VideoEncoderTestFlip.avi" };
+    for(uint32_t flip = 0; flip < 2; flip++)
+    {
+        VideoEncoder::UniquePtr pEncoder = VideoEncoder::create(createDesc(filenames[flip], VideoEncoder::CodecID::RawVideo, kWidth, kHeight, flip != 0));
+        if(pEncoder == nullptr)
+        {
+            return test_fail("Failed to create the encoder");
+        }
+        pEncoder->appendFrame(image.data());
+        pEncoder->endCapture();
+    }
+
+    // The container may store the rows bottom-up, so compare the two files with each other instead of with the input
+    std::vector<uint8_t> firstRow(kWidth * 3);
+    std::vector<uint8_t> lastRow(kWidth * 3);
+    for(uint32_t x = 0; x < kWidth; x++)
+    {
+        firstRow[x * 3 + 2] = 255;
+        lastRow[x * 3 + 0] = 255;
+        lastRow[x * 3 + 1] = uint8_t(kHeight - 1);
+    }
+
+    const size_t rowSize = kWidth * 3;
+    const size_t imageSize = rowSize * kHeight;
+    std::vector<uint8_t> files[2] = { readFile(filenames[0]), readFile(filenames[1]) };
+    size_t offsets[2];
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        offsets[i] = findRawImage(files[i], firstRow, lastRow);
+        if(offsets[i] + imageSize > files[i].size())
+        {
+            return test_fail("The frame wasn't found in " + filenames[i]);
+        }
+    }
+
+    for(uint32_t y = 0; y < kHeight; y++)
+    {
+        const uint8_t* pRow = &files[0][offsets[0] + y * rowSize];
+        const uint8_t* pFlippedRow = &files[1][offsets[1] + (kHeight - 1 - y) * rowSize];
+        if(memcmp(pRow, pFlippedRow, rowSize) != 0)
+        {
+            return test_fail("The flipped frame doesn't match the original frame with its rows reversed");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(VideoEncoderTest, TestCompressedCodecs)
+{
+    // Encode with every codec. flipY is set per encoder, so every other codec flips its frames. The file must be written and the encoder must not hang when the pipeline is drained
+    const VideoEncoder::CodecID codecs[] = { VideoEncoder::CodecID::H264, VideoEncoder::CodecID::HEVC, VideoEncoder::CodecID::MPEG2, VideoEncoder::CodecID::MPEG4 };
+    const std::string filenames[] = { "VideoEncoderTestH264.mp4", "VideoEncoderTestHEVC.mp4", "VideoEncoderTestMPEG2.mkv", "VideoEncoderTestMPEG4.mp4" };
+
+    std::vector<uint8_t> image(kWidth * kHeight * 4);
+    for(uint32_t c = 0; c < arraysize(codecs); c++)
+    {
+        VideoEncoder::UniquePtr pEncoder = VideoEncoder::create(createDesc(filenames[c], codecs[c], kWidth, kHeight, (c & 1) != 0));
+        if(pEncoder == nullptr)
+        {
+            return test_fail("Failed to create the encoder for " + filenames[c]);
+        }
+
+        for(uint32_t i = 0; i < kFrameCount; i++)
+        {
+            fillSolidFrame(image, i);
+            pEncoder->appendFrame(image.data());
+        }
+        pEncoder->endCapture();
+        pEncoder = nullptr;
+
+        if(getFileSize(filenames[c]) == 0)
+        {
+            return test_fail(filenames[c] + " is empty");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(VideoEncoderTest, TestAppendThroughput)
+{
+    // Time spent by the caller in appendFrame(), which is what a capture costs the application, and the total encode time
+    const uint32_t width = 1920;
+    const uint32_t height = 1080;
+    const uint32_t frameCount = 240;
+    VideoEncoder::UniquePtr pEncoder = VideoEncoder::create(createDesc("VideoEncoderTestThroughput.mp4", VideoEncoder::CodecID::H264, width, height, true));
+    if(pEncoder == nullptr)
+    {
+        return test_fail("Failed to create the encoder");
+    }
+
+    std::vector<uint8_t> image(width * height * 4);
+    float appendTime = 0;
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    for(uint32_t i = 0; i < frameCount; i++)
+    {
+        fillSolidFrame(image, i);
+        CpuTimer::TimePoint appendStart = CpuTimer::getCurrentTimePoint();
+        pEncoder->appendFrame(image.data());
+        appendTime += CpuTimer::calcDuration(appendStart, CpuTimer::getCurrentTimePoint());
+    }
+    pEncoder->endCapture();
+    const float totalTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    std::string perf = TestHelper::formatPerfResult("appendFrame", appendTime / frameCount, "ms");
+    perf += TestHelper::formatPerfResult("Encode 1080p", frameCount * 1000 / totalTime, "fps");
+    return test_pass_perf(perf);
+}
+
+int main()
+{
+    VideoEncoderTest vet;
+    vet.init();
+    vet.run();
+    return 0;
+}